@@ -274,7 +274,27 @@ const std::vector<Handler<CommandLineValues>>& CommandLineArgs() {
               L"is disabled (but Edge may still attempt to read previous "
               L"state)."})
           .Set(&CommandLineValues::positions_history_behavior,
-               CommandLineValues::HistoryFileBehavior::kReadOnly)};
+               CommandLineValues::HistoryFileBehavior::kReadOnly),
+
+      Handler<CommandLineValues>(
+          {FlagName{L"trace"}},
+          FlagShortHelp{L"Record a trace of the editor's activity."})
+          .SetHelp(LazyString{
+              L"The `--trace` command-line argument must be followed by a "
+              L"path. Edge will record the operations it executes (in every "
+              L"thread) and, when it exits, write them to that path in the "
+              L"Chrome trace-event format, which you can load in "
+              L"chrome://tracing or https://ui.perfetto.dev.\n\n"
+              L"Only the most recent operations of each thread are retained. "
+              L"You can also control the recording (without this flag) through "
+              L"the `editor.StartTraceRecording`, `editor.StopTraceRecording` "
+              L"and `editor.SaveTrace` functions."})
+          .Require(L"path", L"Path to write the trace to")
+          .Set(&CommandLineValues::trace_path,
+               [](LazyString input) -> ValueOrError<std::optional<Path>> {
+                 DECLARE_OR_RETURN(Path path, Path::New(input));
+                 return Success(std::optional<Path>(path));
+               })};
   return handlers;
 }
 
@@ -338,7 +358,7 @@ LazyString CommandsToRun(CommandLineValues args) {
             LazyString{FromByteString(getenv(kEdgeParentAddress))})
             .CppRepresentation()
             .read() +
-        LazyString{L");\n"};
+        LazyString{L", \"binary,vm\");\n"};
     start_shell = false;
   } else if (args.nested_edge_behavior ==
              CommandLineValues::NestedEdgeBehavior::kWaitForClose) {
@@ -75,6 +75,10 @@ struct CommandLineValues : public command_line_arguments::StandardArguments {
   HistoryFileBehavior prompt_history_behavior = HistoryFileBehavior::kUpdate;
 
   HistoryFileBehavior positions_history_behavior = HistoryFileBehavior::kUpdate;
+
+  // If present, record a trace of the editor's activity (from the start) and
+  // write it to this path when the editor exits.
+  std::optional<infrastructure::Path> trace_path = {};
 };
 
 const std::vector<afc::command_line_arguments::Handler<CommandLineValues>>&
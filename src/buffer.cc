@@ -1,5 +1,6 @@
 #include "src/buffer.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <cstring>
 #include <iostream>
@@ -31,6 +32,7 @@ extern "C" {
 #include "src/futures/futures.h"
 #include "src/infrastructure/dirname.h"
 #include "src/infrastructure/file_descriptor_reader.h"
+#include "src/infrastructure/memory_mapped_file.h"
 #include "src/infrastructure/regular_file_adapter.h"
 #include "src/infrastructure/time.h"
 #include "src/infrastructure/tracker.h"
@@ -85,6 +87,9 @@ using afc::infrastructure::AddSeconds;
 using afc::infrastructure::FileAdapter;
 using afc::infrastructure::FileDescriptor;
 using afc::infrastructure::FileSystemDriver;
+using afc::infrastructure::FsyncPolicy;
+using afc::infrastructure::LinesFromMemoryMappedFile;
+using afc::infrastructure::MemoryMappedFile;
 using afc::infrastructure::Now;
 using afc::infrastructure::Path;
 using afc::infrastructure::PathComponent;
@@ -319,6 +324,11 @@ class OpenBufferMutableLineSequenceObserver
 
   void InsertedCharacter(LineColumn) override { Notify(); }
 
+  void InsertedCharacters(const std::vector<LineColumn>&,
+                          ColumnNumberDelta) override {
+    Notify();
+  }
+
   void Notify(bool update_disk_state = true) {
     std::optional<gc::Root<OpenBuffer>> root_this = buffer_.Lock();
     if (!root_this.has_value()) return;
@@ -382,7 +392,8 @@ OpenBuffer::OpenBuffer(ConstructorAccessTag, Options options,
       contents_(MakeNonNullShared<DelegatingMutableLineSequenceObserver>(
           std::vector<NonNull<std::shared_ptr<MutableLineSequenceObserver>>>(
               {contents_observer_,
-               cursors_tracker_.NewMutableLineSequenceObserver()}))),
+               cursors_tracker_.NewMutableLineSequenceObserver(),
+               search_index_->NewMutableLineSequenceObserver()}))),
       default_commands_(std::move(default_commands)),
       mode_(std::move(mode)),
       status_(std::move(status)),
@@ -630,8 +641,12 @@ futures::Value<PossibleError> OpenBuffer::PersistState() const {
       .Transform([serialized_state = SerializeState(position(), variables_),
                   file_system_driver = execution_context_->file_system_driver(),
                   &editor = editor(),
-                  weak_status = std::weak_ptr<Status>(status_.get_shared())](
-                     Path edge_state_directory) {
+                  weak_status = std::weak_ptr<Status>(status_.get_shared()),
+                  root_this = RootFromThis()](Path edge_state_directory) {
+        root_this->buffer_syntax_parser_.SaveCache(
+            file_system_driver,
+            Path::Join(edge_state_directory,
+                       PathComponent::FromString(L".edge_parse_cache")));
         Path path = Path::Join(edge_state_directory,
                                PathComponent::FromString(L".edge_state"));
         LOG(INFO) << "PersistState: Preparing state file: " << path;
@@ -642,8 +657,8 @@ futures::Value<PossibleError> OpenBuffer::PersistState() const {
                               LineSequence{};
         return futures::OnError(
             SaveContentsToFile(path, header + serialized_state,
-                               editor.thread_pool(),
-                               file_system_driver.value()),
+                               editor.thread_pool(), file_system_driver.value(),
+                               FsyncPolicy::kSkip),
             [weak_status](Error error) {
               error = AugmentError(LazyString{L"Unable to persist state"},
                                    std::move(error));
@@ -665,6 +680,7 @@ void OpenBuffer::ClearContents() {
                                                      name());
   contents_.EraseLines(LineNumber(0), LineNumber(0) + contents_.size(),
                        MutableLineSequence::ObserverBehavior::kHide);
+  search_index_->Invalidate();
   file_adapter_->SetPositionToZero();
   undo_state_.Clear();
 }
@@ -809,6 +825,20 @@ void OpenBuffer::UpdateTreeParser() {
                         ? IdentifierBehavior::kColorByHash
                         : IdentifierBehavior::kNone,
                 .dictionary = std::move(dictionary)});
+        if (root_this->Read(buffer_variables::persist_state))
+          std::visit(
+              overload{IgnoreErrors{},
+                       [&](std::list<PathComponent> components) {
+                         Path path = root_this->editor().edge_path()[0];
+                         for (const PathComponent& component : components)
+                           path = Path::Join(path, component);
+                         root_this->buffer_syntax_parser_.LoadCache(
+                             root_this->file_system_driver(),
+                             root_this->editor().thread_pool(),
+                             Path::Join(path, PathComponent::FromString(
+                                                  L".edge_parse_cache")));
+                       }},
+              root_this->EdgeStateDirectoryComponents());
         root_this->MaybeStartUpdatingSyntaxTrees();
         return EmptyValue();
       });
@@ -1101,9 +1131,10 @@ futures::Value<PossibleError> OpenBuffer::Save(Options::SaveType save_type) {
       });
 }
 
-futures::ValueOrError<Path> OpenBuffer::GetEdgeStateDirectory() const {
-  auto path_vector = editor().edge_path();
-  if (path_vector.empty()) return Error{LazyString{L"Empty edge path."}};
+ValueOrError<std::list<PathComponent>>
+OpenBuffer::EdgeStateDirectoryComponents() const {
+  if (editor().edge_path().empty())
+    return Error{LazyString{L"Empty edge path."}};
   DECLARE_OR_RETURN(
       Path file_path,
       AugmentError(
@@ -1126,8 +1157,13 @@ futures::ValueOrError<Path> OpenBuffer::GetEdgeStateDirectory() const {
                                  file_path.DirectorySplit()));
 
   file_path_components.push_front(EditorState::StatePathComponent());
+  return file_path_components;
+}
 
-  auto path = std::make_shared<Path>(path_vector[0]);
+futures::ValueOrError<Path> OpenBuffer::GetEdgeStateDirectory() const {
+  DECLARE_OR_RETURN(std::list<PathComponent> file_path_components,
+                    EdgeStateDirectoryComponents());
+  auto path = std::make_shared<Path>(editor().edge_path()[0]);
   auto error = std::make_shared<std::optional<Error>>();
   LOG(INFO) << "GetEdgeStateDirectory: Preparing state directory: " << *path;
   return futures::ForEachWithCopy(
@@ -1986,11 +2022,48 @@ futures::Value<PossibleError> OpenBuffer::SetInputFromPath(
       .Transform([buffer = RootFromThis(),
                   path](FileDescriptor fd) -> futures::Value<PossibleError> {
         LOG(INFO) << path << ": Opened file descriptor: " << fd;
+        if (buffer->Read(buffer_variables::load_with_mmap))
+          return buffer->LoadMemoryMappedFile(fd);
         return buffer->SetInputFiles(fd, std::nullopt, false,
                                      std::optional<ProcessId>());
       });
 }
 
+futures::Value<EmptyValue> OpenBuffer::LoadMemoryMappedFile(
+    FileDescriptor fd) {
+  return editor()
+      .thread_pool()
+      .Run([fd] -> std::optional<std::vector<Line>> {
+        return std::visit(
+            overload{[](NonNull<std::shared_ptr<const MemoryMappedFile>> file)
+                         -> std::optional<std::vector<Line>> {
+                       return LinesFromMemoryMappedFile(std::move(file));
+                     },
+                     [fd](Error error) -> std::optional<std::vector<Line>> {
+                       LOG(INFO) << fd << ": Unable to map file: " << error;
+                       return std::nullopt;
+                     }},
+            MemoryMappedFile::New(fd));
+      })
+      .Transform([buffer = RootFromThis(),
+                  fd](std::optional<std::vector<Line>> lines)
+                     -> futures::Value<EmptyValue> {
+        if (!lines.has_value())
+          return buffer->SetInputFiles(fd, std::nullopt, false,
+                                       std::optional<ProcessId>());
+        buffer->file_system_driver()->Close(fd);
+        // These changes don't count: they come from disk.
+        auto disk_state_freezer = buffer->FreezeDiskState();
+        auto follower = buffer->GetEndPositionFollower();
+        buffer->AppendToLastLine(lines->front());
+        buffer->AppendLines(
+            std::vector<Line>(std::make_move_iterator(lines->begin() + 1),
+                              std::make_move_iterator(lines->end())),
+            MutableLineSequence::ObserverBehavior::kHide);
+        return EmptyValue{};
+      });
+}
+
 const FileDescriptorReader* OpenBuffer::fd() const { return fd_.get(); }
 
 const FileDescriptorReader* OpenBuffer::fd_error() const {
@@ -2450,7 +2523,11 @@ futures::Value<EmptyValue> OpenBuffer::ApplyToCursors(
       .cursors = active_cursors(), .active = position()});
 
   std::optional<futures::Value<EmptyValue>> transformation_result;
-  if (cursors_affected == Modifiers::CursorsAffected::kAll) {
+  if (cursors_affected == Modifiers::CursorsAffected::kAll &&
+      mode == transformation::Input::Mode::kFinal &&
+      ApplyInsertToAllCursors(transformation)) {
+    transformation_result = futures::Past(EmptyValue());
+  } else if (cursors_affected == Modifiers::CursorsAffected::kAll) {
     CursorsSet single_cursor;
     CursorsSet& cursors = active_cursors();
     transformation_result = cursors_tracker_.ApplyTransformationToCursors(
@@ -2490,6 +2567,64 @@ futures::Value<EmptyValue> OpenBuffer::ApplyToCursors(
       });
 }
 
+bool OpenBuffer::ApplyInsertToAllCursors(
+    const transformation::Variant& transformation) {
+  const transformation::Insert* insert =
+      std::get_if<transformation::Insert>(&transformation);
+  if (insert == nullptr || insert->position.has_value() ||
+      insert->final_position != transformation::Insert::FinalPosition::kEnd ||
+      insert->modifiers.insertion != Modifiers::ModifyMode::kShift ||
+      insert->contents_to_insert.size() != LineNumberDelta(1) ||
+      insert->contents_to_insert.CountCharacters() == 0)
+    return false;
+
+  const CursorsSet& cursors = active_cursors();
+  if (cursors.size() < 2) return false;
+  std::vector<LineColumn> positions(cursors.begin(), cursors.end());
+  // Cursors past the end of their lines would first have to be moved back.
+  if (!std::ranges::all_of(positions, [this](LineColumn position) {
+        return contents_.AdjustLineColumn(position) == position;
+      }))
+    return false;
+
+  TRACK_OPERATION(OpenBuffer_ApplyInsertToAllCursors);
+  LineBuilder text;
+  for (size_t i = 0; i < insert->modifiers.repetitions.value_or(1); i++)
+    text.Append(LineBuilder(insert->contents_to_insert.at(LineNumber(0))));
+  if (insert->modifiers_set.has_value())
+    text.SetAllModifiers(insert->modifiers_set.value());
+  const ColumnNumberDelta length = text.EndColumn().ToDelta();
+  contents_.InsertInPositions(positions, std::move(text).Build());
+
+  // The undo entry deletes the inserted texts starting with the last one, so
+  // that the positions of the others remain valid.
+  transformation::Stack undo_stack;
+  std::optional<LineNumber> last_line;
+  ColumnNumberDelta shift;
+  for (const LineColumn& position : positions) {
+    if (position.line != last_line) {
+      SetMutableLineSequenceLineMetadata(*this, line_processor_map_, contents_,
+                                         position.line);
+      last_line = position.line;
+      shift = ColumnNumberDelta();
+    }
+    undo_stack.push_front(TransformationAtPosition(
+        LineColumn(position.line, position.column + shift),
+        transformation::GetCharactersDeleteOptions(
+            static_cast<size_t>(length.read()))));
+    shift += length;
+  }
+
+  editor().StartHandlingInterrupts();
+  last_transformation_ = transformation;
+  NonNull<std::shared_ptr<transformation::Stack>> undo = undo_state_.Current();
+  undo->push_front(std::move(undo_stack));
+  *undo = transformation::Stack{.stack = {OptimizeBase(std::move(*undo))}};
+  undo_state_.SetCurrentModifiedBuffer();
+  UpdateLastAction();
+  return true;
+}
+
 futures::Value<typename transformation::Result> OpenBuffer::Apply(
     transformation::Variant transformation, LineColumn position,
     transformation::Input::Mode mode) {
@@ -5,6 +5,7 @@
 
 #include <condition_variable>
 #include <iterator>
+#include <list>
 #include <map>
 #include <memory>
 #include <vector>
@@ -35,6 +36,7 @@
 #include "src/line_marks.h"
 #include "src/log.h"
 #include "src/parse_tree.h"
+#include "src/search_index.h"
 #include "src/status.h"
 #include "src/transformation.h"
 #include "src/transformation_input.h"
@@ -292,6 +294,12 @@ class OpenBuffer : public language::gc::EnableRootFromThis<OpenBuffer> {
   // contents() is empty).
   void CheckPosition();
 
+  // Index of the matches of the last search in this buffer (see
+  // `SearchIndex`).
+  const language::NonNull<std::shared_ptr<SearchIndex>>& search_index() const {
+    return search_index_;
+  }
+
   infrastructure::screen::CursorsSet& FindOrCreateCursors(
       const std::wstring& name);
   // May return nullptr.
@@ -562,6 +570,12 @@ class OpenBuffer : public language::gc::EnableRootFromThis<OpenBuffer> {
   futures::Value<transformation::Result> Apply(
       transformation::Variant transformation,
       language::text::LineColumn position, transformation::Input::Mode mode);
+
+  // If `transformation` inserts text without line breaks and there are
+  // multiple active cursors, inserts it at all of them at once (modifying each
+  // line once and pushing a single undo entry) and returns true. Otherwise
+  // returns false without doing anything.
+  bool ApplyInsertToAllCursors(const transformation::Variant& transformation);
   void UpdateTreeParser();
 
   // Returns true if the position given is set to a value other than
@@ -573,11 +587,23 @@ class OpenBuffer : public language::gc::EnableRootFromThis<OpenBuffer> {
   // Signal that EndOfFile was received in both fd_ and fd_error_.
   void SignalEndOfFile();
 
+  // Loads the contents of `fd` by mapping them into memory (see
+  // `buffer_variables::load_with_mmap`). If that fails (e.g., because `fd`
+  // isn't a regular file), falls back to `SetInputFiles`.
+  futures::Value<language::EmptyValue> LoadMemoryMappedFile(
+      infrastructure::FileDescriptor fd);
+
   SeekInput NewSeekInput(Structure structure, Direction direction,
                          language::text::LineColumn* position) const;
   void OnCursorMove();
   void UpdateBackup();
 
+  // Returns the components of the path that `GetEdgeStateDirectory` returns,
+  // relative to the first directory in the edge path. Doesn't create any
+  // directories.
+  language::ValueOrError<std::list<infrastructure::PathComponent>>
+  EdgeStateDirectoryComponents() const;
+
   const Options options_;
   const language::NonNull<std::unique_ptr<transformation::Input::Adapter>>
       transformation_adapter_;
@@ -622,6 +648,8 @@ class OpenBuffer : public language::gc::EnableRootFromThis<OpenBuffer> {
 
   infrastructure::screen::CursorsTracker cursors_tracker_;
 
+  const language::NonNull<std::shared_ptr<SearchIndex>> search_index_;
+
   language::NonNull<std::shared_ptr<OpenBufferMutableLineSequenceObserver>>
       contents_observer_;
 
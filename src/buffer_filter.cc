@@ -2,6 +2,10 @@
 
 #include <glog/logging.h>
 
+#include <atomic>
+#include <condition_variable>
+
+#include "src/concurrent/protected.h"
 #include "src/infrastructure/dirname.h"
 #include "src/infrastructure/tracker.h"
 #include "src/language/container.h"
@@ -16,6 +20,8 @@
 
 namespace container = afc::language::container;
 
+using afc::concurrent::ProtectedWithCondition;
+using afc::concurrent::ThreadPool;
 using afc::futures::DeleteNotification;
 using afc::infrastructure::Path;
 using afc::infrastructure::screen::LineModifier;
@@ -23,6 +29,8 @@ using afc::infrastructure::screen::LineModifierSet;
 using afc::language::Error;
 using afc::language::IgnoreErrors;
 using afc::language::IsError;
+using afc::language::MakeNonNullShared;
+using afc::language::NonNull;
 using afc::language::overload;
 using afc::language::ValueOrDie;
 using afc::language::ValueOrError;
@@ -39,6 +47,7 @@ using afc::language::lazy_string::ToLazyString;
 using afc::language::text::Line;
 using afc::language::text::LineBuilder;
 using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
 using afc::language::text::LineSequence;
 using afc::vm::EscapedMap;
 using afc::vm::EscapedString;
@@ -309,81 +318,163 @@ std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+void HistoryIndex::Update(const LineSequence& history) {
+  TRACK_OPERATION(FilterSortBuffer_HistoryIndex_Update);
+  if (!lines_parsed_.IsZero() &&
+      (history.size() < lines_parsed_ || history.front() != first_line_ ||
+       history.at(LineNumber() + lines_parsed_ - LineNumberDelta(1)) !=
+           last_line_)) {
+    LOG(INFO) << "History doesn't extend the lines parsed; starting over.";
+    *this = HistoryIndex();
+  }
+  VLOG(5) << "Parsing history lines: " << lines_parsed_ << " to "
+          << history.size();
+  for (LineNumber line = LineNumber() + lines_parsed_;
+       line.ToDelta() < history.size(); ++line)
+    Add(history.at(line));
+  if (lines_parsed_.IsZero()) first_line_ = history.front();
+  lines_parsed_ = history.size();
+  last_line_ = history.back();
+}
+
+const std::vector<HistoryIndex::Entry>& HistoryIndex::entries() const {
+  return entries_;
+}
+
+const std::vector<Error>& HistoryIndex::errors() const { return errors_; }
+
+void HistoryIndex::Add(const Line& line) {
+  TRACK_OPERATION(FilterSortBuffer_HistoryIndex_Add);
+  VLOG(8) << "Considering line: " << line.contents();
+  auto warn_if = [&](bool condition, Error error) {
+    if (condition) {
+      // We don't use AugmentError because we'd rather append to the end of the
+      // description, not the beginning.
+      Error wrapper_error{error.read() + LazyString{L": "} +
+                          line.contents().read()};
+      VLOG(5) << "Found error: " << wrapper_error;
+      errors_.push_back(wrapper_error);
+    }
+    return condition;
+  };
+  if (line.empty()) return;
+  ValueOrError<std::multimap<Identifier, EscapedString>> line_keys_or_error =
+      ParseBufferLine(line);
+  auto* line_keys = std::get_if<0>(&line_keys_or_error);
+  if (line_keys == nullptr) {
+    errors_.push_back(GetError(line_keys_or_error));
+    return;
+  }
+  auto range = line_keys->equal_range(HistoryIdentifierValue());
+  int value_count = std::distance(range.first, range.second);
+  if (warn_if(value_count == 0,
+              Error{LazyString{L"Line is missing `value` section"}}) ||
+      warn_if(value_count != 1,
+              Error{LazyString{L"Line has multiple `value` sections"}}))
+    return;
+
+  EscapedString history_value = range.first->second;
+  math::naive_bayes::Event event(
+      ToLazyString(history_value.EscapedRepresentation()));
+  auto [it, inserted] = entry_by_event_.insert({event, entries_.size()});
+  if (inserted)
+    entries_.push_back(Entry{
+        .event = event,
+        .tokens = ExtendTokensToEndOfString(
+            history_value.EscapedRepresentation(),
+            TokenizeNameForPrefixSearches(
+                history_value.EscapedRepresentation()))});
+
+  math::naive_bayes::FeaturesSet features;
+  for (auto& [key, value] : *line_keys)
+    if (key != HistoryIdentifierValue())
+      features.insert(math::naive_bayes::Feature(
+          ToLazyString(key) + LazyString{L":"} +
+          ToLazyString(value.EscapedRepresentation())));
+  entries_[it->second].features.push_back(std::move(features));
+}
+
+namespace {
+// Helpers that `MatchEntries` schedules in the thread pool, which may only
+// start running once `MatchEntries` has returned (e.g., if it runs in the
+// pool, all of whose threads are busy). `MatchEntries` waits only for the
+// helpers that have started; those that start after `done` is set return
+// without touching its data.
+struct MatchEntriesHelpers {
+  size_t active = 0;
+  bool done = false;
+};
+
+// Returns, for each entry in `entries`, the positions of `filter_tokens` in its
+// value (or std::nullopt if it doesn't match). Returns an empty vector if
+// `abort_value` is notified.
+std::vector<std::optional<std::vector<Token>>> MatchEntries(
+    const std::vector<Token>& filter_tokens,
+    const std::vector<HistoryIndex::Entry>& entries,
+    const std::optional<NonNull<std::shared_ptr<ThreadPool>>>& thread_pool,
+    const DeleteNotification::Value& abort_value) {
+  TRACK_OPERATION(FilterSortBuffer_MatchEntries);
+  // Checking `abort_value` requires a lock, so we only do it once per chunk.
+  static constexpr size_t kEntriesPerChunk = 4096;
+  const size_t chunks =
+      (entries.size() + kEntriesPerChunk - 1) / kEntriesPerChunk;
+  std::vector<std::optional<std::vector<Token>>> output(entries.size());
+  struct State {
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<bool> aborted = false;
+    ProtectedWithCondition<MatchEntriesHelpers> helpers =
+        ProtectedWithCondition<MatchEntriesHelpers>(MatchEntriesHelpers{});
+  };
+  auto state = std::make_shared<State>();
+  auto match_chunks = [&filter_tokens, &entries, &abort_value, &output,
+                       chunks](State& data) {
+    for (size_t chunk = data.next_chunk++; chunk < chunks && !data.aborted;
+         chunk = data.next_chunk++) {
+      if (abort_value.has_value()) {
+        data.aborted = true;
+        return;
+      }
+      const size_t begin = chunk * kEntriesPerChunk;
+      const size_t end = std::min(entries.size(), begin + kEntriesPerChunk);
+      for (size_t i = begin; i < end; i++)
+        output[i] = FindFilterPositions(filter_tokens, entries[i].tokens);
+    }
+  };
+  if (thread_pool.has_value())
+    for (size_t i = 1; i < std::min(chunks, thread_pool->value().size()); i++)
+      thread_pool->value().RunIgnoringResult([state, match_chunks] {
+        if (!state->helpers.lock(
+                [](MatchEntriesHelpers& helpers, std::condition_variable&) {
+                  if (helpers.done) return false;
+                  helpers.active++;
+                  return true;
+                }))
+          return;
+        match_chunks(*state);
+        state->helpers.lock([](MatchEntriesHelpers& helpers,
+                               std::condition_variable& condition) {
+          helpers.active--;
+          condition.notify_all();
+        });
+      });
+  match_chunks(*state);
+  state->helpers.lock(
+      [](MatchEntriesHelpers& helpers, std::condition_variable&) {
+        helpers.done = true;
+      });
+  state->helpers.wait(
+      [](MatchEntriesHelpers& helpers) { return helpers.active == 0; });
+  if (state->aborted) return {};
+  return output;
+}
+}  // namespace
+
 FilterSortBufferOutput FilterSortBuffer(FilterSortBufferInput input) {
   VLOG(4) << "Start matching: " << input.history.size();
   TRACK_OPERATION(FilterSortBuffer);
   FilterSortBufferOutput output;
 
   if (input.abort_value.has_value()) return output;
-  // Sets of features for each unique `value` value in the history.
-  math::naive_bayes::History history_data;
-  // Tokens by parsing the `value` value in the history.
-  std::unordered_map<math::naive_bayes::Event, std::vector<Token>>
-      history_value_tokens;
-  std::vector<Token> filter_tokens = TokenizeBySpaces(input.filter);
-  input.history.EveryLine([&](LineNumber, const Line& line) {
-    TRACK_OPERATION(FilterSortBuffer_Input_History_EveryLine);
-    VLOG(8) << "Considering line: " << line.contents();
-    auto warn_if = [&](bool condition, Error error) {
-      if (condition) {
-        // We don't use AugmentError because we'd rather append to the
-        // end of the description, not the beginning.
-        Error wrapper_error{error.read() + LazyString{L": "} +
-                            line.contents().read()};
-        VLOG(5) << "Found error: " << wrapper_error;
-        output.errors.push_back(wrapper_error);
-      }
-      return condition;
-    };
-    if (line.empty()) return !input.abort_value.has_value();
-    ValueOrError<std::multimap<Identifier, EscapedString>> line_keys_or_error =
-        ParseBufferLine(line);
-    auto* line_keys = std::get_if<0>(&line_keys_or_error);
-    if (line_keys == nullptr) {
-      output.errors.push_back(GetError(line_keys_or_error));
-      return !input.abort_value.has_value();
-    }
-    auto range = line_keys->equal_range(HistoryIdentifierValue());
-    int value_count = std::distance(range.first, range.second);
-    if (warn_if(value_count == 0,
-                Error{LazyString{L"Line is missing `value` section"}}) ||
-        warn_if(value_count != 1,
-                Error{LazyString{L"Line has multiple `value` sections"}})) {
-      return !input.abort_value.has_value();
-    }
-
-    EscapedString history_value = range.first->second;
-    VLOG(8) << "Considering history value: " << history_value;
-    std::vector<Token> line_tokens = ExtendTokensToEndOfString(
-        history_value.EscapedRepresentation(),
-        TokenizeNameForPrefixSearches(history_value.EscapedRepresentation()));
-    math::naive_bayes::Event event_key(
-        ToLazyString(history_value.EscapedRepresentation()));
-    std::vector<math::naive_bayes::FeaturesSet>* features_output = nullptr;
-    if (filter_tokens.empty()) {
-      VLOG(6) << "Accepting value (empty filters): " << line.contents();
-      features_output = &history_data[event_key];
-    } else if (auto match = FindFilterPositions(filter_tokens, line_tokens);
-               match.has_value()) {
-      VLOG(5) << "Accepting value, produced a match: " << line.contents();
-      features_output = &history_data[event_key];
-      history_value_tokens.insert({event_key, std::move(match.value())});
-    } else {
-      VLOG(6) << "Ignoring value, no match: " << line.contents();
-      return !input.abort_value.has_value();
-    }
-    math::naive_bayes::FeaturesSet current_features;
-    for (auto& [key, value] : *line_keys)
-      if (key != HistoryIdentifierValue())
-        current_features.insert(math::naive_bayes::Feature(
-            ToLazyString(key) + LazyString{L":"} +
-            ToLazyString(value.EscapedRepresentation())));
-    features_output->push_back(std::move(current_features));
-
-    return !input.abort_value.has_value();
-  });
-
-  VLOG(4) << "Matches found: " << history_data.read().size();
 
   // For sorting.
   math::naive_bayes::FeaturesSet current_features;
@@ -396,8 +487,43 @@ FilterSortBufferOutput FilterSortBuffer(FilterSortBufferInput input) {
         math::naive_bayes::Feature{ToLazyString(name) + LazyString{L":"} +
                                    ToLazyString(value.CppRepresentation())});
 
+  // Tokens by parsing the `value` value in the history.
+  std::unordered_map<math::naive_bayes::Event, std::vector<Token>>
+      history_value_tokens;
+  std::vector<math::naive_bayes::Event> sorted_events;
+  std::vector<Token> filter_tokens = TokenizeBySpaces(input.filter);
+  input.history_index->lock([&](HistoryIndex& index) {
+    index.Update(input.history);
+    output.errors = index.errors();
+    const std::vector<HistoryIndex::Entry>& entries = index.entries();
+    // Sets of features for each unique `value` value in the history. References
+    // the entries in `index`, so we must sort before releasing the lock.
+    math::naive_bayes::HistoryView history_data;
+    if (filter_tokens.empty()) {
+      VLOG(6) << "Accepting all values (empty filters).";
+      for (const HistoryIndex::Entry& entry : entries)
+        history_data[entry.event] = &entry.features;
+    } else {
+      std::vector<std::optional<std::vector<Token>>> matches = MatchEntries(
+          filter_tokens, entries, input.thread_pool, input.abort_value);
+      for (size_t i = 0; i < matches.size(); i++)
+        if (matches[i].has_value()) {
+          VLOG(5) << "Accepting value, produced a match: " << entries[i].event;
+          history_data[entries[i].event] = &entries[i].features;
+          history_value_tokens.insert(
+              {entries[i].event, std::move(matches[i].value())});
+        }
+    }
+    VLOG(4) << "Matches found: " << history_data.size();
+    // Since we hold the lock on the index, we must stop promptly once aborted.
+    sorted_events = math::naive_bayes::Sort(
+        history_data, current_features,
+        [&input] { return input.abort_value.has_value(); });
+  });
+  if (input.abort_value.has_value()) return output;
+
   std::ranges::copy(
-      math::naive_bayes::Sort(history_data, current_features) |
+      sorted_events |
           std::views::transform(
               [&](const math::naive_bayes::Event& key)
                   -> ValueOrError<FilterSortBufferOutput::Match> {
@@ -574,5 +700,130 @@ auto filter_sort_history_sync_tests_registration = tests::Register(
                             .data = LineSequence::ForTests({L"ls", L""})}));
              }},
     });
+
+Line HistoryLineForTests(std::wstring value) {
+  return LineBuilder{SingleLine{LazyString{L"value:\"" + value + L"\""}}}
+      .Build();
+}
+
+auto history_index_tests_registration = tests::Register(
+    L"HistoryIndex",
+    {{.name = L"GroupsByValue",
+      .callback =
+          [] {
+            HistoryIndex index;
+            index.Update(container::Materialize<LineSequence>(
+                std::vector<Line>{HistoryLineForTests(L"foo"),
+                                  HistoryLineForTests(L"bar"),
+                                  HistoryLineForTests(L"foo")}));
+            CHECK_EQ(index.entries().size(), 2ul);
+            CHECK_EQ(index.entries()[0].event,
+                     math::naive_bayes::Event{LazyString{L"foo"}});
+            CHECK_EQ(index.entries()[0].features.size(), 2ul);
+            CHECK_EQ(index.entries()[1].event,
+                     math::naive_bayes::Event{LazyString{L"bar"}});
+            CHECK_EQ(index.entries()[1].features.size(), 1ul);
+          }},
+     {.name = L"Appended",
+      .callback =
+          [] {
+            HistoryIndex index;
+            std::vector<Line> lines = {HistoryLineForTests(L"foo"),
+                                       HistoryLineForTests(L"bar")};
+            index.Update(container::Materialize<LineSequence>(lines));
+            lines.push_back(HistoryLineForTests(L"quux"));
+            lines.push_back(
+                LineBuilder{SingleLine{LazyString{L"value:\""}}}.Build());
+            index.Update(container::Materialize<LineSequence>(lines));
+            CHECK_EQ(index.entries().size(), 3ul);
+            CHECK_EQ(index.entries()[2].event,
+                     math::naive_bayes::Event{LazyString{L"quux"}});
+            CHECK_EQ(index.errors().size(), 1ul);
+          }},
+     {.name = L"EditedStartsOver",
+      .callback =
+          [] {
+            HistoryIndex index;
+            index.Update(container::Materialize<LineSequence>(
+                std::vector<Line>{HistoryLineForTests(L"foo"),
+                                  HistoryLineForTests(L"bar")}));
+            index.Update(container::Materialize<LineSequence>(
+                std::vector<Line>{HistoryLineForTests(L"foo"),
+                                  HistoryLineForTests(L"quux"),
+                                  HistoryLineForTests(L"bar")}));
+            CHECK_EQ(index.entries().size(), 3ul);
+            CHECK_EQ(index.entries()[1].event,
+                     math::naive_bayes::Event{LazyString{L"quux"}});
+            CHECK_EQ(index.entries()[2].features.size(), 1ul);
+          }},
+     {.name = L"FilterSortBufferReusesIndex",
+      .callback =
+          [] {
+            auto history_index =
+                MakeNonNullShared<concurrent::Protected<HistoryIndex>>();
+            std::vector<Line> lines = {HistoryLineForTests(L"foo"),
+                                       HistoryLineForTests(L"bar")};
+            auto run = [&] {
+              return FilterSortBuffer(FilterSortBufferInput{
+                  .abort_value = DeleteNotification::Never(),
+                  .filter = SingleLine{LazyString{L"f"}},
+                  .history = container::Materialize<LineSequence>(lines),
+                  .current_features = {},
+                  .history_index = history_index});
+            };
+            CHECK_EQ(run().matches.size(), 1ul);
+            lines.push_back(HistoryLineForTests(L"fuzz"));
+            CHECK_EQ(run().matches.size(), 2ul);
+          }},
+     {.name = L"FilterSortBufferConcurrent", .callback = [] {
+        std::vector<Line> lines;
+        for (int i = 0; i < 10000; i++)
+          lines.push_back(HistoryLineForTests(
+              (i % 2 == 0 ? L"foo" : L"bar") + std::to_wstring(i)));
+        FilterSortBufferOutput output = FilterSortBuffer(FilterSortBufferInput{
+            .abort_value = DeleteNotification::Never(),
+            .filter = SingleLine{LazyString{L"bar"}},
+            .history = container::Materialize<LineSequence>(lines),
+            .current_features = {},
+            .thread_pool = MakeNonNullShared<ThreadPool>(
+                LazyString{L"FilterSortBufferTest"}, 4)});
+        CHECK_EQ(output.matches.size(), 5000ul);
+      }},
+     {.name = L"FilterSortBufferFromBusyThreadPool", .callback = [] {
+        // Runs FilterSortBuffer in all the threads of its own pool, so that
+        // none of the helpers it schedules can start before it returns.
+        std::vector<Line> lines;
+        for (int i = 0; i < 10000; i++)
+          lines.push_back(HistoryLineForTests(
+              (i % 2 == 0 ? L"foo" : L"bar") + std::to_wstring(i)));
+        static constexpr size_t kThreads = 2;
+        auto thread_pool = MakeNonNullShared<ThreadPool>(
+            LazyString{L"FilterSortBufferBusyTest"}, kThreads);
+        ProtectedWithCondition<std::vector<size_t>> outputs(
+            std::vector<size_t>{});
+        for (size_t i = 0; i < kThreads; i++)
+          thread_pool->RunIgnoringResult([&] {
+            size_t matches =
+                FilterSortBuffer(
+                    FilterSortBufferInput{
+                        .abort_value = DeleteNotification::Never(),
+                        .filter = SingleLine{LazyString{L"bar"}},
+                        .history = container::Materialize<LineSequence>(lines),
+                        .current_features = {},
+                        .thread_pool = thread_pool})
+                    .matches.size();
+            outputs.lock([matches](std::vector<size_t>& values,
+                                   std::condition_variable& condition) {
+              values.push_back(matches);
+              condition.notify_all();
+            });
+          });
+        outputs.wait([](std::vector<size_t>& values) {
+          return values.size() == kThreads;
+        });
+        outputs.lock([](std::vector<size_t>& values, std::condition_variable&) {
+          for (size_t matches : values) CHECK_EQ(matches, 5000ul);
+        });
+      }}});
 }  // namespace
 }  // namespace afc::editor
@@ -1,15 +1,21 @@
 #ifndef __AFC_EDITOR_BUFFER_FILTER_H__
 #define __AFC_EDITOR_BUFFER_FILTER_H__
 
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include "src/concurrent/protected.h"
+#include "src/concurrent/thread_pool.h"
 #include "src/futures/delete_notification.h"
 #include "src/language/error/value_or_error.h"
 #include "src/language/lazy_string/lazy_string.h"
 #include "src/language/lazy_string/single_line.h"
 #include "src/language/lazy_string/tokenize.h"
+#include "src/language/safe_types.h"
 #include "src/language/text/line.h"
 #include "src/language/text/line_sequence.h"
+#include "src/math/naive_bayes.h"
 #include "src/vm/escape.h"
 #include "src/vm/types.h"
 
@@ -31,11 +37,64 @@ struct TokenAndModifiers {
 language::text::Line ColorizeLine(language::lazy_string::LazyString line,
                                   std::vector<TokenAndModifiers> tokens);
 
+// The parsed contents of a history buffer, grouped by their `value` section
+// (so that `FilterSortBuffer` doesn't need to parse the history again).
+//
+// We assume that history buffers only grow by appending lines, so `Update` only
+// needs to parse the new lines.
+//
+// This class is thread-compatible.
+class HistoryIndex {
+ public:
+  struct Entry {
+    // The (escaped) `value` section.
+    math::naive_bayes::Event event;
+    // The tokens (in `event`) against which filters are matched.
+    std::vector<language::lazy_string::Token> tokens;
+    // For each line with this `value`, the rest of its features.
+    std::vector<math::naive_bayes::FeaturesSet> features;
+  };
+
+  // Parses the lines that have been appended to `history` since the last call.
+  // If `history` doesn't extend the lines previously parsed (e.g., because the
+  // history buffer was edited), starts over.
+  void Update(const language::text::LineSequence& history);
+
+  // In the order in which their values first appear in the history.
+  const std::vector<Entry>& entries() const;
+
+  // Errors found in the lines parsed (which don't contribute entries).
+  const std::vector<language::Error>& errors() const;
+
+ private:
+  void Add(const language::text::Line& line);
+
+  language::text::LineNumberDelta lines_parsed_;
+  // The first and last lines parsed, to validate that the history passed to
+  // `Update` extends them.
+  std::optional<language::text::Line> first_line_;
+  std::optional<language::text::Line> last_line_;
+
+  std::vector<Entry> entries_;
+  std::unordered_map<math::naive_bayes::Event, size_t> entry_by_event_;
+  std::vector<language::Error> errors_;
+};
+
 struct FilterSortBufferInput {
   futures::DeleteNotification::Value abort_value;
   language::lazy_string::SingleLine filter;
   language::text::LineSequence history;
   std::multimap<vm::Identifier, vm::EscapedString> current_features;
+
+  // Customers that filter the same history repeatedly should retain the index
+  // and pass it in every call.
+  language::NonNull<std::shared_ptr<concurrent::Protected<HistoryIndex>>>
+      history_index =
+          language::MakeNonNullShared<concurrent::Protected<HistoryIndex>>();
+
+  // If present, large histories are matched against the filter concurrently.
+  std::optional<language::NonNull<std::shared_ptr<concurrent::ThreadPool>>>
+      thread_pool = std::nullopt;
 };
 
 struct FilterSortBufferOutput {
@@ -1,5 +1,6 @@
 #include "src/buffer_syntax_parser.h"
 
+#include "src/language/overload.h"
 #include "src/language/safe_types.h"
 #include "src/parse_tree.h"
 #include "src/parsers/cpp.h"
@@ -8,12 +9,19 @@
 #include "src/parsers/diff.h"
 #include "src/parsers/markdown.h"
 #include "src/parsers/py.h"
+#include "src/parsers/util.h"
 
+using afc::concurrent::ThreadPoolWithWorkQueue;
 using afc::futures::DeleteNotification;
+using afc::infrastructure::FileSystemDriver;
+using afc::infrastructure::Path;
+using afc::language::EmptyValue;
+using afc::language::Error;
 using afc::language::MakeNonNullShared;
 using afc::language::MakeNonNullUnique;
 using afc::language::NonNull;
 using afc::language::Observers;
+using afc::language::overload;
 using afc::language::lazy_string::LazyString;
 using afc::language::lazy_string::SingleLine;
 using afc::language::text::LineColumn;
@@ -24,6 +32,7 @@ using afc::language::text::Range;
 namespace afc::editor {
 void BufferSyntaxParser::UpdateParser(ParserOptions options) {
   data_->lock([&options](Data& data) {
+    data.parser_id = options.parser_name;
     if (options.parser_name == ParserId::Text()) {
       data.tree_parser = NewLineTreeParser(NewWordsTreeParser(
           options.symbol_characters, options.typos_set, NewNullTreeParser()));
@@ -125,6 +134,70 @@ void BufferSyntaxParser::Parse(const LineSequence contents) {
   parse_channel_.Push(contents);
 }
 
+namespace {
+struct LineOrientedParser {
+  NonNull<std::shared_ptr<parsers::LineOrientedTreeParser>> parser;
+  ParserId parser_id;
+};
+
+std::optional<LineOrientedParser> GetLineOrientedParser(
+    const NonNull<std::shared_ptr<TreeParser>>& parser,
+    const std::optional<ParserId>& parser_id) {
+  std::shared_ptr<parsers::LineOrientedTreeParser> output =
+      std::dynamic_pointer_cast<parsers::LineOrientedTreeParser>(
+          parser.get_shared());
+  if (output == nullptr || !parser_id.has_value()) return std::nullopt;
+  return LineOrientedParser{
+      .parser = NonNull<std::shared_ptr<parsers::LineOrientedTreeParser>>::
+          Unsafe(std::move(output)),
+      .parser_id = parser_id.value()};
+}
+}  // namespace
+
+void BufferSyntaxParser::LoadCache(
+    NonNull<std::shared_ptr<FileSystemDriver>> file_system_driver,
+    ThreadPoolWithWorkQueue& thread_pool, Path path) {
+  std::optional<LineOrientedParser> parser = data_->lock([](const Data& data) {
+    return GetLineOrientedParser(data.tree_parser, data.parser_id);
+  });
+  if (!parser.has_value()) return;
+  file_system_driver->ReadFile(path).Transform(
+      [&thread_pool, parser = std::move(parser.value()),
+       path](std::string contents) {
+        thread_pool.RunIgnoringResult([parser, path,
+                                       contents = std::move(contents)] {
+          TRACK_OPERATION(BufferSyntaxParser_LoadCache);
+          std::visit(overload{[&path](Error error) {
+                                LOG(INFO) << path << ": Ignoring parse cache: "
+                                          << error;
+                              },
+                              [](EmptyValue) {}},
+                     parser.parser->LoadCache(parser.parser_id, contents));
+        });
+        return EmptyValue{};
+      });
+}
+
+void BufferSyntaxParser::SaveCache(
+    NonNull<std::shared_ptr<FileSystemDriver>> file_system_driver,
+    Path path) const {
+  thread_pool_.RunIgnoringResult([data = data_, file_system_driver, path] {
+    TRACK_OPERATION(BufferSyntaxParser_SaveCache);
+    auto parser = data->lock([](const Data& data_locked) {
+      return GetLineOrientedParser(data_locked.tree_parser,
+                                   data_locked.parser_id);
+    });
+    if (!parser.has_value()) return;
+    futures::OnError(
+        file_system_driver->WriteFile(
+            path, parser->parser->SerializeCache(parser->parser_id), 0600),
+        [path](Error error) {
+          LOG(INFO) << path << ": Unable to save parse cache: " << error;
+          return error;
+        });
+  });
+}
+
 void BufferSyntaxParser::ParseInternal(const LineSequence contents) {
   language::NonNull<std::shared_ptr<TreeParser>> tree_parser =
       data_->lock([](const Data& data) { return data.tree_parser; });
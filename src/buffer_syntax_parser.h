@@ -8,6 +8,8 @@
 #include "src/concurrent/protected.h"
 #include "src/concurrent/thread_pool.h"
 #include "src/futures/delete_notification.h"
+#include "src/infrastructure/dirname.h"
+#include "src/infrastructure/file_system_driver.h"
 #include "src/language/observers.h"
 #include "src/language/safe_types.h"
 #include "src/language/text/sorted_line_sequence.h"
@@ -30,6 +32,26 @@ class BufferSyntaxParser {
 
   void Parse(language::text::LineSequence contents);
 
+  // Loads (in the background) the results of parsing lines from a file written
+  // by `SaveCache`. Does nothing if the file doesn't exist or was written by a
+  // different parser. Only supported for parsers that cache the results of
+  // parsing individual lines. Lines parsed before the file has been loaded
+  // won't benefit from it.
+  //
+  // The file is read through `file_system_driver`; the results are decoded in
+  // `thread_pool`, which must outlive the load.
+  void LoadCache(
+      language::NonNull<std::shared_ptr<infrastructure::FileSystemDriver>>
+          file_system_driver,
+      concurrent::ThreadPoolWithWorkQueue& thread_pool,
+      infrastructure::Path path);
+
+  // Writes (in the background) the results of parsing lines to `path`.
+  void SaveCache(
+      language::NonNull<std::shared_ptr<infrastructure::FileSystemDriver>>
+          file_system_driver,
+      infrastructure::Path path) const;
+
   language::NonNull<std::shared_ptr<const ParseTree>> tree() const;
   language::NonNull<std::shared_ptr<const ParseTree>> simplified_tree() const;
 
@@ -62,6 +84,7 @@ class BufferSyntaxParser {
   struct Data {
     language::NonNull<std::shared_ptr<TreeParser>> tree_parser =
         NewNullTreeParser();
+    std::optional<ParserId> parser_id;
 
     language::NonNull<std::shared_ptr<const ParseTree>> tree =
         language::MakeNonNullShared<const ParseTree>(language::text::Range());
@@ -349,6 +349,30 @@ EdgeVariable<bool>* const persist_state =
              L"$EDGE_PATH/state/)?")
          .Build();
 
+EdgeVariable<bool>* const fsync_on_save =
+    &BoolStruct()
+         ->Add()
+         .Name(L"fsync_on_save")
+         .Description(
+             L"Should Edge wait until the contents of this buffer have been "
+             L"flushed to stable storage (with `fsync`) when saving it? This "
+             L"makes saving slower but protects the file against data loss if "
+             L"the system crashes right after saving.")
+         .Build();
+
+EdgeVariable<bool>* const load_with_mmap =
+    &BoolStruct()
+         ->Add()
+         .Name(L"load_with_mmap")
+         .Description(
+             L"Should Edge load the contents of this buffer (if it is a regular "
+             L"file) by mapping the file into memory, rather than reading it "
+             L"incrementally? This is significantly faster for very large "
+             L"files, and the contents of the file are not copied until they "
+             L"are modified. However, Edge may crash if the file is truncated "
+             L"while it is loaded.")
+         .Build();
+
 EdgeVariable<bool>* const pin =
     &BoolStruct()
          ->Add()
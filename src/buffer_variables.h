@@ -41,6 +41,8 @@ extern EdgeVariable<bool>* const wrap_from_content;
 extern EdgeVariable<bool>* const extend_lines;
 extern EdgeVariable<bool>* const display_progress;
 extern EdgeVariable<bool>* const persist_state;
+extern EdgeVariable<bool>* const fsync_on_save;
+extern EdgeVariable<bool>* const load_with_mmap;
 extern EdgeVariable<bool>* const pin;
 extern EdgeVariable<bool>* const vm_lines_evaluation;
 extern EdgeVariable<bool>* const view_center_lines;
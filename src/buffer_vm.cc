@@ -33,6 +33,7 @@ namespace container = afc::language::container;
 using afc::concurrent::Protected;
 using afc::infrastructure::ExtendedChar;
 using afc::infrastructure::FileSystemDriver;
+using afc::infrastructure::LatencyPercentilesToString;
 using afc::infrastructure::Path;
 using afc::infrastructure::Tracker;
 using afc::infrastructure::VectorExtendedChar;
@@ -703,6 +704,10 @@ void DefineBufferType(gc::Pool& pool, Environment& environment) {
             buffer->AppendLines(container::MaterializeVector(
                 Tracker::GetData() |
                 std::views::transform([](Tracker::Data data) -> const Line {
+                  std::wstring parents;
+                  for (const auto& [parent, seconds] : data.seconds_by_parent)
+                    parents += (parents.empty() ? L"" : L" ") + parent + L":" +
+                               std::to_wstring(seconds);
                   return LineBuilder(SingleLine{LazyString{L"\""}} +
                                      SingleLine{LazyString{data.name}} +
                                      SingleLine{LazyString{L"\","}} +
@@ -712,8 +717,17 @@ void DefineBufferType(gc::Pool& pool, Environment& environment) {
                                      SingleLine{LazyString{
                                          std::to_wstring(data.seconds)}} +
                                      SingleLine{LazyString{L","}} +
+                                     SingleLine{LazyString{
+                                         std::to_wstring(data.self_seconds)}} +
+                                     SingleLine{LazyString{L","}} +
                                      SingleLine{LazyString{std::to_wstring(
-                                         data.longest_seconds)}})
+                                         data.longest_seconds)}} +
+                                     SingleLine{LazyString{L",\""}} +
+                                     SingleLine{LazyString{
+                                         LatencyPercentilesToString(data)}} +
+                                     SingleLine{LazyString{L"\",\""}} +
+                                     SingleLine{LazyString{parents}} +
+                                     SingleLine{LazyString{L"\""}})
                       .Build();
                 })));
             buffer->AppendLine(SingleLine{});
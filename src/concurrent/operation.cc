@@ -37,7 +37,7 @@ OperationFactory::OperationFactory(
     : thread_pool_(std::move(thread_pool)) {}
 
 language::NonNull<std::unique_ptr<Operation>> OperationFactory::New(
-    std::unique_ptr<bool, std::function<void(bool*)>> tracker_call) {
+    infrastructure::Tracker::Execution tracker_call) {
   return MakeNonNullUnique<Operation>(
       thread_pool_.value(), thread_pool_->size() * 2, std::move(tracker_call));
 }
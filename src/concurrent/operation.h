@@ -5,6 +5,7 @@
 
 #include "src/concurrent/protected.h"
 #include "src/concurrent/thread_pool.h"
+#include "src/infrastructure/tracker.h"
 #include "src/language/safe_types.h"
 #include "src/tests/concurrent_interfaces.h"
 
@@ -16,7 +17,7 @@ class Operation {
   Operation(
       ThreadPool& thread_pool,
       std::optional<size_t> concurrency_limit = std::nullopt,
-      std::unique_ptr<bool, std::function<void(bool*)>> tracker_call = nullptr)
+      infrastructure::Tracker::Execution tracker_call = nullptr)
       : thread_pool_(thread_pool),
         tracker_call_(std::move(tracker_call)),
         concurrency_limit_(concurrency_limit) {}
@@ -81,7 +82,7 @@ class Operation {
   }
 
   ThreadPool& thread_pool_;
-  const std::unique_ptr<bool, std::function<void(bool*)>> tracker_call_;
+  const infrastructure::Tracker::Execution tracker_call_;
   const std::optional<size_t> concurrency_limit_;
   mutable ProtectedWithCondition<unsigned int, EmptyValidator<unsigned int>,
                                  false>
@@ -96,7 +97,7 @@ class OperationFactory {
 
   // `tracker_call` can be null.
   language::NonNull<std::unique_ptr<Operation>> New(
-      std::unique_ptr<bool, std::function<void(bool*)>> tracker_call);
+      infrastructure::Tracker::Execution tracker_call);
 
  private:
   const language::NonNull<std::shared_ptr<ThreadPool>> thread_pool_;
@@ -0,0 +1,133 @@
+// A type-erased callable that receives no arguments (and whose result, if any,
+// is ignored), similar to `std::function<void()>`. Unlike `std::function`, the
+// callable only needs to be movable (not copyable).
+//
+// Callables that fit in `kInlineSize` bytes are stored inside the `Task`,
+// avoiding a separate allocation. `ThreadPool` allocates one `Task` per unit of
+// work. The memory of deleted `Task` instances is kept in a (bounded) free list
+// of the thread that deleted them, and reused by the next `Task` that thread
+// allocates. Threads that run work and schedule more (e.g., the workers of a
+// `ThreadPool`) thus rarely reach the allocator.
+//
+// A `Task` can't be moved (so that the inline storage doesn't need to support
+// moving the callable); hold it through a `std::unique_ptr`.
+#ifndef __AFC_CONCURRENT_TASK_H__
+#define __AFC_CONCURRENT_TASK_H__
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace afc::concurrent {
+class Task {
+ public:
+  static constexpr size_t kInlineSize = 6 * sizeof(void*);
+
+  template <typename Callable>
+  explicit Task(Callable callable) : operations_(&kOperations<Callable>) {
+    if constexpr (kIsInline<Callable>)
+      new (storage_) Callable(std::move(callable));
+    else
+      new (storage_) Callable*(new Callable(std::move(callable)));
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  ~Task() { operations_->destroy(storage_); }
+
+  void Run() { operations_->run(storage_); }
+
+  // Returns a boolean indicating whether the callable is stored inline. Only
+  // meant to be used by tests.
+  bool inline_storage() const { return operations_->inline_storage; }
+
+  static void* operator new(size_t size) {
+    FreeList& free_list = CurrentFreeList();
+    if (size != sizeof(Task) || free_list.head == nullptr)
+      return ::operator new(size);
+    FreeBlock* output = free_list.head;
+    free_list.head = output->next;
+    free_list.size--;
+    return output;
+  }
+
+  static void operator delete(void* pointer, size_t size) {
+    FreeList& free_list = CurrentFreeList();
+    if (size != sizeof(Task) || free_list.size >= FreeList::kMaxSize) {
+      ::operator delete(pointer);
+      return;
+    }
+    // Ensures that the blocks are released when the thread exits.
+    thread_local FreeListReleaser free_list_releaser;
+    free_list.head = new (pointer) FreeBlock{.next = free_list.head};
+    free_list.size++;
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // Trivially destructible, so that `Task` instances can still be deleted while
+  // the thread exits (after `FreeListReleaser` has run).
+  struct FreeList {
+    static constexpr size_t kMaxSize = 1024;
+    FreeBlock* head = nullptr;
+    size_t size = 0;
+  };
+
+  static FreeList& CurrentFreeList() {
+    thread_local FreeList output;
+    return output;
+  }
+
+  // Releases the blocks in `CurrentFreeList()` when the thread exits.
+  struct FreeListReleaser {
+    ~FreeListReleaser() {
+      FreeList& free_list = CurrentFreeList();
+      while (free_list.head != nullptr)
+        ::operator delete(std::exchange(free_list.head, free_list.head->next));
+      // Blocks deleted from now on go directly to the allocator.
+      free_list.size = FreeList::kMaxSize;
+    }
+  };
+
+  struct Operations {
+    void (*run)(void*);
+    void (*destroy)(void*);
+    bool inline_storage;
+  };
+
+  template <typename Callable>
+  static constexpr bool kIsInline =
+      sizeof(Callable) <= kInlineSize &&
+      alignof(Callable) <= alignof(std::max_align_t);
+
+  template <typename Callable>
+  static Callable& Get(void* storage) {
+    if constexpr (kIsInline<Callable>)
+      return *std::launder(static_cast<Callable*>(storage));
+    else
+      return **static_cast<Callable**>(storage);
+  }
+
+  template <typename Callable>
+  static constexpr Operations kOperations = {
+      .run = [](void* storage) { std::invoke(Get<Callable>(storage)); },
+      .destroy =
+          [](void* storage) {
+            if constexpr (kIsInline<Callable>)
+              Get<Callable>(storage).~Callable();
+            else
+              delete &Get<Callable>(storage);
+          },
+      .inline_storage = kIsInline<Callable>};
+
+  alignas(std::max_align_t) std::byte storage_[kInlineSize];
+  const Operations* const operations_;
+};
+}  // namespace afc::concurrent
+#endif  // __AFC_CONCURRENT_TASK_H__
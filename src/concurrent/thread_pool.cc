@@ -1,6 +1,9 @@
 #include "src/concurrent/thread_pool.h"
 
+#include "src/concurrent/work_stealing_deque.h"
 #include "src/infrastructure/time_human.h"
+#include "src/infrastructure/trace_recorder.h"
+#include "src/infrastructure/tracker.h"
 #include "src/language/safe_types.h"
 #include "src/tests/tests.h"
 
@@ -8,29 +11,40 @@ using afc::language::NonNull;
 using afc::language::lazy_string::LazyString;
 
 namespace afc::concurrent {
+namespace {
+// Identifies the pool (and the index of the worker in it) that the current
+// thread belongs to.
+struct CurrentWorker {
+  const ThreadPool* pool = nullptr;
+  size_t index = 0;
+};
+thread_local CurrentWorker current_worker;
+}  // namespace
+
+struct ThreadPool::Worker {
+  WorkStealingDeque<Task> deque;
+};
+
 ThreadPool::ThreadPool(LazyString name, size_t size)
     : name_(std::move(name)), size_(size) {
-  data_.lock([this](Data& data, std::condition_variable&) {
+  for (size_t i = 0; i < size_; i++)
+    workers_.push_back(std::make_unique<Worker>());
+  idle_.lock([this](IdleData& data, std::condition_variable&) {
     for (size_t i = 0; i < size_; i++) {
-      data.threads.push_back(std::thread([this]() { BackgroundThread(); }));
+      data.threads.push_back(std::thread([this, i]() { BackgroundThread(i); }));
     }
   });
 }
 
 size_t ThreadPool::size() const { return size_; }
 
-size_t ThreadPool::pending_work_units() const {
-  return data_.lock([](const Data& data, std::condition_variable&) {
-    return data.active_work + data.work.size();
-  });
-}
+size_t ThreadPool::pending_work_units() const { return pending_work_.load(); }
 
 ThreadPool::~ThreadPool() {
   LOG(INFO) << name_ << ": Starting destruction of ThreadPool.";
+  CHECK(!shutting_down_.exchange(true));
   std::vector<std::thread> threads;
-  data_.lock([&threads](Data& data, std::condition_variable& condition) {
-    CHECK(!data.shutting_down);
-    data.shutting_down = true;
+  idle_.lock([&threads](IdleData& data, std::condition_variable& condition) {
     condition.notify_all();
     threads.swap(data.threads);
   });
@@ -39,47 +53,73 @@ ThreadPool::~ThreadPool() {
   LOG(INFO) << name_ << ": All threads are joined.";
 }
 
-void ThreadPool::Schedule(std::function<void()> work) {
+void ThreadPool::Schedule(std::unique_ptr<Task> work) {
   CHECK(work != nullptr);
+  CHECK(!shutting_down_.load(std::memory_order_relaxed));
   if (auto handler = tests::concurrent::GetGlobalHandler();
       handler != nullptr) {
-    work = handler->Wrap(std::move(work));
+    work = std::make_unique<Task>(
+        handler->Wrap([shared_work = std::shared_ptr<Task>(std::move(work))] {
+          shared_work->Run();
+        }));
   }
-  data_.lock([&work](Data& data, std::condition_variable& condition) {
-    CHECK(!data.shutting_down);
-    data.work.push_back(std::move(work));
-    condition.notify_one();
-  });
+  // We increment `queued_work_` before making the work visible, so that it
+  // never underflows (when the work is taken).
+  pending_work_++;
+  queued_work_++;
+  if (current_worker.pool == this)
+    workers_[current_worker.index]->deque.Push(std::move(work));
+  else
+    injection_queue_.lock(
+        [&work](std::deque<std::unique_ptr<Task>>& queue) {
+          queue.push_back(std::move(work));
+        });
+  // Pairs with `BackgroundThread`: either we see the increment of
+  // `idle_threads_`, or the idle thread sees our increment of `queued_work_`.
+  if (idle_threads_.load() > 0)
+    idle_.lock([](IdleData&, std::condition_variable& condition) {
+      condition.notify_one();
+    });
 }
 
-void ThreadPool::BackgroundThread() {
-  bool active_work_thread = false;
-  while (true) {
-    std::function<void()> callback;
+std::unique_ptr<Task> ThreadPool::FindWork(size_t worker_index) {
+  std::unique_ptr<Task> output = workers_[worker_index]->deque.Pop();
+  if (output == nullptr)
+    output = injection_queue_.lock(
+        [](std::deque<std::unique_ptr<Task>>& queue) -> std::unique_ptr<Task> {
+          if (queue.empty()) return nullptr;
+          std::unique_ptr<Task> front = std::move(queue.front());
+          queue.pop_front();
+          return front;
+        });
+  for (size_t i = 1; i < size_ && output == nullptr; i++)
+    output = workers_[(worker_index + i) % size_]->deque.Steal();
+  if (output != nullptr) queued_work_--;
+  return output;
+}
+
+void ThreadPool::BackgroundThread(size_t worker_index) {
+  current_worker = {.pool = this, .index = worker_index};
+  infrastructure::SetTraceThreadName(name_.ToString() + L" " +
+                                     std::to_wstring(worker_index));
+  while (!shutting_down_.load(std::memory_order_relaxed)) {
+    if (std::unique_ptr<Task> work = FindWork(worker_index); work != nullptr) {
+      VLOG(9) << name_ << ": BackgroundThread executing work.";
+      auto call = INLINE_TRACKER(ThreadPool_BackgroundThread_Run);
+      work->Run();
+      call = nullptr;
+      work = nullptr;
+      pending_work_--;
+      continue;
+    }
     VLOG(8) << name_ << ": BackgroundThread waits for work.";
-    data_.wait([this, &callback, &active_work_thread](Data& data) {
-      if (active_work_thread) {
-        CHECK_GE(data.active_work, 0ul);
-        data.active_work--;
-        active_work_thread = false;
-      }
-
-      if (data.shutting_down) return true;
-      if (data.work.empty()) return false;
-      callback = std::move(data.work.front());
-      data.work.pop_front();
-      data.active_work++;
-      active_work_thread = true;
-      CHECK_LE(data.active_work, size_);
-      return true;
+    idle_threads_++;
+    idle_.wait([this](IdleData&) {
+      return shutting_down_.load() || queued_work_.load() > 0;
     });
-    if (callback == nullptr) {
-      VLOG(4) << name_ << ": BackgroundThread exits.";
-      return;
-    }
-    VLOG(9) << name_ << ": BackgroundThread executing work.";
-    callback();
+    idle_threads_--;
   }
+  VLOG(4) << name_ << ": BackgroundThread exits.";
 }
 
 ThreadPoolWithWorkQueue::ThreadPoolWithWorkQueue(
@@ -115,4 +155,105 @@ ThreadPoolWithWorkQueue::work_queue() const {
   return work_queue_;
 }
 
+namespace {
+// Schedules `count` units of work (each of which may schedule additional work)
+// and blocks until they have all run.
+void RunAndWait(ThreadPool& pool, size_t count,
+                std::function<void(ThreadPool&, std::function<void()>)> body) {
+  ProtectedWithCondition<size_t> done(0);
+  std::function<void()> notify = [&done] {
+    done.lock([](size_t& value, std::condition_variable& condition) {
+      value++;
+      condition.notify_all();
+    });
+  };
+  for (size_t i = 0; i < count; i++)
+    pool.RunIgnoringResult([&pool, &body, notify] { body(pool, notify); });
+  done.wait([count](size_t& value) { return value == count; });
+}
+
+const bool thread_pool_tests_registration = tests::Register(
+    L"ThreadPool",
+    {{.name = L"TaskInlineStorage",
+      .callback =
+          [] {
+            int value = 0;
+            Task small([&value] { value++; });
+            CHECK(small.inline_storage());
+            small.Run();
+            CHECK_EQ(value, 1);
+            std::array<char, Task::kInlineSize + 1> large_data = {};
+            large_data[0] = 5;
+            Task large([&value, large_data] { value += large_data[0]; });
+            CHECK(!large.inline_storage());
+            large.Run();
+            CHECK_EQ(value, 6);
+          }},
+     {.name = L"TaskReusesMemory",
+      .callback =
+          [] {
+            auto task = std::make_unique<Task>([] {});
+            void* address = task.get();
+            task = nullptr;
+            task = std::make_unique<Task>([] {});
+            CHECK_EQ(static_cast<void*>(task.get()), address);
+          }},
+     {.name = L"TaskMoveOnly",
+      .callback =
+          [] {
+            auto value = std::make_unique<int>(4);
+            int output = 0;
+            Task task([&output, value = std::move(value)] { output = *value; });
+            task.Run();
+            CHECK_EQ(output, 4);
+          }},
+     {.name = L"RunsExternalWork",
+      .callback =
+          [] {
+            ThreadPool pool(LazyString{L"RunsExternalWork"}, 4);
+            std::atomic<size_t> count = 0;
+            RunAndWait(pool, 1000,
+                       [&count](ThreadPool&, std::function<void()> notify) {
+                         count++;
+                         notify();
+                       });
+            CHECK_EQ(count.load(), 1000ul);
+          }},
+     {.name = L"RunsNestedWork",
+      .callback =
+          [] {
+            // Each unit of work schedules more work from inside the pool (so
+            // it goes to the deque of the worker and may get stolen).
+            ThreadPool pool(LazyString{L"RunsNestedWork"}, 4);
+            std::atomic<size_t> count = 0;
+            RunAndWait(pool, 10,
+                       [&count](ThreadPool& input_pool,
+                                std::function<void()> notify) {
+                         auto pending =
+                             std::make_shared<std::atomic<size_t>>(100);
+                         for (size_t i = 0; i < 100; i++)
+                           input_pool.RunIgnoringResult(
+                               [&count, pending, notify] {
+                                 count++;
+                                 if (--*pending == 0) notify();
+                               });
+                       });
+            CHECK_EQ(count.load(), 1000ul);
+          }},
+     {.name = L"PendingWorkUnits", .callback = [] {
+        ThreadPool pool(LazyString{L"PendingWorkUnits"}, 2);
+        ProtectedWithCondition<bool> release(false);
+        for (int i = 0; i < 5; i++)
+          pool.RunIgnoringResult([&release] {
+            release.wait([](bool& value) { return value; });
+          });
+        CHECK_EQ(pool.pending_work_units(), 5ul);
+        release.lock([](bool& value, std::condition_variable& condition) {
+          value = true;
+          condition.notify_all();
+        });
+        while (pool.pending_work_units() > 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }}});
+}  // namespace
 }  // namespace afc::concurrent
@@ -1,12 +1,15 @@
 #ifndef __AFC_EDITOR_THREAD_POOL_H__
 #define __AFC_EDITOR_THREAD_POOL_H__
 
+#include <atomic>
+#include <deque>
 #include <functional>
-#include <list>
 #include <memory>
 #include <thread>
 #include <vector>
 
+#include "src/concurrent/protected.h"
+#include "src/concurrent/task.h"
 #include "src/concurrent/work_queue.h"
 #include "src/futures/futures.h"
 #include "src/language/lazy_string/lazy_string.h"
@@ -14,17 +17,43 @@
 namespace afc::concurrent {
 // Prefer using concurrent::OperationFactory over scheduling directly to the
 // thread pool.
+//
+// Each thread in the pool has its own deque of work (a `WorkStealingDeque`).
+// Work scheduled from one of the threads of the pool is pushed to its deque;
+// work scheduled from other threads is pushed to a shared "injection" queue.
+// Threads that run out of work take it from the injection queue or steal it
+// from the deques of other threads. This avoids contention on a single mutex
+// when work is scheduled from the pool itself (e.g., `Bag::ForEachShard`).
 class ThreadPool {
+  struct Worker;
+
   const language::lazy_string::LazyString name_;
   const size_t size_;
-  struct Data {
-    bool shutting_down = false;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Work scheduled from threads outside of the pool.
+  Protected<std::deque<std::unique_ptr<Task>>,
+            EmptyValidator<std::deque<std::unique_ptr<Task>>>, false>
+      injection_queue_;
+
+  // Units of work that have been scheduled but haven't started running. May
+  // transiently count work that has not yet been pushed to a queue.
+  std::atomic<size_t> queued_work_ = 0;
+
+  // Units of work that have been scheduled but haven't finished running.
+  std::atomic<size_t> pending_work_ = 0;
+  std::atomic<bool> shutting_down_ = false;
+
+  // Threads block in `idle_` when they can't find any work. Threads that
+  // schedule work only need to lock it (in order to notify the condition) if
+  // `idle_threads_` is positive.
+  std::atomic<size_t> idle_threads_ = 0;
+  struct IdleData {
     std::vector<std::thread> threads = {};
-    size_t active_work = 0;
-    std::list<std::function<void()>> work = {};
   };
-  ProtectedWithCondition<Data, EmptyValidator<Data>, false> data_ =
-      ProtectedWithCondition<Data, EmptyValidator<Data>, false>(Data{});
+  ProtectedWithCondition<IdleData, EmptyValidator<IdleData>, false> idle_ =
+      ProtectedWithCondition<IdleData, EmptyValidator<IdleData>, false>(
+          IdleData{});
 
  public:
   ThreadPool(language::lazy_string::LazyString name, size_t size);
@@ -36,14 +65,13 @@ class ThreadPool {
 
   template <typename Callable>
   void RunIgnoringResult(Callable callable) {
-    // We copy callable into a shared pointer in case it's not copyable.
-    Schedule([shared_callable = std::make_shared<Callable>(
-                  std::move(callable))] { (*shared_callable)(); });
+    Schedule(std::make_unique<Task>(std::move(callable)));
   }
 
  private:
-  void Schedule(std::function<void()> work);
-  void BackgroundThread();
+  void Schedule(std::unique_ptr<Task> work);
+  std::unique_ptr<Task> FindWork(size_t worker_index);
+  void BackgroundThread(size_t worker_index);
 };
 
 // This is very similar to ThreadPool, but holds a work_queue. This allows us to
@@ -0,0 +1,91 @@
+// Benchmarks for ThreadPool, measuring the overhead of scheduling (many, very
+// small) units of work.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "src/concurrent/thread_pool.h"
+#include "src/infrastructure/time.h"
+#include "src/tests/benchmarks.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::language::lazy_string::LazyString;
+using afc::tests::BenchmarkName;
+
+namespace afc::concurrent {
+namespace {
+constexpr size_t kThreads = 8;
+
+// Counts the units of work that have finished; `Wait` blocks until `expected`
+// have.
+class Counter {
+ public:
+  explicit Counter(size_t expected) : expected_(expected) {}
+
+  void Increment() {
+    if (++count_ == expected_) {
+      done_ = true;
+      done_.notify_all();
+    }
+  }
+
+  void Wait() { done_.wait(false); }
+
+ private:
+  const size_t expected_;
+  std::atomic<size_t> count_ = 0;
+  std::atomic<bool> done_ = false;
+};
+
+// A few threads (outside of the pool) schedule work concurrently. Returns the
+// time per unit of work.
+bool registration_contention = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"ThreadPool::Contention")},
+    [](int elements) {
+      static constexpr size_t kProducers = 4;
+      // Declared before `pool`, which joins its threads (some of which may
+      // still be inside `Counter::Increment`) when it's destroyed.
+      Counter counter(kProducers * elements);
+      ThreadPool pool(LazyString{L"Contention"}, kThreads);
+      auto start = Now();
+      std::vector<std::thread> producers;
+      for (size_t i = 0; i < kProducers; i++)
+        producers.push_back(std::thread([&pool, &counter, elements] {
+          for (int j = 0; j < elements; j++)
+            pool.RunIgnoringResult([&counter] { counter.Increment(); });
+        }));
+      for (std::thread& producer : producers) producer.join();
+      counter.Wait();
+      return SecondsBetween(start, Now()) / (kProducers * elements);
+    });
+
+// A single unit of work recursively schedules work (from threads in the pool)
+// until `elements` units have run. Returns the time per unit of work.
+void FanOut(ThreadPool& pool, Counter& counter, int elements) {
+  if (elements > 1) {
+    int half = elements / 2;
+    pool.RunIgnoringResult(
+        [&pool, &counter, half] { FanOut(pool, counter, half); });
+    pool.RunIgnoringResult([&pool, &counter, rest = elements - half] {
+      FanOut(pool, counter, rest);
+    });
+  } else {
+    counter.Increment();
+  }
+}
+
+bool registration_fan_out = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"ThreadPool::FanOut")},
+    [](int elements) {
+      Counter counter(elements);
+      ThreadPool pool(LazyString{L"FanOut"}, kThreads);
+      auto start = Now();
+      pool.RunIgnoringResult(
+          [&pool, &counter, elements] { FanOut(pool, counter, elements); });
+      counter.Wait();
+      return SecondsBetween(start, Now()) / elements;
+    });
+}  // namespace
+}  // namespace afc::concurrent
@@ -0,0 +1,329 @@
+#include "src/concurrent/timer_wheel.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <bit>
+#include <map>
+
+#include "src/tests/tests.h"
+
+using afc::infrastructure::AddSeconds;
+using afc::infrastructure::Time;
+
+namespace afc::concurrent {
+TimerWheel::TimerWheel() { heads_.fill(kNoNode); }
+
+TimerWheel::Handle TimerWheel::Insert(Time time, Callback callback) {
+  NodeIndex index;
+  if (free_nodes_.empty()) {
+    CHECK_LT(nodes_.size(), static_cast<size_t>(kNoNode));
+    index = nodes_.size();
+    nodes_.emplace_back();
+  } else {
+    index = free_nodes_.back();
+    free_nodes_.pop_back();
+  }
+  Node& node = nodes_[index];
+  node.time = time;
+  node.tick = Tick(time);
+  node.sequence = next_sequence_++;
+  node.callback.emplace(std::move(callback));
+  node.list = ListFor(node.tick);
+  Link(index);
+  size_++;
+  return Handle{.index = index, .generation = node.generation};
+}
+
+bool TimerWheel::Cancel(Handle handle) {
+  if (handle.index >= nodes_.size()) return false;
+  Node& node = nodes_[handle.index];
+  if (node.generation != handle.generation || !node.callback.has_value())
+    return false;
+  Unlink(handle.index);
+  node.callback = std::nullopt;
+  node.generation++;
+  free_nodes_.push_back(handle.index);
+  size_--;
+  return true;
+}
+
+std::optional<Time> TimerWheel::NextTime() const {
+  auto earliest_in_list = [this](ListIndex list) {
+    Time output = nodes_[heads_[list]].time;
+    for (NodeIndex index = heads_[list]; index != kNoNode;
+         index = nodes_[index].next)
+      output = std::min(output, nodes_[index].time);
+    return output;
+  };
+  if (heads_[kDueList] != kNoNode) return earliest_in_list(kDueList);
+  for (size_t level = 0; level < kLevels; level++)
+    if (occupied_[level] != 0)
+      return earliest_in_list(level * kSlots +
+                              std::countr_zero(occupied_[level]));
+  return std::nullopt;
+}
+
+std::vector<TimerWheel::Entry> TimerWheel::TakeExpired(Time now) {
+  Advance(Tick(now));
+  std::vector<NodeIndex> expired;
+  for (NodeIndex index = heads_[kDueList]; index != kNoNode;
+       index = nodes_[index].next)
+    if (nodes_[index].time <= now) expired.push_back(index);
+  return Take(std::move(expired));
+}
+
+std::vector<TimerWheel::Entry> TimerWheel::TakeAll() {
+  std::vector<NodeIndex> all;
+  for (NodeIndex index = 0; index < nodes_.size(); index++)
+    if (nodes_[index].callback.has_value()) all.push_back(index);
+  return Take(std::move(all));
+}
+
+size_t TimerWheel::size() const { return size_; }
+
+size_t TimerWheel::cascades() const { return cascades_; }
+
+/* static */ uint64_t TimerWheel::Tick(const Time& time) {
+  if (time.tv_sec < 0) return 0;
+  return static_cast<uint64_t>(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+TimerWheel::ListIndex TimerWheel::ListFor(uint64_t tick) const {
+  if (tick <= current_tick_) return kDueList;
+  size_t level = (63 - std::countl_zero(tick ^ current_tick_)) / kSlotBits;
+  return level * kSlots + ((tick >> (level * kSlotBits)) & (kSlots - 1));
+}
+
+void TimerWheel::Link(NodeIndex index) {
+  Node& node = nodes_[index];
+  node.previous = kNoNode;
+  node.next = heads_[node.list];
+  if (node.next != kNoNode) nodes_[node.next].previous = index;
+  heads_[node.list] = index;
+  if (node.list != kDueList)
+    occupied_[node.list / kSlots] |= uint64_t{1} << (node.list % kSlots);
+}
+
+void TimerWheel::Unlink(NodeIndex index) {
+  Node& node = nodes_[index];
+  if (node.previous == kNoNode)
+    heads_[node.list] = node.next;
+  else
+    nodes_[node.previous].next = node.next;
+  if (node.next != kNoNode) nodes_[node.next].previous = node.previous;
+  if (node.list != kDueList && heads_[node.list] == kNoNode)
+    occupied_[node.list / kSlots] &= ~(uint64_t{1} << (node.list % kSlots));
+}
+
+void TimerWheel::Advance(uint64_t tick) {
+  while (tick > current_tick_) {
+    size_t level = 0;
+    while (level < kLevels && occupied_[level] == 0) level++;
+    if (level == kLevels) break;
+    uint64_t slot = std::countr_zero(occupied_[level]);
+    // The bits of `current_tick_` above `level` are shared by all the ticks
+    // in the slot.
+    size_t upper_shift = (level + 1) * kSlotBits;
+    uint64_t upper_mask =
+        upper_shift >= 64 ? 0 : ~((uint64_t{1} << upper_shift) - 1);
+    uint64_t slot_start =
+        (current_tick_ & upper_mask) | slot << (level * kSlotBits);
+    // Callbacks that remain in the wheel keep their positions (since
+    // `slot_start` is smaller than all their ticks).
+    if (slot_start > tick) break;
+    current_tick_ = slot_start;
+    ListIndex list = level * kSlots + slot;
+    NodeIndex index = heads_[list];
+    heads_[list] = kNoNode;
+    occupied_[level] &= ~(uint64_t{1} << slot);
+    while (index != kNoNode) {
+      NodeIndex next = nodes_[index].next;
+      nodes_[index].list = ListFor(nodes_[index].tick);
+      if (level > 0) cascades_++;
+      Link(index);
+      index = next;
+    }
+  }
+  current_tick_ = std::max(current_tick_, tick);
+}
+
+std::vector<TimerWheel::Entry> TimerWheel::Take(
+    std::vector<NodeIndex> nodes) {
+  std::sort(nodes.begin(), nodes.end(), [this](NodeIndex a, NodeIndex b) {
+    const Node& node_a = nodes_[a];
+    const Node& node_b = nodes_[b];
+    if (node_a.time != node_b.time) return node_a.time < node_b.time;
+    return node_a.sequence < node_b.sequence;
+  });
+  std::vector<Entry> output;
+  output.reserve(nodes.size());
+  for (NodeIndex index : nodes) {
+    Node& node = nodes_[index];
+    Unlink(index);
+    output.push_back(
+        Entry{.time = node.time, .callback = std::move(node.callback.value())});
+    node.callback = std::nullopt;
+    node.generation++;
+    free_nodes_.push_back(index);
+    size_--;
+  }
+  return output;
+}
+
+namespace {
+void RunAll(std::vector<TimerWheel::Entry> entries) {
+  for (TimerWheel::Entry& entry : entries) std::move(entry.callback)();
+}
+
+const bool timer_wheel_tests_registration = tests::Register(
+    L"TimerWheel",
+    {{.name = L"Empty",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            CHECK(wheel.NextTime() == std::nullopt);
+            CHECK(wheel.TakeExpired(infrastructure::Now()).empty());
+          }},
+     {.name = L"Order",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            Time start{.tv_sec = 1000, .tv_nsec = 0};
+            std::vector<int> output;
+            for (int delta : {6000, 2, 40, 3, 70000, 1, 0, 500})
+              wheel.Insert(AddSeconds(start, delta / 1000.0),
+                           [&output, delta] { output.push_back(delta); });
+            CHECK(wheel.NextTime() == start);
+            RunAll(wheel.TakeExpired(AddSeconds(start, 0.1)));
+            CHECK(output == std::vector<int>({0, 1, 2, 3, 40}));
+            CHECK(wheel.NextTime() == AddSeconds(start, 0.5));
+            RunAll(wheel.TakeExpired(AddSeconds(start, 100)));
+            CHECK(output == std::vector<int>({0, 1, 2, 3, 40, 500, 6000,
+                                              70000}));
+            CHECK_EQ(wheel.size(), 0ul);
+          }},
+     {.name = L"SameTimeKeepsInsertionOrder",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            Time time{.tv_sec = 5, .tv_nsec = 0};
+            std::vector<int> output;
+            for (int i = 0; i < 10; i++)
+              wheel.Insert(time, [&output, i] { output.push_back(i); });
+            RunAll(wheel.TakeExpired(time));
+            CHECK(output == std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+          }},
+     {.name = L"SubMillisecond",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            Time time{.tv_sec = 5, .tv_nsec = 100};
+            wheel.Insert(Time{.tv_sec = 5, .tv_nsec = 200}, [] {});
+            CHECK(wheel.TakeExpired(time).empty());
+            CHECK(wheel.NextTime() == Time({.tv_sec = 5, .tv_nsec = 200}));
+            CHECK_EQ(wheel.TakeExpired(Time{.tv_sec = 5, .tv_nsec = 200})
+                         .size(),
+                     1ul);
+          }},
+     {.name = L"InsertInPast",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            wheel.TakeExpired(Time{.tv_sec = 100, .tv_nsec = 0});
+            wheel.Insert(Time{.tv_sec = 50, .tv_nsec = 0}, [] {});
+            CHECK(wheel.NextTime() == Time({.tv_sec = 50, .tv_nsec = 0}));
+            CHECK_EQ(wheel.TakeExpired(Time{.tv_sec = 50, .tv_nsec = 0})
+                         .size(),
+                     1ul);
+          }},
+     {.name = L"Cancel",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            Time time{.tv_sec = 5, .tv_nsec = 0};
+            std::vector<int> output;
+            std::vector<TimerWheel::Handle> handles;
+            for (int i = 0; i < 5; i++)
+              handles.push_back(wheel.Insert(
+                  AddSeconds(time, i), [&output, i] { output.push_back(i); }));
+            CHECK(wheel.Cancel(handles[0]));
+            CHECK(!wheel.Cancel(handles[0]));
+            CHECK(wheel.Cancel(handles[3]));
+            CHECK(wheel.NextTime() == AddSeconds(time, 1));
+            RunAll(wheel.TakeExpired(AddSeconds(time, 10)));
+            CHECK(output == std::vector<int>({1, 2, 4}));
+            // The node has been reused; the old handle must not cancel it.
+            TimerWheel::Handle handle = wheel.Insert(time, [] {});
+            CHECK(!wheel.Cancel(handles[4]));
+            CHECK(wheel.Cancel(handle));
+            CHECK_EQ(wheel.size(), 0ul);
+          }},
+     {.name = L"TakeAll",
+      .callback =
+          [] {
+            TimerWheel wheel;
+            std::vector<int> output;
+            wheel.Insert(Time{.tv_sec = 1000000, .tv_nsec = 0},
+                         [&output] { output.push_back(1); });
+            wheel.Insert(Time{.tv_sec = 3, .tv_nsec = 0},
+                         [&output] { output.push_back(0); });
+            RunAll(wheel.TakeAll());
+            CHECK(output == std::vector<int>({0, 1}));
+            CHECK(wheel.NextTime() == std::nullopt);
+          }},
+     {.name = L"MatchesReference", .callback = [] {
+        // Compares the wheel against a multimap, with random insertions,
+        // cancellations and advances.
+        TimerWheel wheel;
+        std::multimap<std::pair<uint64_t, int>, TimerWheel::Handle> reference;
+        std::vector<int> output;
+        uint64_t now_ms = 1000;
+        auto to_time = [](uint64_t ms) {
+          return Time{.tv_sec = static_cast<time_t>(ms / 1000),
+                      .tv_nsec = static_cast<long>(ms % 1000) * 1000000};
+        };
+        for (int i = 0; i < 20000; i++) {
+          switch (random() % 4) {
+            case 0:
+            case 1: {
+              uint64_t ms = now_ms + (random() % 3 == 0
+                                          ? random() % 100000000
+                                          : random() % 1000);
+              reference.insert(
+                  {{ms, i}, wheel.Insert(to_time(ms), [&output, i] {
+                     output.push_back(i);
+                   })});
+              break;
+            }
+            case 2:
+              if (!reference.empty()) {
+                auto it = reference.begin();
+                std::advance(it, random() % reference.size());
+                CHECK(wheel.Cancel(it->second));
+                reference.erase(it);
+              }
+              break;
+            case 3: {
+              now_ms += random() % 3 == 0 ? random() % 1000000 : random() % 50;
+              output.clear();
+              RunAll(wheel.TakeExpired(to_time(now_ms)));
+              std::vector<int> expected;
+              while (!reference.empty() &&
+                     reference.begin()->first.first <= now_ms) {
+                expected.push_back(reference.begin()->first.second);
+                reference.erase(reference.begin());
+              }
+              CHECK(output == expected);
+            }
+          }
+          CHECK_EQ(wheel.size(), reference.size());
+          if (reference.empty())
+            CHECK(wheel.NextTime() == std::nullopt);
+          else
+            CHECK(wheel.NextTime() ==
+                  to_time(reference.begin()->first.first));
+        }
+      }}});
+}  // namespace
+}  // namespace afc::concurrent
@@ -0,0 +1,123 @@
+// Hierarchical timer wheel (Varghese and Lauck, "Hashed and Hierarchical Timing
+// Wheels"), holding callbacks that should run at given times.
+//
+// Time is divided into ticks of one millisecond. The wheel has `kLevels`
+// levels of `kSlots` slots each. A callback is stored in the level
+// corresponding to the most significant group of `kSlotBits` bits in which its
+// tick differs from the current tick, in the slot given by the value of its
+// tick in that group. Callbacks in lower levels always run before callbacks in
+// higher levels, and, within a level, callbacks in lower slots run first. When
+// the wheel advances into a slot in a level above 0, its callbacks "cascade"
+// down (i.e., are re-inserted in lower levels). Callbacks whose tick has been
+// reached are kept in a separate "due" list.
+//
+// Insertion and cancellation run in constant time. Each callback cascades at
+// most `kLevels` times.
+//
+// This class is not thread-safe.
+#ifndef __AFC_CONCURRENT_TIMER_WHEEL_H__
+#define __AFC_CONCURRENT_TIMER_WHEEL_H__
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "src/infrastructure/time.h"
+#include "src/language/once_only_function.h"
+
+namespace afc::concurrent {
+class TimerWheel {
+ public:
+  static constexpr size_t kSlotBits = 6;
+  static constexpr size_t kSlots = 1 << kSlotBits;
+  static constexpr size_t kLevels = (64 + kSlotBits - 1) / kSlotBits;
+
+  using Callback = language::OnceOnlyFunction<void()>;
+
+  // Identifies a callback given to `Insert`.
+  struct Handle {
+    size_t index;
+    size_t generation;
+
+    bool operator==(const Handle&) const = default;
+  };
+
+  TimerWheel();
+
+  Handle Insert(infrastructure::Time time, Callback callback);
+
+  // Removes (and deletes) the callback. Returns false if the callback is no
+  // longer in the wheel (e.g., because it has already been taken).
+  bool Cancel(Handle handle);
+
+  // Returns the earliest time of a callback in the wheel.
+  std::optional<infrastructure::Time> NextTime() const;
+
+  struct Entry {
+    infrastructure::Time time;
+    Callback callback;
+  };
+
+  // Removes and returns all the callbacks with a time smaller than or equal to
+  // `now`. They are sorted by their time; callbacks with the same time are
+  // returned in the order in which they were inserted.
+  std::vector<Entry> TakeExpired(infrastructure::Time now);
+
+  // Like `TakeExpired`, but returns all the callbacks.
+  std::vector<Entry> TakeAll();
+
+  size_t size() const;
+
+  // Number of times that a callback has been moved from a level to a lower
+  // level.
+  size_t cascades() const;
+
+ private:
+  using NodeIndex = uint32_t;
+  static constexpr NodeIndex kNoNode = UINT32_MAX;
+
+  // Identifies one of the lists of callbacks: either a slot in a level (at
+  // index `level * kSlots + slot`) or the due list (`kDueList`).
+  using ListIndex = size_t;
+  static constexpr ListIndex kDueList = kLevels * kSlots;
+
+  struct Node {
+    infrastructure::Time time;
+    uint64_t tick = 0;
+    // Used to preserve the insertion order of callbacks with the same time.
+    uint64_t sequence = 0;
+    std::optional<Callback> callback = std::nullopt;
+    size_t generation = 0;
+    ListIndex list = kDueList;
+    NodeIndex previous = kNoNode;
+    NodeIndex next = kNoNode;
+  };
+
+  static uint64_t Tick(const infrastructure::Time& time);
+  ListIndex ListFor(uint64_t tick) const;
+
+  void Link(NodeIndex index);
+  void Unlink(NodeIndex index);
+
+  // Moves `current_tick_` forward to `tick`, cascading callbacks as needed.
+  void Advance(uint64_t tick);
+
+  // Removes the nodes and returns their entries, sorted.
+  std::vector<Entry> Take(std::vector<NodeIndex> nodes);
+
+  std::vector<Node> nodes_;
+  std::vector<NodeIndex> free_nodes_;
+  std::array<NodeIndex, kLevels * kSlots + 1> heads_;
+
+  // Bit `i` of `occupied_[level]` is set iff the slot `i` in `level` isn't
+  // empty.
+  std::array<uint64_t, kLevels> occupied_ = {};
+
+  uint64_t current_tick_ = 0;
+  uint64_t next_sequence_ = 0;
+  size_t size_ = 0;
+  size_t cascades_ = 0;
+};
+}  // namespace afc::concurrent
+#endif  // __AFC_CONCURRENT_TIMER_WHEEL_H__
@@ -5,8 +5,10 @@
 
 #include "src/futures/delete_notification.h"
 #include "src/infrastructure/time.h"
+#include "src/infrastructure/tracker.h"
 #include "src/tests/tests.h"
 
+using afc::infrastructure::AddSeconds;
 using afc::infrastructure::Now;
 using afc::infrastructure::SecondsBetween;
 using afc::language::EmptyValue;
@@ -15,10 +17,6 @@ using afc::language::NonNull;
 using afc::language::OnceOnlyFunction;
 
 namespace afc::concurrent {
-bool operator>(const WorkQueue::Callback& a, const WorkQueue::Callback& b) {
-  return a.time > b.time;
-};
-
 /* static */ NonNull<std::shared_ptr<WorkQueue>> WorkQueue::New() {
   return MakeNonNullShared<WorkQueue>(ConstructorAccessTag());
 }
@@ -32,12 +30,17 @@ void WorkQueue::StartShutdown() {
   });
 }
 
-void WorkQueue::Schedule(WorkQueue::Callback callback) {
-  data_.lock([&](MutableData& data) {
-    data.callbacks.emplace_back(std::move(callback));
-    std::push_heap(data.callbacks.begin(), data.callbacks.end(), operator>);
+WorkQueue::CallbackId WorkQueue::Schedule(WorkQueue::Callback callback) {
+  CallbackId output = data_.lock([&](MutableData& data) {
+    return data.callbacks.Insert(callback.time, std::move(callback.callback));
   });
   schedule_observers_.Notify();
+  return output;
+}
+
+bool WorkQueue::Cancel(CallbackId id) {
+  return data_.lock(
+      [&id](MutableData& data) { return data.callbacks.Cancel(id); });
 }
 
 futures::Value<EmptyValue> WorkQueue::Wait(struct timespec time) {
@@ -55,16 +58,13 @@ void WorkQueue::Execute() { Execute(infrastructure::Now); }
 void WorkQueue::Execute(std::function<infrastructure::Time()> clock) {
   bool loop = true;
   while (loop) {
-    std::vector<OnceOnlyFunction<void()>> callbacks_ready;
+    std::vector<TimerWheel::Entry> callbacks_ready;
     data_.lock([&loop, &callbacks_ready, &clock](MutableData& data) {
       loop = data.shutting_down;
       VLOG(5) << "Executing work queue: callbacks: " << data.callbacks.size();
-      while (!data.callbacks.empty() &&
-             (data.shutting_down || data.callbacks.front().time <= clock())) {
-        callbacks_ready.push_back(std::move(data.callbacks.front().callback));
-        std::pop_heap(data.callbacks.begin(), data.callbacks.end(), operator>);
-        data.callbacks.pop_back();
-      }
+      callbacks_ready = data.shutting_down
+                            ? data.callbacks.TakeAll()
+                            : data.callbacks.TakeExpired(clock());
     });
 
     VLOG(4) << "Callbacks ready: " << callbacks_ready.size();
@@ -72,22 +72,27 @@ void WorkQueue::Execute(std::function<infrastructure::Time()> clock) {
 
     // Make sure we stay alive until all callbacks have run.
     const std::shared_ptr<WorkQueue> shared_this = shared_from_this();
-    for (auto& callback : callbacks_ready) {
+    for (TimerWheel::Entry& entry : callbacks_ready) {
       auto start = clock();
       VLOG(9) << "Running callback.";
-      std::move(callback)();
+      auto call = INLINE_TRACKER(WorkQueue_Execute_Callback);
+      std::move(entry.callback)();
+      call = nullptr;
       auto end = Now();
-      data_.lock()->execution_seconds.IncrementAndGetEventsPerSecond(
-          SecondsBetween(start, end));
+      data_.lock([&](MutableData& data) {
+        data.execution_seconds.IncrementAndGetEventsPerSecond(
+            SecondsBetween(start, end));
+        data.executed_callbacks.IncrementAndGetEventsPerSecond(1);
+        data.delay_seconds.IncrementAndGetEventsPerSecond(
+            std::max(0.0, SecondsBetween(entry.time, start)));
+      });
     }
   }
 }
 
 std::optional<struct timespec> WorkQueue::NextExecution() {
-  return data_.lock([](MutableData& data) -> std::optional<struct timespec> {
-    if (data.callbacks.empty()) return std::nullopt;
-    return data.callbacks.front().time;
-  });
+  return data_.lock(
+      [](MutableData& data) { return data.callbacks.NextTime(); });
 }
 
 double WorkQueue::RecentUtilization() const {
@@ -96,6 +101,22 @@ double WorkQueue::RecentUtilization() const {
   });
 }
 
+WorkQueue::Stats WorkQueue::RecentStats() const {
+  return data_.lock([](const MutableData& data) {
+    double callbacks_per_second = data.executed_callbacks.GetEventsPerSecond();
+    return Stats{
+        .utilization = data.execution_seconds.GetEventsPerSecond(),
+        .callbacks_per_second = callbacks_per_second,
+        .average_delay_seconds =
+            callbacks_per_second == 0
+                ? 0
+                : data.delay_seconds.GetEventsPerSecond() /
+                      callbacks_per_second,
+        .pending_callbacks = data.callbacks.size(),
+        .cascades = data.callbacks.cascades()};
+  });
+}
+
 language::Observable& WorkQueue::OnSchedule() { return schedule_observers_; }
 
 bool WorkQueue::shutting_down() const {
@@ -140,7 +161,6 @@ const bool work_queue_tests_registration = tests::Register(
         language::NonNull<std::shared_ptr<WorkQueue>> work_queue =
             WorkQueue::New();
         struct timespec time{};
-        using infrastructure::AddSeconds;
         // We insert them in some ~random order.
         for (double delta : {6, 2, 4, 3, 7, 1, 0, 5})
           work_queue->Schedule(
@@ -154,6 +174,37 @@ const bool work_queue_tests_registration = tests::Register(
           work_queue->Execute([&] { return AddSeconds(time, i + 0.5); });
         }
         CHECK(!work_queue->NextExecution().has_value());
+      }},
+     {.name = L"Cancel",
+      .callback =
+          [] {
+            NonNull<std::shared_ptr<WorkQueue>> work_queue = WorkQueue::New();
+            std::vector<int> values;
+            WorkQueue::CallbackId first = work_queue->Schedule(
+                {.callback = [&values] { values.push_back(0); }});
+            work_queue->Schedule(
+                {.callback = [&values] { values.push_back(1); }});
+            CHECK(work_queue->Cancel(first));
+            CHECK(!work_queue->Cancel(first));
+            work_queue->Execute();
+            CHECK(values == std::vector<int>({1}));
+            CHECK(!work_queue->NextExecution().has_value());
+          }},
+     {.name = L"RecentStats", .callback = [] {
+        NonNull<std::shared_ptr<WorkQueue>> work_queue = WorkQueue::New();
+        for (int i = 0; i < 10; i++)
+          work_queue->Schedule(
+              {.time = AddSeconds(Now(), 3600), .callback = [] {}});
+        work_queue->Schedule(
+            {.time = AddSeconds(Now(), -1), .callback = [] {}});
+        WorkQueue::Stats stats = work_queue->RecentStats();
+        CHECK_EQ(stats.pending_callbacks, 11ul);
+        CHECK_EQ(stats.callbacks_per_second, 0.0);
+        work_queue->Execute();
+        stats = work_queue->RecentStats();
+        CHECK_EQ(stats.pending_callbacks, 10ul);
+        CHECK_GT(stats.callbacks_per_second, 0.0);
+        CHECK_GE(stats.average_delay_seconds, 0.9);
       }}});
 
 const bool work_queue_channel_tests_registration = tests::Register(
@@ -6,10 +6,10 @@
 #include <condition_variable>
 #include <functional>
 #include <mutex>
-#include <queue>
 #include <vector>
 
 #include "src/concurrent/protected.h"
+#include "src/concurrent/timer_wheel.h"
 #include "src/futures/futures.h"
 #include "src/infrastructure/time.h"
 #include "src/language/observers.h"
@@ -56,7 +56,14 @@ class WorkQueue : public std::enable_shared_from_this<WorkQueue> {
     language::OnceOnlyFunction<void()> callback = [] {};
   };
 
-  void Schedule(Callback callback);
+  // Identifies a callback given to `Schedule`.
+  using CallbackId = TimerWheel::Handle;
+
+  CallbackId Schedule(Callback callback);
+
+  // Removes a callback (without running it). Returns false if the callback has
+  // already run (or been cancelled).
+  bool Cancel(CallbackId id);
 
   futures::Value<language::EmptyValue> Wait(infrastructure::Time time);
 
@@ -79,25 +86,44 @@ class WorkQueue : public std::enable_shared_from_this<WorkQueue> {
   // WorkQueue is spending running callbacks, recently.
   double RecentUtilization() const;
 
+  struct Stats {
+    // Same as `RecentUtilization`.
+    double utilization = 0;
+
+    // Recent rate of callbacks executed.
+    double callbacks_per_second = 0;
+
+    // Recent average of the seconds elapsed between the time at which
+    // callbacks were scheduled to run and the time at which they ran.
+    double average_delay_seconds = 0;
+
+    size_t pending_callbacks = 0;
+
+    // Total number of times that a callback has moved to a lower level of the
+    // timer wheel.
+    size_t cascades = 0;
+  };
+
+  Stats RecentStats() const;
+
   language::Observable& OnSchedule();
 
   bool shutting_down() const;
 
  private:
   struct MutableData {
-    using Queue = std::priority_queue<
-        Callback, std::vector<Callback>,
-        std::function<bool(const Callback&, const Callback&)>>;
-
-    // This is a priority queue. The elements are ~sorted by `Callback::time` in
-    // descending order (last element is the next one that should execute). This
-    // isn't a full order, but is a heap order.
-    std::vector<Callback> callbacks;
+    TimerWheel callbacks;
 
     // This is used to track the percentage of time spent executing (seconds per
     // second).
     math::DecayingCounter execution_seconds = math::DecayingCounter(1.0);
 
+    math::DecayingCounter executed_callbacks = math::DecayingCounter(1.0);
+
+    // The sum of the delays of the callbacks executed (seconds per second).
+    // Divided by `executed_callbacks`, gives the average delay.
+    math::DecayingCounter delay_seconds = math::DecayingCounter(1.0);
+
     bool shutting_down = false;
   };
   Protected<MutableData> data_;
@@ -0,0 +1,138 @@
+// A lock-free work-stealing deque (Chase and Lev, "Dynamic Circular
+// Work-Stealing Deque"), using the memory orderings from Lê et al., "Correct
+// and Efficient Work-Stealing for Weak Memory Models".
+//
+// A single thread (the "owner") may call `Push` and `Pop`, which operate on the
+// bottom of the deque (so the owner sees its elements in LIFO order). Any
+// thread may call `Steal`, which takes elements from the top.
+//
+// The deque owns the elements it contains (and deletes them when it is
+// deleted). It grows as needed, but never shrinks; buffers that have been
+// replaced are retained until the deque is deleted (since thieves may still be
+// reading from them).
+#ifndef __AFC_CONCURRENT_WORK_STEALING_DEQUE_H__
+#define __AFC_CONCURRENT_WORK_STEALING_DEQUE_H__
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace afc::concurrent {
+template <typename T>
+class WorkStealingDeque {
+ public:
+  // `initial_capacity` must be a power of two.
+  explicit WorkStealingDeque(size_t initial_capacity = 64) {
+    CHECK_GT(initial_capacity, 0ul);
+    CHECK_EQ(initial_capacity & (initial_capacity - 1), 0ul);
+    buffers_.push_back(std::make_unique<Buffer>(initial_capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // Must not run concurrently with any other method.
+  ~WorkStealingDeque() {
+    while (Pop() != nullptr) {
+    }
+  }
+
+  // Can only be called by the owner.
+  void Push(std::unique_ptr<T> value) {
+    CHECK(value != nullptr);
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(buffer->mask))
+      buffer = Grow(*buffer, top, bottom);
+    buffer->Put(bottom, value.release());
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // Can only be called by the owner. Returns the element that was most
+  // recently pushed (or nullptr, if the deque is empty).
+  std::unique_ptr<T> Pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* output = buffer->Get(bottom);
+    if (top == bottom) {
+      // The last element; we race against thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        output = nullptr;
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return std::unique_ptr<T>(output);
+  }
+
+  // Can be called by any thread. Returns the oldest element. May return
+  // nullptr (spuriously) if it races against other threads for the element.
+  std::unique_ptr<T> Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+    T* output = buffer_.load(std::memory_order_acquire)->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return nullptr;
+    return std::unique_ptr<T>(output);
+  }
+
+  // The value is approximate if other threads are modifying the deque.
+  size_t size() const {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+  }
+
+ private:
+  struct Buffer {
+    explicit Buffer(size_t capacity)
+        : mask(capacity - 1),
+          slots(std::make_unique<std::atomic<T*>[]>(capacity)) {}
+
+    T* Get(int64_t index) const {
+      return slots[index & mask].load(std::memory_order_relaxed);
+    }
+
+    void Put(int64_t index, T* value) {
+      slots[index & mask].store(value, std::memory_order_relaxed);
+    }
+
+    const size_t mask;
+    const std::unique_ptr<std::atomic<T*>[]> slots;
+  };
+
+  Buffer* Grow(const Buffer& current, int64_t top, int64_t bottom) {
+    buffers_.push_back(std::make_unique<Buffer>(2 * (current.mask + 1)));
+    Buffer* output = buffers_.back().get();
+    for (int64_t i = top; i < bottom; i++) output->Put(i, current.Get(i));
+    buffer_.store(output, std::memory_order_release);
+    return output;
+  }
+
+  // Thieves modify `top_` and the owner modifies `bottom_`; we keep them in
+  // separate cache lines.
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  std::atomic<Buffer*> buffer_;
+
+  // Only accessed by the owner.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+}  // namespace afc::concurrent
+#endif  // __AFC_CONCURRENT_WORK_STEALING_DEQUE_H__
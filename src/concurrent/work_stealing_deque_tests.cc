@@ -0,0 +1,83 @@
+#include "src/concurrent/work_stealing_deque.h"
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "src/tests/tests.h"
+
+namespace afc::concurrent {
+namespace {
+const bool tests_registration = tests::Register(
+    L"concurrent::WorkStealingDeque",
+    {{.name = L"Empty",
+      .callback =
+          [] {
+            WorkStealingDeque<int> deque;
+            CHECK(deque.Pop() == nullptr);
+            CHECK(deque.Steal() == nullptr);
+            CHECK_EQ(deque.size(), 0ul);
+          }},
+     {.name = L"PopIsLifoStealIsFifo",
+      .callback =
+          [] {
+            WorkStealingDeque<int> deque;
+            for (int i = 0; i < 4; i++) deque.Push(std::make_unique<int>(i));
+            CHECK_EQ(deque.size(), 4ul);
+            CHECK_EQ(*deque.Pop(), 3);
+            CHECK_EQ(*deque.Steal(), 0);
+            CHECK_EQ(*deque.Pop(), 2);
+            CHECK_EQ(*deque.Steal(), 1);
+            CHECK(deque.Pop() == nullptr);
+          }},
+     {.name = L"Grows",
+      .callback =
+          [] {
+            WorkStealingDeque<int> deque(2);
+            for (int i = 0; i < 1000; i++) deque.Push(std::make_unique<int>(i));
+            CHECK_EQ(*deque.Steal(), 0);
+            for (int i = 999; i > 0; i--) CHECK_EQ(*deque.Pop(), i);
+            CHECK(deque.Pop() == nullptr);
+          }},
+     {.name = L"DeletesRemainingElements",
+      .callback =
+          [] {
+            auto value = std::make_shared<int>(0);
+            {
+              WorkStealingDeque<std::shared_ptr<int>> deque;
+              deque.Push(std::make_unique<std::shared_ptr<int>>(value));
+              CHECK_EQ(value.use_count(), 2);
+            }
+            CHECK_EQ(value.use_count(), 1);
+          }},
+     {.name = L"ConcurrentSteal", .callback = [] {
+        // The owner pushes (and pops) while a few thieves steal; every element
+        // must be taken exactly once.
+        static constexpr size_t kElements = 100000;
+        WorkStealingDeque<size_t> deque(4);
+        std::vector<std::atomic<int>> taken(kElements);
+        std::atomic<bool> done = false;
+        std::vector<std::thread> thieves;
+        for (int i = 0; i < 3; i++)
+          thieves.push_back(std::thread([&] {
+            while (!done.load())
+              if (std::unique_ptr<size_t> value = deque.Steal();
+                  value != nullptr)
+                taken[*value]++;
+          }));
+        for (size_t i = 0; i < kElements; i++) {
+          deque.Push(std::make_unique<size_t>(i));
+          if (i % 3 == 0)
+            if (std::unique_ptr<size_t> value = deque.Pop(); value != nullptr)
+              taken[*value]++;
+        }
+        while (std::unique_ptr<size_t> value = deque.Pop()) taken[*value]++;
+        done = true;
+        for (std::thread& thief : thieves) thief.join();
+        while (std::unique_ptr<size_t> value = deque.Steal()) taken[*value]++;
+        for (const std::atomic<int>& count : taken) CHECK_EQ(count.load(), 1);
+      }}});
+}  // namespace
+}  // namespace afc::concurrent
@@ -59,6 +59,8 @@ using afc::infrastructure::Now;
 using afc::infrastructure::Path;
 using afc::infrastructure::PathComponent;
 using afc::infrastructure::UnixSignal;
+using afc::infrastructure::screen::Screen;
+using afc::infrastructure::screen::ScreenDecoder;
 using afc::language::EmptyValue;
 using afc::language::EraseOrDie;
 using afc::language::Error;
@@ -894,6 +896,12 @@ void EditorState::ExecutionIteration(
       buffer_registry().buffers() | gc::view::Value,
       [&handler](OpenBuffer& buffer) { buffer.AddExecutionHandlers(handler); });
 
+  for (auto it = remote_screen_receivers_.begin();
+       it != remote_screen_receivers_.end(); ++it)
+    handler.AddHandler(
+        it->fd, POLLIN | POLLPRI, [this, it](int) { ReadRemoteScreen(it); },
+        it->generation);
+
   if (shared_data_->pipe_to_communicate_internal_events.has_value())
     handler.AddHandler(
         shared_data_->pipe_to_communicate_internal_events->first,
@@ -909,6 +917,36 @@ void EditorState::ExecutionIteration(
         });
 }
 
+void EditorState::ReceiveRemoteScreen(
+    FileDescriptor fd, NonNull<std::shared_ptr<Screen>> screen) {
+  LOG(INFO) << "Receiving remote screen updates from: " << fd;
+  remote_screen_receivers_.push_back(RemoteScreenReceiver{
+      .fd = fd,
+      .generation = infrastructure::execution::NewFileDescriptorGeneration(),
+      .decoder = ScreenDecoder(std::move(screen))});
+}
+
+void EditorState::ReadRemoteScreen(
+    std::list<RemoteScreenReceiver>::iterator receiver) {
+  TRACK_OPERATION(EditorState_ReadRemoteScreen);
+  char buffer[64 * 1024];
+  while (true) {
+    ssize_t bytes_read = read(receiver->fd.read(), buffer, sizeof(buffer));
+    if (bytes_read == -1 && errno == EINTR) continue;
+    if (bytes_read == -1 && errno == EAGAIN) return;
+    if (bytes_read > 0) {
+      PossibleError result =
+          receiver->decoder.Receive(std::string_view(buffer, bytes_read));
+      if (!IsError(result)) continue;
+      LOG(INFO) << "Invalid remote screen update: " << std::get<Error>(result);
+    }
+    LOG(INFO) << "Done receiving remote screen updates: " << receiver->fd;
+    close(receiver->fd.read());
+    remote_screen_receivers_.erase(receiver);
+    return;
+  }
+}
+
 BufferRegistry& EditorState::buffer_registry() {
   return buffer_registry_.ptr().value();
 }
@@ -24,6 +24,7 @@
 #include "src/infrastructure/audio.h"
 #include "src/infrastructure/execution.h"
 #include "src/infrastructure/file_system_driver.h"
+#include "src/infrastructure/screen/screen_protocol.h"
 #include "src/insert_history.h"
 #include "src/language/ghost_type.h"
 #include "src/language/lazy_string/lazy_string.h"
@@ -229,6 +230,14 @@ class EditorState {
 
   void ExecutionIteration(infrastructure::execution::IterationHandler& handler);
 
+  // Applies the screen updates read from `fd` (see
+  // `infrastructure/screen/screen_protocol.h`) to `screen`, until `fd` reaches
+  // its end. Takes ownership of `fd`.
+  void ReceiveRemoteScreen(
+      infrastructure::FileDescriptor fd,
+      language::NonNull<std::shared_ptr<infrastructure::screen::Screen>>
+          screen);
+
   InsertHistory& insert_history() { return insert_history_; }
 
   infrastructure::audio::Player& audio_player() const { return audio_player_; }
@@ -252,6 +261,15 @@ class EditorState {
 
   static void NotifyInternalEvent(SharedData& data);
 
+  struct RemoteScreenReceiver {
+    infrastructure::FileDescriptor fd;
+    size_t generation;
+    infrastructure::screen::ScreenDecoder decoder;
+  };
+
+  // Reads the available input for the receiver, removing it if it's done.
+  void ReadRemoteScreen(std::list<RemoteScreenReceiver>::iterator receiver);
+
   EdgeStructInstance<language::lazy_string::LazyString> string_variables_;
   EdgeStructInstance<bool> bool_variables_;
   EdgeStructInstance<int> int_variables_;
@@ -291,6 +309,8 @@ class EditorState {
 
   BuffersList buffer_tree_;
 
+  std::list<RemoteScreenReceiver> remote_screen_receivers_;
+
   const language::NonNull<std::shared_ptr<concurrent::ThreadPoolWithWorkQueue>>
       thread_pool_;
 };
@@ -30,6 +30,16 @@ EdgeVariable<bool>* const multiple_buffers =
          .Description(L"Should all visible buffers be considered as active?")
          .Build();
 
+EdgeVariable<bool>* const parallel_line_generation =
+    &BoolStruct()
+         ->Add()
+         .Name(L"parallel_line_generation")
+         .Description(
+             L"Should the lines shown in the screen be generated concurrently "
+             L"(in the thread pool)? Only applies to lines that are generated "
+             L"exclusively from immutable inputs.")
+         .Build();
+
 EdgeStruct<int>* IntStruct() {
   static EdgeStruct<int>* output = new EdgeStruct<int>();
   return output;
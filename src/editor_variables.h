@@ -12,6 +12,7 @@ extern EdgeVariable<language::lazy_string::LazyString>* const buffer_sort_order;
 
 EdgeStruct<bool>* BoolStruct();
 extern EdgeVariable<bool>* const multiple_buffers;
+extern EdgeVariable<bool>* const parallel_line_generation;
 
 EdgeStruct<int>* IntStruct();
 extern EdgeVariable<int>* const buffers_to_retain;
@@ -8,6 +8,8 @@
 #include "src/infrastructure/dirname.h"
 #include "src/infrastructure/dirname_vm.h"
 #include "src/infrastructure/extended_char_vm.h"
+#include "src/infrastructure/trace_recorder.h"
+#include "src/infrastructure/trace_writer.h"
 #include "src/infrastructure/tracker.h"
 #include "src/insert_history_buffer.h"
 #include "src/language/container.h"
@@ -208,6 +210,27 @@ gc::Root<Environment> BuildEditorEnvironment(
         Tracker::ResetAll();
       }).ptr());
 
+  editor_type.ptr()->AddField(
+      Identifier{NON_EMPTY_SINGLE_LINE_CONSTANT(L"StartTraceRecording")},
+      vm::NewCallback(pool, kPurityTypeUnknown, [](EditorState&) {
+        infrastructure::StartTraceRecording();
+      }).ptr());
+
+  editor_type.ptr()->AddField(
+      Identifier{NON_EMPTY_SINGLE_LINE_CONSTANT(L"StopTraceRecording")},
+      vm::NewCallback(pool, kPurityTypeUnknown, [](EditorState&) {
+        infrastructure::StopTraceRecording();
+      }).ptr());
+
+  editor_type.ptr()->AddField(
+      Identifier{NON_EMPTY_SINGLE_LINE_CONSTANT(L"SaveTrace")},
+      vm::NewCallback(pool, kPurityTypeUnknown,
+                      [](EditorState&, LazyString path_str) -> PossibleError {
+                        DECLARE_OR_RETURN(Path path, Path::New(path_str));
+                        return infrastructure::WriteTrace(path);
+                      })
+          .ptr());
+
   editor_type.ptr()->AddField(
       Identifier{
           NonEmptySingleLine{SingleLine{LazyString{L"EnterSetBufferMode"}}}},
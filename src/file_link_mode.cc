@@ -53,9 +53,11 @@ using afc::futures::IterationControlCommand;
 using afc::futures::UnwrapVectorFuture;
 using afc::infrastructure::FileDescriptor;
 using afc::infrastructure::FileSystemDriver;
+using afc::infrastructure::FsyncPolicy;
 using afc::infrastructure::Path;
 using afc::infrastructure::PathComponent;
 using afc::infrastructure::ProcessId;
+using afc::infrastructure::WriteLineSequence;
 using afc::language::EmptyValue;
 using afc::language::Error;
 using afc::language::FromByteString;
@@ -182,9 +184,13 @@ futures::Value<PossibleError> Save(
   return std::move(path_future)
       .Transform([&editor, stat_buffer,
                   options](Path path) mutable -> futures::Value<PossibleError> {
-        return SaveContentsToFile(path, options.buffer->contents().snapshot(),
-                                  editor.thread_pool(),
-                                  options.buffer->file_system_driver().value())
+        return SaveContentsToFile(
+                   path, options.buffer->contents().snapshot(),
+                   editor.thread_pool(),
+                   options.buffer->file_system_driver().value(),
+                   options.buffer->Read(buffer_variables::fsync_on_save)
+                       ? FsyncPolicy::kSync
+                       : FsyncPolicy::kSkip)
             .Transform([options](EmptyValue) mutable {
               return options.buffer->PersistState();
             })
@@ -212,30 +218,18 @@ futures::Value<PossibleError> Save(
 
 futures::Value<PossibleError> SaveContentsToOpenFile(
     ThreadPoolWithWorkQueue& thread_pool, Path original_path, Path path,
-    FileDescriptor fd, LineSequence contents) {
-  return thread_pool.Run([contents, original_path, path, fd]() {
+    FileDescriptor fd, LineSequence contents, FsyncPolicy fsync_policy) {
+  return thread_pool.Run([contents, original_path, path, fd, fsync_policy]() {
     LOG(INFO) << original_path
               << ": SaveContentsToOpenFile: writing contents: " << path;
-    // TODO: It'd be significant more efficient to do fewer (bigger) writes.
-    std::optional<PossibleError> error;
-    contents.EveryLine([&](LineNumber position, const Line& line) {
-      std::string str =
-          (position == LineNumber(0) ? "" : "\n") + line.contents().ToBytes();
-      if (write(fd.read(), str.c_str(), str.size()) == -1) {
-        Error write_error{path.read() + LazyString{L": write failed: "} +
-                          LazyString{std::to_wstring(fd.read())} +
-                          LazyString{L": "} +
-                          LazyString{FromByteString(strerror(errno))}};
-        LOG(INFO) << original_path
-                  << ": SaveContentsToOpenFile: Error: " << write_error;
-        error = std::move(write_error);
-        return false;
-      }
-      return true;
-    });
+    PossibleError output = AugmentError(
+        path.read(), WriteLineSequence(fd, contents, fsync_policy));
+    if (IsError(output))
+      LOG(INFO) << original_path
+                << ": SaveContentsToOpenFile: Error: " << GetError(output);
     LOG(INFO) << original_path
               << ": SaveContentsToOpenFile: Writing done: " << path;
-    return error.value_or(Success());
+    return output;
   });
 }
 }  // namespace
@@ -244,8 +238,8 @@ futures::Value<PossibleError> SaveContentsToOpenFile(
 // notified.
 futures::Value<PossibleError> SaveContentsToFile(
     const Path& path, LineSequence contents,
-    ThreadPoolWithWorkQueue& thread_pool,
-    FileSystemDriver& file_system_driver) {
+    ThreadPoolWithWorkQueue& thread_pool, FileSystemDriver& file_system_driver,
+    FsyncPolicy fsync_policy) {
   Path tmp_path = Path::Join(
       ValueOrDie(path.Dirname()),
       ValueOrDie(PathComponent::New(ValueOrDie(path.Basename()).read() +
@@ -271,10 +265,10 @@ futures::Value<PossibleError> SaveContentsToFile(
             });
       })
       .Transform([&thread_pool, path, contents = std::move(contents), tmp_path,
-                  &file_system_driver](FileDescriptor fd) {
+                  &file_system_driver, fsync_policy](FileDescriptor fd) {
         CHECK_NE(fd.read(), -1);
         return OnError(SaveContentsToOpenFile(thread_pool, path, tmp_path, fd,
-                                              contents),
+                                              contents, fsync_policy),
                        [&file_system_driver, fd](Error error) {
                          file_system_driver.Close(fd);
                          return MakeUnexpected(error);
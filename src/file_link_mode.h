@@ -10,6 +10,7 @@
 #include "src/editor.h"
 #include "src/futures/futures.h"
 #include "src/infrastructure/dirname.h"
+#include "src/infrastructure/file_descriptor_writer.h"
 #include "src/language/error/value_or_error.h"
 #include "src/language/lazy_string/char_buffer.h"
 #include "src/language/text/line_sequence.h"
@@ -22,7 +23,8 @@ namespace editor {
 futures::Value<language::PossibleError> SaveContentsToFile(
     const infrastructure::Path& path, language::text::LineSequence contents,
     concurrent::ThreadPoolWithWorkQueue& thread_pool,
-    infrastructure::FileSystemDriver& file_system_driver);
+    infrastructure::FileSystemDriver& file_system_driver,
+    infrastructure::FsyncPolicy fsync_policy);
 
 struct OpenFileOptions {
   EditorState& editor_state;
@@ -1,6 +1,7 @@
 #include "src/futures/futures.h"
 
 #include <ranges>
+#include <thread>
 #include <variant>
 #include <vector>
 
@@ -16,6 +17,7 @@ using afc::language::MakeNonNullShared;
 using afc::language::NonNull;
 using afc::language::PossibleError;
 using afc::language::Success;
+using afc::language::ValueOrDie;
 using afc::language::lazy_string::LazyString;
 
 namespace afc::futures {
@@ -209,6 +211,130 @@ const bool futures_loop_tests_registration = tests::Register(
         });
       }}});
 
+const bool futures_ready_value_tests_registration = tests::Register(
+    L"FuturesReadyValue",
+    {{.name = L"TransformChain",
+      .callback =
+          [] {
+            Value<int> value = Past(0);
+            for (int i = 0; i < 100; i++)
+              value = std::move(value).Transform([](int x) { return x + 1; });
+            CHECK(value.has_value());
+            CHECK_EQ(value.Get().value(), 100);
+          }},
+     {.name = L"TransformReturningFuture",
+      .callback =
+          [] {
+            Future<int> inner;
+            Value<int> value =
+                Past(1).Transform([&inner](int) -> Value<int> {
+                  return std::move(inner.value);
+                });
+            CHECK(!value.has_value());
+            std::move(inner.consumer)(5);
+            CHECK_EQ(value.Get().value(), 5);
+          }},
+     {.name = L"TransformStopsOnError",
+      .callback =
+          [] {
+            std::optional<language::ValueOrError<int>> result;
+            Past(language::ValueOrError<int>(Error{LazyString{L"xyz"}}))
+                .Transform([](int) {
+                  CHECK(false);
+                  return Success(1);
+                })
+                .SetConsumer([&result](language::ValueOrError<int> value) {
+                  result = value;
+                });
+            CHECK_EQ(GetError(result.value()), Error{LazyString{L"xyz"}});
+          }},
+     {.name = L"MoveOnly",
+      .callback =
+          [] {
+            std::unique_ptr<int> output;
+            Past(std::make_unique<int>(4))
+                .Transform([](std::unique_ptr<int> x) {
+                  (*x)++;
+                  return x;
+                })
+                .SetConsumer([&output](std::unique_ptr<int> x) {
+                  output = std::move(x);
+                });
+            CHECK_EQ(*output, 5);
+          }},
+     {.name = L"DoubleConsumer", .callback = [] {
+        Value<int> value = Past(0);
+        std::move(value).SetConsumer([](int) {});
+        CHECK(!value.has_value());
+        tests::ForkAndWaitForFailure(
+            [&] { std::move(value).SetConsumer([](int) {}); });
+      }}});
+
+Value<int> AddCoroutine(Value<int> a, Value<int> b) {
+  int a_value = co_await std::move(a);
+  int b_value = co_await std::move(b);
+  co_return a_value + b_value;
+}
+
+ValueOrError<int> DivideCoroutine(ValueOrError<int> a, ValueOrError<int> b) {
+  DECLARE_OR_CO_RETURN(int a_value, co_await std::move(a));
+  DECLARE_OR_CO_RETURN(int b_value, co_await std::move(b));
+  if (b_value == 0) co_return Error{LazyString{L"Division by zero"}};
+  co_return a_value / b_value;
+}
+
+const bool futures_coroutine_tests_registration = tests::Register(
+    L"FuturesCoroutine",
+    {{.name = L"ReadyValues",
+      .callback =
+          [] {
+            Value<int> output = AddCoroutine(Past(2), Past(3));
+            CHECK_EQ(output.Get().value(), 5);
+          }},
+     {.name = L"Suspends",
+      .callback =
+          [] {
+            Future<int> a;
+            Future<int> b;
+            Value<int> output =
+                AddCoroutine(std::move(a.value), std::move(b.value));
+            CHECK(!output.has_value());
+            std::move(b.consumer)(10);
+            CHECK(!output.has_value());
+            std::move(a.consumer)(4);
+            CHECK_EQ(output.Get().value(), 14);
+          }},
+     {.name = L"ResumesInOtherThread",
+      .callback =
+          [] {
+            Future<int> a;
+            Value<int> output = AddCoroutine(std::move(a.value), Past(1));
+            std::thread thread(
+                [consumer = std::move(a.consumer)] mutable {
+                  std::move(consumer)(41);
+                });
+            thread.join();
+            CHECK_EQ(output.Get().value(), 42);
+          }},
+     {.name = L"Errors", .callback = [] {
+        CHECK_EQ(ValueOrDie(DivideCoroutine(Past(Success(12)),
+                                            Past(Success(4)))
+                                .Get()
+                                .value()),
+                 3);
+        CHECK_EQ(GetError(DivideCoroutine(Past(Success(12)),
+                                          Past(Success(0)))
+                              .Get()
+                              .value()),
+                 Error{LazyString{L"Division by zero"}});
+        Future<language::ValueOrError<int>> a;
+        ValueOrError<int> output =
+            DivideCoroutine(std::move(a.value), Past(Success(0)));
+        CHECK(!output.has_value());
+        std::move(a.consumer)(Error{LazyString{L"Bad input"}});
+        CHECK_EQ(GetError(output.Get().value()),
+                 Error{LazyString{L"Bad input"}});
+      }}});
 }  // namespace
 
 }  // namespace afc::futures
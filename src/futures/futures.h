@@ -28,10 +28,14 @@
 
 #include <glog/logging.h>
 
+#include <atomic>
+#include <coroutine>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <type_traits>
+#include <variant>
 
 #include "src/concurrent/protected.h"
 #include "src/language/error/value_or_error.h"
@@ -47,6 +51,9 @@ struct Future;
 template <typename Type>
 class Value;
 
+template <typename Type>
+class ValueAwaiter;
+
 enum class IterationControlCommand { kContinue, kStop };
 
 enum class ErrorHandling { Enable, Disable };
@@ -85,6 +92,11 @@ struct TransformTraits {
                         typename ReturnType::Consumer consumer) {
     ReturnTraits::Feed(callable(std::move(initial_value)), std::move(consumer));
   }
+
+  // Used when the initial value is already known.
+  static ReturnType Apply(InitialType initial_value, Callable& callable) {
+    return ReturnType(callable(std::move(initial_value)));
+  }
 };
 
 template <class InitialType, class Callable>
@@ -106,6 +118,17 @@ struct TransformTraits<language::ValueOrError<InitialType>, Callable,
                    }},
                std::move(initial_value));
   }
+
+  static ReturnType Apply(language::ValueOrError<InitialType> initial_value,
+                          Callable& callable) {
+    return std::visit(
+        language::overload{
+            [](language::Error error) { return ReturnType(std::move(error)); },
+            [&](InitialType value) {
+              return ReturnType(callable(std::move(value)));
+            }},
+        std::move(initial_value));
+  }
 };
 
 template <class T>
@@ -136,33 +159,48 @@ class Value {
 
   template <typename Other,
             typename = std::enable_if_t<std::is_convertible_v<Other, Type>>>
-  Value(Value<Other>&& other) {
-    std::move(other).SetConsumer([data = data_](Other&& other_immediate) {
-      data->Feed(static_cast<Type>(std::move(other_immediate)));
-    });
-  }
+  Value(Value<Other>&& other) : state_(ConvertState(std::move(other))) {}
 
   template <typename U,
             typename = std::enable_if_t<std::is_constructible_v<Type, U> &&
                                         !is_future<std::decay_t<U>>::value>>
-  Value(U&& early_value) {
-    data_->Feed(std::move(early_value));
-  }
+  Value(U&& early_value)
+      : state_(std::in_place_index<0>, std::move(early_value)) {}
 
   using Consumer = language::OnceOnlyFunction<void(Type)>;
   using type = Type;
 
-  bool has_value() const { return data_->has_value(); }
-  std::optional<Type> Get() const { return data_->read(); }
+  bool has_value() const {
+    if (state_.index() == 0) return true;
+    const std::shared_ptr<FutureData>& data = std::get<1>(state_);
+    return data != nullptr && data->has_value();
+  }
+
+  std::optional<Type> Get() const {
+    if (const Type* ready_value = std::get_if<0>(&state_);
+        ready_value != nullptr)
+      return *ready_value;
+    const std::shared_ptr<FutureData>& data = std::get<1>(state_);
+    if (data == nullptr) return std::nullopt;
+    return data->read();
+  }
 
   void SetConsumer(Consumer consumer) && {
-    data_->SetConsumer(std::move(consumer));
+    if (state_.index() == 0) {
+      std::move(consumer)(TakeReadyValue());
+      return;
+    }
+    const std::shared_ptr<FutureData> data = std::get<1>(std::move(state_));
+    state_.template emplace<1>(nullptr);
+    CHECK(data != nullptr) << "Consumer set on a value already consumed.";
+    data->SetConsumer(std::move(consumer));
   }
 
   template <ErrorHandling ErrorHandlingValue = ErrorHandling::Enable,
             typename Callable>
   auto Transform(Callable callable) && {
     using Traits = TransformTraits<Type, Callable, ErrorHandlingValue>;
+    if (state_.index() == 0) return Traits::Apply(TakeReadyValue(), callable);
     Future<typename Traits::ReturnType::type> output;
     std::move(*this).SetConsumer(
         [consumer = std::move(output.consumer),
@@ -184,8 +222,16 @@ class Value {
   template <typename Callable>
   auto ConsumeErrors(Callable error_callback) &&;
 
+  // Allows functions returning a `Value<Type>` to be coroutines. The
+  // coroutine starts running immediately (as soon as it is called) and the
+  // value is given by `co_return`. Exceptions aren't supported.
+  class promise_type;
+
  private:
+  template <typename>
+  friend class Value;
   friend Future<Type>;
+  friend ValueAwaiter<Type>;
 
   // This class is thread-safe.
   class FutureData {
@@ -249,9 +295,36 @@ class Value {
     concurrent::Protected<Data> data_;
   };
 
-  Value(std::shared_ptr<FutureData> data) : data_(std::move(data)) {}
+  Value(std::shared_ptr<FutureData> data)
+      : state_(std::in_place_index<1>, std::move(data)) {}
+
+  template <typename Other>
+  static std::variant<Type, std::shared_ptr<FutureData>> ConvertState(
+      Value<Other>&& other) {
+    if (other.state_.index() == 0)
+      return std::variant<Type, std::shared_ptr<FutureData>>(
+          std::in_place_index<0>,
+          static_cast<Type>(other.TakeReadyValue()));
+    auto data = std::make_shared<FutureData>();
+    std::move(other).SetConsumer([data](Other&& other_immediate) {
+      data->Feed(static_cast<Type>(std::move(other_immediate)));
+    });
+    return std::variant<Type, std::shared_ptr<FutureData>>(
+        std::in_place_index<1>, std::move(data));
+  }
 
-  std::shared_ptr<FutureData> data_ = std::make_shared<FutureData>();
+  // Requires that the value is ready. Leaves `this` in the consumed state.
+  Type TakeReadyValue() {
+    Type output = std::get<0>(std::move(state_));
+    state_.template emplace<1>(nullptr);
+    return output;
+  }
+
+  // Values known when the `Value` is created (e.g., `Past`) are held directly,
+  // avoiding the allocation (and locking) of a `FutureData`. Otherwise, holds
+  // the `FutureData` shared with the corresponding `Future::consumer`. Once the
+  // value has been given to a consumer, holds nullptr.
+  std::variant<Type, std::shared_ptr<FutureData>> state_;
 };
 
 template <typename T>
@@ -275,6 +348,70 @@ struct Future {
         value(std::move(data)) {}
 };
 
+template <typename Type>
+class Value<Type>::promise_type {
+ public:
+  Value<Type> get_return_object() { return std::move(future_.value); }
+  std::suspend_never initial_suspend() noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept { return {}; }
+  void return_value(Type value) {
+    std::move(future_.consumer)(std::move(value));
+  }
+  void unhandled_exception() { LOG(FATAL) << "Exception in coroutine."; }
+
+ private:
+  Future<Type> future_;
+};
+
+// Returned by `co_await` on a `Value<Type>`. If the value is already known,
+// the coroutine doesn't suspend. Otherwise, it is resumed by the thread that
+// gives the value to the future (inside its call to the consumer).
+template <typename Type>
+class ValueAwaiter {
+ public:
+  explicit ValueAwaiter(Value<Type> value) : value_(std::move(value)) {}
+
+  bool await_ready() {
+    if (value_.state_.index() == 0) {
+      result_.emplace(value_.TakeReadyValue());
+      return true;
+    }
+    return false;
+  }
+
+  // The consumer may run (in a different thread) before we return; we use
+  // `state_` to determine who should resume the coroutine.
+  bool await_suspend(std::coroutine_handle<> handle) {
+    std::move(value_).SetConsumer([this, handle](Type value) {
+      result_.emplace(std::move(value));
+      if (state_.exchange(State::kReady) == State::kSuspended) handle.resume();
+    });
+    return state_.exchange(State::kSuspended) != State::kReady;
+  }
+
+  Type await_resume() { return std::move(result_.value()); }
+
+ private:
+  enum class State { kPending, kSuspended, kReady };
+
+  Value<Type> value_;
+  std::optional<Type> result_;
+  std::atomic<State> state_ = State::kPending;
+};
+
+template <typename Type>
+ValueAwaiter<Type> operator co_await(Value<Type>&& value) {
+  return ValueAwaiter<Type>(std::move(value));
+}
+
+// Like `DECLARE_OR_RETURN`, for coroutines returning a `ValueOrError`.
+#define DECLARE_OR_CO_RETURN(variable, expr)                                 \
+  decltype(auto) CONCAT(tmp_result_, __LINE__) = expr;                       \
+  if (IsError(CONCAT(tmp_result_, __LINE__)))                                \
+    co_return language::MakeUnexpected(                                     \
+        GetError(CONCAT(tmp_result_, __LINE__)));                            \
+  variable = language::ValueOrDie(std::move(CONCAT(tmp_result_, __LINE__)));
+
 // ConsumeErrors only makes sense if Type is a ValueOrError<>.
 //
 // It would be ideal to define that just for those future::Value<> instances,
@@ -301,9 +438,7 @@ auto Value<Type>::ConsumeErrors(Callable error_callback) && {
 
 template <typename Type>
 static Value<Type> Past(Type value) {
-  Future<Type> output;
-  std::move(output.consumer)(std::move(value));
-  return std::move(output.value);
+  return Value<Type>(std::move(value));
 }
 
 template <typename Callable>
@@ -0,0 +1,67 @@
+// Benchmarks for chains of `futures::Value` transformations, such as those
+// evaluated (typically, with values that are already known) when applying a
+// transformation to a buffer.
+
+#include "src/futures/futures.h"
+#include "src/infrastructure/time.h"
+#include "src/tests/benchmarks.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::tests::BenchmarkName;
+
+namespace afc::futures {
+namespace {
+constexpr int kSteps = 1000;
+
+Value<int> TransformChain(Value<int> value) {
+  for (int i = 0; i < kSteps; i++)
+    value = std::move(value).Transform([](int x) { return x + 1; });
+  return value;
+}
+
+// Returns the time per step in a chain of `kSteps` transformations, starting
+// from a value that is already known.
+bool registration_transform_ready = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"Futures::TransformChainReady")},
+    [](int elements) {
+      auto start = Now();
+      for (int run = 0; run < elements; run++)
+        CHECK_EQ(TransformChain(Past(run)).Get().value(), run + kSteps);
+      return SecondsBetween(start, Now()) / elements / kSteps;
+    });
+
+// Like `Futures::TransformChainReady`, but the value only becomes known after
+// the chain has been created.
+bool registration_transform_deferred = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"Futures::TransformChainDeferred")},
+    [](int elements) {
+      auto start = Now();
+      for (int run = 0; run < elements; run++) {
+        Future<int> input;
+        Value<int> output = TransformChain(std::move(input.value));
+        std::move(input.consumer)(run);
+        CHECK_EQ(output.Get().value(), run + kSteps);
+      }
+      return SecondsBetween(start, Now()) / elements / kSteps;
+    });
+
+Value<int> AwaitChain(Value<int> value) {
+  int output = co_await std::move(value);
+  for (int i = 0; i < kSteps; i++) output = co_await Past(output + 1);
+  co_return output;
+}
+
+// The chain of `Futures::TransformChainReady`, expressed as a coroutine.
+bool registration_await_ready = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"Futures::AwaitChainReady")},
+    [](int elements) {
+      auto start = Now();
+      for (int run = 0; run < elements; run++)
+        CHECK_EQ(AwaitChain(Past(run)).Get().value(), run + kSteps);
+      return SecondsBetween(start, Now()) / elements / kSteps;
+    });
+}  // namespace
+}  // namespace afc::futures
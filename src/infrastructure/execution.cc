@@ -1,65 +1,425 @@
 #include "src/infrastructure/execution.h"
 
 #include <poll.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+#include <unistd.h>
 
+#include <array>
+#include <atomic>
 #include <cmath>
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "src/infrastructure/file_system_driver.h"
-#include "src/language/container.h"
+#include "src/infrastructure/tracker.h"
+#include "src/language/error/value_or_error.h"
+#include "src/tests/tests.h"
 
-using afc::language::InsertOrDie;
+using afc::language::ValueOrDie;
 
 namespace afc::infrastructure::execution {
+// Waits for events in the file descriptors of an iteration and runs their
+// handlers.
+class ExecutionEnvironment::Backend {
+ public:
+  struct Handler {
+    FileDescriptor fd;
+    int requested_events;
+    std::function<void(int)> callback;
+    size_t generation;
+  };
+
+  virtual ~Backend() = default;
+
+  // Returns false if the wait was interrupted by a signal.
+  virtual bool Run(std::vector<Handler>& handlers, int timeout_ms) = 0;
+
+ protected:
+  // Runs the handler if `events` (which must be `POLL*` values) call for it.
+  static void Dispatch(Handler& handler, int events) {
+    if ((events & (POLLIN | POLLPRI | POLLHUP)) == 0) return;
+    TRACK_OPERATION(ExecutionEnvironment_Handler);
+    handler.callback(events);
+  }
+};
+
 namespace {
+using Handler = ExecutionEnvironment::Backend::Handler;
+
 class IterationHandlerImpl : public IterationHandler {
-  std::vector<std::pair<struct pollfd, std::function<void(int)>>> handler_;
+  std::vector<Handler> handlers_;
 
  public:
   void AddHandler(FileDescriptor fd, int requested_events,
-                  std::function<void(int)> handler) override {
-    struct pollfd pollfd;
-    pollfd.fd = fd.read();
-    pollfd.events = requested_events;
-    handler_.push_back({std::move(pollfd), std::move(handler)});
-  }
-
-  void Run(const ExecutionEnvironmentOptions& options) {
-    // The file descriptor at position i will be either fd or fd_error
-    // of buffers[i]. The exception to this is fd 0 (at the end).
-    struct pollfd fds[handler_.size()];
-    for (size_t i = 0; i < handler_.size(); i++) fds[i] = handler_[i].first;
-    // buffers.reserve(sizeof(fds) / sizeof(fds[0]));
-    Time now = Now();
-    std::optional<Time> next_execution = options.get_next_alarm();
-    int timeout_ms = next_execution.has_value()
-                         ? static_cast<int>(ceil(std::min(
-                               std::max(0.0, MillisecondsBetween(
-                                                 now, next_execution.value())),
-                               1000.0)))
-                         : 1000;
-    VLOG(5) << "Timeout: " << timeout_ms << " has value "
-            << (next_execution.has_value() ? "yes" : "no");
-    if (poll(fds, handler_.size(), timeout_ms) == -1) {
+                  std::function<void(int)> handler,
+                  size_t generation) override {
+    handlers_.push_back(Handler{.fd = fd,
+                                .requested_events = requested_events,
+                                .callback = std::move(handler),
+                                .generation = generation});
+  }
+
+  std::vector<Handler>& handlers() { return handlers_; }
+};
+
+class PollBackend : public ExecutionEnvironment::Backend {
+ public:
+  bool Run(std::vector<Handler>& handlers, int timeout_ms) override {
+    std::vector<struct pollfd> fds(handlers.size());
+    for (size_t i = 0; i < handlers.size(); i++) {
+      fds[i].fd = handlers[i].fd.read();
+      fds[i].events = handlers[i].requested_events;
+    }
+    int result;
+    {
+      TRACK_OPERATION(ExecutionEnvironment_Wait);
+      result = poll(fds.data(), fds.size(), timeout_ms);
+    }
+    if (result == -1) {
       CHECK_EQ(errno, EINTR) << "poll failed: " << strerror(errno);
-      options.on_signals();
-      return;
+      return false;
     }
-    for (size_t i = 0; i < handler_.size(); i++)
-      if (fds[i].revents & (POLLIN | POLLPRI | POLLHUP))
-        handler_[i].second(fds[i].revents);
+    TRACK_OPERATION(ExecutionEnvironment_Dispatch);
+    for (size_t i = 0; i < handlers.size(); i++)
+      Dispatch(handlers[i], fds[i].revents);
+    return true;
   }
 };
+
+#if defined(__linux__)
+// File descriptors are registered (edge-triggered) when they are first given
+// to `AddHandler` and remain registered while their generation doesn't change,
+// so the cost of an iteration doesn't grow with the number of idle file
+// descriptors.
+//
+// Handlers aren't required to consume all the available input (e.g.,
+// `FileDescriptorReader` reads a bounded amount), and may skip iterations. So
+// we retain the events signaled for each file descriptor until a (level
+// triggered) `poll` of just the file descriptors with pending events shows that
+// they have been consumed.
+class EpollBackend : public ExecutionEnvironment::Backend {
+  static constexpr size_t kMaxEvents = 256;
+
+  struct Registration {
+    uint32_t generation;
+    // The `POLL*` events registered with epoll.
+    int events;
+    // The `POLL*` events that have been signaled and may not have been consumed
+    // yet.
+    int pending_events = 0;
+  };
+
+  const int epoll_fd_;
+  std::unordered_map<int, Registration> registrations_;
+
+ public:
+  EpollBackend() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+    CHECK_NE(epoll_fd_, -1) << "epoll_create1 failed: " << strerror(errno);
+  }
+
+  ~EpollBackend() override { close(epoll_fd_); }
+
+  bool Run(std::vector<Handler>& handlers, int timeout_ms) override {
+    for (const Handler& handler : handlers) Register(handler);
+    if (RefreshPendingEvents(handlers)) timeout_ms = 0;
+
+    std::array<struct epoll_event, kMaxEvents> events;
+    int count;
+    {
+      TRACK_OPERATION(ExecutionEnvironment_Wait);
+      count = epoll_wait(epoll_fd_, events.data(), events.size(), timeout_ms);
+    }
+    if (count == -1) {
+      CHECK_EQ(errno, EINTR) << "epoll_wait failed: " << strerror(errno);
+      return false;
+    }
+    for (int i = 0; i < count; i++) {
+      // Events for a previous generation come from files that were closed
+      // while some other process retained them (e.g., a child process that
+      // inherited them); we can no longer remove them from epoll.
+      if (auto it = registrations_.find(FileDescriptorFromData(events[i].data));
+          it != registrations_.end() &&
+          it->second.generation == GenerationFromData(events[i].data))
+        it->second.pending_events |= ToPollEvents(events[i].events);
+    }
+
+    TRACK_OPERATION(ExecutionEnvironment_Dispatch);
+    for (Handler& handler : handlers)
+      Dispatch(handler,
+               registrations_.at(handler.fd.read()).pending_events &
+                   (handler.requested_events | POLLERR | POLLHUP));
+    return true;
+  }
+
+ private:
+  static int ToPollEvents(uint32_t events) {
+    int output = 0;
+    if (events & EPOLLIN) output |= POLLIN;
+    if (events & EPOLLPRI) output |= POLLPRI;
+    if (events & EPOLLOUT) output |= POLLOUT;
+    if (events & EPOLLERR) output |= POLLERR;
+    if (events & EPOLLHUP) output |= POLLHUP;
+    return output;
+  }
+
+  static uint32_t ToEpollEvents(int events) {
+    uint32_t output = EPOLLET;
+    if (events & POLLIN) output |= EPOLLIN;
+    if (events & POLLPRI) output |= EPOLLPRI;
+    if (events & POLLOUT) output |= EPOLLOUT;
+    return output;
+  }
+
+  static int FileDescriptorFromData(epoll_data_t data) {
+    return static_cast<int>(data.u64 & 0xFFFFFFFF);
+  }
+
+  static uint32_t GenerationFromData(epoll_data_t data) {
+    return static_cast<uint32_t>(data.u64 >> 32);
+  }
+
+  void Control(int operation, int fd, Registration& registration) {
+    TRACK_OPERATION(ExecutionEnvironment_EpollControl);
+    struct epoll_event event;
+    event.events = ToEpollEvents(registration.events);
+    event.data.u64 = (static_cast<uint64_t>(registration.generation) << 32) |
+                     static_cast<uint32_t>(fd);
+    if (epoll_ctl(epoll_fd_, operation, fd, &event) != -1) return;
+    if (operation == EPOLL_CTL_ADD && errno == EEXIST) {
+      // The file was already registered under a different generation.
+      return Control(EPOLL_CTL_MOD, fd, registration);
+    }
+    // epoll doesn't support regular files, which are always ready.
+    CHECK_EQ(errno, EPERM) << "epoll_ctl failed: " << strerror(errno);
+    registration.pending_events = POLLIN;
+  }
+
+  void Register(const Handler& handler) {
+    const int fd = handler.fd.read();
+    const uint32_t generation = static_cast<uint32_t>(handler.generation);
+    if (auto it = registrations_.find(fd);
+        it != registrations_.end() && it->second.generation == generation) {
+      if ((it->second.events | handler.requested_events) == it->second.events)
+        return;
+      it->second.events |= handler.requested_events;
+      return Control(EPOLL_CTL_MOD, fd, it->second);
+    }
+    Registration& registration = registrations_[fd];
+    registration = Registration{.generation = generation,
+                                .events = handler.requested_events};
+    Control(EPOLL_CTL_ADD, fd, registration);
+  }
+
+  // Replaces the pending events of the file descriptors in `handlers` that
+  // have any with their current state. Returns true if any remain.
+  bool RefreshPendingEvents(const std::vector<Handler>& handlers) {
+    std::vector<struct pollfd> fds;
+    for (const Handler& handler : handlers)
+      if (int fd = handler.fd.read(); registrations_.at(fd).pending_events != 0)
+        fds.push_back(pollfd{.fd = fd,
+                             .events = static_cast<short>(
+                                 registrations_.at(fd).events),
+                             .revents = 0});
+    if (fds.empty()) return false;
+    TRACK_OPERATION(ExecutionEnvironment_RefreshPendingEvents);
+    if (poll(fds.data(), fds.size(), 0) == -1) {
+      CHECK_EQ(errno, EINTR) << "poll failed: " << strerror(errno);
+      return true;  // Retain the pending events.
+    }
+    bool output = false;
+    for (const struct pollfd& fd : fds) {
+      registrations_.at(fd.fd).pending_events = fd.revents & ~POLLNVAL;
+      output = output || registrations_.at(fd.fd).pending_events != 0;
+    }
+    return output;
+  }
+};
+#endif
+
+std::unique_ptr<ExecutionEnvironment::Backend> NewBackend() {
+#if defined(__linux__)
+  return std::make_unique<EpollBackend>();
+#else
+  return std::make_unique<PollBackend>();
+#endif
+}
 }  // namespace
 
+size_t NewFileDescriptorGeneration() {
+  static std::atomic<size_t> next_generation = 1;
+  return next_generation++;
+}
+
 ExecutionEnvironment::ExecutionEnvironment(ExecutionEnvironmentOptions options)
-    : options_(std::move(options)) {}
+    : options_(std::move(options)), backend_(NewBackend()) {}
+
+ExecutionEnvironment::~ExecutionEnvironment() = default;
 
 void ExecutionEnvironment::Run() {
   while (!options_.stop_check()) {
     IterationHandlerImpl handler;
     options_.on_iteration(handler);
-    handler.Run(options_);
+    std::optional<Time> next_execution = options_.get_next_alarm();
+    int timeout_ms =
+        next_execution.has_value()
+            ? static_cast<int>(ceil(std::min(
+                  std::max(0.0, MillisecondsBetween(Now(),
+                                                    next_execution.value())),
+                  1000.0)))
+            : 1000;
+    VLOG(5) << "Timeout: " << timeout_ms << " has value "
+            << (next_execution.has_value() ? "yes" : "no");
+    if (!backend_->Run(handler.handlers(), timeout_ms)) options_.on_signals();
   }
 }
-}  // namespace afc::infrastructure::execution
\ No newline at end of file
+
+namespace {
+// Runs an environment (where `on_iteration` adds handlers) until `done` returns
+// true. Returns the seconds elapsed.
+double RunUntil(std::function<bool()> done,
+                std::function<void(IterationHandler&)> on_iteration) {
+  Time start = Now();
+  ExecutionEnvironment(ExecutionEnvironmentOptions{
+                           .stop_check = std::move(done),
+                           .get_next_alarm = [] { return std::nullopt; },
+                           .on_signals = [] {},
+                           .on_iteration = std::move(on_iteration)})
+      .Run();
+  return SecondsBetween(start, Now());
+}
+
+struct Pipe {
+  FileDescriptor read;
+  FileDescriptor write;
+
+  static Pipe New() {
+    int fds[2];
+    CHECK_EQ(pipe(fds), 0);
+    return Pipe{.read = ValueOrDie(FileDescriptor::New(fds[0])),
+                .write = ValueOrDie(FileDescriptor::New(fds[1]))};
+  }
+
+  void Write(std::string data) const {
+    CHECK_EQ(::write(write.read(), data.c_str(), data.size()),
+             static_cast<ssize_t>(data.size()));
+  }
+
+  std::string ReadBytes(size_t size) const {
+    std::string output(size, '\0');
+    ssize_t result = ::read(read.read(), output.data(), size);
+    CHECK_GE(result, 0);
+    output.resize(result);
+    return output;
+  }
+
+  void Close() const {
+    close(read.read());
+    close(write.read());
+  }
+};
+
+// In these tests, every iteration has a file descriptor ready (so a test that
+// waits for the timeout is missing events).
+const bool tests_registration = tests::Register(
+    L"ExecutionEnvironment",
+    {{.name = L"RunsHandler",
+      .callback =
+          [] {
+            Pipe pipe = Pipe::New();
+            pipe.Write("hey");
+            std::string input;
+            RunUntil([&] { return !input.empty(); },
+                     [&](IterationHandler& handler) {
+                       handler.AddHandler(pipe.read, POLLIN, [&](int events) {
+                         CHECK(events & POLLIN);
+                         input += pipe.ReadBytes(100);
+                       });
+                     });
+            CHECK_EQ(input, "hey");
+            pipe.Close();
+          }},
+     {.name = L"HandlerDoesNotConsumeAllInput",
+      .callback =
+          [] {
+            Pipe pipe = Pipe::New();
+            pipe.Write("abcde");
+            std::string input;
+            double seconds = RunUntil(
+                [&] { return input.size() == 5; },
+                [&](IterationHandler& handler) {
+                  handler.AddHandler(pipe.read, POLLIN, [&](int) {
+                    input += pipe.ReadBytes(1);
+                  });
+                });
+            CHECK_EQ(input, "abcde");
+            CHECK_LT(seconds, 0.5);
+            pipe.Close();
+          }},
+     {.name = L"HandlerSkipsIterations",
+      .callback =
+          [] {
+            Pipe pipe = Pipe::New();
+            size_t iteration = 0;
+            std::string input;
+            RunUntil([&] { return input == "ab"; },
+                     [&](IterationHandler& handler) {
+                       switch (iteration++) {
+                         case 0:
+                           pipe.Write("a");
+                           break;
+                         case 1:
+                           // Written while no handler is registered.
+                           pipe.Write("b");
+                           return;
+                       }
+                       handler.AddHandler(pipe.read, POLLIN, [&](int) {
+                         input += pipe.ReadBytes(100);
+                       });
+                     });
+            CHECK_EQ(input, "ab");
+            pipe.Close();
+          }},
+     {.name = L"Hangup",
+      .callback =
+          [] {
+            Pipe pipe = Pipe::New();
+            close(pipe.write.read());
+            std::optional<int> received_events;
+            RunUntil([&] { return received_events.has_value(); },
+                     [&](IterationHandler& handler) {
+                       handler.AddHandler(
+                           pipe.read, POLLIN | POLLPRI,
+                           [&](int events) { received_events = events; });
+                     });
+            CHECK(received_events.value() & POLLHUP);
+            close(pipe.read.read());
+          }},
+     {.name = L"ReusedFileDescriptor", .callback = [] {
+        Pipe pipe = Pipe::New();
+        pipe.Write("old");
+        const size_t old_generation = NewFileDescriptorGeneration();
+        size_t generation = old_generation;
+        std::string input;
+        double seconds = RunUntil(
+            [&] { return input == "oldnew"; },
+            [&](IterationHandler& handler) {
+              if (input == "old" && generation == old_generation) {
+                // Replace the pipe with a new one. It will most likely get the
+                // same file descriptors.
+                pipe.Close();
+                pipe = Pipe::New();
+                pipe.Write("new");
+                generation = NewFileDescriptorGeneration();
+              }
+              handler.AddHandler(
+                  pipe.read, POLLIN,
+                  [&](int) { input += pipe.ReadBytes(100); }, generation);
+            });
+        CHECK_EQ(input, "oldnew");
+        CHECK_LT(seconds, 0.5);
+        pipe.Close();
+      }}});
+}  // namespace
+}  // namespace afc::infrastructure::execution
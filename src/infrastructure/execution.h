@@ -2,6 +2,7 @@
 #define __AFC_EDITOR_INFRASTRUCTURE_EXECUTION__
 
 #include <functional>
+#include <memory>
 #include <optional>
 
 #include "poll.h"
@@ -13,10 +14,21 @@ class IterationHandler {
  public:
   virtual ~IterationHandler() = default;
 
+  // During the current iteration, runs `handler` if any of `requested_events`
+  // (or `POLLHUP`) are signaled for the file descriptor.
+  //
+  // The file descriptor may remain registered (with the operating system)
+  // between iterations. Whenever a file descriptor is closed and its number
+  // may later be reused, the new file must be given a different `generation`.
   virtual void AddHandler(FileDescriptor, int requested_events,
-                          std::function<void(int)> handler) = 0;
+                          std::function<void(int)> handler,
+                          size_t generation = 0) = 0;
 };
 
+// Returns a value (different from all previous values) that can be given as
+// the `generation` argument to `IterationHandler::AddHandler`.
+size_t NewFileDescriptorGeneration();
+
 struct ExecutionEnvironmentOptions {
   std::function<bool()> stop_check;
   std::function<std::optional<Time>()> get_next_alarm;
@@ -24,14 +36,22 @@ struct ExecutionEnvironmentOptions {
   std::function<void(IterationHandler&)> on_iteration;
 };
 
+// Runs iterations until `stop_check` returns true. On Linux, file descriptors
+// are watched with epoll (and kept registered across iterations); elsewhere,
+// with poll.
 class ExecutionEnvironment {
-  const ExecutionEnvironmentOptions options_;
-
  public:
+  class Backend;
+
   ExecutionEnvironment(ExecutionEnvironmentOptions options);
+  ~ExecutionEnvironment();
 
   void Run();
+
+ private:
+  const ExecutionEnvironmentOptions options_;
+  std::unique_ptr<Backend> backend_;
 };
 }  // namespace afc::infrastructure::execution
 
-#endif
\ No newline at end of file
+#endif
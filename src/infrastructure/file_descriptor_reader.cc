@@ -1,23 +1,31 @@
 #include "src/infrastructure/file_descriptor_reader.h"
 
+#include <algorithm>
 #include <cctype>
 #include <ostream>
+#include <string_view>
 
 #include "src/infrastructure/time.h"
 #include "src/infrastructure/tracker.h"
 #include "src/language/lazy_string/char_buffer.h"
 #include "src/language/lazy_string/lazy_string.h"
+#include "src/language/lazy_string/utf8_buffer.h"
+#include "src/language/overload.h"
 #include "src/language/text/line.h"
 #include "src/language/wstring.h"
 
 using afc::infrastructure::FileDescriptor;
 using afc::language::EmptyValue;
+using afc::language::Error;
 using afc::language::MakeNonNullShared;
 using afc::language::NonNull;
+using afc::language::overload;
 using afc::language::lazy_string::ColumnNumber;
 using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::lazy_string::IncompleteUtf8SuffixLength;
 using afc::language::lazy_string::LazyString;
 using afc::language::lazy_string::NewLazyString;
+using afc::language::lazy_string::NewUtf8LazyString;
 using afc::language::text::Line;
 using afc::language::text::LineBuilder;
 using afc::language::text::LineNumberDelta;
@@ -25,8 +33,19 @@ using afc::language::text::LineNumberDelta;
 namespace afc::editor {
 using ::operator<<;
 
+namespace {
+// Used for input that isn't valid UTF-8: expands each byte to a `wchar_t`.
+LazyString BytesToLazyString(std::string_view input) {
+  std::vector<wchar_t> buffer;
+  buffer.reserve(input.size());
+  for (char c : input) buffer.push_back(static_cast<unsigned char>(c));
+  return NewLazyString(std::move(buffer));
+}
+}  // namespace
+
 FileDescriptorReader::FileDescriptorReader(Options options)
-    : options_(MakeNonNullShared<Options>(std::move(options))) {}
+    : options_(MakeNonNullShared<Options>(std::move(options))),
+      generation_(infrastructure::execution::NewFileDescriptorGeneration()) {}
 
 FileDescriptorReader::~FileDescriptorReader() { close(fd().read()); }
 
@@ -39,76 +58,85 @@ struct timespec FileDescriptorReader::last_input_received() const {
 void FileDescriptorReader::Register(
     infrastructure::execution::IterationHandler& handler) {
   if (state_ == State::kProcessing) return;
-  handler.AddHandler(fd(), POLLIN | POLLPRI, [this](int) {
-    LOG(INFO) << "Reading input from " << options_->fd << " for buffer "
-              << options_->name;
-    static const size_t kLowBufferSize = 1024 * 60;
-    if (low_buffer_ == nullptr) {
-      CHECK_EQ(low_buffer_length_, 0ul);
-      low_buffer_.reset(new char[kLowBufferSize]);
-    }
-    ssize_t characters_read =
-        read(fd().read(), low_buffer_.get() + low_buffer_length_,
-             kLowBufferSize - low_buffer_length_);
-    LOG(INFO) << "Read returns: " << characters_read;
-    if (characters_read == -1) {
-      if (errno == EAGAIN) {
-        options_->receive_data(LazyString{});
-        return;
-      }
-      return std::move(options_->receive_end_of_file)();
-    }
-    CHECK_GE(characters_read, 0);
-    CHECK_LE(characters_read, ssize_t(kLowBufferSize - low_buffer_length_));
-    if (characters_read == 0) return std::move(options_->receive_end_of_file)();
-    low_buffer_length_ += characters_read;
-
-    auto chars_tracker_call =
-        INLINE_TRACKER(FileDescriptorReader_ReadData_UnicodeConversion);
-    const char* low_buffer_tmp = low_buffer_.get();
-    int output_characters =
-        mbsnrtowcs(nullptr, &low_buffer_tmp, low_buffer_length_, 0, nullptr);
-    std::vector<wchar_t> buffer(output_characters == -1 ? low_buffer_length_
-                                                        : output_characters);
-
-    low_buffer_tmp = low_buffer_.get();
-    if (output_characters == -1) {
-      low_buffer_tmp = nullptr;
-      for (size_t i = 0; i < low_buffer_length_; i++) {
-        buffer[i] = static_cast<wchar_t>(*(low_buffer_.get() + i));
-      }
-    } else {
-      mbsnrtowcs(&buffer[0], &low_buffer_tmp, low_buffer_length_, buffer.size(),
-                 nullptr);
-    }
-
-    chars_tracker_call = nullptr;
-
-    LazyString buffer_wrapper = NewLazyString(std::move(buffer));
-    VLOG(5) << "Input: [" << buffer_wrapper << "]";
-
-    size_t processed = low_buffer_tmp == nullptr
-                           ? low_buffer_length_
-                           : low_buffer_tmp - low_buffer_.get();
-    VLOG(5) << options_->name << ": Characters consumed: " << processed
-            << ", produced: " << buffer_wrapper.size();
-    CHECK_LE(processed, low_buffer_length_);
-    memmove(low_buffer_.get(), low_buffer_tmp, low_buffer_length_ - processed);
-    low_buffer_length_ -= processed;
-    if (low_buffer_length_ == 0) {
-      LOG(INFO) << "Consumed all input.";
-      low_buffer_ = nullptr;
-    }
-
-    clock_gettime(0, &last_input_received_);
-    state_ = State::kProcessing;
-    options_->receive_data(std::move(buffer_wrapper))
-        .Transform([this](EmptyValue) {
-          CHECK(state_ == State::kProcessing);
-          state_ = State::kReading;
-          return EmptyValue{};
-        });
-  });
+  handler.AddHandler(
+      fd(), POLLIN | POLLPRI,
+      [this](int) {
+        LOG(INFO) << "Reading input from " << options_->fd << " for buffer "
+                  << options_->name;
+        static const size_t kLowBufferSize = 1024 * 60;
+        if (low_buffer_.size() < kLowBufferSize)
+          low_buffer_.resize(kLowBufferSize);
+        ssize_t characters_read =
+            read(fd().read(), low_buffer_.data() + low_buffer_length_,
+                 kLowBufferSize - low_buffer_length_);
+        LOG(INFO) << "Read returns: " << characters_read;
+        if (characters_read == -1) {
+          if (errno == EAGAIN) {
+            options_->receive_data(LazyString{});
+            return;
+          }
+          return std::move(options_->receive_end_of_file)();
+        }
+        CHECK_GE(characters_read, 0);
+        CHECK_LE(characters_read,
+                 ssize_t(kLowBufferSize - low_buffer_length_));
+        const std::string_view input(low_buffer_.data(),
+                                     low_buffer_length_ + characters_read);
+        if (characters_read == 0) {
+          if (input.empty()) return std::move(options_->receive_end_of_file)();
+          // The input ended in the middle of a multi-byte character. Hand the
+          // bytes held back as they are before signaling the end of file.
+          LOG(INFO) << options_->name
+                    << ": Incomplete character at end of file, bytes: "
+                    << input.size();
+          LazyString pending = BytesToLazyString(input);
+          low_buffer_length_ = 0;
+          state_ = State::kProcessing;
+          options_->receive_data(std::move(pending))
+              .Transform([options = options_](EmptyValue) {
+                std::move(options->receive_end_of_file)();
+                return EmptyValue{};
+              });
+          return;
+        }
+
+        auto chars_tracker_call =
+            INLINE_TRACKER(FileDescriptorReader_ReadData_UnicodeConversion);
+        // The bytes are retained as they are (rather than expanded to a
+        // `wchar_t` per character); only bytes of an incomplete trailing
+        // character are held back.
+        const size_t processed =
+            input.size() - IncompleteUtf8SuffixLength(input);
+        NonNull<std::shared_ptr<const std::string>> shared_contents =
+            MakeNonNullShared<const std::string>(input.substr(0, processed));
+        // Moves the bytes of the incomplete character to the start.
+        low_buffer_length_ = input.size() - processed;
+        std::copy(input.begin() + processed, input.end(), low_buffer_.begin());
+        LazyString buffer_wrapper = std::visit(
+            overload{[](LazyString output) { return output; },
+                     [&shared_contents](Error error) {
+                       LOG(INFO) << "Not valid UTF-8, reading bytes: " << error;
+                       return BytesToLazyString(shared_contents.value());
+                     }},
+            NewUtf8LazyString(shared_contents));
+
+        chars_tracker_call = nullptr;
+
+        VLOG(5) << "Input: [" << buffer_wrapper << "]";
+        VLOG(5) << options_->name << ": Characters consumed: " << processed
+                << ", produced: " << buffer_wrapper.size();
+        if (low_buffer_length_ == 0) LOG(INFO) << "Consumed all input.";
+
+        clock_gettime(0, &last_input_received_);
+        state_ = State::kProcessing;
+        options_->receive_data(std::move(buffer_wrapper))
+            .Transform([this](EmptyValue) {
+              CHECK(state_ == State::kProcessing);
+              state_ = State::kReading;
+              return EmptyValue{};
+            });
+      },
+      generation_);
 }
 
 }  // namespace afc::editor
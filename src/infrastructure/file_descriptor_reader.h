@@ -63,13 +63,20 @@ class FileDescriptorReader {
 
   const language::NonNull<std::shared_ptr<const Options>> options_;
 
+  // Distinguishes our file descriptor from files that previously used the same
+  // number (see `IterationHandler::AddHandler`).
+  const size_t generation_;
+
   enum State { kReading, kProcessing };
   State state_ = State::kReading;
 
-  // We read directly into low_buffer_ and then drain from that into
-  // options_.buffer. It's possible that not all bytes read can be converted
-  // (for example, if the reading stops in the middle of a wide character).
-  std::unique_ptr<char[]> low_buffer_;
+  // We read directly into low_buffer_ (which is allocated once and reused) and
+  // then hand a copy of its contents (without converting them) to
+  // `options_.receive_data`. It's possible that not all bytes read can be
+  // handed (if the reading stops in the middle of a multi-byte character);
+  // those are kept at the start of low_buffer_ until the next read, and
+  // low_buffer_length_ counts them.
+  std::string low_buffer_;
   size_t low_buffer_length_ = 0;
 
   mutable struct timespec last_input_received_ = {0, 0};
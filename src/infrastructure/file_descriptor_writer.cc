@@ -0,0 +1,236 @@
+#include "src/infrastructure/file_descriptor_writer.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <span>
+
+#include "src/infrastructure/time.h"
+#include "src/language/lazy_string/functional.h"
+#include "src/language/text/line.h"
+#include "src/language/wstring.h"
+#include "src/tests/benchmarks.h"
+#include "src/tests/tests.h"
+
+using afc::language::EmptyValue;
+using afc::language::Error;
+using afc::language::FromByteString;
+using afc::language::IsError;
+using afc::language::PossibleError;
+using afc::language::Success;
+using afc::language::ValueOrDie;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::ForEachColumn;
+using afc::language::lazy_string::LazyString;
+using afc::language::text::Line;
+using afc::language::text::LineNumber;
+using afc::language::text::LineSequence;
+using afc::tests::BenchmarkName;
+
+namespace afc::infrastructure {
+namespace {
+constexpr size_t kBufferSize = 64 * 1024;
+constexpr size_t kBuffersCount = 16;
+
+// The largest number of bytes that `EncodeUtf8` can output.
+constexpr size_t kMaximumCharacterBytes = 4;
+
+// Writes the UTF-8 encoding of `c` to `output`; returns the number of bytes
+// written. Invalid code points are replaced with U+FFFD.
+size_t EncodeUtf8(wchar_t c, char* output) {
+  uint32_t code = static_cast<uint32_t>(c);
+  if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF) code = 0xFFFD;
+  if (code < 0x80) {
+    output[0] = static_cast<char>(code);
+    return 1;
+  }
+  if (code < 0x800) {
+    output[0] = static_cast<char>(0xC0 | (code >> 6));
+    output[1] = static_cast<char>(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    output[0] = static_cast<char>(0xE0 | (code >> 12));
+    output[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    output[2] = static_cast<char>(0x80 | (code & 0x3F));
+    return 3;
+  }
+  output[0] = static_cast<char>(0xF0 | (code >> 18));
+  output[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+  output[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+  output[3] = static_cast<char>(0x80 | (code & 0x3F));
+  return 4;
+}
+
+Error ErrnoError(LazyString description, FileDescriptor fd) {
+  return Error{description + LazyString{L": "} +
+               LazyString{std::to_wstring(fd.read())} + LazyString{L": "} +
+               LazyString{FromByteString(strerror(errno))}};
+}
+}  // namespace
+
+FileDescriptorWriter::FileDescriptorWriter(FileDescriptor fd) : fd_(fd) {}
+
+PossibleError FileDescriptorWriter::Append(const LazyString& input) {
+  std::optional<Error> error;
+  ForEachColumn(input, [&](ColumnNumber, wchar_t c) {
+    if (error.has_value()) return;
+    if (PossibleError reserve = Reserve(kMaximumCharacterBytes);
+        IsError(reserve)) {
+      error = std::get<Error>(reserve);
+      return;
+    }
+    Buffer& buffer = buffers_[current_buffer_];
+    buffer.size += EncodeUtf8(c, buffer.data.get() + buffer.size);
+  });
+  if (error.has_value()) return *error;
+  return Success();
+}
+
+PossibleError FileDescriptorWriter::Append(char c) {
+  RETURN_IF_ERROR(Reserve(1));
+  Buffer& buffer = buffers_[current_buffer_];
+  buffer.data[buffer.size++] = c;
+  return Success();
+}
+
+PossibleError FileDescriptorWriter::Reserve(size_t bytes) {
+  CHECK_LE(bytes, kBufferSize);
+  if (buffers_.empty())
+    buffers_.push_back(
+        Buffer{.data = std::make_unique<char[]>(kBufferSize), .size = 0});
+  if (buffers_[current_buffer_].size + bytes <= kBufferSize) return Success();
+  if (current_buffer_ + 1 == kBuffersCount) return Flush();
+  if (++current_buffer_ == buffers_.size())
+    buffers_.push_back(
+        Buffer{.data = std::make_unique<char[]>(kBufferSize), .size = 0});
+  return Success();
+}
+
+PossibleError FileDescriptorWriter::Flush() {
+  std::vector<iovec> chunks;
+  for (Buffer& buffer : buffers_)
+    if (buffer.size > 0)
+      chunks.push_back(iovec{.iov_base = buffer.data.get(),
+                             .iov_len = buffer.size});
+  std::span<iovec> pending(chunks);
+  while (!pending.empty()) {
+    ssize_t written = writev(fd_.read(), pending.data(), pending.size());
+    if (written == -1) {
+      if (errno == EINTR) continue;
+      return ErrnoError(LazyString{L"write failed"}, fd_);
+    }
+    // Skip the contents that were written. `writev` may return after writing
+    // only some of the contents.
+    size_t remaining = written;
+    while (!pending.empty() && remaining >= pending.front().iov_len) {
+      remaining -= pending.front().iov_len;
+      pending = pending.subspan(1);
+    }
+    if (remaining > 0) {
+      pending.front().iov_base =
+          static_cast<char*>(pending.front().iov_base) + remaining;
+      pending.front().iov_len -= remaining;
+    }
+  }
+  for (Buffer& buffer : buffers_) buffer.size = 0;
+  current_buffer_ = 0;
+  return Success();
+}
+
+PossibleError WriteLineSequence(FileDescriptor fd, const LineSequence& contents,
+                                FsyncPolicy fsync_policy) {
+  FileDescriptorWriter writer(fd);
+  PossibleError output = Success();
+  contents.EveryLine([&](LineNumber position, const Line& line) {
+    if (position > LineNumber()) output = writer.Append('\n');
+    if (!IsError(output)) output = writer.Append(line.contents().read());
+    return !IsError(output);
+  });
+  RETURN_IF_ERROR(output);
+  RETURN_IF_ERROR(writer.Flush());
+  switch (fsync_policy) {
+    case FsyncPolicy::kSkip:
+      break;
+    case FsyncPolicy::kSync:
+      if (fsync(fd.read()) == -1)
+        return ErrnoError(LazyString{L"fsync failed"}, fd);
+      break;
+  }
+  return Success();
+}
+
+namespace {
+// Writes `contents` to a temporary file and returns the bytes written.
+std::string WriteToTemporaryFile(const LineSequence& contents) {
+  char path[] = "/tmp/edge-tests-file-descriptor-writer-XXXXXX";
+  FileDescriptor fd = ValueOrDie(FileDescriptor::New(mkstemp(path)));
+  unlink(path);
+  ValueOrDie(WriteLineSequence(fd, contents, FsyncPolicy::kSkip));
+  std::string output;
+  char buffer[4096];
+  ssize_t bytes_read;
+  while ((bytes_read = pread(fd.read(), buffer, sizeof(buffer),
+                             output.size())) > 0)
+    output.append(buffer, bytes_read);
+  close(fd.read());
+  return output;
+}
+
+const bool file_descriptor_writer_tests_registration = tests::Register(
+    L"FileDescriptorWriter",
+    {{.name = L"Empty",
+      .callback = [] { CHECK_EQ(WriteToTemporaryFile(LineSequence{}), ""); }},
+     {.name = L"Lines",
+      .callback =
+          [] {
+            CHECK_EQ(WriteToTemporaryFile(LineSequence::ForTests(
+                         {L"alejandro", L"", L"forero", L""})),
+                     "alejandro\n\nforero\n");
+          }},
+     {.name = L"Utf8",
+      .callback =
+          [] {
+            CHECK_EQ(WriteToTemporaryFile(LineSequence::ForTests(
+                         {L"año", L"☃\U0001F337"})),
+                     "a\xc3\xb1o\n\xe2\x98\x83\xf0\x9f\x8c\xb7");
+          }},
+     {.name = L"InvalidCodePoint",
+      .callback =
+          [] {
+            CHECK_EQ(WriteToTemporaryFile(LineSequence::ForTests(
+                         {std::wstring(1, static_cast<wchar_t>(0xD800))})),
+                     "\xef\xbf\xbd");
+          }},
+     {.name = L"LargerThanBuffers", .callback = [] {
+        // Each line has 4096 bytes (including the newline), so these contents
+        // require multiple flushes.
+        std::vector<std::wstring> lines(2 * kBufferSize * kBuffersCount / 4096,
+                                        std::wstring(2047, L'ñ') + L"o");
+        std::string output =
+            WriteToTemporaryFile(LineSequence::ForTests(lines));
+        CHECK_EQ(output.size(), lines.size() * 4096 - 1);
+        CHECK_EQ(output.substr(4092, 6), "\xc3\xb1o\n\xc3\xb1");
+        CHECK_EQ(output.substr(output.size() - 3), "\xc3\xb1o");
+      }}});
+
+bool write_line_sequence_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"WriteLineSequence")},
+    [](int elements) {
+      LineSequence contents = LineSequence::ForTests(std::vector<std::wstring>(
+          elements, L"  // Alejandro Forero Cuervo, Medellín: 0123456789."));
+      FileDescriptor fd =
+          ValueOrDie(FileDescriptor::New(open("/dev/null", O_WRONLY)));
+      auto start = Now();
+      ValueOrDie(WriteLineSequence(fd, contents, FsyncPolicy::kSkip));
+      double output = SecondsBetween(start, Now());
+      close(fd.read());
+      return output;
+    });
+}  // namespace
+}  // namespace afc::infrastructure
@@ -0,0 +1,54 @@
+#ifndef __AFC_INFRASTRUCTURE_FILE_DESCRIPTOR_WRITER_H__
+#define __AFC_INFRASTRUCTURE_FILE_DESCRIPTOR_WRITER_H__
+
+#include <memory>
+#include <vector>
+
+#include "src/infrastructure/file_system_driver.h"
+#include "src/language/error/value_or_error.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/text/line_sequence.h"
+
+namespace afc::infrastructure {
+// Should the contents be flushed to stable storage (with `fsync`) once they've
+// been written?
+enum class FsyncPolicy { kSkip, kSync };
+
+// Encodes strings as UTF-8 into large buffers, which are written to a file
+// descriptor (with `writev`) once they are full. This avoids issuing a system
+// call for each (typically small) string.
+//
+// The buffers are allocated once and reused after each flush.
+class FileDescriptorWriter {
+ public:
+  explicit FileDescriptorWriter(FileDescriptor fd);
+  FileDescriptorWriter(const FileDescriptorWriter&) = delete;
+
+  // Either of these may flush some (or all) of the contents buffered.
+  language::PossibleError Append(const language::lazy_string::LazyString&);
+  language::PossibleError Append(char c);
+
+  // Writes all the contents buffered.
+  language::PossibleError Flush();
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+
+  // Makes sure that there's space for at least `bytes` in the current buffer.
+  language::PossibleError Reserve(size_t bytes);
+
+  const FileDescriptor fd_;
+  std::vector<Buffer> buffers_;
+  size_t current_buffer_ = 0;
+};
+
+// Writes `contents` to `fd` (encoded as UTF-8, with lines separated by '\n').
+language::PossibleError WriteLineSequence(
+    FileDescriptor fd, const language::text::LineSequence& contents,
+    FsyncPolicy fsync_policy);
+}  // namespace afc::infrastructure
+
+#endif  // __AFC_INFRASTRUCTURE_FILE_DESCRIPTOR_WRITER_H__
@@ -1,10 +1,12 @@
 #include "src/infrastructure/file_system_driver.h"
 
+#include <cerrno>
 #include <csignal>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 
 extern "C" {
 #include <glob.h>
@@ -140,6 +142,58 @@ futures::Value<PossibleError> FileSystemDriver::Mkdir(Path path,
   });
 }
 
+futures::ValueOrError<std::string> FileSystemDriver::ReadFile(
+    Path path) const {
+  return thread_pool_.Run(
+      [path = std::move(path)]() -> ValueOrError<std::string> {
+        int fd = open(path.ToBytes().c_str(), O_RDONLY);
+        RETURN_IF_ERROR(SyscallReturnValue(path, LazyString{L"Open"}, fd));
+        std::string output;
+        char buffer[64 * 1024];
+        ssize_t bytes_read;
+        while ((bytes_read = read(fd, buffer, sizeof(buffer))) != 0)
+          if (bytes_read > 0)
+            output.append(buffer, bytes_read);
+          else if (errno != EINTR)
+            break;
+        PossibleError read_result = SyscallReturnValue(
+            path, LazyString{L"Read"}, bytes_read == -1 ? -1 : 0);
+        close(fd);
+        RETURN_IF_ERROR(read_result);
+        return output;
+      });
+}
+
+futures::Value<PossibleError> FileSystemDriver::WriteFile(
+    Path path, std::string contents, mode_t mode) const {
+  return thread_pool_.Run([path = std::move(path),
+                           contents = std::move(contents),
+                           mode]() -> PossibleError {
+    DECLARE_OR_RETURN(Path tmp_path,
+                      Path::New(path.read() + LazyString{L".tmp"}));
+    int fd = open(tmp_path.ToBytes().c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                  mode);
+    RETURN_IF_ERROR(SyscallReturnValue(tmp_path, LazyString{L"Open"}, fd));
+    std::string_view pending = contents;
+    while (!pending.empty()) {
+      ssize_t written = write(fd, pending.data(), pending.size());
+      if (written == -1 && errno == EINTR) continue;
+      if (written == -1) {
+        PossibleError error =
+            SyscallReturnValue(tmp_path, LazyString{L"Write"}, -1);
+        close(fd);
+        return error;
+      }
+      pending.remove_prefix(written);
+    }
+    RETURN_IF_ERROR(
+        SyscallReturnValue(tmp_path, LazyString{L"Close"}, close(fd)));
+    return SyscallReturnValue(
+        path, LazyString{L"Rename"},
+        rename(tmp_path.ToBytes().c_str(), path.ToBytes().c_str()));
+  });
+}
+
 PossibleError FileSystemDriver::Kill(ProcessId pid, UnixSignal sig) {
   if (kill(pid.read(), sig.read()) == -1)
     Error(LazyString{L"Kill: "} + LazyString{FromByteString(strerror(errno))});
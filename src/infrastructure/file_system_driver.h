@@ -2,6 +2,7 @@
 #define __AFC_INFRASTRUCTURE_FILE_SYSTEM_DRIVER_H__
 
 #include <map>
+#include <string>
 #include <vector>
 
 extern "C" {
@@ -60,6 +61,17 @@ class FileSystemDriver {
   futures::Value<language::PossibleError> Rename(Path oldpath,
                                                  Path newpath) const;
   futures::Value<language::PossibleError> Mkdir(Path path, mode_t mode) const;
+
+  // Returns the entire contents of the file at `path`.
+  futures::ValueOrError<std::string> ReadFile(Path path) const;
+
+  // Replaces the contents of the file at `path` with `contents`. The contents
+  // are written to a temporary file that is then renamed, so concurrent readers
+  // never see a partially written file. If the file is created, it will have
+  // the permissions given by `mode`.
+  futures::Value<language::PossibleError> WriteFile(Path path,
+                                                    std::string contents,
+                                                    mode_t mode) const;
   language::PossibleError Kill(ProcessId, UnixSignal);
 
   struct WaitPidOutput {
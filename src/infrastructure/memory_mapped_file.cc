@@ -0,0 +1,160 @@
+#include "src/infrastructure/memory_mapped_file.h"
+
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/lazy_string/char_buffer.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/lazy_string/single_line.h"
+#include "src/language/lazy_string/utf8_buffer.h"
+#include "src/language/overload.h"
+#include "src/language/wstring.h"
+#include "src/tests/tests.h"
+
+using afc::language::Error;
+using afc::language::FromByteString;
+using afc::language::IsError;
+using afc::language::MakeNonNullShared;
+using afc::language::NonNull;
+using afc::language::overload;
+using afc::language::ValueOrDie;
+using afc::language::ValueOrError;
+using afc::language::lazy_string::LazyString;
+using afc::language::lazy_string::NewLazyString;
+using afc::language::lazy_string::NewUtf8LazyString;
+using afc::language::lazy_string::SingleLine;
+using afc::language::text::Line;
+
+namespace afc::infrastructure {
+/* static */ ValueOrError<NonNull<std::shared_ptr<const MemoryMappedFile>>>
+MemoryMappedFile::New(FileDescriptor fd) {
+  TRACK_OPERATION(MemoryMappedFile_New);
+  auto errno_error = [fd](std::wstring description) {
+    return Error{LazyString{description} + LazyString{L": "} +
+                 LazyString{std::to_wstring(fd.read())} + LazyString{L": "} +
+                 LazyString{FromByteString(strerror(errno))}};
+  };
+  struct stat stat_buffer;
+  if (fstat(fd.read(), &stat_buffer) == -1) return errno_error(L"fstat failed");
+  if (!S_ISREG(stat_buffer.st_mode))
+    return Error{LazyString{L"Not a regular file: "} +
+                 LazyString{std::to_wstring(fd.read())}};
+  size_t size = stat_buffer.st_size;
+  // `mmap` rejects empty mappings.
+  if (size == 0)
+    return MakeNonNullShared<const MemoryMappedFile>(ConstructorAccessTag(),
+                                                     nullptr, 0);
+  void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.read(), 0);
+  if (address == MAP_FAILED) return errno_error(L"mmap failed");
+  return MakeNonNullShared<const MemoryMappedFile>(ConstructorAccessTag(),
+                                                   address, size);
+}
+
+MemoryMappedFile::MemoryMappedFile(ConstructorAccessTag, void* address,
+                                   size_t size)
+    : address_(address), size_(size) {}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  if (address_ != nullptr) munmap(address_, size_);
+}
+
+std::string_view MemoryMappedFile::contents() const {
+  return std::string_view(static_cast<const char*>(address_), size_);
+}
+
+namespace {
+Line NewLine(const NonNull<std::shared_ptr<const MemoryMappedFile>>& file,
+             std::string_view bytes) {
+  return Line(SingleLine{std::visit(
+      overload{[](LazyString output) { return output; },
+               [bytes](Error) {
+                 std::vector<wchar_t> buffer;
+                 buffer.reserve(bytes.size());
+                 for (char c : bytes)
+                   buffer.push_back(static_cast<unsigned char>(c));
+                 return NewLazyString(std::move(buffer));
+               }},
+      NewUtf8LazyString(file.get_shared(), bytes))});
+}
+}  // namespace
+
+std::vector<Line> LinesFromMemoryMappedFile(
+    NonNull<std::shared_ptr<const MemoryMappedFile>> file) {
+  TRACK_OPERATION(MemoryMappedFile_LinesFromMemoryMappedFile);
+  std::vector<Line> output;
+  std::string_view contents = file->contents();
+  while (true) {
+    // `memchr` is vectorized (in typical implementations), so this is
+    // significantly faster than scanning the contents ourselves.
+    const char* newline =
+        contents.empty() ? nullptr
+                         : static_cast<const char*>(
+                               memchr(contents.data(), '\n', contents.size()));
+    if (newline == nullptr) {
+      output.push_back(NewLine(file, contents));
+      return output;
+    }
+    size_t length = newline - contents.data();
+    output.push_back(NewLine(file, contents.substr(0, length)));
+    contents.remove_prefix(length + 1);
+  }
+}
+
+namespace {
+std::vector<std::wstring> LoadTemporaryFile(std::string contents) {
+  char path[] = "/tmp/edge-tests-memory-mapped-file-XXXXXX";
+  FileDescriptor fd = ValueOrDie(FileDescriptor::New(mkstemp(path)));
+  unlink(path);
+  CHECK_EQ(write(fd.read(), contents.data(), contents.size()),
+           static_cast<ssize_t>(contents.size()));
+  NonNull<std::shared_ptr<const MemoryMappedFile>> file =
+      ValueOrDie(MemoryMappedFile::New(fd));
+  close(fd.read());
+  std::vector<std::wstring> output;
+  for (const Line& line : LinesFromMemoryMappedFile(file))
+    output.push_back(line.ToString());
+  return output;
+}
+
+const bool memory_mapped_file_tests_registration = tests::Register(
+    L"MemoryMappedFile",
+    {{.name = L"Empty",
+      .callback =
+          [] {
+            CHECK(LoadTemporaryFile("") == std::vector<std::wstring>{L""});
+          }},
+     {.name = L"Lines",
+      .callback =
+          [] {
+            CHECK(LoadTemporaryFile("alejandro\n\nforero\n") ==
+                  (std::vector<std::wstring>{L"alejandro", L"", L"forero",
+                                             L""}));
+          }},
+     {.name = L"Utf8",
+      .callback =
+          [] {
+            CHECK(LoadTemporaryFile("a\xc3\xb1o\n\xe2\x98\x83") ==
+                  (std::vector<std::wstring>{L"año", L"☃"}));
+          }},
+     {.name = L"InvalidUtf8",
+      .callback =
+          [] {
+            CHECK(LoadTemporaryFile("\xff\nok") ==
+                  (std::vector<std::wstring>{L"\xff", L"ok"}));
+          }},
+     {.name = L"NotRegularFile", .callback = [] {
+        int fds[2];
+        CHECK_EQ(pipe(fds), 0);
+        CHECK(IsError(MemoryMappedFile::New(
+            ValueOrDie(FileDescriptor::New(fds[0])))));
+        close(fds[0]);
+        close(fds[1]);
+      }}});
+}  // namespace
+}  // namespace afc::infrastructure
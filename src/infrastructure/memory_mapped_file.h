@@ -0,0 +1,54 @@
+#ifndef __AFC_INFRASTRUCTURE_MEMORY_MAPPED_FILE_H__
+#define __AFC_INFRASTRUCTURE_MEMORY_MAPPED_FILE_H__
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "src/infrastructure/file_system_driver.h"
+#include "src/language/error/value_or_error.h"
+#include "src/language/safe_types.h"
+#include "src/language/text/line.h"
+
+namespace afc::infrastructure {
+// The contents of a regular file, mapped (read-only) into memory. The mapping
+// is removed when the instance is deleted.
+//
+// If the file is truncated while it is mapped, reading the contents that are
+// no longer in the file crashes the process (SIGBUS); this should only be used
+// for files that aren't expected to change.
+class MemoryMappedFile {
+ public:
+  struct ConstructorAccessTag {
+   private:
+    ConstructorAccessTag() = default;
+    friend MemoryMappedFile;
+  };
+
+  // Doesn't take ownership of `fd`, which can be closed as soon as this
+  // returns. Fails if `fd` isn't a regular file.
+  static language::ValueOrError<
+      language::NonNull<std::shared_ptr<const MemoryMappedFile>>>
+  New(FileDescriptor fd);
+
+  MemoryMappedFile(ConstructorAccessTag, void* address, size_t size);
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  ~MemoryMappedFile();
+
+  std::string_view contents() const;
+
+ private:
+  void* const address_;
+  const size_t size_;
+};
+
+// Breaks the contents of `file` into lines. The lines read their contents
+// directly from the mapped memory (retaining `file`), rather than copies.
+//
+// Lines that aren't valid UTF-8 are the exception: they are copied, reading
+// each byte as a character.
+std::vector<language::text::Line> LinesFromMemoryMappedFile(
+    language::NonNull<std::shared_ptr<const MemoryMappedFile>> file);
+}  // namespace afc::infrastructure
+
+#endif  // __AFC_INFRASTRUCTURE_MEMORY_MAPPED_FILE_H__
@@ -1,5 +1,6 @@
 #include "src/infrastructure/regular_file_adapter.h"
 
+#include "src/language/lazy_string/character_scanner.h"
 #include "src/language/text/line.h"
 #include "src/language/text/line_builder.h"
 
@@ -13,6 +14,7 @@ using afc::language::NonNull;
 using afc::language::Observers;
 using afc::language::lazy_string::ColumnNumber;
 using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::lazy_string::FindCharacter;
 using afc::language::lazy_string::LazyString;
 using afc::language::lazy_string::SingleLine;
 using afc::language::text::Line;
@@ -41,18 +43,17 @@ std::vector<Line> CreateLineInstances(LazyString contents,
   std::vector<Line> lines_to_insert;
   lines_to_insert.reserve(4096);
   ColumnNumber line_start;
-  for (ColumnNumber i; i.ToDelta() < ColumnNumberDelta(contents.size()); ++i) {
-    if (contents.get(i) == '\n') {
-      VLOG(8) << "Adding line from " << line_start << " to " << i;
+  while (std::optional<ColumnNumber> newline =
+             FindCharacter(contents, L'\n', line_start)) {
+    VLOG(8) << "Adding line from " << line_start << " to " << *newline;
 
-      LineBuilder line_options;
-      line_options.set_contents(SingleLine{
-          contents.Substring(line_start, ColumnNumber(i) - line_start)});
-      line_options.set_modifiers(ColumnNumber(0), modifiers);
-      lines_to_insert.emplace_back(std::move(line_options).Build());
+    LineBuilder line_options;
+    line_options.set_contents(
+        SingleLine{contents.Substring(line_start, *newline - line_start)});
+    line_options.set_modifiers(ColumnNumber(0), modifiers);
+    lines_to_insert.emplace_back(std::move(line_options).Build());
 
-      line_start = ColumnNumber(i) + ColumnNumberDelta(1);
-    }
+    line_start = *newline + ColumnNumberDelta(1);
   }
 
   VLOG(8) << "Adding last line from " << line_start << " to "
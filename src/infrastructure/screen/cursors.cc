@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <optional>
 #include <set>
 #include <unordered_set>
 
@@ -61,20 +62,12 @@ CursorsSet::iterator CursorsSet::insert(LineColumn line) {
   return it;
 }
 
-CursorsSet::iterator CursorsSet::lower_bound(LineColumn line) {
-  return cursors_.lower_bound(line);
-}
-
 CursorsSet::const_iterator CursorsSet::lower_bound(LineColumn line) const {
-  return const_cast<CursorsSet*>(this)->lower_bound(line);
-}
-
-CursorsSet::iterator CursorsSet::find(LineColumn line) {
-  return cursors_.find(line);
+  return cursors_.lower_bound(line);
 }
 
 CursorsSet::const_iterator CursorsSet::find(LineColumn line) const {
-  return const_cast<CursorsSet*>(this)->find(line);
+  return cursors_.find(line);
 }
 
 bool CursorsSet::cursors_in_line(LineNumber line) const {
@@ -101,13 +94,10 @@ void CursorsSet::erase(LineColumn position) {
 }
 
 void CursorsSet::swap(CursorsSet* other) {
-  size_t active_distance = std::distance(begin(), active_);
-  size_t other_active_distance = std::distance(other->begin(), other->active_);
+  // Iterators remain valid (and keep pointing to the same cursors) across
+  // `LineColumnMultiset::swap`.
   cursors_.swap(other->cursors_);
-  active_ = begin();
-  other->active_ = other->begin();
-  std::advance(active_, other_active_distance);
-  std::advance(other->active_, active_distance);
+  std::swap(active_, other->active_);
 }
 
 void CursorsSet::clear() {
@@ -115,12 +105,11 @@ void CursorsSet::clear() {
   active_ = cursors_.end();
 }
 
-CursorsSet::const_iterator CursorsSet::active() const {
-  CHECK((active_ == cursors_.end()) == cursors_.empty());
-  return active_;
+void CursorsSet::ShiftLines(Range range, LineNumberDelta delta) {
+  cursors_.ShiftLines(range, delta);
 }
 
-CursorsSet::iterator CursorsSet::active() {
+CursorsSet::const_iterator CursorsSet::active() const {
   CHECK((active_ == cursors_.end()) == cursors_.empty());
   return active_;
 }
@@ -128,7 +117,7 @@ CursorsSet::iterator CursorsSet::active() {
 void CursorsSet::set_active(iterator input_iterator) {
   active_ = input_iterator;
   CHECK((active_ == cursors_.end()) == cursors_.empty());
-  CHECK(cursors_.contains(*input_iterator));
+  CHECK(cursors_.find(*input_iterator) != cursors_.end());
 }
 
 size_t CursorsSet::current_index() const {
@@ -221,16 +210,37 @@ struct CursorsTracker::Transformation {
 
   language::text::Range OutputOf() const { return TransformRange(range); }
 
+  // Returns the subset of `range` where all cursors just move by `line_delta`
+  // (keeping their columns), if there's one.
+  std::optional<language::text::Range> UniformLineShiftRange() const {
+    if (line_delta.IsZero() || !column_delta.IsZero() ||
+        !column_lower_bound.IsZero())
+      return std::nullopt;
+    static const LineNumber kMaxLine = std::numeric_limits<LineNumber>::max();
+    LineColumn begin = range.begin();
+    // Cursors at kMaxLine never move.
+    LineColumn end = std::min(range.end(), LineColumn(kMaxLine));
+    if (line_delta < LineNumberDelta(0))
+      // Cursors before this line would be clamped to line_lower_bound.
+      begin = std::max(begin, LineColumn(line_lower_bound - line_delta));
+    else
+      // Cursors after this line would overflow.
+      end = std::min(end, LineColumn(kMaxLine - line_delta));
+    if (begin >= end) return std::nullopt;
+    return Range(begin, end);
+  }
+
   void AdjustCursorsSet(CursorsSet* cursors_set) const {
     VLOG(8) << "Adjusting cursor set of size: " << cursors_set->size();
 
-    // Transfer affected cursors from cursors into cursors_affected.
+    // Transfer affected cursors from cursors into cursors_affected, except for
+    // those in the uniform range (which we shift without visiting them).
     CursorsSet cursors_affected;
     bool transferred_active = false;
-    {
-      auto it = cursors_set->lower_bound(range.begin());
-      auto end = cursors_set->lower_bound(range.end());
-      while (it != end) {
+    auto transfer = [&](LineColumn begin, LineColumn end) {
+      auto it = cursors_set->lower_bound(begin);
+      auto end_it = cursors_set->lower_bound(end);
+      while (it != end_it) {
         auto result = cursors_affected.insert(*it);
         if (it == cursors_set->active() && !transferred_active) {
           transferred_active = true;
@@ -238,6 +248,14 @@ struct CursorsTracker::Transformation {
         }
         cursors_set->erase(it++);
       }
+    };
+    if (std::optional<Range> uniform = UniformLineShiftRange();
+        uniform.has_value()) {
+      transfer(range.begin(), uniform->begin());
+      transfer(uniform->end(), range.end());
+      cursors_set->ShiftLines(*uniform, line_delta);
+    } else {
+      transfer(range.begin(), range.end());
     }
 
     // Apply the transformation and add the cursors back.
@@ -393,6 +411,29 @@ class CursorsTrackerMutableLineSequenceObserver
 
   void InsertedCharacter(LineColumn) override {}
 
+  void InsertedCharacters(const std::vector<LineColumn>& positions,
+                          ColumnNumberDelta amount) override {
+    // Within each line we visit the positions from right to left, so that they
+    // remain valid as we shift cursors. We visit the lines in ascending order
+    // to keep `AdjustCursors` from reordering the transformations.
+    auto line_end = positions.begin();
+    while (line_end != positions.end()) {
+      auto line_begin = line_end;
+      line_end = std::find_if(line_begin, positions.end(),
+                              [line = line_begin->line](LineColumn p) {
+                                return p.line != line;
+                              });
+      for (auto it = line_end; it != line_begin;) {
+        --it;
+        cursors_.AdjustCursors(
+            CursorsTracker::Transformation()
+                .WithBegin(*it)
+                .WithEnd(LineColumn(it->line + LineNumberDelta(1)))
+                .ColumnDelta(amount));
+      }
+    }
+  }
+
  private:
   CursorsTracker& cursors_;
 };
@@ -11,8 +11,10 @@
 #include <vector>
 
 #include "src/futures/futures.h"
+#include "src/infrastructure/screen/line_column_multiset.h"
 #include "src/language/text/line_column.h"
 #include "src/language/text/mutable_line_sequence.h"
+#include "src/language/text/range.h"
 
 namespace afc::infrastructure::screen {
 class CursorsTrackerMutableLineSequenceObserver;
@@ -25,16 +27,15 @@ class CursorsSet {
  public:
   CursorsSet() = default;
   CursorsSet(const CursorsSet& other)
-      : cursors_(other.cursors_), active_(cursors_.find(*other.active_)) {}
+      : cursors_(other.cursors_),
+        active_(std::next(cursors_.begin(), other.current_index())) {}
   CursorsSet& operator=(CursorsSet other) {
-    cursors_ = other.cursors_;
-    active_ = cursors_.find(*other.active_);
+    swap(&other);
     return *this;
   }
 
-  using iterator = std::multiset<language::text::LineColumn>::iterator;
-  using const_iterator =
-      std::multiset<language::text::LineColumn>::const_iterator;
+  using iterator = LineColumnMultiset::const_iterator;
+  using const_iterator = LineColumnMultiset::const_iterator;
 
   // position must already be a value in the set (or we'll crash).
   void SetCurrentCursor(language::text::LineColumn position);
@@ -50,10 +51,7 @@ class CursorsSet {
   bool empty() const;
   iterator insert(language::text::LineColumn line);
 
-  iterator lower_bound(language::text::LineColumn line);
   const_iterator lower_bound(language::text::LineColumn line) const;
-
-  iterator find(language::text::LineColumn line);
   const_iterator find(language::text::LineColumn line) const;
 
   // Are there any cursors in a given line?
@@ -66,9 +64,14 @@ class CursorsSet {
 
   void clear();
 
+  // Adds `delta` to the line of every cursor in `range`, without visiting
+  // them (see `LineColumnMultiset::ShiftLines`). The lines must not overflow.
+  void ShiftLines(language::text::Range range,
+                  language::text::LineNumberDelta delta);
+
   template <typename iterator>
   void insert(iterator begin, iterator end) {
-    cursors_.insert(begin, end);
+    for (iterator it = begin; it != end; ++it) cursors_.insert(*it);
     if (active_ == cursors_.end()) {
       active_ = this->begin();
     }
@@ -76,11 +79,8 @@ class CursorsSet {
 
   const_iterator begin() const { return cursors_.begin(); }
   const_iterator end() const { return cursors_.end(); }
-  iterator begin() { return cursors_.begin(); }
-  iterator end() { return cursors_.end(); }
 
   const_iterator active() const;
-  iterator active();
   void set_active(iterator iterator);
 
   size_t current_index() const;
@@ -88,9 +88,9 @@ class CursorsSet {
   bool operator==(const CursorsSet& b) const;
 
  private:
-  std::multiset<language::text::LineColumn> cursors_;
+  LineColumnMultiset cursors_;
   // Must be equal to cursors_.end() iff cursors_ is empty.
-  std::multiset<language::text::LineColumn>::iterator active_ = cursors_.end();
+  LineColumnMultiset::const_iterator active_ = cursors_.end();
 };
 
 class CursorsTracker {
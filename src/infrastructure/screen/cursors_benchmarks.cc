@@ -0,0 +1,84 @@
+// Benchmarks for CursorsTracker, with one cursor on each line of a buffer
+// (such as after creating a cursor on each line). They return the time that
+// the cursors take to follow a single edit (near the top of the buffer or, for
+// InsertedCharacters, at every cursor).
+
+#include <memory>
+#include <vector>
+
+#include "src/infrastructure/screen/cursors.h"
+#include "src/infrastructure/time.h"
+#include "src/language/text/mutable_line_sequence_observer.h"
+#include "src/tests/benchmarks.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::language::NonNull;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::text::LineColumn;
+using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
+using afc::language::text::MutableLineSequenceObserver;
+using afc::tests::BenchmarkName;
+
+namespace afc::infrastructure::screen {
+namespace {
+constexpr int kEdits = 100;
+
+// Runs `edit` kEdits times against a tracker with `cursors` cursors. Returns
+// the time per edit.
+template <typename Edit>
+double Run(int cursors, Edit edit) {
+  CursorsTracker tracker;
+  CursorsSet& cursors_set = tracker.FindOrCreateCursors(L"");
+  for (int i = 0; i < cursors; i++)
+    cursors_set.insert(LineColumn(LineNumber(i), ColumnNumber(4)));
+  NonNull<std::unique_ptr<MutableLineSequenceObserver>> observer =
+      tracker.NewMutableLineSequenceObserver();
+  auto start = Now();
+  for (int i = 0; i < kEdits; i++) edit(observer.value());
+  return SecondsBetween(start, Now()) / kEdits;
+}
+
+bool registration_lines_inserted = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"CursorsTracker::LinesInserted")},
+    [](int cursors) {
+      return Run(cursors, [](MutableLineSequenceObserver& observer) {
+        observer.LinesInserted(LineNumber(1), LineNumberDelta(1));
+      });
+    });
+
+bool registration_lines_erased = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"CursorsTracker::LinesErased")},
+    [](int cursors) {
+      return Run(cursors, [](MutableLineSequenceObserver& observer) {
+        observer.LinesErased(LineNumber(1), LineNumberDelta(1));
+      });
+    });
+
+bool registration_split_line = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"CursorsTracker::SplitLine")},
+    [](int cursors) {
+      return Run(cursors, [](MutableLineSequenceObserver& observer) {
+        observer.SplitLine(LineColumn(LineNumber(1), ColumnNumber(2)));
+      });
+    });
+
+bool registration_inserted_characters = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"CursorsTracker::InsertedCharacters")},
+    [](int cursors) {
+      std::vector<LineColumn> positions;
+      for (int i = 0; i < cursors; i++)
+        positions.push_back(LineColumn(LineNumber(i), ColumnNumber(4)));
+      return Run(cursors, [&positions](MutableLineSequenceObserver& observer) {
+        observer.InsertedCharacters(positions, ColumnNumberDelta(1));
+        for (LineColumn& position : positions)
+          position.column += ColumnNumberDelta(1);
+      });
+    });
+}  // namespace
+}  // namespace afc::infrastructure::screen
@@ -0,0 +1,414 @@
+#include "src/infrastructure/screen/diffing_screen.h"
+
+#include <glog/logging.h>
+
+#include <cwchar>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/tests/tests.h"
+
+using afc::language::MakeNonNullShared;
+using afc::language::NonNull;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::lazy_string::LazyString;
+using afc::language::text::LineColumn;
+using afc::language::text::LineColumnDelta;
+using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
+
+namespace afc::infrastructure::screen {
+namespace {
+// When two changed cells (with the same modifiers) are separated by at most
+// this many unchanged cells, we rewrite the unchanged cells rather than moving
+// the cursor (which typically takes more bytes).
+constexpr size_t kMaxCellsToRewrite = 4;
+}  // namespace
+
+DiffingScreen::DiffingScreen(NonNull<std::shared_ptr<Screen>> delegate)
+    : delegate_(std::move(delegate)) {
+  AdjustSize();
+}
+
+void DiffingScreen::Flush() { delegate_->Flush(); }
+
+void DiffingScreen::HardRefresh() {
+  AdjustSize();
+  delegate_->HardRefresh();
+  invalid_lines_.assign(invalid_lines_.size(), true);
+  dirty_lines_.assign(dirty_lines_.size(), true);
+  delegate_cursor_ = std::nullopt;
+  delegate_modifiers_ = std::nullopt;
+  delegate_cursor_visibility_ = std::nullopt;
+}
+
+void DiffingScreen::Refresh() {
+  TRACK_OPERATION(DiffingScreen_Refresh);
+  AdjustSize();
+  for (LineNumber line; line.ToDelta() < size_.line; ++line)
+    if (dirty_lines_[line.read()]) RefreshLine(line);
+  if (cursor_visibility_ == NORMAL &&
+      cursor_.line.ToDelta() < size_.line &&
+      cursor_.column.ToDelta() < size_.column)
+    MoveDelegate(cursor_);
+  if (delegate_cursor_visibility_ != cursor_visibility_) {
+    delegate_->SetCursorVisibility(cursor_visibility_);
+    delegate_cursor_visibility_ = cursor_visibility_;
+  }
+  delegate_->Refresh();
+}
+
+void DiffingScreen::Clear() {
+  AdjustSize();
+  back_.assign(back_.size(), Cell{});
+  dirty_lines_.assign(dirty_lines_.size(), true);
+}
+
+void DiffingScreen::SetCursorVisibility(CursorVisibility cursor_visibility) {
+  cursor_visibility_ = cursor_visibility;
+}
+
+void DiffingScreen::Move(LineColumn position) {
+  AdjustSize();
+  cursor_ = position;
+}
+
+void DiffingScreen::WriteString(const LazyString& str) {
+  for (wchar_t c : str.ToString()) {
+    if (cursor_.line.ToDelta() >= size_.line) return;
+    if (c == L'\n') {
+      while (cursor_.column.ToDelta() < size_.column) {
+        SetCell(cursor_, Cell{});
+        ++cursor_.column;
+      }
+      cursor_ = LineColumn(cursor_.line.next());
+    } else {
+      WriteCharacter(c);
+    }
+  }
+}
+
+void DiffingScreen::SetModifier(LineModifier modifier) {
+  if (modifier == LineModifier::kReset)
+    modifiers_.reset();
+  else
+    modifiers_.set(static_cast<size_t>(modifier));
+}
+
+LineColumnDelta DiffingScreen::size() const { return delegate_->size(); }
+
+void DiffingScreen::AdjustSize() {
+  LineColumnDelta size = delegate_->size();
+  if (size == size_) return;
+  LOG(INFO) << "Screen size changed: " << size;
+  size_ = size;
+  size_t cells = std::max(0, size_.line.read()) *
+                 std::max(0, size_.column.read());
+  back_.assign(cells, Cell{});
+  front_.assign(cells, Cell{});
+  dirty_lines_.assign(std::max(0, size_.line.read()), true);
+  invalid_lines_.assign(std::max(0, size_.line.read()), true);
+  delegate_cursor_ = std::nullopt;
+}
+
+DiffingScreen::Cell& DiffingScreen::back_cell(LineColumn position) {
+  return back_[position.line.read() * size_.column.read() +
+               position.column.read()];
+}
+
+DiffingScreen::Cell& DiffingScreen::front_cell(LineColumn position) {
+  return front_[position.line.read() * size_.column.read() +
+                position.column.read()];
+}
+
+void DiffingScreen::WriteCharacter(wchar_t c) {
+  int width = wcwidth(c);
+  if (width == 0) {
+    // Combining character: attach it to the previous cell.
+    if (cursor_.column.IsZero()) return;
+    LineColumn previous(cursor_.line, cursor_.column.previous());
+    if (back_cell(previous).contents.empty() && !previous.column.IsZero())
+      previous.column = previous.column.previous();
+    back_cell(previous).contents.push_back(c);
+    dirty_lines_[previous.line.read()] = true;
+    return;
+  }
+  // We don't know how the delegate renders characters that `wcwidth` doesn't
+  // recognize; we assume they take a single cell.
+  width = std::max(width, 1);
+  if ((cursor_.column + ColumnNumberDelta(width)).ToDelta() > size_.column) {
+    while (cursor_.column.ToDelta() < size_.column) {
+      SetCell(cursor_, Cell{});
+      ++cursor_.column;
+    }
+    cursor_ = LineColumn(cursor_.line.next());
+    if (cursor_.line.ToDelta() >= size_.line) return;
+  }
+  SetCell(cursor_, Cell{.contents = std::wstring(1, c),
+                        .modifiers = modifiers_});
+  ++cursor_.column;
+  if (width == 2) {
+    SetCell(cursor_, Cell{.contents = L"", .modifiers = modifiers_});
+    ++cursor_.column;
+  }
+  if (cursor_.column.ToDelta() >= size_.column)
+    cursor_ = LineColumn(cursor_.line.next());
+}
+
+void DiffingScreen::SetCell(LineColumn position, Cell cell) {
+  Cell& current = back_cell(position);
+  if (current.contents.empty() && !position.column.IsZero() &&
+      !cell.contents.empty())
+    // Overwriting the second half of a double-width character.
+    back_cell(LineColumn(position.line, position.column.previous())) = Cell{};
+  LineColumn next(position.line, position.column.next());
+  if (next.column.ToDelta() < size_.column &&
+      back_cell(next).contents.empty() && !current.contents.empty())
+    // Overwriting the first half of a double-width character.
+    back_cell(next) = Cell{};
+  current = std::move(cell);
+  dirty_lines_[position.line.read()] = true;
+}
+
+bool DiffingScreen::Changed(LineColumn position) {
+  return invalid_lines_[position.line.read()] ||
+         back_cell(position) != front_cell(position);
+}
+
+void DiffingScreen::RefreshLine(LineNumber line) {
+  // Cells starting at `blank_start` are all blank.
+  ColumnNumber blank_start = ColumnNumber() + size_.column;
+  while (!blank_start.IsZero() &&
+         back_cell(LineColumn(line, blank_start.previous())) == Cell{})
+    blank_start = blank_start.previous();
+
+  ColumnNumber column;
+  while (column.ToDelta() < size_.column) {
+    if (!Changed(LineColumn(line, column))) {
+      ++column;
+      continue;
+    }
+    if (back_cell(LineColumn(line, column)).contents.empty() &&
+        !column.IsZero())
+      column = column.previous();
+    if (column >= blank_start) {
+      ClearToEndOfLine(LineColumn(line, column));
+      break;
+    }
+    column = RefreshRun(LineColumn(line, column), blank_start);
+  }
+  dirty_lines_[line.read()] = false;
+  invalid_lines_[line.read()] = false;
+}
+
+ColumnNumber DiffingScreen::RefreshRun(LineColumn start, ColumnNumber end) {
+  MoveDelegate(start);
+  std::wstring text;
+  auto flush_text = [&] {
+    if (text.empty()) return;
+    delegate_->WriteString(LazyString{std::move(text)});
+    text.clear();
+  };
+  ColumnNumber column = start.column;
+  while (column < end) {
+    LineColumn position(start.line, column);
+    if (!Changed(position)) {
+      // Decide whether to rewrite a short sequence of unchanged cells.
+      const ColumnNumber limit = std::min(
+          end, column + ColumnNumberDelta(kMaxCellsToRewrite + 1));
+      ColumnNumber next = column;
+      while (next < limit && !Changed(LineColumn(start.line, next)) &&
+             back_cell(LineColumn(start.line, next)).modifiers ==
+                 delegate_modifiers_)
+        ++next;
+      if (next == limit || !Changed(LineColumn(start.line, next))) break;
+    }
+    const Cell& cell = back_cell(position);
+    if (cell.modifiers != delegate_modifiers_) {
+      flush_text();
+      SetDelegateModifiers(cell.modifiers);
+    }
+    text += cell.contents;
+    front_cell(position) = cell;
+    ++column;
+  }
+  flush_text();
+  delegate_cursor_ = LineColumn(start.line, column);
+  return column;
+}
+
+void DiffingScreen::ClearToEndOfLine(LineColumn start) {
+  MoveDelegate(start);
+  SetDelegateModifiers(ModifierBits());
+  delegate_->WriteString(LazyString{L"\n"});
+  for (LineColumn position = start; position.column.ToDelta() < size_.column;
+       ++position.column)
+    front_cell(position) = Cell{};
+  delegate_cursor_ = std::nullopt;
+}
+
+void DiffingScreen::MoveDelegate(LineColumn position) {
+  if (delegate_cursor_ == position) return;
+  delegate_->Move(position);
+  delegate_cursor_ = position;
+}
+
+void DiffingScreen::SetDelegateModifiers(ModifierBits modifiers) {
+  if (delegate_modifiers_ == modifiers) return;
+  ModifierBits to_add = modifiers;
+  if (!delegate_modifiers_.has_value() ||
+      (delegate_modifiers_.value() & ~modifiers).any()) {
+    delegate_->SetModifier(LineModifier::kReset);
+  } else {
+    to_add &= ~delegate_modifiers_.value();
+  }
+  for (size_t i = 0; i < to_add.size(); i++)
+    if (to_add.test(i)) delegate_->SetModifier(static_cast<LineModifier>(i));
+  delegate_modifiers_ = modifiers;
+}
+
+namespace {
+// Records the operations applied to it.
+class RecordingScreen : public Screen {
+ public:
+  std::vector<std::string> operations;
+
+  void Flush() override {}
+  void HardRefresh() override { operations.push_back("HardRefresh"); }
+  void Refresh() override {}
+  void Clear() override { operations.push_back("Clear"); }
+  void SetCursorVisibility(CursorVisibility cursor_visibility) override {
+    operations.push_back("SetCursorVisibility:" +
+                         CursorVisibilityToString(cursor_visibility).ToBytes());
+  }
+  void Move(LineColumn position) override {
+    operations.push_back("Move:" + std::to_string(position.line.read()) + "," +
+                         std::to_string(position.column.read()));
+  }
+  void WriteString(const LazyString& str) override {
+    operations.push_back("WriteString:" + str.ToBytes());
+  }
+  void SetModifier(LineModifier modifier) override {
+    operations.push_back("SetModifier:" +
+                         std::to_string(static_cast<int>(modifier)));
+  }
+  LineColumnDelta size() const override {
+    return LineColumnDelta(LineNumberDelta(3), ColumnNumberDelta(20));
+  }
+};
+
+struct Test {
+  NonNull<std::shared_ptr<RecordingScreen>> delegate =
+      MakeNonNullShared<RecordingScreen>();
+  DiffingScreen screen = DiffingScreen(delegate);
+
+  Test() { screen.SetCursorVisibility(Screen::INVISIBLE); }
+
+  // Draws `lines` (terminating each with '\n') and returns the operations
+  // applied to the delegate.
+  std::vector<std::string> Draw(std::vector<std::wstring> lines) {
+    delegate->operations.clear();
+    for (size_t i = 0; i < lines.size(); i++) {
+      screen.Move(LineColumn(LineNumber(i)));
+      screen.SetModifier(LineModifier::kReset);
+      screen.WriteString(LazyString{lines[i] + L"\n"});
+    }
+    screen.Refresh();
+    return delegate->operations;
+  }
+};
+
+const bool tests_registration = tests::Register(
+    L"DiffingScreen",
+    {{.name = L"InitialDraw",
+      .callback =
+          [] {
+            Test test;
+            CHECK(test.Draw({L"alpha", L"", L"beta"}) ==
+                  std::vector<std::string>(
+                      {"Move:0,0", "SetModifier:0", "WriteString:alpha",
+                       "WriteString:\n", "Move:1,0", "WriteString:\n",
+                       "Move:2,0", "WriteString:beta", "WriteString:\n",
+                       "SetCursorVisibility:INVISIBLE"}));
+          }},
+     {.name = L"UnchangedFrame",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"alpha", L"beta"});
+            CHECK(test.Draw({L"alpha", L"beta"}).empty());
+          }},
+     {.name = L"OnlyChangedCells",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"hello world", L"beta"});
+            CHECK(test.Draw({L"hello there", L"beta"}) ==
+                  std::vector<std::string>({"Move:0,6", "WriteString:there"}));
+          }},
+     {.name = L"ShortGapIsRewritten",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"abcdefghijklmnop"});
+            CHECK(test.Draw({L"Abc-efghijklmnoP"}) ==
+                  std::vector<std::string>({"Move:0,0", "WriteString:Abc-",
+                                            "Move:0,15", "WriteString:P"}));
+          }},
+     {.name = L"ShorterLine",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"alpha beta"});
+            CHECK(test.Draw({L"alpha"}) ==
+                  std::vector<std::string>({"Move:0,6", "WriteString:\n"}));
+          }},
+     {.name = L"Modifiers",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"alpha beta"});
+            test.delegate->operations.clear();
+            test.screen.Move(LineColumn(LineNumber(0), ColumnNumber(6)));
+            test.screen.SetModifier(LineModifier::kBold);
+            test.screen.WriteString(LazyString{L"be"});
+            test.screen.SetModifier(LineModifier::kRed);
+            test.screen.WriteString(LazyString{L"ta"});
+            test.screen.Refresh();
+            CHECK(test.delegate->operations ==
+                  std::vector<std::string>(
+                      {"Move:0,6", "SetModifier:1", "WriteString:be",
+                       "SetModifier:7", "WriteString:ta"}));
+            CHECK(test.Draw({L"alpha beta"}) ==
+                  std::vector<std::string>({"Move:0,6", "SetModifier:0",
+                                            "WriteString:beta"}));
+          }},
+     {.name = L"CursorPosition",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"alpha"});
+            test.delegate->operations.clear();
+            test.screen.Move(LineColumn(LineNumber(0), ColumnNumber(2)));
+            test.screen.SetCursorVisibility(Screen::NORMAL);
+            test.screen.Refresh();
+            CHECK(test.delegate->operations ==
+                  std::vector<std::string>(
+                      {"Move:0,2", "SetCursorVisibility:NORMAL"}));
+          }},
+     {.name = L"HardRefreshRedrawsEverything",
+      .callback =
+          [] {
+            Test test;
+            test.Draw({L"alpha"});
+            test.screen.HardRefresh();
+            CHECK(test.Draw({L"alpha"}) ==
+                  std::vector<std::string>(
+                      {"Move:0,0", "SetModifier:0", "WriteString:alpha",
+                       "WriteString:\n", "Move:1,0", "WriteString:\n",
+                       "Move:2,0", "WriteString:\n",
+                       "SetCursorVisibility:INVISIBLE"}));
+          }}});
+}  // namespace
+}  // namespace afc::infrastructure::screen
@@ -0,0 +1,107 @@
+// A `Screen` that draws into a buffer of cells and, on `Refresh`, only applies
+// to the delegate screen the changes to the cells since the previous refresh.
+//
+// Callers can keep drawing entire lines (or screens); the delegate only sees
+// the minimal sequence of moves, modifier changes and writes required to bring
+// it up to date.
+#ifndef __AFC_INFRASTRUCTURE_SCREEN_DIFFING_SCREEN_H__
+#define __AFC_INFRASTRUCTURE_SCREEN_DIFFING_SCREEN_H__
+
+#include <bitset>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/infrastructure/screen/line_modifier.h"
+#include "src/infrastructure/screen/screen.h"
+#include "src/language/safe_types.h"
+#include "src/language/text/line_column.h"
+
+namespace afc::infrastructure::screen {
+class DiffingScreen : public Screen {
+ public:
+  explicit DiffingScreen(language::NonNull<std::shared_ptr<Screen>> delegate);
+
+  void Flush() override;
+  void HardRefresh() override;
+  void Refresh() override;
+  void Clear() override;
+  void SetCursorVisibility(CursorVisibility cursor_visibility) override;
+  void Move(language::text::LineColumn position) override;
+
+  // Characters are placed in cells according to `wcwidth`. A '\n' clears the
+  // rest of the line and moves to the start of the next line.
+  void WriteString(const language::lazy_string::LazyString& str) override;
+  void SetModifier(LineModifier modifier) override;
+
+  language::text::LineColumnDelta size() const override;
+
+ private:
+  // Indexed by the values of `LineModifier` (kReset is never set).
+  using ModifierBits = std::bitset<kLineModifierCount>;
+
+  struct Cell {
+    // Empty for the cell after a double-width character. May contain more
+    // than one character, if there are zero-width (combining) characters.
+    std::wstring contents = L" ";
+    ModifierBits modifiers;
+
+    bool operator==(const Cell&) const = default;
+  };
+
+  // Resizes the buffers if the size of the delegate has changed.
+  void AdjustSize();
+
+  Cell& back_cell(language::text::LineColumn position);
+  Cell& front_cell(language::text::LineColumn position);
+
+  // Writes a single (non-'\n') character at `cursor_` and advances it.
+  void WriteCharacter(wchar_t c);
+
+  // Stores `cell` at `position`, repairing any double-width character that it
+  // partially overwrites.
+  void SetCell(language::text::LineColumn position, Cell cell);
+
+  bool Changed(language::text::LineColumn position);
+
+  void RefreshLine(language::text::LineNumber line);
+
+  // Applies the cells in the line starting at `start` and returns the column
+  // after the last cell applied. Stops at the first unchanged cell that isn't
+  // shortly followed by a changed cell, or at `end`.
+  language::lazy_string::ColumnNumber RefreshRun(
+      language::text::LineColumn start,
+      language::lazy_string::ColumnNumber end);
+
+  void ClearToEndOfLine(language::text::LineColumn start);
+
+  void MoveDelegate(language::text::LineColumn position);
+  void SetDelegateModifiers(ModifierBits modifiers);
+
+  const language::NonNull<std::shared_ptr<Screen>> delegate_;
+
+  language::text::LineColumnDelta size_;
+
+  // Cells as they should be shown (back) and as we've applied them to the
+  // delegate (front). Indexed by `line * size_.column + column`.
+  std::vector<Cell> back_;
+  std::vector<Cell> front_;
+
+  // Lines that may have changed since the last refresh.
+  std::vector<bool> dirty_lines_;
+  // Lines for which the contents of `front_` aren't known.
+  std::vector<bool> invalid_lines_;
+
+  // Position and modifiers that the next write will use.
+  language::text::LineColumn cursor_;
+  ModifierBits modifiers_;
+  CursorVisibility cursor_visibility_ = NORMAL;
+
+  // The state of the delegate, if known.
+  std::optional<language::text::LineColumn> delegate_cursor_;
+  std::optional<ModifierBits> delegate_modifiers_;
+  std::optional<CursorVisibility> delegate_cursor_visibility_;
+};
+}  // namespace afc::infrastructure::screen
+#endif  // __AFC_INFRASTRUCTURE_SCREEN_DIFFING_SCREEN_H__
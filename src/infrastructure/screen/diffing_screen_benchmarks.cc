@@ -0,0 +1,159 @@
+// Benchmarks for DiffingScreen, replaying a scroll through a large C++ file
+// (drawn the way `Terminal` draws lines: entire lines, with their modifiers).
+//
+// The "Bytes" benchmarks return an estimate of the bytes that a terminal would
+// receive per frame (rather than a time).
+
+#include <string>
+#include <vector>
+
+#include "src/infrastructure/screen/diffing_screen.h"
+#include "src/infrastructure/time.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/tests/benchmarks.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::language::MakeNonNullShared;
+using afc::language::NonNull;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::lazy_string::LazyString;
+using afc::language::text::LineColumn;
+using afc::language::text::LineColumnDelta;
+using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
+using afc::tests::BenchmarkName;
+
+namespace afc::infrastructure::screen {
+namespace {
+const LineColumnDelta kScreenSize(LineNumberDelta(50), ColumnNumberDelta(120));
+
+// Counts the bytes of the escape sequences that a terminal would receive.
+class CountingScreen : public Screen {
+ public:
+  size_t bytes = 0;
+
+  void Flush() override {}
+  void HardRefresh() override {}
+  void Refresh() override {}
+  void Clear() override { bytes += 4; }
+  void SetCursorVisibility(CursorVisibility) override { bytes += 6; }
+  void Move(LineColumn position) override {
+    // ESC [ line ; column H
+    bytes += 4 + std::to_string(position.line.read() + 1).size() +
+             std::to_string(position.column.read() + 1).size();
+  }
+  void WriteString(const LazyString& str) override {
+    for (wchar_t c : str.ToString())
+      bytes += c == L'\n' ? 3 : c < 0x80 ? 1 : c < 0x800 ? 2 : 3;
+  }
+  void SetModifier(LineModifier) override { bytes += 4; }
+  LineColumnDelta size() const override { return kScreenSize; }
+};
+
+struct Token {
+  LineModifierSet modifiers;
+  std::wstring text;
+};
+
+using Line = std::vector<Token>;
+
+// Returns the (syntax-highlighted) lines of a C++ file.
+const std::vector<Line>& CppFile() {
+  static const std::vector<Line>* const output = [] {
+    auto lines = new std::vector<Line>();
+    const Token kType{{LineModifier::kCyan}, L"std::vector<int>"};
+    const Token kKeyword{{LineModifier::kBold}, L"return"};
+    for (size_t i = 0; i < 10000; i++) {
+      std::wstring indent((i % 4) * 2, L' ');
+      std::wstring id = L"value_" + std::to_wstring(i % 97);
+      switch (i % 5) {
+        case 0:
+          lines->push_back({{{}, indent}, kType, {{}, L" " + id + L" = "},
+                            {{LineModifier::kYellow}, std::to_wstring(i)},
+                            {{}, L";"}});
+          break;
+        case 1:
+          lines->push_back(
+              {{{}, indent},
+               {{LineModifier::kBlue}, L"// Adjusts " + id + L" if needed."}});
+          break;
+        case 2:
+          lines->push_back({{{}, indent + L"if (" + id + L".empty()) "},
+                            kKeyword, {{}, L" false;"}});
+          break;
+        case 3:
+          lines->push_back({{{}, indent + L"Process(" + id + L", "},
+                            {{LineModifier::kYellow}, L"\"text\""},
+                            {{}, L");"}});
+          break;
+        default:
+          lines->push_back({});
+      }
+    }
+    return lines;
+  }();
+  return *output;
+}
+
+// Draws all the frames of a scroll (by one line each frame) through `screen`.
+// Returns the time per frame.
+double Scroll(Screen& screen, int frames) {
+  const std::vector<Line>& file = CppFile();
+  auto start = Now();
+  for (int frame = 0; frame < frames; frame++) {
+    for (LineNumber line; line.ToDelta() < kScreenSize.line; ++line) {
+      screen.Move(LineColumn(line));
+      screen.SetModifier(LineModifier::kReset);
+      for (const Token& token : file[(frame + line.read()) % file.size()]) {
+        screen.SetModifier(LineModifier::kReset);
+        for (LineModifier modifier : token.modifiers)
+          screen.SetModifier(modifier);
+        screen.WriteString(LazyString{token.text});
+      }
+      screen.WriteString(LazyString{L"\n"});
+    }
+    screen.SetCursorVisibility(Screen::INVISIBLE);
+    screen.Refresh();
+    screen.Flush();
+  }
+  return SecondsBetween(start, Now()) / frames;
+}
+
+bool registration_direct_time = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"DiffingScreen::DirectTime")},
+    [](int frames) {
+      CountingScreen screen;
+      return Scroll(screen, frames);
+    });
+
+bool registration_direct_bytes = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"DiffingScreen::DirectBytes")},
+    [](int frames) {
+      CountingScreen screen;
+      Scroll(screen, frames);
+      return static_cast<double>(screen.bytes) / frames;
+    });
+
+bool registration_diffing_time = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"DiffingScreen::DiffingTime")},
+    [](int frames) {
+      DiffingScreen screen(MakeNonNullShared<CountingScreen>());
+      return Scroll(screen, frames);
+    });
+
+bool registration_diffing_bytes = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"DiffingScreen::DiffingBytes")},
+    [](int frames) {
+      NonNull<std::shared_ptr<CountingScreen>> counter =
+          MakeNonNullShared<CountingScreen>();
+      DiffingScreen screen(counter);
+      Scroll(screen, frames);
+      return static_cast<double>(counter->bytes) / frames;
+    });
+}  // namespace
+}  // namespace afc::infrastructure::screen
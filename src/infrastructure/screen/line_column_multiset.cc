@@ -0,0 +1,498 @@
+#include "src/infrastructure/screen/line_column_multiset.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "src/tests/tests.h"
+
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::text::LineColumn;
+using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
+using afc::language::text::Range;
+
+namespace afc::infrastructure::screen {
+struct LineColumnMultiset::Node {
+  LineColumn position;
+
+  // Must still be added to the lines of all the descendants of this node (but
+  // not to `position`). Always zero in nodes without children.
+  LineNumberDelta pending_line_delta = LineNumberDelta();
+
+  uint_fast32_t priority;
+
+  Node* parent = nullptr;
+  std::unique_ptr<Node> left = nullptr;
+  std::unique_ptr<Node> right = nullptr;
+};
+
+struct LineColumnMultiset::Tree {
+  std::unique_ptr<Node> root;
+  size_t size = 0;
+
+  // Number of nodes with a non-zero `pending_line_delta`. While it is zero,
+  // the positions of all nodes are up to date.
+  size_t pending_nodes = 0;
+
+  std::minstd_rand random_generator;
+
+  enum class Equal { kLeft, kRight };
+
+  std::unique_ptr<Node> NewNode(LineColumn position) {
+    return std::unique_ptr<Node>(
+        new Node{.position = position, .priority = random_generator()});
+  }
+
+  std::unique_ptr<Node> Copy(const Node* node, Node* parent) {
+    if (node == nullptr) return nullptr;
+    std::unique_ptr<Node> output(
+        new Node{.position = node->position,
+                 .pending_line_delta = node->pending_line_delta,
+                 .priority = node->priority,
+                 .parent = parent});
+    output->left = Copy(node->left.get(), output.get());
+    output->right = Copy(node->right.get(), output.get());
+    return output;
+  }
+
+  static void SetLeft(Node& node, std::unique_ptr<Node> child) {
+    if (child != nullptr) child->parent = &node;
+    node.left = std::move(child);
+  }
+
+  static void SetRight(Node& node, std::unique_ptr<Node> child) {
+    if (child != nullptr) child->parent = &node;
+    node.right = std::move(child);
+  }
+
+  void SetRoot(std::unique_ptr<Node> node) {
+    if (node != nullptr) node->parent = nullptr;
+    root = std::move(node);
+  }
+
+  // Adjusts the position of `node` and schedules the adjustment of its
+  // descendants.
+  void Shift(Node& node, LineNumberDelta delta) {
+    node.position.line += delta;
+    if (node.left == nullptr && node.right == nullptr) return;
+    bool was_pending = !node.pending_line_delta.IsZero();
+    node.pending_line_delta += delta;
+    bool is_pending = !node.pending_line_delta.IsZero();
+    if (is_pending && !was_pending)
+      pending_nodes++;
+    else if (was_pending && !is_pending)
+      pending_nodes--;
+  }
+
+  // Pushes the pending adjustment of `node` down to its children.
+  void Push(Node& node) {
+    if (node.pending_line_delta.IsZero()) return;
+    if (node.left != nullptr) Shift(*node.left, node.pending_line_delta);
+    if (node.right != nullptr) Shift(*node.right, node.pending_line_delta);
+    node.pending_line_delta = LineNumberDelta();
+    pending_nodes--;
+  }
+
+  // Ensures that the position of `node` is up to date.
+  void Refresh(Node* node) {
+    if (pending_nodes == 0) return;
+    std::vector<Node*> ancestors;
+    for (Node* ancestor = node->parent; ancestor != nullptr;
+         ancestor = ancestor->parent)
+      ancestors.push_back(ancestor);
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) Push(**it);
+  }
+
+  // Returns the nodes with values smaller than `key` (and, if `equal` is
+  // `kLeft`, the nodes with values equal to `key`) and the rest.
+  std::pair<std::unique_ptr<Node>, std::unique_ptr<Node>> Split(
+      std::unique_ptr<Node> node, const LineColumn& key, Equal equal) {
+    if (node == nullptr) return {};
+    Push(*node);
+    node->parent = nullptr;
+    if (node->position < key ||
+        (equal == Equal::kLeft && node->position == key)) {
+      auto [left, right] = Split(std::move(node->right), key, equal);
+      SetRight(*node, std::move(left));
+      return {std::move(node), std::move(right)};
+    }
+    auto [left, right] = Split(std::move(node->left), key, equal);
+    SetLeft(*node, std::move(right));
+    return {std::move(left), std::move(node)};
+  }
+
+  // All values in `a` must be smaller than or equal to all values in `b`.
+  std::unique_ptr<Node> Merge(std::unique_ptr<Node> a,
+                              std::unique_ptr<Node> b) {
+    if (a == nullptr) return b;
+    if (b == nullptr) return a;
+    if (a->priority > b->priority) {
+      Push(*a);
+      SetRight(*a, Merge(std::move(a->right), std::move(b)));
+      return a;
+    }
+    Push(*b);
+    SetLeft(*b, Merge(std::move(a), std::move(b->left)));
+    return b;
+  }
+
+  // `node` must not have children.
+  Node* Insert(std::unique_ptr<Node> node) {
+    Node* output = node.get();
+    auto [left, right] = Split(std::move(root), node->position, Equal::kLeft);
+    SetRoot(Merge(Merge(std::move(left), std::move(node)), std::move(right)));
+    return output;
+  }
+
+  void Erase(Node* node) {
+    Refresh(node);
+    Push(*node);
+    Node* parent = node->parent;
+    std::unique_ptr<Node>& slot =
+        parent == nullptr
+            ? root
+            : (parent->left.get() == node ? parent->left : parent->right);
+    std::unique_ptr<Node> replacement =
+        Merge(std::move(node->left), std::move(node->right));
+    if (replacement != nullptr) replacement->parent = parent;
+    slot = std::move(replacement);
+  }
+
+  // Appends to `output` the nodes in `node` (in order), without children.
+  void Release(std::unique_ptr<Node> node,
+               std::vector<std::unique_ptr<Node>>& output) {
+    if (node == nullptr) return;
+    Push(*node);
+    std::unique_ptr<Node> right = std::move(node->right);
+    Release(std::move(node->left), output);
+    node->parent = nullptr;
+    output.push_back(std::move(node));
+    Release(std::move(right), output);
+  }
+
+  Node* Leftmost(Node* node) {
+    while (node->left != nullptr) {
+      Push(*node);
+      node = node->left.get();
+    }
+    return node;
+  }
+
+  Node* Rightmost(Node* node) {
+    while (node->right != nullptr) {
+      Push(*node);
+      node = node->right.get();
+    }
+    return node;
+  }
+
+  Node* Next(Node* node) {
+    if (node->right != nullptr) {
+      Push(*node);
+      return Leftmost(node->right.get());
+    }
+    while (node->parent != nullptr && node->parent->right.get() == node)
+      node = node->parent;
+    return node->parent;
+  }
+
+  Node* Previous(Node* node) {
+    if (node == nullptr)
+      return root == nullptr ? nullptr : Rightmost(root.get());
+    if (node->left != nullptr) {
+      Push(*node);
+      return Rightmost(node->left.get());
+    }
+    while (node->parent != nullptr && node->parent->left.get() == node)
+      node = node->parent;
+    return node->parent;
+  }
+
+  Node* LowerBound(const LineColumn& key) {
+    Node* output = nullptr;
+    Node* node = root.get();
+    while (node != nullptr) {
+      Push(*node);
+      if (node->position < key) {
+        node = node->right.get();
+      } else {
+        output = node;
+        node = node->left.get();
+      }
+    }
+    return output;
+  }
+};
+
+LineColumnMultiset::const_iterator::reference
+LineColumnMultiset::const_iterator::operator*() const {
+  CHECK(node_ != nullptr);
+  tree_->Refresh(node_);
+  return node_->position;
+}
+
+LineColumnMultiset::const_iterator&
+LineColumnMultiset::const_iterator::operator++() {
+  CHECK(node_ != nullptr);
+  tree_->Refresh(node_);
+  node_ = tree_->Next(node_);
+  return *this;
+}
+
+LineColumnMultiset::const_iterator
+LineColumnMultiset::const_iterator::operator++(int) {
+  const_iterator output = *this;
+  ++*this;
+  return output;
+}
+
+LineColumnMultiset::const_iterator&
+LineColumnMultiset::const_iterator::operator--() {
+  if (node_ != nullptr) tree_->Refresh(node_);
+  node_ = tree_->Previous(node_);
+  CHECK(node_ != nullptr);
+  return *this;
+}
+
+LineColumnMultiset::const_iterator
+LineColumnMultiset::const_iterator::operator--(int) {
+  const_iterator output = *this;
+  --*this;
+  return output;
+}
+
+LineColumnMultiset::LineColumnMultiset() : tree_(std::make_unique<Tree>()) {}
+
+LineColumnMultiset::LineColumnMultiset(const LineColumnMultiset& other)
+    : tree_(std::make_unique<Tree>()) {
+  tree_->root = tree_->Copy(other.tree_->root.get(), nullptr);
+  tree_->size = other.tree_->size;
+  tree_->pending_nodes = other.tree_->pending_nodes;
+}
+
+LineColumnMultiset& LineColumnMultiset::operator=(LineColumnMultiset other) {
+  swap(other);
+  return *this;
+}
+
+LineColumnMultiset::~LineColumnMultiset() = default;
+
+size_t LineColumnMultiset::size() const { return tree_->size; }
+
+bool LineColumnMultiset::empty() const { return tree_->size == 0; }
+
+LineColumnMultiset::const_iterator LineColumnMultiset::begin() const {
+  return const_iterator(tree_.get(), tree_->root == nullptr
+                                         ? nullptr
+                                         : tree_->Leftmost(tree_->root.get()));
+}
+
+LineColumnMultiset::const_iterator LineColumnMultiset::end() const {
+  return const_iterator(tree_.get(), nullptr);
+}
+
+LineColumnMultiset::const_iterator LineColumnMultiset::insert(
+    LineColumn position) {
+  tree_->size++;
+  return const_iterator(tree_.get(), tree_->Insert(tree_->NewNode(position)));
+}
+
+LineColumnMultiset::const_iterator LineColumnMultiset::lower_bound(
+    LineColumn position) const {
+  return const_iterator(tree_.get(), tree_->LowerBound(position));
+}
+
+LineColumnMultiset::const_iterator LineColumnMultiset::find(
+    LineColumn position) const {
+  const_iterator output = lower_bound(position);
+  return output != end() && *output == position ? output : end();
+}
+
+void LineColumnMultiset::erase(const_iterator it) {
+  CHECK(it.tree_ == tree_.get());
+  CHECK(it.node_ != nullptr);
+  tree_->Erase(it.node_);
+  tree_->size--;
+}
+
+void LineColumnMultiset::clear() {
+  tree_->root = nullptr;
+  tree_->size = 0;
+  tree_->pending_nodes = 0;
+}
+
+void LineColumnMultiset::swap(LineColumnMultiset& other) {
+  tree_.swap(other.tree_);
+}
+
+void LineColumnMultiset::ShiftLines(Range range, LineNumberDelta delta) {
+  if (delta.IsZero() || range.empty()) return;
+  Tree& tree = *tree_;
+  auto [before, rest] =
+      tree.Split(std::move(tree.root), range.begin(), Tree::Equal::kRight);
+  auto [shifted, after] =
+      tree.Split(std::move(rest), range.end(), Tree::Equal::kRight);
+  std::vector<std::unique_ptr<Node>> overtaken;
+  if (shifted != nullptr) {
+    tree.Shift(*shifted, delta);
+    if (delta < LineNumberDelta()) {
+      auto [kept, overtaken_tree] =
+          tree.Split(std::move(before), tree.Leftmost(shifted.get())->position,
+                     Tree::Equal::kLeft);
+      before = std::move(kept);
+      tree.Release(std::move(overtaken_tree), overtaken);
+    } else {
+      auto [overtaken_tree, kept] =
+          tree.Split(std::move(after), tree.Rightmost(shifted.get())->position,
+                     Tree::Equal::kRight);
+      after = std::move(kept);
+      tree.Release(std::move(overtaken_tree), overtaken);
+    }
+  }
+  tree.SetRoot(tree.Merge(tree.Merge(std::move(before), std::move(shifted)),
+                          std::move(after)));
+  for (std::unique_ptr<Node>& node : overtaken) tree.Insert(std::move(node));
+}
+
+bool LineColumnMultiset::operator==(const LineColumnMultiset& other) const {
+  return size() == other.size() && std::equal(begin(), end(), other.begin());
+}
+
+namespace {
+std::vector<LineColumn> ToVector(const LineColumnMultiset& input) {
+  return std::vector<LineColumn>(input.begin(), input.end());
+}
+
+LineColumnMultiset FromLines(std::vector<size_t> lines) {
+  LineColumnMultiset output;
+  for (size_t line : lines) output.insert(LineColumn(LineNumber(line)));
+  return output;
+}
+
+std::vector<LineColumn> Lines(std::vector<size_t> lines) {
+  std::vector<LineColumn> output;
+  for (size_t line : lines) output.push_back(LineColumn(LineNumber(line)));
+  return output;
+}
+
+const bool tests_registration = tests::Register(
+    L"LineColumnMultiset",
+    {{.name = L"InsertKeepsOrder",
+      .callback =
+          [] {
+            CHECK(ToVector(FromLines({5, 1, 3, 1, 0})) ==
+                  Lines({0, 1, 1, 3, 5}));
+          }},
+     {.name = L"EraseOneOfEqualValues",
+      .callback =
+          [] {
+            LineColumnMultiset values = FromLines({1, 2, 2, 3});
+            values.erase(values.find(LineColumn(LineNumber(2))));
+            CHECK(ToVector(values) == Lines({1, 2, 3}));
+            CHECK_EQ(values.size(), 3ul);
+          }},
+     {.name = L"ShiftSuffix",
+      .callback =
+          [] {
+            LineColumnMultiset values = FromLines({0, 1, 2, 3, 4, 5});
+            values.ShiftLines(
+                Range(LineColumn(LineNumber(3)), LineColumn::Max()),
+                LineNumberDelta(10));
+            CHECK(ToVector(values) == Lines({0, 1, 2, 13, 14, 15}));
+            values.ShiftLines(
+                Range(LineColumn(LineNumber(13)), LineColumn::Max()),
+                LineNumberDelta(-10));
+            CHECK(ToVector(values) == Lines({0, 1, 2, 3, 4, 5}));
+          }},
+     {.name = L"ShiftOvertakes",
+      .callback =
+          [] {
+            LineColumnMultiset values;
+            values.insert(LineColumn(LineNumber(5), ColumnNumber(10)));
+            values.insert(LineColumn(LineNumber(6), ColumnNumber(2)));
+            values.insert(LineColumn(LineNumber(7)));
+            values.ShiftLines(
+                Range(LineColumn(LineNumber(6)), LineColumn::Max()),
+                LineNumberDelta(-1));
+            CHECK(ToVector(values) ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(5), ColumnNumber(2)),
+                       LineColumn(LineNumber(5), ColumnNumber(10)),
+                       LineColumn(LineNumber(6))}));
+          }},
+     {.name = L"IteratorsSurviveShift",
+      .callback =
+          [] {
+            LineColumnMultiset values = FromLines({0, 1, 2, 3, 4, 5, 6, 7});
+            LineColumnMultiset::const_iterator it =
+                values.find(LineColumn(LineNumber(6)));
+            values.ShiftLines(
+                Range(LineColumn(LineNumber(4)), LineColumn::Max()),
+                LineNumberDelta(3));
+            CHECK_EQ(*it, LineColumn(LineNumber(9)));
+            CHECK_EQ(*std::prev(it), LineColumn(LineNumber(8)));
+            CHECK_EQ(*std::prev(values.end()), LineColumn(LineNumber(10)));
+          }},
+     {.name = L"CopyAndSwap",
+      .callback =
+          [] {
+            LineColumnMultiset a = FromLines({1, 2, 3});
+            a.ShiftLines(Range(LineColumn(LineNumber(2)), LineColumn::Max()),
+                         LineNumberDelta(5));
+            LineColumnMultiset b = a;
+            CHECK(a == b);
+            LineColumnMultiset c = FromLines({4});
+            LineColumnMultiset::const_iterator it = c.begin();
+            c.swap(b);
+            CHECK(ToVector(c) == Lines({1, 7, 8}));
+            CHECK_EQ(*it, LineColumn(LineNumber(4)));
+            CHECK(++it == b.end());
+          }},
+     {.name = L"MatchesMultiset", .callback = [] {
+        std::minstd_rand generator(42);
+        LineColumnMultiset values;
+        std::multiset<LineColumn> expected;
+        for (int i = 0; i < 2000; i++) {
+          LineColumn position(LineNumber(generator() % 100),
+                              ColumnNumber(generator() % 4));
+          switch (generator() % 4) {
+            case 0:
+            case 1:
+              values.insert(position);
+              expected.insert(position);
+              break;
+            case 2:
+              if (auto it = values.lower_bound(position); it != values.end()) {
+                expected.erase(expected.find(*it));
+                values.erase(it);
+              }
+              break;
+            case 3: {
+              Range range(position,
+                          LineColumn(position.line +
+                                     LineNumberDelta(1 + generator() % 20)));
+              LineNumberDelta delta(static_cast<int>(generator() % 11) - 5);
+              if (range.begin().line.ToDelta() < -delta) break;
+              values.ShiftLines(range, delta);
+              std::multiset<LineColumn> shifted;
+              for (LineColumn value : expected) {
+                if (range.Contains(value)) value.line += delta;
+                shifted.insert(value);
+              }
+              expected = std::move(shifted);
+              break;
+            }
+          }
+          CHECK_EQ(values.size(), expected.size());
+          CHECK(ToVector(values) == std::vector<LineColumn>(expected.begin(),
+                                                            expected.end()));
+        }
+      }}});
+}  // namespace
+}  // namespace afc::infrastructure::screen
@@ -0,0 +1,94 @@
+// A multiset of `LineColumn` values that can shift the lines of all the values
+// in a range in logarithmic time, regardless of how many values the range
+// contains.
+//
+// The values are kept in a balanced tree (a treap). Each node can hold a
+// pending adjustment to the lines of all its descendants, which is only pushed
+// down to the children when a traversal goes through the node.
+//
+// Iterators remain valid until the value they point to is erased (even across
+// calls to `ShiftLines` and `swap`).
+#ifndef __AFC_INFRASTRUCTURE_SCREEN_LINE_COLUMN_MULTISET_H__
+#define __AFC_INFRASTRUCTURE_SCREEN_LINE_COLUMN_MULTISET_H__
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+#include "src/language/text/line_column.h"
+#include "src/language/text/range.h"
+
+namespace afc::infrastructure::screen {
+class LineColumnMultiset {
+  struct Node;
+  struct Tree;
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = language::text::LineColumn;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const language::text::LineColumn*;
+    using reference = const language::text::LineColumn&;
+
+    const_iterator() = default;
+
+    reference operator*() const;
+    pointer operator->() const { return &**this; }
+
+    const_iterator& operator++();
+    const_iterator operator++(int);
+    const_iterator& operator--();
+    const_iterator operator--(int);
+
+    bool operator==(const const_iterator&) const = default;
+
+   private:
+    friend class LineColumnMultiset;
+    const_iterator(Tree* tree, Node* node) : tree_(tree), node_(node) {}
+
+    Tree* tree_ = nullptr;
+    // nullptr for `end()`.
+    Node* node_ = nullptr;
+  };
+  using iterator = const_iterator;
+
+  LineColumnMultiset();
+  LineColumnMultiset(const LineColumnMultiset& other);
+  LineColumnMultiset& operator=(LineColumnMultiset other);
+  ~LineColumnMultiset();
+
+  size_t size() const;
+  bool empty() const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // The new value is inserted after all values equal to it.
+  const_iterator insert(language::text::LineColumn position);
+
+  // Returns the first value that isn't smaller than `position`.
+  const_iterator lower_bound(language::text::LineColumn position) const;
+  const_iterator find(language::text::LineColumn position) const;
+
+  void erase(const_iterator it);
+  void clear();
+  void swap(LineColumnMultiset& other);
+
+  // Adds `delta` to the line of every value in `range`. The resulting lines
+  // must not overflow (nor become negative).
+  //
+  // Takes logarithmic time, plus (if the shifted values end up interleaved
+  // with values outside of `range`) logarithmic time for each value outside of
+  // `range` that they overtake.
+  void ShiftLines(language::text::Range range,
+                  language::text::LineNumberDelta delta);
+
+  bool operator==(const LineColumnMultiset& other) const;
+
+ private:
+  std::unique_ptr<Tree> tree_;
+};
+}  // namespace afc::infrastructure::screen
+#endif  // __AFC_INFRASTRUCTURE_SCREEN_LINE_COLUMN_MULTISET_H__
@@ -1,6 +1,7 @@
 #ifndef __AFC_EDITOR_INFRASTRUCTURE_LINE_MODIFIER_H__
 #define __AFC_EDITOR_INFRASTRUCTURE_LINE_MODIFIER_H__
 
+#include <cstddef>
 #include <functional>
 #include <string>
 #include <unordered_set>
@@ -27,6 +28,11 @@ enum class LineModifier {
   kBgRed,
 };
 
+// The number of values in `LineModifier`. Must be updated whenever values are
+// added (after the last one).
+constexpr size_t kLineModifierCount =
+    static_cast<size_t>(LineModifier::kBgRed) + 1;
+
 using LineModifierSet =
     std::unordered_set<LineModifier, language::EnumClassHash>;
 
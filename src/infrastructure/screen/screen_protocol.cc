@@ -0,0 +1,443 @@
+#include "src/infrastructure/screen/screen_protocol.h"
+
+#include <glog/logging.h>
+
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/lazy_string/utf8_buffer.h"
+#include "src/tests/tests.h"
+
+using afc::language::Error;
+using afc::language::MakeNonNullShared;
+using afc::language::NonNull;
+using afc::language::PossibleError;
+using afc::language::Success;
+using afc::language::ValueOrError;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::LazyString;
+using afc::language::lazy_string::NewUtf8LazyString;
+using afc::language::text::LineColumn;
+using afc::language::text::LineColumnDelta;
+using afc::language::text::LineNumber;
+
+namespace afc::infrastructure::screen {
+namespace {
+enum class Opcode : uint8_t {
+  kHardRefresh = 1,
+  kRefresh = 2,
+  kClear = 3,
+  kSetCursorVisibility = 4,
+  kMove = 5,
+  kWriteString = 6,
+  kSetModifier = 7,
+};
+
+void AppendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+void AppendOpcode(Opcode opcode, std::string& output) {
+  output.push_back(static_cast<char>(opcode));
+}
+
+// Returns std::nullopt if `input` ends before the varint is complete.
+ValueOrError<std::optional<uint64_t>> ReadVarint(std::string_view input,
+                                                 size_t& position) {
+  uint64_t output = 0;
+  for (size_t shift = 0; shift < 64; shift += 7) {
+    if (position >= input.size()) return std::optional<uint64_t>();
+    uint8_t byte = static_cast<uint8_t>(input[position++]);
+    output |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return std::optional<uint64_t>(output);
+  }
+  return Error{LazyString{L"Varint is too long."}};
+}
+
+// Reads a varint from a frame (which must contain it entirely).
+ValueOrError<uint64_t> ReadFrameVarint(std::string_view frame,
+                                       size_t& position) {
+  DECLARE_OR_RETURN(std::optional<uint64_t> output,
+                    ReadVarint(frame, position));
+  if (!output.has_value()) return Error{LazyString{L"Truncated varint."}};
+  return output.value();
+}
+
+ValueOrError<uint8_t> ReadFrameByte(std::string_view frame, size_t& position) {
+  if (position >= frame.size()) return Error{LazyString{L"Truncated frame."}};
+  return static_cast<uint8_t>(frame[position++]);
+}
+
+// Applies the operations in `frame` to `screen`. If `screen` is nullptr, only
+// validates them.
+PossibleError ApplyFrame(const std::shared_ptr<const std::string>& frame,
+                         Screen* screen) {
+  size_t position = 0;
+  while (position < frame->size()) {
+    DECLARE_OR_RETURN(uint8_t opcode, ReadFrameByte(*frame, position));
+    switch (static_cast<Opcode>(opcode)) {
+      case Opcode::kHardRefresh:
+        if (screen != nullptr) screen->HardRefresh();
+        break;
+      case Opcode::kRefresh:
+        if (screen != nullptr) screen->Refresh();
+        break;
+      case Opcode::kClear:
+        if (screen != nullptr) screen->Clear();
+        break;
+      case Opcode::kSetCursorVisibility: {
+        DECLARE_OR_RETURN(uint8_t value, ReadFrameByte(*frame, position));
+        if (value > Screen::NORMAL)
+          return Error{LazyString{L"Invalid cursor visibility."}};
+        if (screen != nullptr)
+          screen->SetCursorVisibility(
+              static_cast<Screen::CursorVisibility>(value));
+        break;
+      }
+      case Opcode::kMove: {
+        DECLARE_OR_RETURN(uint64_t line, ReadFrameVarint(*frame, position));
+        DECLARE_OR_RETURN(uint64_t column, ReadFrameVarint(*frame, position));
+        if (screen != nullptr)
+          screen->Move(LineColumn(LineNumber(line), ColumnNumber(column)));
+        break;
+      }
+      case Opcode::kWriteString: {
+        DECLARE_OR_RETURN(uint64_t length, ReadFrameVarint(*frame, position));
+        if (length > frame->size() - position)
+          return Error{LazyString{L"Truncated string."}};
+        DECLARE_OR_RETURN(
+            LazyString str,
+            NewUtf8LazyString(frame,
+                              std::string_view(*frame).substr(position,
+                                                              length)));
+        position += length;
+        if (screen != nullptr) screen->WriteString(str);
+        break;
+      }
+      case Opcode::kSetModifier: {
+        DECLARE_OR_RETURN(uint8_t value, ReadFrameByte(*frame, position));
+        if (value >= kLineModifierCount)
+          return Error{LazyString{L"Invalid modifier."}};
+        if (screen != nullptr)
+          screen->SetModifier(static_cast<LineModifier>(value));
+        break;
+      }
+      default:
+        return Error{LazyString{L"Invalid opcode."}};
+    }
+  }
+  return Success();
+}
+}  // namespace
+
+ScreenEncoder::ScreenEncoder(std::function<void(std::string)> write_frame)
+    : write_frame_(std::move(write_frame)) {}
+
+void ScreenEncoder::Flush() {
+  FlushPendingLine(false);
+  std::string output;
+  AppendVarint(frame_.size(), output);
+  output += std::move(frame_);
+  frame_.clear();
+  write_frame_(std::move(output));
+}
+
+void ScreenEncoder::HardRefresh() {
+  FlushPendingLine(false);
+  AppendOpcode(Opcode::kHardRefresh, frame_);
+  sent_lines_.clear();
+}
+
+void ScreenEncoder::Refresh() {
+  FlushPendingLine(false);
+  AppendOpcode(Opcode::kRefresh, frame_);
+}
+
+void ScreenEncoder::Clear() {
+  FlushPendingLine(false);
+  AppendOpcode(Opcode::kClear, frame_);
+  sent_lines_.clear();
+}
+
+void ScreenEncoder::SetCursorVisibility(CursorVisibility cursor_visibility) {
+  // An invisible cursor doesn't depend on the position left by the skipped
+  // operations.
+  FlushPendingLine(cursor_visibility == INVISIBLE);
+  AppendOpcode(Opcode::kSetCursorVisibility, frame_);
+  frame_.push_back(static_cast<char>(cursor_visibility));
+}
+
+void ScreenEncoder::Move(LineColumn position) {
+  FlushPendingLine(true);
+  if (position.column.IsZero()) {
+    pending_line_ = PendingLine{
+        .line = position.line,
+        .contents = LineContents{.operations = "", .modifiers = modifiers_}};
+    return;
+  }
+  AppendOpcode(Opcode::kMove, frame_);
+  AppendVarint(position.line.read(), frame_);
+  AppendVarint(position.column.read(), frame_);
+}
+
+void ScreenEncoder::WriteString(const LazyString& str) {
+  std::string& output =
+      pending_line_.has_value() ? pending_line_->contents.operations : frame_;
+  if (!pending_line_.has_value()) {
+    SyncModifiers(modifiers_);
+    // We don't know which lines a write outside of a line modifies.
+    sent_lines_.clear();
+  }
+  std::string bytes = str.ToBytes();
+  AppendOpcode(Opcode::kWriteString, output);
+  AppendVarint(bytes.size(), output);
+  output += bytes;
+}
+
+void ScreenEncoder::SetModifier(LineModifier modifier) {
+  if (!pending_line_.has_value()) SyncModifiers(modifiers_);
+  if (modifier == LineModifier::kReset)
+    modifiers_.clear();
+  else
+    modifiers_.insert(modifier);
+  if (!pending_line_.has_value()) sent_modifiers_ = modifiers_;
+  std::string& output =
+      pending_line_.has_value() ? pending_line_->contents.operations : frame_;
+  AppendOpcode(Opcode::kSetModifier, output);
+  output.push_back(static_cast<char>(modifier));
+}
+
+LineColumnDelta ScreenEncoder::size() const { return size_; }
+
+void ScreenEncoder::set_size(LineColumnDelta size) { size_ = size; }
+
+void ScreenEncoder::FlushPendingLine(bool can_skip) {
+  if (!pending_line_.has_value()) return;
+  PendingLine pending_line = std::move(pending_line_.value());
+  pending_line_ = std::nullopt;
+  const size_t line = pending_line.line.read();
+  if (can_skip &&
+      (pending_line.contents.operations.empty() ||
+       (line < sent_lines_.size() &&
+        sent_lines_[line] == pending_line.contents)))
+    return;
+  if (!pending_line.contents.operations.empty())
+    SyncModifiers(pending_line.contents.modifiers);
+  AppendOpcode(Opcode::kMove, frame_);
+  AppendVarint(line, frame_);
+  AppendVarint(0, frame_);
+  if (pending_line.contents.operations.empty()) return;  // Only moves.
+  frame_ += pending_line.contents.operations;
+  sent_modifiers_ = modifiers_;
+  if (line >= sent_lines_.size()) sent_lines_.resize(line + 1);
+  sent_lines_[line] = std::move(pending_line.contents);
+}
+
+void ScreenEncoder::SyncModifiers(const LineModifierSet& modifiers) {
+  if (sent_modifiers_ == modifiers) return;
+  AppendOpcode(Opcode::kSetModifier, frame_);
+  frame_.push_back(static_cast<char>(LineModifier::kReset));
+  for (LineModifier modifier : modifiers) {
+    AppendOpcode(Opcode::kSetModifier, frame_);
+    frame_.push_back(static_cast<char>(modifier));
+  }
+  sent_modifiers_ = modifiers;
+}
+
+ScreenDecoder::ScreenDecoder(NonNull<std::shared_ptr<Screen>> screen)
+    : screen_(std::move(screen)) {}
+
+PossibleError ScreenDecoder::Receive(std::string_view input) {
+  pending_ += input;
+  size_t position = 0;
+  while (true) {
+    size_t frame_start = position;
+    DECLARE_OR_RETURN(std::optional<uint64_t> length,
+                      ReadVarint(pending_, frame_start));
+    if (!length.has_value() || length.value() > pending_.size() - frame_start)
+      break;
+    auto frame = std::make_shared<const std::string>(
+        pending_.substr(frame_start, length.value()));
+    position = frame_start + length.value();
+    RETURN_IF_ERROR(ApplyFrame(frame, nullptr));
+    CHECK(!IsError(ApplyFrame(frame, &screen_.value())));
+    screen_->Flush();
+  }
+  pending_.erase(0, position);
+  return Success();
+}
+
+namespace {
+// Records the operations applied to it.
+class RecordingScreen : public Screen {
+ public:
+  std::vector<std::string> operations;
+
+  void Flush() override { operations.push_back("Flush"); }
+  void HardRefresh() override { operations.push_back("HardRefresh"); }
+  void Refresh() override { operations.push_back("Refresh"); }
+  void Clear() override { operations.push_back("Clear"); }
+  void SetCursorVisibility(CursorVisibility cursor_visibility) override {
+    operations.push_back("SetCursorVisibility:" +
+                         CursorVisibilityToString(cursor_visibility).ToBytes());
+  }
+  void Move(LineColumn position) override {
+    operations.push_back("Move:" + std::to_string(position.line.read()) + "," +
+                         std::to_string(position.column.read()));
+  }
+  void WriteString(const LazyString& str) override {
+    operations.push_back("WriteString:" + str.ToBytes());
+  }
+  void SetModifier(LineModifier modifier) override {
+    operations.push_back("SetModifier:" +
+                         std::to_string(static_cast<int>(modifier)));
+  }
+  LineColumnDelta size() const override { return LineColumnDelta(); }
+};
+
+struct Connection {
+  NonNull<std::shared_ptr<RecordingScreen>> screen =
+      MakeNonNullShared<RecordingScreen>();
+  ScreenDecoder decoder = ScreenDecoder(screen);
+  std::vector<std::string> frames;
+  ScreenEncoder encoder = ScreenEncoder([this](std::string frame) {
+    frames.push_back(frame);
+    CHECK(!IsError(decoder.Receive(frame)));
+  });
+};
+
+void DrawLines(Screen& screen, std::vector<std::string> lines) {
+  for (size_t i = 0; i < lines.size(); i++) {
+    screen.Move(LineColumn(LineNumber(i)));
+    screen.SetModifier(LineModifier::kReset);
+    screen.WriteString(LazyString{language::FromByteString(lines[i])});
+  }
+}
+
+const bool tests_registration = tests::Register(
+    L"ScreenProtocol",
+    {{.name = L"RoundTrip",
+      .callback =
+          [] {
+            Connection connection;
+            connection.encoder.HardRefresh();
+            connection.encoder.Move(LineColumn(LineNumber(3), ColumnNumber(5)));
+            connection.encoder.SetModifier(LineModifier::kBold);
+            connection.encoder.WriteString(LazyString{L"Hello"});
+            connection.encoder.SetCursorVisibility(Screen::NORMAL);
+            connection.encoder.Clear();
+            connection.encoder.Refresh();
+            connection.encoder.Flush();
+            CHECK(connection.screen->operations ==
+                  std::vector<std::string>(
+                      {"HardRefresh", "Move:3,5", "SetModifier:1",
+                       "WriteString:Hello", "SetCursorVisibility:NORMAL",
+                       "Clear", "Refresh", "Flush"}));
+          }},
+     {.name = L"SkipsUnchangedLines",
+      .callback =
+          [] {
+            Connection connection;
+            DrawLines(connection.encoder, {"alpha", "beta", "gamma"});
+            connection.encoder.Flush();
+            connection.screen->operations.clear();
+            DrawLines(connection.encoder, {"alpha", "BETA", "gamma"});
+            connection.encoder.SetCursorVisibility(Screen::INVISIBLE);
+            connection.encoder.Refresh();
+            connection.encoder.Flush();
+            CHECK(connection.screen->operations ==
+                  std::vector<std::string>(
+                      {"Move:1,0", "SetModifier:0", "WriteString:BETA",
+                       "SetCursorVisibility:INVISIBLE", "Refresh", "Flush"}));
+            CHECK_LT(connection.frames[1].size(),
+                     connection.frames[0].size() / 2);
+          }},
+     {.name = L"LastLineBeforeRefreshIsSent",
+      .callback =
+          [] {
+            // The cursor position after the last line matters.
+            Connection connection;
+            DrawLines(connection.encoder, {"alpha"});
+            connection.encoder.Flush();
+            connection.screen->operations.clear();
+            DrawLines(connection.encoder, {"alpha"});
+            connection.encoder.Refresh();
+            connection.encoder.Flush();
+            CHECK(connection.screen->operations ==
+                  std::vector<std::string>({"Move:0,0", "SetModifier:0",
+                                            "WriteString:alpha", "Refresh",
+                                            "Flush"}));
+          }},
+     {.name = L"ModifiersAfterSkippedLine",
+      .callback =
+          [] {
+            Connection connection;
+            auto draw = [&](std::string second_line) {
+              Screen& screen = connection.encoder;
+              screen.SetModifier(LineModifier::kReset);
+              screen.Move(LineColumn(LineNumber(0)));
+              screen.SetModifier(LineModifier::kBold);
+              screen.WriteString(LazyString{L"bold"});
+              // Depends on the modifiers of the previous line.
+              screen.Move(LineColumn(LineNumber(1)));
+              screen.WriteString(
+                  LazyString{language::FromByteString(second_line)});
+              screen.Move(LineColumn(LineNumber(2)));
+              screen.Flush();
+            };
+            draw("first");
+            connection.screen->operations.clear();
+            draw("second");
+            CHECK(connection.screen->operations ==
+                  std::vector<std::string>(
+                      {"SetModifier:0", "SetModifier:0", "SetModifier:1",
+                       "Move:1,0", "WriteString:second", "Move:2,0",
+                       "Flush"}));
+          }},
+     {.name = L"HardRefreshSendsAllLines",
+      .callback =
+          [] {
+            Connection connection;
+            DrawLines(connection.encoder, {"alpha", "beta"});
+            connection.encoder.Flush();
+            connection.screen->operations.clear();
+            connection.encoder.HardRefresh();
+            DrawLines(connection.encoder, {"alpha", "beta"});
+            connection.encoder.Flush();
+            CHECK_EQ(connection.screen->operations.size(), 8ul);
+          }},
+     {.name = L"PartialInput",
+      .callback =
+          [] {
+            std::string data;
+            ScreenEncoder encoder(
+                [&data](std::string frame) { data += frame; });
+            DrawLines(encoder, {"alpha", "beta"});
+            encoder.Flush();
+            encoder.Move(LineColumn(LineNumber(7), ColumnNumber(3)));
+            encoder.Flush();
+            auto screen = MakeNonNullShared<RecordingScreen>();
+            ScreenDecoder decoder(screen);
+            for (char c : data) {
+              size_t operations = screen->operations.size();
+              CHECK(!IsError(decoder.Receive(std::string(1, c))));
+              CHECK(screen->operations.size() == operations ||
+                    screen->operations.back() == "Flush");
+            }
+            CHECK(screen->operations ==
+                  std::vector<std::string>(
+                      {"Move:0,0", "SetModifier:0", "WriteString:alpha",
+                       "Move:1,0", "SetModifier:0", "WriteString:beta",
+                       "Flush", "Move:7,3", "Flush"}));
+          }},
+     {.name = L"InvalidInput", .callback = [] {
+        auto screen = MakeNonNullShared<RecordingScreen>();
+        ScreenDecoder decoder(screen);
+        // A frame of two bytes with a truncated `Move`.
+        CHECK(IsError(decoder.Receive(std::string("\x02\x05\xFF", 3))));
+        CHECK(screen->operations.empty());
+      }}});
+}  // namespace
+}  // namespace afc::infrastructure::screen
@@ -0,0 +1,107 @@
+// Compact binary encoding of the operations applied to a `Screen`, used to
+// send screen updates to remote clients.
+//
+// The stream is a sequence of frames. Each frame is its length (in bytes,
+// encoded as a varint) followed by a sequence of operations. Each operation is
+// an opcode (one byte) followed by its arguments: integers are encoded as
+// (unsigned, LEB128) varints and strings as their length followed by their
+// UTF-8 bytes. The receiver applies all the operations in a frame and then
+// calls `Screen::Flush`.
+//
+// The encoder remembers the operations that last drew each line of the screen
+// (i.e., a `Move` to its first column followed by calls to `WriteString` and
+// `SetModifier`) and skips them if they are repeated.
+#ifndef __AFC_INFRASTRUCTURE_SCREEN_SCREEN_PROTOCOL_H__
+#define __AFC_INFRASTRUCTURE_SCREEN_SCREEN_PROTOCOL_H__
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/infrastructure/screen/line_modifier.h"
+#include "src/infrastructure/screen/screen.h"
+#include "src/language/error/value_or_error.h"
+#include "src/language/safe_types.h"
+#include "src/language/text/line_column.h"
+
+namespace afc::infrastructure::screen {
+// Implements `Screen` by encoding the operations. Each frame is given to
+// `write_frame` when `Flush` is called.
+class ScreenEncoder : public Screen {
+ public:
+  explicit ScreenEncoder(std::function<void(std::string)> write_frame);
+
+  void Flush() override;
+  void HardRefresh() override;
+  void Refresh() override;
+  void Clear() override;
+  void SetCursorVisibility(CursorVisibility cursor_visibility) override;
+  void Move(language::text::LineColumn position) override;
+  void WriteString(const language::lazy_string::LazyString& str) override;
+  void SetModifier(LineModifier modifier) override;
+
+  language::text::LineColumnDelta size() const override;
+  void set_size(language::text::LineColumnDelta size);
+
+ private:
+  // The operations that draw a line, and the modifiers active before them.
+  struct LineContents {
+    std::string operations;
+    LineModifierSet modifiers;
+
+    bool operator==(const LineContents&) const = default;
+  };
+
+  struct PendingLine {
+    language::text::LineNumber line;
+    LineContents contents;
+  };
+
+  // Appends the operations of `pending_line_` to `frame_`, unless they are the
+  // same that last drew the line and `can_skip`.
+  void FlushPendingLine(bool can_skip);
+
+  // Appends operations to `frame_` to set the modifiers of the receiver to
+  // `modifiers`.
+  void SyncModifiers(const LineModifierSet& modifiers);
+
+  const std::function<void(std::string)> write_frame_;
+
+  std::string frame_;
+  std::optional<PendingLine> pending_line_;
+
+  // Indexed by line number.
+  std::vector<std::optional<LineContents>> sent_lines_;
+
+  // The modifiers that would be active if all operations were sent.
+  LineModifierSet modifiers_;
+  // The modifiers active in the receiver after the operations in `frame_`.
+  LineModifierSet sent_modifiers_;
+
+  language::text::LineColumnDelta size_ = language::text::LineColumnDelta(
+      language::text::LineNumberDelta(25),
+      language::lazy_string::ColumnNumberDelta(80));
+};
+
+// Applies the frames produced by a `ScreenEncoder` to a screen.
+class ScreenDecoder {
+ public:
+  explicit ScreenDecoder(
+      language::NonNull<std::shared_ptr<Screen>> screen);
+
+  // Applies all the frames that are complete in the data received (including
+  // data from previous calls). A frame is only applied if it is entirely
+  // valid.
+  language::PossibleError Receive(std::string_view input);
+
+ private:
+  const language::NonNull<std::shared_ptr<Screen>> screen_;
+
+  // Data received that doesn't yet contain a complete frame.
+  std::string pending_;
+};
+}  // namespace afc::infrastructure::screen
+#endif  // __AFC_INFRASTRUCTURE_SCREEN_SCREEN_PROTOCOL_H__
@@ -0,0 +1,266 @@
+#include "src/infrastructure/trace_recorder.h"
+
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <list>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "src/concurrent/protected.h"
+#include "src/language/wstring.h"
+#include "src/tests/tests.h"
+
+using afc::concurrent::EmptyValidator;
+using afc::concurrent::Protected;
+using afc::language::ToByteString;
+
+namespace afc::infrastructure {
+namespace {
+std::atomic<bool> recording_enabled = false;
+std::atomic<size_t> recording_events_per_thread = kDefaultTraceEventsPerThread;
+
+// The events recorded by a single thread. Only that thread records them, so the
+// lock is only contended while the trace is being started or exported.
+struct ThreadEvents {
+  size_t capacity;
+  // Once `events` reaches `capacity`, it's used as a ring buffer: the oldest
+  // event is at `recorded % capacity`.
+  std::vector<TraceEvent> events = {};
+  size_t recorded = 0;
+  std::optional<std::wstring> name = std::nullopt;
+
+  std::vector<TraceEvent> OldestFirst() const {
+    if (events.size() < capacity) return events;
+    std::vector<TraceEvent> output;
+    output.reserve(events.size());
+    output.insert(output.end(), events.begin() + recorded % capacity,
+                  events.end());
+    output.insert(output.end(), events.begin(),
+                  events.begin() + recorded % capacity);
+    return output;
+  }
+};
+
+struct ThreadTrace {
+  // Identifies the thread in the trace.
+  const size_t id;
+  Protected<ThreadEvents, EmptyValidator<ThreadEvents>, false> events;
+};
+
+// Never shrinks: the events of a thread outlive it.
+using ThreadTraces = std::list<ThreadTrace>;
+
+Protected<ThreadTraces>::Lock lock_thread_traces() {
+  static Protected<ThreadTraces, EmptyValidator<ThreadTraces>, false>* const
+      output =
+          new Protected<ThreadTraces, EmptyValidator<ThreadTraces>, false>();
+  return output->lock();
+}
+
+ThreadTrace& CurrentThreadTrace() {
+  thread_local ThreadTrace* output = nullptr;
+  if (output == nullptr) {
+    auto lock = lock_thread_traces();
+    output = &lock->emplace_back(ThreadTrace{
+        .id = lock->size(),
+        .events = Protected<ThreadEvents, EmptyValidator<ThreadEvents>, false>(
+            ThreadEvents{.capacity = recording_events_per_thread.load()})});
+  }
+  return *output;
+}
+
+// Appends `input` to `output`, escaping it as the contents of a JSON string.
+void AppendJsonString(const std::wstring& input, std::string& output) {
+  for (char c : ToByteString(input)) switch (c) {
+      case '"':
+        output += "\\\"";
+        break;
+      case '\\':
+        output += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          static constexpr char kHexDigits[] = "0123456789abcdef";
+          output += "\\u00";
+          output += kHexDigits[c >> 4];
+          output += kHexDigits[c & 0xf];
+        } else {
+          output += c;
+        }
+    }
+}
+
+// Appends `nanoseconds` to `output`, in microseconds (the unit of the trace).
+void AppendMicroseconds(int64_t nanoseconds, std::string& output) {
+  if (nanoseconds < 0) {
+    output += '-';
+    nanoseconds = -nanoseconds;
+  }
+  std::string fraction = std::to_string(nanoseconds % 1000);
+  output += std::to_string(nanoseconds / 1000) + "." +
+            std::string(3 - fraction.size(), '0') + fraction;
+}
+}  // namespace
+
+void StartTraceRecording(size_t events_per_thread) {
+  CHECK_GT(events_per_thread, 0ul);
+  LOG(INFO) << "Starting trace recording: " << events_per_thread;
+  recording_events_per_thread = events_per_thread;
+  for (ThreadTrace& thread_trace : *lock_thread_traces())
+    thread_trace.events.lock([events_per_thread](ThreadEvents& events) {
+      events.capacity = events_per_thread;
+      events.events.clear();
+      events.recorded = 0;
+    });
+  recording_enabled = true;
+}
+
+void StopTraceRecording() {
+  LOG(INFO) << "Stopping trace recording.";
+  recording_enabled = false;
+}
+
+bool IsTraceRecordingEnabled() {
+  return recording_enabled.load(std::memory_order_relaxed);
+}
+
+void RecordTraceEvent(const TraceEvent& event) {
+  if (!IsTraceRecordingEnabled()) return;
+  CurrentThreadTrace().events.lock([&event](ThreadEvents& events) {
+    if (events.events.size() < events.capacity)
+      events.events.push_back(event);
+    else
+      events.events[events.recorded % events.capacity] = event;
+    events.recorded++;
+  });
+}
+
+void SetTraceThreadName(std::wstring name) {
+  CurrentThreadTrace().events.lock(
+      [&name](ThreadEvents& events) { events.name = std::move(name); });
+}
+
+std::string TraceToJson() {
+  const std::string pid = std::to_string(getpid());
+  std::string output = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first_entry = true;
+  auto start_entry = [&] {
+    output += first_entry ? "\n" : ",\n";
+    first_entry = false;
+  };
+  for (ThreadTrace& thread_trace : *lock_thread_traces()) {
+    auto [name, events] = thread_trace.events.lock([](ThreadEvents& data) {
+      return std::make_pair(data.name, data.OldestFirst());
+    });
+    const std::string tid = std::to_string(thread_trace.id);
+    if (name.has_value()) {
+      start_entry();
+      output += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+                ",\"tid\":" + tid + ",\"args\":{\"name\":\"";
+      AppendJsonString(name.value(), output);
+      output += "\"}}";
+    }
+    for (const TraceEvent& event : events) {
+      start_entry();
+      output += "{\"name\":\"";
+      AppendJsonString(event.name, output);
+      output += "\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid +
+                ",\"ts\":";
+      AppendMicroseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             event.start.time_since_epoch())
+                             .count(),
+                         output);
+      output += ",\"dur\":";
+      AppendMicroseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             event.end - event.start)
+                             .count(),
+                         output);
+      output += "}";
+    }
+  }
+  output += "\n]}\n";
+  return output;
+}
+
+namespace {
+const bool trace_recorder_tests_registration = tests::Register(
+    L"TraceRecorder",
+    {{.name = L"DisabledRecordsNothing",
+      .callback =
+          [] {
+            StartTraceRecording();
+            StopTraceRecording();
+            auto now = std::chrono::steady_clock::now();
+            RecordTraceEvent({.name = L"Ignored", .start = now, .end = now});
+            CHECK(TraceToJson().find("Ignored") == std::string::npos);
+          }},
+     {.name = L"Events",
+      .callback =
+          [] {
+            StartTraceRecording();
+            SetTraceThreadName(L"Main \"thread\"");
+            std::chrono::steady_clock::time_point start{
+                std::chrono::nanoseconds(5'000'042)};
+            RecordTraceEvent(
+                {.name = L"Foo",
+                 .start = start,
+                 .end = start + std::chrono::nanoseconds(1'500)});
+            StopTraceRecording();
+            std::string json = TraceToJson();
+            CHECK(json.find("{\"name\":\"thread_name\",\"ph\":\"M\"") !=
+                  std::string::npos);
+            CHECK(json.find("\"args\":{\"name\":\"Main \\\"thread\\\"\"}}") !=
+                  std::string::npos);
+            CHECK(json.find("{\"name\":\"Foo\",\"ph\":\"X\"") !=
+                  std::string::npos);
+            CHECK(json.find("\"ts\":5000.042,\"dur\":1.500}") !=
+                  std::string::npos);
+          }},
+     {.name = L"RingBufferKeepsNewest",
+      .callback =
+          [] {
+            StartTraceRecording(2);
+            auto now = std::chrono::steady_clock::now();
+            for (const wchar_t* name : {L"First", L"Second", L"Third"})
+              RecordTraceEvent({.name = name, .start = now, .end = now});
+            StopTraceRecording();
+            std::string json = TraceToJson();
+            CHECK(json.find("First") == std::string::npos);
+            size_t second = json.find("Second");
+            CHECK(second != std::string::npos);
+            CHECK(json.find("Third") != std::string::npos);
+            CHECK_LT(second, json.find("Third"));
+          }},
+     {.name = L"RestartDiscardsEvents",
+      .callback =
+          [] {
+            auto now = std::chrono::steady_clock::now();
+            StartTraceRecording();
+            RecordTraceEvent({.name = L"Old", .start = now, .end = now});
+            StartTraceRecording();
+            RecordTraceEvent({.name = L"New", .start = now, .end = now});
+            StopTraceRecording();
+            std::string json = TraceToJson();
+            CHECK(json.find("Old") == std::string::npos);
+            CHECK(json.find("New") != std::string::npos);
+          }},
+     {.name = L"Threads", .callback = [] {
+        StartTraceRecording();
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (const wchar_t* name : {L"Alpha", L"Beta"})
+          threads.emplace_back([name, now] {
+            for (int i = 0; i < 100; i++)
+              RecordTraceEvent({.name = name, .start = now, .end = now});
+          });
+        for (std::thread& thread : threads) thread.join();
+        StopTraceRecording();
+        std::string json = TraceToJson();
+        CHECK(json.find("Alpha") != std::string::npos);
+        CHECK(json.find("Beta") != std::string::npos);
+      }}});
+}  // namespace
+}  // namespace afc::infrastructure
@@ -0,0 +1,55 @@
+// Opt-in recording of timed events (such as the executions of operations
+// tracked by `Tracker`), to be inspected in a timeline. The recording is
+// exported in the Chrome trace-event format, which both chrome://tracing and
+// https://ui.perfetto.dev can load.
+//
+// Example:
+//
+//     StartTraceRecording();
+//     …  the editor runs …
+//     std::string json = TraceToJson();
+//
+// While recording is disabled (the default), `RecordTraceEvent` only performs a
+// relaxed atomic load. While it is enabled, each thread appends events to its
+// own fixed-size ring buffer (overwriting its oldest events once full), so only
+// the most recent events of each thread are retained.
+
+#ifndef __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_RECORDER_H__
+#define __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_RECORDER_H__
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace afc::infrastructure {
+struct TraceEvent {
+  // Must outlive the recording (e.g., a string literal or the name of a
+  // `Tracker`, which is never deleted).
+  const wchar_t* name;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+};
+
+constexpr size_t kDefaultTraceEventsPerThread = 1 << 14;
+
+// Discards all events previously recorded and starts recording. Each thread
+// retains (at most) its last `events_per_thread` events.
+void StartTraceRecording(
+    size_t events_per_thread = kDefaultTraceEventsPerThread);
+
+// Stops recording, retaining the events recorded so far.
+void StopTraceRecording();
+
+bool IsTraceRecordingEnabled();
+
+// Does nothing unless recording is enabled.
+void RecordTraceEvent(const TraceEvent& event);
+
+// Sets the name under which the events of the current thread are displayed.
+void SetTraceThreadName(std::wstring name);
+
+// Returns the events retained, in the Chrome trace-event (JSON) format.
+std::string TraceToJson();
+}  // namespace afc::infrastructure
+
+#endif  // __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_RECORDER_H__
@@ -0,0 +1,23 @@
+#include "src/infrastructure/trace_writer.h"
+
+#include <glog/logging.h>
+
+#include <fstream>
+
+#include "src/infrastructure/trace_recorder.h"
+
+using afc::language::Error;
+using afc::language::PossibleError;
+using afc::language::Success;
+using afc::language::lazy_string::LazyString;
+
+namespace afc::infrastructure {
+PossibleError WriteTrace(const Path& path) {
+  LOG(INFO) << "Writing trace: " << path;
+  std::ofstream output(path.ToBytes(), std::ios::binary | std::ios::trunc);
+  output << TraceToJson();
+  if (!output)
+    return Error{LazyString{L"Unable to write trace: "} + path.read()};
+  return Success();
+}
+}  // namespace afc::infrastructure
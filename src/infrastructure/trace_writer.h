@@ -0,0 +1,15 @@
+// Writes the events retained by the trace recorder (see trace_recorder.h) to a
+// file.
+
+#ifndef __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_WRITER_H__
+#define __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_WRITER_H__
+
+#include "src/infrastructure/dirname.h"
+#include "src/language/error/value_or_error.h"
+
+namespace afc::infrastructure {
+// Overwrites `path` with the output of `TraceToJson`.
+language::PossibleError WriteTrace(const Path& path);
+}  // namespace afc::infrastructure
+
+#endif  // __AFC_EDITOR_SRC_INFRASTRUCTURE_TRACE_WRITER_H__
@@ -2,10 +2,20 @@
 
 #include <glog/logging.h>
 
-#include "src/infrastructure/time.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/infrastructure/trace_recorder.h"
 #include "src/language/container.h"
 #include "src/language/safe_types.h"
 #include "src/language/wstring.h"
+#include "src/tests/tests.h"
 
 namespace container = afc::language::container;
 
@@ -22,15 +32,68 @@ Protected<Trackers>::Lock lock_trackers() {
       new Protected<Trackers, EmptyValidator<Trackers>, false>();
   return output->lock();
 }
+
+size_t NextTrackerId() {
+  static std::atomic<size_t> next_id = 0;
+  return next_id++;
+}
+
+// The innermost execution that is nested in the current thread.
+thread_local Tracker::Execution* innermost_execution = nullptr;
+
+// Set once the current thread is exiting and its shards have been retired.
+thread_local bool thread_shards_retired = false;
+
+// Only the first kParentsPerShard operations inside which a tracker runs (in a
+// given thread) are reflected in `Data::seconds_by_parent`.
+constexpr size_t kParentsPerShard = 8;
 }  // namespace
 
+// The counters of a tracker for a single thread. Only that thread modifies them
+// (except for `Tracker::Reset`), so relaxed atomic operations suffice.
+struct Tracker::Shard {
+  std::atomic<uint64_t> executions = 0;
+  std::atomic<uint64_t> nanoseconds = 0;
+  std::atomic<uint64_t> self_nanoseconds = 0;
+  std::atomic<uint64_t> longest_nanoseconds = 0;
+  std::array<std::atomic<uint64_t>, kLatencyBuckets> latency_histogram = {};
+
+  struct ParentEntry {
+    // Once set (with release semantics), never changes.
+    std::atomic<Tracker*> parent = nullptr;
+    std::atomic<uint64_t> nanoseconds = 0;
+  };
+  std::array<ParentEntry, kParentsPerShard> parents = {};
+
+  void Clear() {
+    executions = 0;
+    nanoseconds = 0;
+    self_nanoseconds = 0;
+    longest_nanoseconds = 0;
+    for (std::atomic<uint64_t>& count : latency_histogram) count = 0;
+    for (ParentEntry& entry : parents) entry.nanoseconds = 0;
+  }
+};
+
+// The shards of the current thread. Retires them when the thread exits.
+struct Tracker::ThreadShards {
+  // Indexed by `Tracker::id_`. Null for trackers that this thread hasn't
+  // executed.
+  std::vector<std::pair<Tracker*, Shard*>> shards;
+
+  ~ThreadShards() {
+    thread_shards_retired = true;
+    for (auto [tracker, shard] : shards)
+      if (shard != nullptr) tracker->Retire(*shard);
+  }
+};
+
 /* static */ std::list<Tracker::Data> Tracker::GetData() {
   std::list<Tracker::Data> output = container::MaterializeList(
       *lock_trackers() |
-      std::views::transform(
-          [](const NonNull<Tracker*> tracker) -> Tracker::Data {
-            return *tracker->data_.lock();
-          }));
+      std::views::transform([](const NonNull<Tracker*> tracker) {
+        return tracker->ReadData();
+      }));
   output.sort([](const Tracker::Data& a, const Tracker::Data& b) {
     return a.seconds < b.seconds;
   });
@@ -46,42 +109,422 @@ Protected<Trackers>::Lock lock_trackers() {
 }
 
 Tracker::Tracker(std::wstring name)
-    : trackers_it_([this]() {
+    : name_(std::move(name)),
+      id_(NextTrackerId()),
+      trackers_it_([this]() {
         auto lock = lock_trackers();
         lock->push_front(NonNull<Tracker*>::AddressOf(*this));
         return lock->begin();
       }()),
-      data_(Tracker::Data{std::move(name), 0, 0.0}) {}
+      shards_(Shards{.retired = Data{.name = name_}}) {}
 
 Tracker::~Tracker() {
   LOG(FATAL) << "Internal error: afc::infrastructure::Tracker instances should "
                 "never be deleted: "
-             << data_.lock([](Data& data) { return data.name; });
+             << name_;
+}
+
+Tracker::Execution Tracker::Call() { return Execution(*this); }
+
+void Tracker::Reset() {
+  shards_.lock([](Shards& shards) {
+    for (Shard& shard : shards.all) shard.Clear();
+    shards.retired.executions = 0;
+    shards.retired.seconds = 0;
+    shards.retired.self_seconds = 0;
+    shards.retired.longest_seconds = 0;
+    shards.retired.latency_histogram = {};
+    shards.retired.seconds_by_parent.clear();
+  });
 }
 
-std::unique_ptr<bool, std::function<void(bool*)>> Tracker::Call() {
-  data_.lock([](Data& data) {
-    VLOG(5) << "Start: " << data.name;
-    data.executions++;
+/* static */ void Tracker::AddShard(const Shard& shard, Data& output) {
+  static constexpr auto kRelaxed = std::memory_order_relaxed;
+  static constexpr double kSecondsPerNanosecond = 1e-9;
+  output.executions += shard.executions.load(kRelaxed);
+  output.seconds += shard.nanoseconds.load(kRelaxed) * kSecondsPerNanosecond;
+  output.self_seconds +=
+      shard.self_nanoseconds.load(kRelaxed) * kSecondsPerNanosecond;
+  output.longest_seconds = std::max(
+      output.longest_seconds,
+      shard.longest_nanoseconds.load(kRelaxed) * kSecondsPerNanosecond);
+  for (size_t i = 0; i < kLatencyBuckets; i++)
+    output.latency_histogram[i] += shard.latency_histogram[i].load(kRelaxed);
+  for (const Shard::ParentEntry& entry : shard.parents)
+    if (Tracker* parent = entry.parent.load(std::memory_order_acquire);
+        parent != nullptr)
+      if (uint64_t nanoseconds = entry.nanoseconds.load(kRelaxed);
+          nanoseconds > 0)
+        output.seconds_by_parent[parent->name_] +=
+            nanoseconds * kSecondsPerNanosecond;
+}
+
+Tracker::Data Tracker::ReadData() const {
+  return shards_.lock([](const Shards& shards) {
+    Data output = shards.retired;
+    for (const Shard& shard : shards.all) AddShard(shard, output);
+    return output;
   });
-  struct timespec start = infrastructure::Now();
-  return std::unique_ptr<bool, std::function<void(bool*)>>(
-      new bool(), [this, start](bool* value) {
-        double seconds = GetElapsedSecondsSince(start);
-        delete value;
-        data_.lock([seconds](Data& data) {
-          VLOG(6) << "Finish: " << data.name << ": " << seconds;
-          data.seconds += seconds;
-          data.longest_seconds = std::max(data.longest_seconds, seconds);
-        });
-      });
 }
 
-void Tracker::Reset() {
-  data_.lock([](Data& data) {
-    data.executions = 0;
-    data.seconds = 0;
-    data.longest_seconds = 0;
+Tracker::Shard& Tracker::CurrentThreadShard() {
+  thread_local ThreadShards thread_shards;
+  if (thread_shards_retired)
+    // The thread is exiting (e.g., this runs from the destructor of another
+    // thread_local object). The shard we return will never be retired.
+    return *shards_.lock(
+        [](Shards& shards) { return &shards.all.emplace_back(); });
+  if (thread_shards.shards.size() <= id_)
+    thread_shards.shards.resize(id_ + 1, {nullptr, nullptr});
+  auto& [tracker, shard] = thread_shards.shards[id_];
+  if (shard == nullptr) {
+    tracker = this;
+    shard = shards_.lock([](Shards& shards) {
+      if (shards.free.empty()) return &shards.all.emplace_back();
+      Shard* output = shards.free.back();
+      shards.free.pop_back();
+      return output;
+    });
+  }
+  return *shard;
+}
+
+void Tracker::Retire(Shard& shard) {
+  shards_.lock([&shard](Shards& shards) {
+    AddShard(shard, shards.retired);
+    shard.Clear();
+    // The thread that set them is gone.
+    for (Shard::ParentEntry& entry : shard.parents) entry.parent = nullptr;
+    shards.free.push_back(&shard);
   });
 }
+
+void Tracker::Record(const Execution& execution, uint64_t nanoseconds) {
+  static constexpr auto kRelaxed = std::memory_order_relaxed;
+  Shard& shard = CurrentThreadShard();
+  shard.executions.fetch_add(1, kRelaxed);
+  shard.nanoseconds.fetch_add(nanoseconds, kRelaxed);
+  shard.self_nanoseconds.fetch_add(
+      nanoseconds - std::min(nanoseconds, execution.children_nanoseconds_),
+      kRelaxed);
+  if (nanoseconds > shard.longest_nanoseconds.load(kRelaxed))
+    shard.longest_nanoseconds.store(nanoseconds, kRelaxed);
+  shard.latency_histogram[LatencyBucket(nanoseconds)].fetch_add(1, kRelaxed);
+
+  if (execution.parent_tracker_ == nullptr) return;
+  for (Shard::ParentEntry& entry : shard.parents) {
+    Tracker* parent = entry.parent.load(kRelaxed);
+    if (parent == nullptr) {
+      parent = execution.parent_tracker_;
+      entry.parent.store(parent, std::memory_order_release);
+    }
+    if (parent == execution.parent_tracker_) {
+      entry.nanoseconds.fetch_add(nanoseconds, kRelaxed);
+      return;
+    }
+  }
+}
+
+Tracker::Execution::Execution(Tracker& tracker)
+    : tracker_(&tracker),
+      parent_tracker_(innermost_execution == nullptr
+                          ? nullptr
+                          : innermost_execution->tracker_),
+      start_(std::chrono::steady_clock::now()),
+      linked_(true),
+      parent_(innermost_execution) {
+  if (parent_ != nullptr) parent_->child_ = this;
+  innermost_execution = this;
+}
+
+Tracker::Execution::Execution(Execution&& other)
+    : tracker_(std::exchange(other.tracker_, nullptr)),
+      parent_tracker_(other.parent_tracker_),
+      start_(other.start_),
+      children_nanoseconds_(other.children_nanoseconds_) {
+  other.Unlink();
+}
+
+Tracker::Execution& Tracker::Execution::operator=(Execution&& other) {
+  if (this == &other) return *this;
+  Finish();
+  tracker_ = std::exchange(other.tracker_, nullptr);
+  parent_tracker_ = other.parent_tracker_;
+  start_ = other.start_;
+  children_nanoseconds_ = other.children_nanoseconds_;
+  other.Unlink();
+  return *this;
+}
+
+Tracker::Execution& Tracker::Execution::operator=(std::nullptr_t) {
+  Finish();
+  return *this;
+}
+
+Tracker::Execution::~Execution() { Finish(); }
+
+void Tracker::Execution::Finish() {
+  if (tracker_ == nullptr) return;
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  uint64_t nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_)
+          .count();
+  if (linked_ && parent_ != nullptr)
+    parent_->children_nanoseconds_ += nanoseconds;
+  Unlink();
+  RecordTraceEvent(
+      {.name = tracker_->name_.c_str(), .start = start_, .end = end});
+  std::exchange(tracker_, nullptr)->Record(*this, nanoseconds);
+}
+
+void Tracker::Execution::Unlink() {
+  if (!linked_) return;
+  if (parent_ != nullptr) parent_->child_ = child_;
+  if (child_ != nullptr) {
+    child_->parent_ = parent_;
+  } else {
+    CHECK(innermost_execution == this);
+    innermost_execution = parent_;
+  }
+  linked_ = false;
+  parent_ = nullptr;
+  child_ = nullptr;
+}
+
+/* static */ size_t Tracker::LatencyBucket(uint64_t nanoseconds) {
+  static constexpr uint64_t kSubBuckets = 1 << kLatencySubBucketBits;
+  if (nanoseconds < kSubBuckets) return nanoseconds;
+  size_t exponent = std::bit_width(nanoseconds) - 1;
+  if (exponent >= kLatencyMaxBits) return kLatencyBuckets - 1;
+  return ((exponent - kLatencySubBucketBits + 1) << kLatencySubBucketBits) +
+         (nanoseconds >> (exponent - kLatencySubBucketBits)) - kSubBuckets;
+}
+
+/* static */ uint64_t Tracker::LatencyBucketLowerBound(size_t bucket) {
+  static constexpr uint64_t kSubBuckets = 1 << kLatencySubBucketBits;
+  if (bucket < kSubBuckets) return bucket;
+  size_t shift = (bucket >> kLatencySubBucketBits) - 1;
+  return (kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+/* static */ double Tracker::LatencyPercentile(const Data& data,
+                                               double percentile) {
+  size_t total = std::accumulate(data.latency_histogram.begin(),
+                                 data.latency_histogram.end(), 0ul);
+  if (total == 0) return 0;
+  size_t target =
+      std::max<size_t>(1, static_cast<size_t>(std::ceil(percentile * total)));
+  size_t accumulated = 0;
+  for (size_t i = 0; i < kLatencyBuckets; i++) {
+    accumulated += data.latency_histogram[i];
+    if (accumulated >= target)
+      // We return the middle of the bucket, but never above the longest
+      // execution.
+      return std::min(data.longest_seconds,
+                      1e-9 *
+                          (LatencyBucketLowerBound(i) +
+                           LatencyBucketLowerBound(
+                               std::min(i + 1, kLatencyBuckets - 1))) /
+                          2);
+  }
+  return data.longest_seconds;
+}
+
+std::wstring LatencyPercentilesToString(const Tracker::Data& data) {
+  auto format = [](double seconds) -> std::wstring {
+    double microseconds = seconds * 1e6;
+    if (microseconds < 1e4)
+      return std::to_wstring(std::lround(microseconds)) + L"us";
+    if (microseconds < 1e7)
+      return std::to_wstring(std::lround(microseconds / 1e3)) + L"ms";
+    return std::to_wstring(std::lround(microseconds / 1e6)) + L"s";
+  };
+  if (data.executions == 0) return L"";
+  return L"p50:" + format(Tracker::LatencyPercentile(data, 0.5)) + L" p99:" +
+         format(Tracker::LatencyPercentile(data, 0.99)) + L" p999:" +
+         format(Tracker::LatencyPercentile(data, 0.999));
+}
+
+namespace {
+std::optional<Tracker::Data> FindData(const std::wstring& name) {
+  for (Tracker::Data& data : Tracker::GetData())
+    if (data.name == name) return std::move(data);
+  return std::nullopt;
+}
+
+const bool tracker_tests_registration = tests::Register(
+    L"Tracker",
+    {{.name = L"LatencyBucket",
+      .callback =
+          [] {
+            CHECK_EQ(Tracker::LatencyBucket(0), 0ul);
+            CHECK_EQ(Tracker::LatencyBucket(3), 3ul);
+            CHECK_EQ(Tracker::LatencyBucket(4), 4ul);
+            CHECK_EQ(Tracker::LatencyBucket(7), 7ul);
+            CHECK_EQ(Tracker::LatencyBucket(8), 8ul);
+            CHECK_EQ(Tracker::LatencyBucket(9), 8ul);
+            CHECK_EQ(Tracker::LatencyBucket(10), 9ul);
+            CHECK_EQ(Tracker::LatencyBucket(15), 11ul);
+            CHECK_EQ(Tracker::LatencyBucket(16), 12ul);
+            CHECK_EQ(Tracker::LatencyBucket(1ul << 40),
+                     Tracker::kLatencyBuckets - 1);
+          }},
+     {.name = L"LatencyBucketLowerBound",
+      .callback =
+          [] {
+            for (size_t bucket = 0; bucket < Tracker::kLatencyBuckets;
+                 bucket++) {
+              uint64_t bound = Tracker::LatencyBucketLowerBound(bucket);
+              CHECK_EQ(Tracker::LatencyBucket(bound), bucket);
+              if (bucket > 0)
+                CHECK_EQ(Tracker::LatencyBucket(bound - 1), bucket - 1);
+            }
+          }},
+     {.name = L"LatencyPercentile",
+      .callback =
+          [] {
+            Tracker::Data data{.name = L"foo", .longest_seconds = 1};
+            CHECK_EQ(Tracker::LatencyPercentile(data, 0.5), 0.0);
+            // 98 executions of 1000ns (bucket [896, 1024)) and 2 of 1s.
+            data.latency_histogram[Tracker::LatencyBucket(1000)] = 98;
+            data.latency_histogram[Tracker::LatencyBucket(1000000000)] = 2;
+            CHECK_LT(std::abs(Tracker::LatencyPercentile(data, 0.5) - 960e-9),
+                     1e-12);
+            CHECK_LT(std::abs(Tracker::LatencyPercentile(data, 0.9) - 960e-9),
+                     1e-12);
+            CHECK_GT(Tracker::LatencyPercentile(data, 0.99), 0.8);
+            CHECK_LE(Tracker::LatencyPercentile(data, 0.99), 1.0);
+          }},
+     {.name = L"CallUpdatesHistogram",
+      .callback =
+          [] {
+            // Trackers are never deleted.
+            static Tracker* const tracker = new Tracker(L"TrackerTest");
+            tracker->Reset();
+            for (int i = 0; i < 2; i++) auto call = tracker->Call();
+            std::optional<Tracker::Data> data = FindData(L"TrackerTest");
+            CHECK(data.has_value());
+            CHECK_EQ(data->executions, 2ul);
+            CHECK_EQ(std::accumulate(data->latency_histogram.begin(),
+                                     data->latency_histogram.end(), 0ul),
+                     2ul);
+          }},
+     {.name = L"AssignNullFinishes",
+      .callback =
+          [] {
+            static Tracker* const tracker = new Tracker(L"TrackerTestNull");
+            tracker->Reset();
+            Tracker::Execution call = tracker->Call();
+            call = nullptr;
+            CHECK_EQ(FindData(L"TrackerTestNull")->executions, 1ul);
+            call = nullptr;
+            CHECK_EQ(FindData(L"TrackerTestNull")->executions, 1ul);
+          }},
+     {.name = L"Nested",
+      .callback =
+          [] {
+            static Tracker* const parent = new Tracker(L"TrackerTestParent");
+            static Tracker* const child = new Tracker(L"TrackerTestChild");
+            parent->Reset();
+            child->Reset();
+            {
+              auto parent_call = parent->Call();
+              for (int i = 0; i < 3; i++) {
+                auto child_call = child->Call();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+              }
+            }
+            {
+              auto orphan_call = child->Call();
+            }
+            Tracker::Data parent_data = FindData(L"TrackerTestParent").value();
+            Tracker::Data child_data = FindData(L"TrackerTestChild").value();
+            CHECK_EQ(child_data.executions, 4ul);
+            CHECK_EQ(child_data.seconds_by_parent.size(), 1ul);
+            CHECK_GE(child_data.seconds_by_parent[L"TrackerTestParent"], 3e-3);
+            CHECK_LE(child_data.seconds_by_parent[L"TrackerTestParent"],
+                     child_data.seconds);
+            CHECK_EQ(child_data.self_seconds, child_data.seconds);
+            CHECK_LE(parent_data.self_seconds, parent_data.seconds - 3e-3);
+            CHECK(parent_data.seconds_by_parent.empty());
+          }},
+     {.name = L"OutOfOrder",
+      .callback =
+          [] {
+            static Tracker* const a = new Tracker(L"TrackerTestOutOfOrderA");
+            static Tracker* const b = new Tracker(L"TrackerTestOutOfOrderB");
+            static Tracker* const c = new Tracker(L"TrackerTestOutOfOrderC");
+            Tracker::Execution a_call = a->Call();
+            Tracker::Execution b_call = b->Call();
+            a_call = nullptr;
+            b_call = nullptr;
+            {
+              auto c_call = c->Call();
+            }
+            CHECK(FindData(L"TrackerTestOutOfOrderC")
+                      ->seconds_by_parent.empty());
+          }},
+     {.name = L"MovedExecutionIsDetached",
+      .callback =
+          [] {
+            static Tracker* const a = new Tracker(L"TrackerTestMovedA");
+            static Tracker* const b = new Tracker(L"TrackerTestMovedB");
+            a->Reset();
+            std::optional<Tracker::Execution> moved;
+            moved.emplace(a->Call());
+            {
+              auto b_call = b->Call();
+            }
+            moved = std::nullopt;
+            CHECK_EQ(FindData(L"TrackerTestMovedA")->executions, 1ul);
+            CHECK(FindData(L"TrackerTestMovedB")->seconds_by_parent.empty());
+          }},
+     {.name = L"RecordsTraceEvent",
+      .callback =
+          [] {
+            static Tracker* const tracker = new Tracker(L"TrackerTestTrace");
+            StartTraceRecording();
+            tracker->Call();
+            StopTraceRecording();
+            CHECK(TraceToJson().find("\"name\":\"TrackerTestTrace\"") !=
+                  std::string::npos);
+          }},
+     {.name = L"Threads", .callback = [] {
+        static Tracker* const tracker = new Tracker(L"TrackerTestThreads");
+        tracker->Reset();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++)
+          threads.push_back(std::thread([] {
+            for (int j = 0; j < 1000; j++) auto call = tracker->Call();
+          }));
+        for (std::thread& thread : threads) thread.join();
+        CHECK_EQ(FindData(L"TrackerTestThreads")->executions, 4000ul);
+      }},
+     {.name = L"ExitedThreads", .callback = [] {
+        static Tracker* const parent = new Tracker(L"TrackerTestExitedParent");
+        static Tracker* const child = new Tracker(L"TrackerTestExitedChild");
+        child->Reset();
+        // Each thread reuses the shards retired by the previous one.
+        for (int i = 0; i < 3; i++)
+          std::thread([] {
+            auto parent_call = parent->Call();
+            for (int j = 0; j < 10; j++) {
+              auto child_call = child->Call();
+              std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+          }).join();
+        Tracker::Data data = FindData(L"TrackerTestExitedChild").value();
+        CHECK_EQ(data.executions, 30ul);
+        CHECK_EQ(std::accumulate(data.latency_histogram.begin(),
+                                 data.latency_histogram.end(), 0ul),
+                 30ul);
+        CHECK_GE(data.seconds, 3e-3);
+        CHECK_EQ(data.seconds_by_parent.size(), 1ul);
+        CHECK_GE(data.seconds_by_parent[L"TrackerTestExitedParent"], 3e-3);
+        child->Reset();
+        Tracker::Data reset_data = FindData(L"TrackerTestExitedChild").value();
+        CHECK_EQ(reset_data.executions, 0ul);
+        CHECK(reset_data.seconds_by_parent.empty());
+      }}});
+}  // namespace
 }  // namespace afc::infrastructure
@@ -1,5 +1,6 @@
 // Tracks number of times an operation happens (globally), as well as total time
-// spent executing it.
+// spent executing it, a histogram of the durations of its executions and the
+// operations inside which it executes.
 //
 // Example:
 //
@@ -13,14 +14,28 @@
 //     auto call = INLINE_TRACKER(MyTrackerName);
 //     …  heavy processing here …
 //     call = nullptr;  // The operation finished.
+//
+// Recording an execution doesn't allocate memory nor take locks (other than the
+// first time that a given thread executes a given operation): each thread
+// updates its own counters, which are only aggregated by `Tracker::GetData`.
+// When a thread exits, its counters are folded into totals for the tracker and
+// reused by other threads.
+//
+// Executions are also passed to `RecordTraceEvent` (see trace_recorder.h).
 
 #ifndef __AFC_EDITOR_SRC_TRACKERS_H__
 #define __AFC_EDITOR_SRC_TRACKERS_H__
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "src/concurrent/protected.h"
 #include "src/language/safe_types.h"
@@ -39,15 +54,85 @@ namespace afc::infrastructure {
 //
 // This class is thread-safe.
 class Tracker {
+  struct Shard;
+  struct ThreadShards;
+
  public:
+  // The latency histogram is log-linear: every power of two (of nanoseconds) is
+  // split into 2^kLatencySubBucketBits buckets of equal width. A bucket's upper
+  // bound is thus at most 25% above its lower bound.
+  static constexpr size_t kLatencySubBucketBits = 2;
+  // Executions longer than 2^kLatencyMaxBits nanoseconds (about 68 seconds)
+  // are counted in the last bucket.
+  static constexpr size_t kLatencyMaxBits = 36;
+  static constexpr size_t kLatencyBuckets =
+      (kLatencyMaxBits - kLatencySubBucketBits + 1) << kLatencySubBucketBits;
+
   struct Data {
     const std::wstring name;
 
     size_t executions = 0;
     double seconds = 0;
+    // Like `seconds`, but excluding the time spent in tracked operations nested
+    // (in the same thread) inside executions of this one.
+    double self_seconds = 0;
     double longest_seconds = 0;
+
+    // `latency_histogram[i]` counts the executions whose duration (in
+    // nanoseconds) was at least `LatencyBucketLowerBound(i)` (and smaller than
+    // `LatencyBucketLowerBound(i + 1)`).
+    std::array<size_t, kLatencyBuckets> latency_histogram = {};
+
+    // For executions that started while another tracked operation was
+    // executing in the same thread, the total seconds spent, indexed by the
+    // name of the (innermost) enclosing operation.
+    std::map<std::wstring, double> seconds_by_parent = {};
+  };
+
+  // Measures a single execution of an operation, from its creation (by
+  // `Tracker::Call`) until it is destroyed (or assigned `nullptr`).
+  //
+  // Executions are nested: an execution that starts while another one is
+  // running (in the same thread) is attributed to it. Moving an execution
+  // removes it from this nesting (but doesn't otherwise affect it), so that it
+  // can be finished from another thread.
+  class Execution {
+   public:
+    Execution() = default;
+    Execution(std::nullptr_t) {}
+    Execution(Execution&& other);
+    Execution& operator=(Execution&& other);
+    Execution& operator=(std::nullptr_t);
+    ~Execution();
+
+   private:
+    friend Tracker;
+    explicit Execution(Tracker& tracker);
+
+    void Finish();
+    void Unlink();
+
+    // Null if the execution has already finished (or this is empty).
+    Tracker* tracker_ = nullptr;
+    Tracker* parent_tracker_ = nullptr;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t children_nanoseconds_ = 0;
+
+    // While nested, the enclosing and the directly nested executions.
+    bool linked_ = false;
+    Execution* parent_ = nullptr;
+    Execution* child_ = nullptr;
   };
 
+  // Returns the index in `Data::latency_histogram` for an execution that took
+  // `nanoseconds`.
+  static size_t LatencyBucket(uint64_t nanoseconds);
+  static uint64_t LatencyBucketLowerBound(size_t bucket);
+
+  // Returns an estimate (from `data.latency_histogram`) of the given percentile
+  // (in the range [0, 1]) of the duration of executions, in seconds.
+  static double LatencyPercentile(const Data& data, double percentile);
+
   static std::list<Data> GetData();
 
   static void ResetAll();
@@ -59,15 +144,39 @@ class Tracker {
   // static initialization order fiasco).
   ~Tracker();
 
-  std::unique_ptr<bool, std::function<void(bool*)>> Call();
+  Execution Call();
   void Reset();
 
  private:
+  static void AddShard(const Shard& shard, Data& output);
+
+  Data ReadData() const;
+  Shard& CurrentThreadShard();
+  // Called when the thread that updates `shard` exits.
+  void Retire(Shard& shard);
+  void Record(const Execution& execution, uint64_t nanoseconds);
+
+  const std::wstring name_;
+  // Index of this tracker in each thread's list of shards.
+  const size_t id_;
   const std::list<language::NonNull<Tracker*>>::iterator trackers_it_;
 
-  concurrent::Protected<Data> data_;
+  struct Shards {
+    // Never shrinks: the shards of threads that have exited are reused.
+    std::list<Shard> all = {};
+    // Shards (in `all`) of threads that have exited. Their counters have been
+    // folded into `retired` (and cleared).
+    std::vector<Shard*> free = {};
+    Data retired;
+  };
+  concurrent::Protected<Shards, concurrent::EmptyValidator<Shards>, false>
+      shards_;
 };
 
+// Returns a description of the median and tail latencies in `data`, such as
+// "p50:24us p99:1ms p999:4s".
+std::wstring LatencyPercentilesToString(const Tracker::Data& data);
+
 #define LSTR(x) L##x
 
 #define INLINE_TRACKER(tracker_name)                           \
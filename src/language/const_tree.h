@@ -84,6 +84,10 @@ class VectorBlock {
                        std::vector<T>({std::forward<T>(value)}));
   }
 
+  static VectorBlock FromValues(std::vector<T> values) {
+    return VectorBlock(ConstructorAccessTag(), std::move(values));
+  }
+
   VectorBlock Insert(size_t index, T&& value) const {
     CHECK_LE(index, size());
     std::vector<T> values;
@@ -146,6 +150,8 @@ class VectorBlock {
 
   size_t size() const { return values_.size(); }
 
+  const std::vector<T>& values() const { return values_; }
+
   const T& Get(size_t index) const {
     CHECK_LT(index, size());
     return values_.at(index);
@@ -260,6 +266,14 @@ class ConstTree {
         .get_shared();
   }
 
+  // Returns a tree with a single block. `block` must not be empty (and can't
+  // have more than `MaxBlockSize` elements).
+  static NonNull<Ptr> FromBlock(Block block) {
+    return ConstTree(ConstructorAccessTag(), std::move(block), nullptr,
+                     nullptr)
+        .Share();
+  }
+
   static NonNull<Ptr> PushBack(const Ptr& a, ValueType element) {
     return FixBlocks(Block::Leaf(std::move(element)), a, nullptr).Share();
   }
@@ -390,6 +404,38 @@ class ConstTree {
     }
   }
 
+  // Calls `callback` on each block with elements in the range [begin, begin +
+  // length), in order. `callback` receives the block, the index (in the block)
+  // of the first element in the range, and the number of elements (in the
+  // block) in the range. Stops as soon as `callback` returns false (in which
+  // case, returns false).
+  template <typename Callable>
+  static bool ForEachBlock(const Ptr& tree, size_t begin, size_t length,
+                           const Callable& callback) {
+    if (length == 0) return true;
+    CHECK(tree != nullptr);
+    CHECK_LE(begin + length, tree->size_);
+    if (size_t size_left = Size(tree->left_); begin < size_left) {
+      size_t left_length = std::min(length, size_left - begin);
+      if (!ForEachBlock(tree->left_, begin, left_length, callback))
+        return false;
+      length -= left_length;
+      begin = 0;
+    } else {
+      begin -= size_left;
+    }
+    if (length == 0) return true;
+    if (size_t block_size = tree->block_->size(); begin < block_size) {
+      size_t block_length = std::min(length, block_size - begin);
+      if (!callback(tree->block_.value(), begin, block_length)) return false;
+      length -= block_length;
+      begin = 0;
+    } else {
+      begin -= block_size;
+    }
+    return ForEachBlock(tree->right_, begin, length, callback);
+  }
+
   template <typename Predicate>
   static bool Every(const Ptr& tree, const Predicate& predicate) {
     if (tree == nullptr) return true;
@@ -2,7 +2,6 @@
 
 #include <cxxabi.h>
 
-#include <cmath>
 #include <memory>
 #include <string>
 #include <utility>
@@ -87,7 +86,7 @@ std::string Demangle(const char* symbol) {
 
 ObjectMetadata::ObjectMetadata(ConstructorAccessKey, Pool& pool,
                                ExpandCallback expand_callback)
-    : pool_(pool), data_(Data{.expand_callback = std::move(expand_callback)}) {}
+    : pool_(pool), expand_callback_(std::move(expand_callback)) {}
 
 ObjectMetadata::~ObjectMetadata() {
   if (container_bag_registration_.has_value())
@@ -110,8 +109,16 @@ void ObjectMetadata::Orphan() {
 Pool& ObjectMetadata::pool() const { return pool_; }
 
 bool ObjectMetadata::IsAlive() const {
-  return data_.lock(
-      [](const Data& data) { return data.expand_callback != nullptr; });
+  return expand_state() != ExpandState::kExpired;
+}
+
+ObjectMetadata::ExpandState ObjectMetadata::expand_state() const {
+  return static_cast<ExpandState>(Arena::GetMark(this));
+}
+
+bool ObjectMetadata::UpdateExpandState(ExpandState expected,
+                                       ExpandState desired) {
+  return Arena::UpdateMark(this, expected, desired);
 }
 
 Pool::Pool(Options options)
@@ -122,6 +129,7 @@ Pool::Pool(Options options)
                   LazyString{L"PoolOperationsFactory"}, 8));
         return std::move(options);
       }()),
+      arena_(MakeNonNullShared<Arena>()),
       eden_(Eden(options_.max_bag_shards, 0, std::nullopt)),
       data_(Data{.expansion_schedule = concurrent::Bag<ObjectExpandVector>(
                      {.name = LazyString{L"GCPoolExpansionSchedule"},
@@ -174,6 +182,8 @@ size_t Pool::count_objects() const {
   });
 }
 
+Arena::Stats Pool::arena_stats() const { return arena_->stats(); }
+
 Pool::CollectOutput Pool::Collect() { return Collect(false); }
 
 Pool::FullCollectStats Pool::FullCollect() {
@@ -194,9 +204,7 @@ Pool::CollectOutput Pool::Collect(bool full) {
       eden_.lock([&](Eden& eden_data) -> std::optional<Eden> {
         if (!full) {
           if (options_.collect_duration_threshold.has_value())
-            timer = CountDownTimer(
-                std::exp2(eden_data.consecutive_unfinished_collect_calls) *
-                options_.collect_duration_threshold.value());
+            timer = CountDownTimer(options_.collect_duration_threshold.value());
 
           if (eden_data.expansion_schedule == std::nullopt) {
             size_t max_metadata_size = std::max(1024ul, data_size);
@@ -220,6 +228,7 @@ Pool::CollectOutput Pool::Collect(bool full) {
             }
           }
         }
+        marking_ = true;
         return std::exchange(
             eden_data, Eden(options_.max_bag_shards,
                             eden_data.consecutive_unfinished_collect_calls + 1,
@@ -247,19 +256,26 @@ Pool::CollectOutput Pool::Collect(bool full) {
               eden->expansion_schedule.has_value()
                   ? eden->expansion_schedule->size()
                   : 0ul;
+          {
+            NonNull<std::unique_ptr<Operation>> operation =
+                options_.operation_factory->New(
+                    INLINE_TRACKER(gc_Pool_ScheduleExpandRoots));
+            // Roots that survive from a previous slice of this marking cycle
+            // have already been scheduled.
+            if (!eden->expansion_schedule.has_value())
+              for (const ObjectMetadataBag& roots : data.roots_list)
+                ScheduleExpandRoots(operation.value(), roots,
+                                    data.expansion_schedule);
+            ScheduleExpandRoots(operation.value(), eden->roots,
+                                data.expansion_schedule);
+          }
+          VLOG(5) << "Roots registered: " << data.expansion_schedule.size();
           ConsumeEden(std::move(*eden), data);
 
           stats.generations = data.roots_list.size();
           stats.begin_total = SumContainedSizes(data.object_metadata_list);
           stats.roots = SumContainedSizes(data.roots_list);
 
-          ScheduleExpandRoots(
-              options_.operation_factory
-                  ->New(INLINE_TRACKER(gc_Pool_ScheduleExpandRoots))
-                  .value(),
-              data.roots_list, data.expansion_schedule);
-          VLOG(5) << "Roots registered: " << data.expansion_schedule.size();
-
           Expand(options_.operation_factory->New(INLINE_TRACKER(gc_Pool_Expand))
                      .value(),
                  data.expansion_schedule, timer);
@@ -274,6 +290,7 @@ Pool::CollectOutput Pool::Collect(bool full) {
                   << "New eden is empty. We've reached all objects at this "
                      "point. We no longer need to keep an expansion_schedule.";
               eden_data.expansion_schedule = std::nullopt;
+              marking_ = false;
               eden_data.consecutive_unfinished_collect_calls = 0;
               return std::nullopt;
             }
@@ -290,6 +307,10 @@ Pool::CollectOutput Pool::Collect(bool full) {
                               ->New(INLINE_TRACKER(gc_Pool_RemoveUnreachable))
                               .value(),
                           data.object_metadata_list, expired_objects_callbacks);
+        // Rather than having `RemoveUnreachable` switch each survivor back to
+        // `kUnreached`, we just visit the packed mark bits (once it is done).
+        arena_->ReplaceMarks(ObjectMetadata::ExpandState::kDone,
+                             ObjectMetadata::ExpandState::kUnreached);
 
         stats.end_total = SumContainedSizes(data.object_metadata_list);
         VLOG(3) << "Survivors: " << stats.end_total;
@@ -331,43 +352,33 @@ bool Pool::Eden::IsEmpty() const {
 }
 
 /* static */ void Pool::ScheduleExpandRoots(
-    const Operation& parallel_operation,
-    const std::list<ObjectMetadataBag>& roots_list,
+    const Operation& parallel_operation, const ObjectMetadataBag& roots,
     Bag<ObjectExpandVector>& schedule) {
-  VLOG(3) << "Registering roots: " << roots_list.size();
-  for (const ObjectMetadataBag& roots : roots_list)
-    roots.ForEachShard(
-        parallel_operation,
-        [&schedule](const std::list<std::weak_ptr<ObjectMetadata>>& shard) {
-          ObjectExpandVector local_expand_vector;
-          for (const std::weak_ptr<ObjectMetadata>& root_weak : shard)
-            VisitPointer(
-                root_weak,
-                [&local_expand_vector](
-                    NonNull<std::shared_ptr<ObjectMetadata>> obj) {
-                  if (!IsExpandAlreadyScheduled(obj))
-                    local_expand_vector.push_back(std::move(obj));
-                },
-                [] { LOG(FATAL) << "Root was dead. Should never happen."; });
-          if (!local_expand_vector.empty())
-            schedule.Add(std::move(local_expand_vector));
-        });
+  VLOG(3) << "Registering roots: " << roots.size();
+  roots.ForEachShard(
+      parallel_operation,
+      [&schedule](const std::list<std::weak_ptr<ObjectMetadata>>& shard) {
+        ObjectExpandVector local_expand_vector;
+        for (const std::weak_ptr<ObjectMetadata>& root_weak : shard)
+          VisitPointer(
+              root_weak,
+              [&local_expand_vector](
+                  NonNull<std::shared_ptr<ObjectMetadata>> obj) {
+                if (!IsExpandAlreadyScheduled(obj))
+                  local_expand_vector.push_back(std::move(obj));
+              },
+              [] { LOG(FATAL) << "Root was dead. Should never happen."; });
+        if (!local_expand_vector.empty())
+          schedule.Add(std::move(local_expand_vector));
+      });
 }
 
 /* static */ bool Pool::IsExpandAlreadyScheduled(
     const NonNull<std::shared_ptr<ObjectMetadata>>& object) {
-  return object->data_.lock([](ObjectMetadata::Data& data) {
-    switch (data.expand_state) {
-      case ObjectMetadata::ExpandState::kDone:
-      case ObjectMetadata::ExpandState::kScheduled:
-        return true;
-      case ObjectMetadata::ExpandState::kUnreached:
-        data.expand_state = ObjectMetadata::ExpandState::kScheduled;
-        return false;
-    }
-    LOG(FATAL) << "Invalid state";
-    return false;
-  });
+  // Objects in any other state (including `kExpired`) don't need to be
+  // scheduled.
+  return !object->UpdateExpandState(ObjectMetadata::ExpandState::kUnreached,
+                                    ObjectMetadata::ExpandState::kScheduled);
 }
 
 /* static */
@@ -382,7 +393,8 @@ void Pool::Expand(const Operation& parallel_operation,
     TRACK_OPERATION(gc_Pool_Expand_shard);
     size_t vectors = 0;
     while (!shard.empty() &&
-           !(count_down_timer.has_value() && count_down_timer->IsDone())) {
+           (vectors == 0 ||
+            !(count_down_timer.has_value() && count_down_timer->IsDone()))) {
       ++vectors;
       std::vector<NonNull<std::shared_ptr<ObjectMetadata>>> elements =
           std::move(shard.back());
@@ -390,26 +402,16 @@ void Pool::Expand(const Operation& parallel_operation,
       for (NonNull<std::shared_ptr<ObjectMetadata>>& obj : elements) {
         TRACK_OPERATION(gc_Pool_Expand_Step);
         VLOG(10) << "Considering obj: " << obj.get_shared();
+        if (!obj->UpdateExpandState(ObjectMetadata::ExpandState::kScheduled,
+                                    ObjectMetadata::ExpandState::kDone)) {
+          CHECK(obj->expand_state() == ObjectMetadata::ExpandState::kDone)
+              << "Invalid state.";
+          continue;
+        }
+        CHECK(obj->expand_callback_ != nullptr);
+        TRACK_OPERATION(gc_Pool_Expand_Step_call);
         std::vector<NonNull<std::shared_ptr<ObjectMetadata>>> expansion =
-            obj->data_.lock(
-                [&](ObjectMetadata::Data& object_data)
-                    -> std::vector<NonNull<std::shared_ptr<ObjectMetadata>>> {
-                  CHECK(object_data.expand_callback != nullptr);
-                  switch (object_data.expand_state) {
-                    case ObjectMetadata::ExpandState::kDone:
-                      return {};
-                    case ObjectMetadata::ExpandState::kScheduled: {
-                      object_data.expand_state =
-                          ObjectMetadata::ExpandState::kDone;
-                      TRACK_OPERATION(gc_Pool_Expand_Step_call);
-                      return object_data.expand_callback();
-                    }
-                    case ObjectMetadata::ExpandState::kUnreached:
-                      LOG(FATAL) << "Invalid state.";
-                  }
-                  LOG(FATAL) << "Invalid state.";
-                  return {};
-                });
+            obj->expand_callback_();
         VLOG(10) << "Installing expansion of " << obj.get_shared() << ": "
                  << expansion.size();
 
@@ -440,25 +442,18 @@ void Pool::RemoveUnreachable(const Operation& parallel_operation,
         return VisitPointer(
             obj_weak,
             [&](NonNull<std::shared_ptr<ObjectMetadata>> obj) -> bool {
-              return obj->data_.lock([&](ObjectMetadata::Data& object_data) {
-                switch (object_data.expand_state) {
-                  case ObjectMetadata::ExpandState::kUnreached:
-                    obj->Orphan();
-                    local_expired_objects_callbacks.push_back(
-                        std::move(object_data.expand_callback));
-                    return true;
-                  case ObjectMetadata::ExpandState::kDone:
-                    object_data.expand_state =
-                        ObjectMetadata::ExpandState::kUnreached;
-                    return false;
-                  case ObjectMetadata::ExpandState::kScheduled:
-                    LOG(FATAL)
-                        << "Invalid State: Removing unreachable objects while "
-                           "some objects are scheduled for expansion.";
-                }
-                LOG(FATAL) << "Unhandled case.";
-                return false;
-              });
+              if (obj->UpdateExpandState(
+                      ObjectMetadata::ExpandState::kUnreached,
+                      ObjectMetadata::ExpandState::kExpired)) {
+                obj->Orphan();
+                local_expired_objects_callbacks.push_back(
+                    std::move(obj->expand_callback_));
+                return true;
+              }
+              CHECK(obj->expand_state() == ObjectMetadata::ExpandState::kDone)
+                  << "Invalid State: Removing unreachable objects while some "
+                     "objects are scheduled for expansion.";
+              return false;
             },
             []() -> bool {
               // The object should handle its own removal. Maybe we lost a race.
@@ -508,6 +503,7 @@ Pool::RootRegistration Pool::AddRoot(
 
 void Pool::AddToEdenExpandList(
     language::NonNull<std::shared_ptr<ObjectMetadata>> object_metadata) {
+  if (!marking_) return;
   eden_.lock([&](Eden& eden) {
     if (eden.expansion_schedule.has_value() &&
         !IsExpandAlreadyScheduled(object_metadata))
@@ -517,9 +513,15 @@ void Pool::AddToEdenExpandList(
 
 language::NonNull<std::shared_ptr<ObjectMetadata>> Pool::NewObjectMetadata(
     ObjectMetadata::ExpandCallback expand_callback) {
+  // The control block of `std::allocate_shared` (sharing the allocation with
+  // the `ObjectMetadata`) must fit in a slot.
+  static_assert(sizeof(ObjectMetadata) + 64 <= Arena::kMaxSlotSize);
   language::NonNull<std::shared_ptr<ObjectMetadata>> object_metadata =
-      MakeNonNullShared<ObjectMetadata>(ObjectMetadata::ConstructorAccessKey(),
-                                        *this, std::move(expand_callback));
+      NonNull<std::shared_ptr<ObjectMetadata>>::Unsafe(
+          std::allocate_shared<ObjectMetadata>(
+              ArenaAllocator<ObjectMetadata>(arena_),
+              ObjectMetadata::ConstructorAccessKey(), *this,
+              std::move(expand_callback)));
   eden_.lock([&](Eden& eden) {
     ObjectMetadata::AddToBag(object_metadata, eden.object_metadata);
     VLOG(10) << "Adding object: " << object_metadata.get_shared()
@@ -541,7 +543,8 @@ Pool::Eden::Eden(size_t bag_shards,
 
 std::ostream& operator<<(std::ostream& os, const Pool& pool) {
   os << "[Pool: <objects: " << pool.count_objects() << "> "
-     << *pool.eden_.lock() << "; " << *pool.data_.lock() << "]";
+     << *pool.eden_.lock() << "; " << *pool.data_.lock() << "; "
+     << pool.arena_stats() << "]";
   return os;
 }
 
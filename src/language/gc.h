@@ -42,6 +42,14 @@
 // `UnfinishedCollectStats` occasionally. When this happens, the caller should
 // try to call `Pool::Collect` again to resume the operation.
 //
+// The marking is tri-color: objects are white (`ObjectMetadata::kUnreached`),
+// gray (`kScheduled`) or black (`kDone`). The progress of the marking is
+// retained across calls to `Pool::Collect`, so each call only does a bounded
+// amount of work (see `Pool::Options::collect_duration_threshold`). While
+// marking is in progress, creating or assigning a `Ptr` acts as a write
+// barrier: it shades the referenced object gray (see `Ptr::Protect`), so that
+// the references that the customer moves around between calls aren't missed.
+//
 // DEFINING MANAGED TYPES
 //
 // An "expand callback" function must be defined for every type `T` for which
@@ -88,6 +96,7 @@
 #define __AFC_LANGUAGE_GC_H__
 #include <glog/logging.h>
 
+#include <atomic>
 #include <functional>
 #include <list>
 #include <memory>
@@ -99,6 +108,7 @@
 #include "src/concurrent/operation.h"
 #include "src/concurrent/protected.h"
 #include "src/infrastructure/time.h"
+#include "src/language/gc_arena.h"
 #include "src/language/safe_types.h"
 
 namespace afc::language::gc {
@@ -116,7 +126,8 @@ class EnableRootFromThis;
 
 class Pool;
 
-// The object metadata, allocated once per object managed. This is an internal
+// The object metadata, allocated once per object managed (in the `Arena` of its
+// pool, which also holds its `ExpandState`). This is an internal
 // class; the reason we expose it here is to allow implementation of the
 // `Expand` functions for the types of the managed objects.
 //
@@ -125,7 +136,7 @@ class Pool;
 //
 // The only `std::shared_ptr<>` reference (in the entire hierarchy of classes in
 // this module, `afc::language::gc`) to the objects managed is kept inside
-// `ObjectMetadata::expand_callback`. Everything else just keeps
+// `ObjectMetadata::expand_callback_`. Everything else just keeps
 // `std::weak_ptr<>` references. By clearing up the `expand_callback`, we
 // effectively allow objects to be deleted.
 class ObjectMetadata {
@@ -167,33 +178,42 @@ class ObjectMetadata {
 
   Pool& pool_;
 
-  // The state of this object during a garbage collection operation.
-  enum ExpandState {
+  // The state of this object during a garbage collection operation. Stored in
+  // the mark bits of the arena slot that holds this object.
+  enum ExpandState : Arena::Mark {
     // This is the initial state that all objects have before the garbage
     // operation starts. At the end, when the collection finishes, all objects
     // remaining in this state will be deleted (and the state of all surviving
     // objects will be switched to this).
-    kUnreached,
+    kUnreached = 0,
 
     // The object has been reached and has been scheduled for expansion.
-    kScheduled,
+    kScheduled = 1,
 
     // The object has been reached and expanded: all its outgoing references
     // have been scheduled.
-    kDone
-  };
-  struct Data {
-    ExpandCallback expand_callback;
-    ExpandState expand_state = ExpandState::kUnreached;
+    kDone = 2,
+
+    // The object wasn't reached and `expand_callback_` has been cleared.
+    kExpired = 3
   };
 
+  ExpandState expand_state() const;
+
+  // Switches the state to `desired` if it is `expected`. Returns a boolean
+  // indicating whether the state was switched.
+  bool UpdateExpandState(ExpandState expected, ExpandState desired);
+
   // `container_bag_registration_` is used to eagerly remove this object from
   // the corresponding bag during its deletion. The corresponding bag must only
   // be deleted after all objects stored in it have been deleted.
   std::optional<concurrent::Bag<std::weak_ptr<ObjectMetadata>>::Registration>
       container_bag_registration_;
 
-  concurrent::Protected<Data> data_;
+  // Only read (by `Pool::Expand`) after switching the state from `kScheduled`
+  // to `kDone`; only cleared (by `Pool::RemoveUnreachable`) after switching it
+  // from `kUnreached` to `kExpired`.
+  ExpandCallback expand_callback_;
 };
 
 template <typename T, typename Enable = void>
@@ -211,8 +231,8 @@ class Pool {
     // When this happens, `Collect` is likely to actually run for slightly
     // longer than this threshold. This may be because some operations, such as
     // generating the set of references from an object, may take significantly
-    // longer, or because we deliberately increase the threshold as collections
-    // keep getting interrupted (in order to ensure that we make progress).
+    // longer. To ensure that we make progress, each call expands at least one
+    // set of objects, even if the threshold has already been reached.
     std::optional<afc::infrastructure::Duration> collect_duration_threshold =
         std::nullopt;
 
@@ -225,7 +245,11 @@ class Pool {
 
   template <typename T>
   Root<T> NewRoot(language::NonNull<std::unique_ptr<T>> value_unique) {
-    language::NonNull<std::shared_ptr<T>> value = std::move(value_unique);
+    // The reference count of `value` is allocated in `arena_`.
+    language::NonNull<std::shared_ptr<T>> value =
+        language::NonNull<std::shared_ptr<T>>::Unsafe(std::shared_ptr<T>(
+            std::move(value_unique).get_unique().release(),
+            std::default_delete<T>(), ArenaAllocator<T>(arena_)));
     Root<T> output =
         Ptr<T>(std::weak_ptr<T>(value.get_shared()), NewObjectMetadata([value] {
                  return ExpandHelper<T>()(value.value());
@@ -247,6 +271,9 @@ class Pool {
 
   size_t count_objects() const;
 
+  // Memory used by the arena (which holds the metadata of all objects).
+  Arena::Stats arena_stats() const;
+
   struct FullCollectStats {
     size_t roots = 0;
     size_t begin_total = 0;
@@ -308,8 +335,7 @@ class Pool {
     std::optional<ObjectExpandVector> expansion_schedule;
 
     // Incremented each time a call to `Collect` stops without finishing, and
-    // reset as soon as the call finishes. Used to adjust the execution
-    // threshold dynamically.
+    // reset as soon as the call finishes.
     size_t consecutive_unfinished_collect_calls;
   };
   friend std::ostream& operator<<(std::ostream& os, const Eden& eden);
@@ -323,8 +349,9 @@ class Pool {
 
     std::list<ObjectMetadataBag> roots_list = {};
 
-    // After inserting from the eden and updating roots, we copy objects from
-    // `roots` into `expansion_schedule` (in `ScheduleExpandRoots`). We then
+    // When a marking cycle starts, we copy objects from `roots_list` into
+    // `expansion_schedule` (in `ScheduleExpandRoots`); when it resumes, we only
+    // copy the roots created since the previous call to `Collect`. We then
     // recursively visit all objects here. Once the list is empty, we'll know
     // a set of unreachable objects.
     //
@@ -342,18 +369,16 @@ class Pool {
   // `data`.
   void ConsumeEden(Eden eden, Data& data);
 
-  // Inserts all not-yet-scheduled objects from `roots_list` into
-  // `expansion_schedule`.
+  // Inserts all not-yet-scheduled objects from `roots` into `schedule`.
   static void ScheduleExpandRoots(
-      const concurrent::Operation& operation,
-      const std::list<ObjectMetadataBag>& roots_list,
+      const concurrent::Operation& operation, const ObjectMetadataBag& roots,
       concurrent::Bag<ObjectExpandVector>& schedule);
 
   static bool IsExpandAlreadyScheduled(
       const language::NonNull<std::shared_ptr<ObjectMetadata>>& object);
 
   // Recursively expand all objects in `data.expansion_schedule`. May stop early
-  // if the timeout is reached.
+  // if the timeout is reached (but each shard expands at least one vector).
   static void Expand(const concurrent::Operation& operation,
                      concurrent::Bag<ObjectExpandVector>& schedule,
                      const std::optional<afc::infrastructure::CountDownTimer>&
@@ -365,7 +390,14 @@ class Pool {
           expired_objects_callbacks);
 
   const Options options_;
+  const language::NonNull<std::shared_ptr<Arena>> arena_;
   concurrent::Protected<Eden> eden_;
+
+  // Whether `eden_.expansion_schedule` has a value (i.e., a marking cycle is in
+  // progress). Lets `AddToEdenExpandList` (the write barrier) avoid locking
+  // `eden_` when there is nothing to do.
+  std::atomic<bool> marking_ = false;
+
   concurrent::Protected<Data> data_;
 
   // If VLOG(10) is on, we'll store back traces of creation of roots here. When
@@ -0,0 +1,282 @@
+#include "src/language/gc_arena.h"
+
+#include <glog/logging.h>
+
+#include <cstdlib>
+#include <new>
+#include <set>
+
+#include "src/tests/tests.h"
+
+namespace afc::language::gc {
+namespace {
+constexpr size_t kMarksPerWord = 32;
+constexpr uint64_t kLowMarkBits = 0x5555555555555555ull;
+
+// Returns a word with the lowest bit of each mark in `word` that is equal to
+// `mark` set (and all other bits cleared).
+uint64_t MatchingMarks(uint64_t word, Arena::Mark mark) {
+  uint64_t difference = word ^ (kLowMarkBits * mark);
+  return ~(difference | (difference >> 1)) & kLowMarkBits;
+}
+}  // namespace
+
+struct Arena::Slab {
+  static constexpr size_t kMarkWords =
+      kSlabSize / kSizeClassGranularity / kMarksPerWord;
+
+  explicit Slab(size_t input_slot_size)
+      : slot_size(input_slot_size),
+        slots((kSlabSize - sizeof(Slab)) / slot_size) {
+    static_assert(sizeof(Slab) % kSizeClassGranularity == 0);
+  }
+
+  void* slot(size_t index) {
+    return reinterpret_cast<char*>(this) + sizeof(Slab) + index * slot_size;
+  }
+
+  size_t SlotIndex(const void* address) const {
+    size_t offset = static_cast<const char*>(address) -
+                    reinterpret_cast<const char*>(this) - sizeof(Slab);
+    DCHECK_LT(offset / slot_size, slots);
+    return offset / slot_size;
+  }
+
+  std::atomic<uint64_t>& MarkWord(size_t index) {
+    return marks[index / kMarksPerWord];
+  }
+
+  static size_t MarkShift(size_t index) { return index % kMarksPerWord * 2; }
+
+  const size_t slot_size;
+  const size_t slots;
+  std::array<std::atomic<uint64_t>, kMarkWords> marks = {};
+};
+
+Arena::~Arena() {
+  for (concurrent::Protected<SizeClass>& size_class : size_classes_)
+    size_class.lock([](SizeClass& data) {
+      CHECK_EQ(data.used_slots, 0ul);
+      for (NonNull<Slab*> slab : data.slabs) {
+        slab->~Slab();
+        std::free(slab.get());
+      }
+    });
+  CHECK_EQ(large_bytes_.load(), 0ul);
+}
+
+void* Arena::Allocate(size_t size) {
+  CHECK_GT(size, 0ul);
+  if (size > kMaxSlotSize) {
+    large_bytes_ += size;
+    return ::operator new(size);
+  }
+  size_t index = SizeClassIndex(size);
+  void* output = size_classes_[index].lock([index](SizeClass& data) -> void* {
+    data.used_slots++;
+    if (void* slot = data.free_list; slot != nullptr) {
+      data.free_list = *static_cast<void**>(slot);
+      return slot;
+    }
+    if (data.unused_slots_in_last_slab == 0) {
+      void* memory = std::aligned_alloc(kSlabSize, kSlabSize);
+      CHECK(memory != nullptr);
+      data.slabs.push_back(NonNull<Slab*>::Unsafe(
+          new (memory) Slab((index + 1) * kSizeClassGranularity)));
+      data.unused_slots_in_last_slab = data.slabs.back()->slots;
+    }
+    Slab& slab = data.slabs.back().value();
+    return slab.slot(slab.slots - data.unused_slots_in_last_slab--);
+  });
+  Slab& slab = SlabContaining(output);
+  size_t slot_index = slab.SlotIndex(output);
+  slab.MarkWord(slot_index)
+      .fetch_and(~(uint64_t{3} << Slab::MarkShift(slot_index)),
+                 std::memory_order_relaxed);
+  return output;
+}
+
+void Arena::Deallocate(void* address, size_t size) {
+  if (size > kMaxSlotSize) {
+    large_bytes_ -= size;
+    ::operator delete(address);
+    return;
+  }
+  size_classes_[SizeClassIndex(size)].lock([address](SizeClass& data) {
+    CHECK_GT(data.used_slots, 0ul);
+    data.used_slots--;
+    *static_cast<void**>(address) = data.free_list;
+    data.free_list = address;
+  });
+}
+
+/* static */ Arena::Mark Arena::GetMark(const void* address) {
+  Slab& slab = SlabContaining(address);
+  size_t index = slab.SlotIndex(address);
+  return (slab.MarkWord(index).load(std::memory_order_acquire) >>
+          Slab::MarkShift(index)) &
+         3;
+}
+
+/* static */ bool Arena::UpdateMark(const void* address, Mark expected,
+                                    Mark desired) {
+  Slab& slab = SlabContaining(address);
+  size_t index = slab.SlotIndex(address);
+  std::atomic<uint64_t>& word = slab.MarkWord(index);
+  const size_t shift = Slab::MarkShift(index);
+  uint64_t current = word.load(std::memory_order_acquire);
+  while (true) {
+    if (((current >> shift) & 3) != expected) return false;
+    uint64_t next = (current & ~(uint64_t{3} << shift)) |
+                    (static_cast<uint64_t>(desired) << shift);
+    if (word.compare_exchange_weak(current, next, std::memory_order_acq_rel,
+                                   std::memory_order_acquire))
+      return true;
+  }
+}
+
+void Arena::ReplaceMarks(Mark from, Mark to) {
+  for (concurrent::Protected<SizeClass>& size_class : size_classes_) {
+    // Slabs are never deleted (while the arena is alive), so we can visit them
+    // without holding the lock.
+    std::vector<NonNull<Slab*>> slabs =
+        size_class.lock([](const SizeClass& data) { return data.slabs; });
+    for (NonNull<Slab*> slab : slabs)
+      for (size_t i = 0; i * kMarksPerWord < slab->slots; i++) {
+        std::atomic<uint64_t>& word = slab->marks[i];
+        uint64_t current = word.load(std::memory_order_acquire);
+        while (uint64_t matching = MatchingMarks(current, from)) {
+          uint64_t next =
+              (current & ~(matching | matching << 1)) | matching * to;
+          if (word.compare_exchange_weak(current, next,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire))
+            break;
+        }
+      }
+  }
+}
+
+Arena::Stats Arena::stats() const {
+  Stats output{.large_bytes = large_bytes_.load()};
+  for (size_t i = 0; i < size_classes_.size(); i++)
+    size_classes_[i].lock([&](const SizeClass& data) {
+      if (!data.slabs.empty())
+        output.size_classes.push_back(
+            {.slot_size = (i + 1) * kSizeClassGranularity,
+             .slabs = data.slabs.size(),
+             .used_slots = data.used_slots});
+    });
+  return output;
+}
+
+/* static */ size_t Arena::SizeClassIndex(size_t size) {
+  return (size - 1) / kSizeClassGranularity;
+}
+
+/* static */ Arena::Slab& Arena::SlabContaining(const void* address) {
+  return *reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(address) &
+                                  ~(kSlabSize - 1));
+}
+
+std::ostream& operator<<(std::ostream& os, const Arena::Stats& stats) {
+  os << "[Arena:";
+  for (const Arena::SizeClassStats& size_class : stats.size_classes)
+    os << " <" << size_class.slot_size
+       << ": slabs: " << size_class.slabs
+       << ", used_bytes: " << size_class.used_bytes() << ">";
+  os << " <large_bytes: " << stats.large_bytes << ">]";
+  return os;
+}
+
+namespace {
+const bool arena_tests_registration = tests::Register(
+    L"GCArena",
+    {{.name = L"ReusesSlots",
+      .callback =
+          [] {
+            Arena arena;
+            void* a = arena.Allocate(40);
+            void* b = arena.Allocate(48);
+            CHECK(a != b);
+            arena.Deallocate(a, 40);
+            CHECK(arena.Allocate(33) == a);
+            Arena::Stats stats = arena.stats();
+            CHECK_EQ(stats.size_classes.size(), 1ul);
+            CHECK_EQ(stats.size_classes[0].slot_size, 48ul);
+            CHECK_EQ(stats.size_classes[0].slabs, 1ul);
+            CHECK_EQ(stats.size_classes[0].used_bytes(), 96ul);
+            arena.Deallocate(a, 33);
+            arena.Deallocate(b, 48);
+          }},
+     {.name = L"ManySlabs",
+      .callback =
+          [] {
+            Arena arena;
+            std::set<void*> addresses;
+            for (int i = 0; i < 10000; i++) {
+              void* address = arena.Allocate(16);
+              CHECK_EQ(reinterpret_cast<uintptr_t>(address) % 16, 0ul);
+              CHECK(addresses.insert(address).second);
+            }
+            Arena::Stats stats = arena.stats();
+            CHECK_EQ(stats.size_classes.size(), 1ul);
+            CHECK_EQ(stats.size_classes[0].slabs, 3ul);
+            CHECK_EQ(stats.size_classes[0].used_slots, 10000ul);
+            for (void* address : addresses) arena.Deallocate(address, 16);
+            CHECK_EQ(arena.stats().size_classes[0].used_slots, 0ul);
+          }},
+     {.name = L"LargeAllocations",
+      .callback =
+          [] {
+            Arena arena;
+            void* address = arena.Allocate(1000);
+            Arena::Stats stats = arena.stats();
+            CHECK(stats.size_classes.empty());
+            CHECK_EQ(stats.large_bytes, 1000ul);
+            arena.Deallocate(address, 1000);
+            CHECK_EQ(arena.stats().large_bytes, 0ul);
+          }},
+     {.name = L"Marks",
+      .callback =
+          [] {
+            Arena arena;
+            std::vector<void*> addresses;
+            for (int i = 0; i < 100; i++)
+              addresses.push_back(arena.Allocate(64));
+            for (void* address : addresses)
+              CHECK_EQ(Arena::GetMark(address), 0);
+            // Addresses in the middle of a slot also work.
+            CHECK(Arena::UpdateMark(static_cast<char*>(addresses[3]) + 40, 0,
+                                    2));
+            CHECK(!Arena::UpdateMark(addresses[3], 0, 1));
+            CHECK(Arena::UpdateMark(addresses[5], 0, 3));
+            CHECK(Arena::UpdateMark(addresses[40], 0, 2));
+            for (size_t i = 0; i < addresses.size(); i++)
+              CHECK_EQ(Arena::GetMark(addresses[i]),
+                       i == 3 || i == 40 ? 2 : i == 5 ? 3 : 0);
+
+            arena.ReplaceMarks(2, 1);
+            CHECK_EQ(Arena::GetMark(addresses[3]), 1);
+            CHECK_EQ(Arena::GetMark(addresses[5]), 3);
+            CHECK_EQ(Arena::GetMark(addresses[40]), 1);
+            CHECK_EQ(Arena::GetMark(addresses[4]), 0);
+
+            // Reallocated slots start with a clear mark.
+            arena.Deallocate(addresses[5], 64);
+            CHECK(arena.Allocate(64) == addresses[5]);
+            CHECK_EQ(Arena::GetMark(addresses[5]), 0);
+            for (void* address : addresses) arena.Deallocate(address, 64);
+          }},
+     {.name = L"Allocator", .callback = [] {
+        auto arena = MakeNonNullShared<Arena>();
+        std::shared_ptr<int> value = std::allocate_shared<int>(
+            ArenaAllocator<int>(arena), 42);
+        CHECK_EQ(*value, 42);
+        CHECK_EQ(arena->stats().size_classes.size(), 1ul);
+        CHECK_EQ(arena->stats().size_classes[0].used_slots, 1ul);
+        value = nullptr;
+        CHECK_EQ(arena->stats().size_classes[0].used_slots, 0ul);
+      }}});
+}  // namespace
+}  // namespace afc::language::gc
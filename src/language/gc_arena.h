@@ -0,0 +1,146 @@
+// Memory arena used by `gc::Pool` to allocate the bookkeeping structures of the
+// objects it manages: the `ObjectMetadata` instances and the reference counts
+// (`std::shared_ptr` control blocks) of the managed values.
+//
+// Memory is reserved in slabs of `kSlabSize` bytes, aligned to their size. Each
+// slab holds blocks ("slots") of a single size class (a multiple of
+// `kSizeClassGranularity`). Freed slots are reused for subsequent allocations
+// of the same size class; slabs are only released when the arena is deleted.
+// Allocations larger than `kMaxSlotSize` are forwarded to the global
+// allocator.
+//
+// Because slabs are aligned, the slab (and slot) that holds any address can be
+// computed directly. Each slab holds a side table with two "mark" bits for
+// each of its slots, packed into words. `Pool` uses them to track the state of
+// each object during a collection (see `ObjectMetadata::ExpandState`), which
+// means that (1) objects don't need their own mutex and (2) operations that
+// affect the marks of all objects (such as `ReplaceMarks`) only need to visit a
+// few contiguous words per slab.
+#ifndef __AFC_LANGUAGE_GC_ARENA_H__
+#define __AFC_LANGUAGE_GC_ARENA_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "src/concurrent/protected.h"
+#include "src/language/safe_types.h"
+
+namespace afc::language::gc {
+class Arena {
+ public:
+  static constexpr size_t kSlabSize = 64 * 1024;
+  static constexpr size_t kSizeClassGranularity = 16;
+  static constexpr size_t kMaxSlotSize = 256;
+
+  // Only the two lowest bits are used.
+  using Mark = uint8_t;
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena();
+
+  // The returned address is aligned to `kSizeClassGranularity`.
+  void* Allocate(size_t size);
+
+  // `size` must be the value given to the corresponding call to `Allocate`.
+  void Deallocate(void* address, size_t size);
+
+  // `address` must be inside a slot (allocated by `Allocate` with a size
+  // smaller than or equal to `kMaxSlotSize`). The mark of a slot is 0 when it
+  // is allocated.
+  static Mark GetMark(const void* address);
+
+  // Sets the mark of the slot containing `address` to `desired` if its current
+  // value is `expected`. Returns a boolean indicating whether it was updated.
+  static bool UpdateMark(const void* address, Mark expected, Mark desired);
+
+  // Replaces the mark of all slots with value `from` to `to`.
+  void ReplaceMarks(Mark from, Mark to);
+
+  struct SizeClassStats {
+    size_t slot_size = 0;
+    size_t slabs = 0;
+    size_t used_slots = 0;
+
+    size_t reserved_bytes() const { return slabs * kSlabSize; }
+    size_t used_bytes() const { return used_slots * slot_size; }
+  };
+
+  struct Stats {
+    // Only contains entries for size classes with at least one slab.
+    std::vector<SizeClassStats> size_classes;
+
+    // Bytes allocated outside of the slabs (larger than `kMaxSlotSize`).
+    size_t large_bytes = 0;
+  };
+
+  Stats stats() const;
+
+ private:
+  struct Slab;
+
+  struct SizeClass {
+    std::vector<NonNull<Slab*>> slabs = {};
+
+    // Singly linked list of freed slots (the first bytes of each freed slot
+    // hold the address of the next).
+    void* free_list = nullptr;
+
+    // Number of slots (in the last slab) that have never been allocated.
+    size_t unused_slots_in_last_slab = 0;
+
+    size_t used_slots = 0;
+  };
+
+  static size_t SizeClassIndex(size_t size);
+  static Slab& SlabContaining(const void* address);
+
+  std::array<concurrent::Protected<SizeClass>,
+             kMaxSlotSize / kSizeClassGranularity>
+      size_classes_;
+  std::atomic<size_t> large_bytes_ = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const Arena::Stats& stats);
+
+// Standard allocator interface that allocates from an arena. Keeps the arena
+// alive (so it may outlive the pool that created it).
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(NonNull<std::shared_ptr<Arena>> arena)
+      : arena_(std::move(arena)) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= Arena::kSizeClassGranularity);
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* address, size_t n) {
+    arena_->Deallocate(address, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return &arena_.value() == &other.arena_.value();
+  }
+
+ private:
+  template <typename U>
+  friend class ArenaAllocator;
+
+  NonNull<std::shared_ptr<Arena>> arena_;
+};
+}  // namespace afc::language::gc
+#endif  // __AFC_LANGUAGE_GC_ARENA_H__
@@ -21,6 +21,10 @@ class StringFromContainer : public LazyStringImpl {
 
   ColumnNumberDelta size() const { return ColumnNumberDelta(data_.size()); }
 
+  ContiguousView Contiguous() const {
+    return std::wstring_view(data_.data(), data_.size());
+  }
+
  protected:
   const Container data_;
 };
@@ -37,6 +41,15 @@ class MoveableCharBuffer : public LazyStringImpl {
 
   ColumnNumberDelta size() const { return size_; }
 
+  // We can't implement `Contiguous` (since the buffer may move), but the
+  // buffer won't move during the call to `callback`.
+  bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                    const ChunkCallback& callback) const override {
+    CHECK_LE((begin + length).ToDelta(), size_);
+    return length.IsZero() ||
+           callback(std::wstring_view(*buffer_ + begin.read(), length.read()));
+  }
+
  protected:
   const wchar_t* const* buffer_;
   ColumnNumberDelta size_;
@@ -0,0 +1,131 @@
+#include "src/language/lazy_string/character_scanner.h"
+
+#include <glog/logging.h>
+
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+namespace afc::language::lazy_string {
+namespace {
+// All the functions below return the index of the first occurrence of `c` in
+// `input`, or `input.size()` if there are none.
+
+template <typename Char>
+size_t FindScalar(std::basic_string_view<Char> input, Char c) {
+  for (size_t i = 0; i < input.size(); i++)
+    if (input[i] == c) return i;
+  return input.size();
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of the x86-64 baseline, so these need no runtime check.
+size_t FindSse2(std::string_view input, char c) {
+  const __m128i needle = _mm_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 16 <= input.size(); i += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+    if (int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)); mask != 0)
+      return i + std::countr_zero(static_cast<unsigned>(mask));
+  }
+  return i + FindScalar(input.substr(i), c);
+}
+
+size_t FindSse2(std::wstring_view input, wchar_t c) {
+  static_assert(sizeof(wchar_t) == 4);
+  const __m128i needle = _mm_set1_epi32(c);
+  size_t i = 0;
+  for (; i + 4 <= input.size(); i += 4) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+    if (int mask =
+            _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, needle)));
+        mask != 0)
+      return i + std::countr_zero(static_cast<unsigned>(mask));
+  }
+  return i + FindScalar(input.substr(i), c);
+}
+
+__attribute__((target("avx2"))) size_t FindAvx2(std::string_view input,
+                                                  char c) {
+  const __m256i needle = _mm256_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 32 <= input.size(); i += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + i));
+    if (int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        mask != 0)
+      return i + std::countr_zero(static_cast<unsigned>(mask));
+  }
+  return i + FindScalar(input.substr(i), c);
+}
+
+__attribute__((target("avx2"))) size_t FindAvx2(std::wstring_view input,
+                                                  wchar_t c) {
+  const __m256i needle = _mm256_set1_epi32(c);
+  size_t i = 0;
+  for (; i + 8 <= input.size(); i += 8) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + i));
+    if (int mask = _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, needle)));
+        mask != 0)
+      return i + std::countr_zero(static_cast<unsigned>(mask));
+  }
+  return i + FindScalar(input.substr(i), c);
+}
+
+bool SupportsAvx2() {
+  static const bool output = __builtin_cpu_supports("avx2");
+  return output;
+}
+#endif
+
+template <typename Char>
+size_t Find(std::basic_string_view<Char> input, Char c) {
+#if defined(__x86_64__)
+  return SupportsAvx2() ? FindAvx2(input, c) : FindSse2(input, c);
+#else
+  return FindScalar(input, c);
+#endif
+}
+}  // namespace
+
+std::optional<ColumnNumber> FindCharacter(const LazyString& input, wchar_t c,
+                                          ColumnNumber start) {
+  CHECK_LE(start.ToDelta(), input.size());
+  std::optional<size_t> index = std::visit(
+      [&]<typename View>(View view) -> std::optional<size_t> {
+        if constexpr (std::is_same_v<View, std::monostate>) {
+          return std::nullopt;
+        } else if constexpr (std::is_same_v<View, std::string_view>) {
+          // The view only contains ASCII characters.
+          if (c < 0 || c >= 0x80) return view.size();
+          return start.read() + Find(view.substr(start.read()),
+                                     static_cast<char>(c));
+        } else {
+          return start.read() + Find(view.substr(start.read()), c);
+        }
+      },
+      input.Contiguous());
+  if (index == std::nullopt) {
+    // Scan the fragments (see `LazyString::ForEachChunk`).
+    index = start.read();
+    input.ForEachChunk(start, input.size() - start.ToDelta(),
+                       [&](std::wstring_view chunk) {
+                         size_t position = Find(chunk, c);
+                         *index += position;
+                         return position == chunk.size();
+                       });
+  }
+  if (*index == static_cast<size_t>(input.size().read())) return std::nullopt;
+  return ColumnNumber(*index);
+}
+}  // namespace afc::language::lazy_string
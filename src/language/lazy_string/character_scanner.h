@@ -0,0 +1,21 @@
+#ifndef __AFC_LANGUAGE_LAZY_STRING_CHARACTER_SCANNER_H__
+#define __AFC_LANGUAGE_LAZY_STRING_CHARACTER_SCANNER_H__
+
+#include <optional>
+
+#include "src/language/lazy_string/column_number.h"
+#include "src/language/lazy_string/lazy_string.h"
+
+namespace afc::language::lazy_string {
+// Returns the first column (at or after `start`) in `input` that contains `c`.
+//
+// If `input` exposes its characters contiguously (see
+// `LazyString::Contiguous`), they are scanned directly, using vector
+// instructions (SSE2 or AVX2, selected at runtime based on the CPU) if
+// available. Otherwise, the fragments that it exposes (see
+// `LazyString::ForEachChunk`) are scanned.
+std::optional<ColumnNumber> FindCharacter(const LazyString& input, wchar_t c,
+                                          ColumnNumber start);
+}  // namespace afc::language::lazy_string
+
+#endif  // __AFC_LANGUAGE_LAZY_STRING_CHARACTER_SCANNER_H__
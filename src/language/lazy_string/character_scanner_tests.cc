@@ -0,0 +1,71 @@
+#include <glog/logging.h>
+
+#include <string>
+#include <variant>
+
+#include "src/language/lazy_string/character_scanner.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/tests/tests.h"
+
+namespace afc::language::lazy_string {
+namespace {
+const bool character_scanner_tests_registration = tests::Register(
+    L"FindCharacter",
+    {{.name = L"Empty",
+      .callback =
+          [] {
+            CHECK(FindCharacter(LazyString{}, L'\n', ColumnNumber{}) ==
+                  std::nullopt);
+          }},
+     {.name = L"Absent",
+      .callback =
+          [] {
+            CHECK(FindCharacter(LazyString{std::wstring(100, L'x')}, L'\n',
+                                ColumnNumber{}) == std::nullopt);
+          }},
+     {.name = L"AllPositions",
+      .callback =
+          [] {
+            // Exercises the vectorized loops as well as the scalar suffixes.
+            for (size_t size = 1; size < 80; size++)
+              for (size_t position = 0; position < size; position++) {
+                std::wstring input(size, L'x');
+                input[position] = L'\n';
+                CHECK(FindCharacter(LazyString{input}, L'\n',
+                                    ColumnNumber{}) == ColumnNumber(position));
+              }
+          }},
+     {.name = L"Start",
+      .callback =
+          [] {
+            LazyString input{L"a\nbc\nd"};
+            CHECK(FindCharacter(input, L'\n', ColumnNumber{1}) ==
+                  ColumnNumber(1));
+            CHECK(FindCharacter(input, L'\n', ColumnNumber{2}) ==
+                  ColumnNumber(4));
+            CHECK(FindCharacter(input, L'\n', ColumnNumber{5}) ==
+                  std::nullopt);
+            CHECK(FindCharacter(input, L'\n', ColumnNumber{6}) ==
+                  std::nullopt);
+          }},
+     {.name = L"Substring",
+      .callback =
+          [] {
+            LazyString input =
+                LazyString{L"\nabcdefghijklmnopqrstuvwxyz\n"}.Substring(
+                    ColumnNumber{1}, ColumnNumberDelta{26});
+            CHECK(FindCharacter(input, L'\n', ColumnNumber{}) == std::nullopt);
+            CHECK(FindCharacter(input, L'z', ColumnNumber{}) ==
+                  ColumnNumber(25));
+          }},
+     {.name = L"NotContiguous", .callback = [] {
+        // Long enough that it won't be flattened.
+        LazyString input =
+            LazyString{ColumnNumberDelta{600}, L'a'} + LazyString{L"d\nef"};
+        CHECK(std::holds_alternative<std::monostate>(input.Contiguous()));
+        CHECK(FindCharacter(input, L'\n', ColumnNumber{}) ==
+              ColumnNumber(601));
+        CHECK(FindCharacter(input, L'\n', ColumnNumber{602}) == std::nullopt);
+      }}});
+}  // namespace
+}  // namespace afc::language::lazy_string
@@ -9,6 +9,16 @@
 #include "src/language/lazy_string/lazy_string.h"
 
 namespace afc::language::lazy_string {
+// Types that wrap a LazyString (such as `SingleLine`), for which we can read
+// the characters in fragments (see `LazyString::ForEachChunk`).
+template <typename StringType>
+concept WrapsLazyString =
+    std::same_as<StringType, LazyString> || requires(const StringType& s) {
+      { s.read() } -> std::convertible_to<const LazyString&>;
+    } || requires(const StringType& s) {
+      { s.read().read() } -> std::convertible_to<const LazyString&>;
+    };
+
 // Finds the first column in a string where `predicate` returns true.
 //
 // If no such column is found, returns an empty optional; otherwise, returns the
@@ -20,6 +30,22 @@ template <typename StringType, typename Predicate>
 std::optional<ColumnNumber> FindFirstColumnWithPredicate(
     const StringType& input, const Predicate& f, ColumnNumber start) {
   CHECK_LE(start.ToDelta(), input.size());
+  if constexpr (WrapsLazyString<StringType>) {
+    std::optional<ColumnNumber> output;
+    ColumnNumber column = start;
+    ToLazyString(input).ForEachChunk(
+        start, input.size() - start.ToDelta(), [&](std::wstring_view chunk) {
+          for (wchar_t c : chunk) {
+            if (f(column, c)) {
+              output = column;
+              return false;
+            }
+            ++column;
+          }
+          return true;
+        });
+    return output;
+  }
   for (ColumnNumberDelta delta = start.ToDelta(); delta < input.size(); ++delta)
     if (ColumnNumber column = ColumnNumber() + delta;
         f(column, input.get(column)))
@@ -2,9 +2,12 @@
 
 #include <glog/logging.h>
 
+#include <array>
+
 #include "src/infrastructure/tracker.h"
 #include "src/language/const_tree.h"
 #include "src/language/lazy_string/functional.h"
+#include "src/language/overload.h"
 #include "src/language/wstring.h"
 
 namespace afc::language::lazy_string {
@@ -16,6 +19,34 @@ ColumnNumberDelta ColumnNumber::ToDelta() const {
 namespace {
 using ::operator<<;
 
+// Size of the buffers used to expose the characters of strings that aren't
+// stored as contiguous `wchar_t` values (see `LazyStringImpl::ForEachChunk`).
+constexpr size_t kChunkSize = 256;
+
+// Strings produced by `Append` (or `Substring` of an appended string) with up
+// to this many characters are flattened: their characters are copied into
+// contiguous storage. This avoids the cost of reading through the tree (in
+// `AppendImpl`) for typical (short) lines, which tend to be the result of
+// many small edits.
+const ColumnNumberDelta kMaxFlatSize{512};
+
+// Calls `callback` on consecutive fragments of `length` characters, obtained
+// through `getter` (which receives the index of the character).
+template <typename Getter>
+bool ForEachCopiedChunk(ColumnNumberDelta length, const Getter& getter,
+                        const LazyStringImpl::ChunkCallback& callback) {
+  std::array<wchar_t, kChunkSize> buffer;
+  for (size_t start = 0; start < static_cast<size_t>(length.read());
+       start += kChunkSize) {
+    size_t chunk_length =
+        std::min(kChunkSize, static_cast<size_t>(length.read()) - start);
+    for (size_t i = 0; i < chunk_length; i++) buffer[i] = getter(start + i);
+    if (!callback(std::wstring_view(buffer.data(), chunk_length)))
+      return false;
+  }
+  return true;
+}
+
 class EmptyStringImpl : public LazyStringImpl {
  public:
   wchar_t get(ColumnNumber) const override {
@@ -23,6 +54,8 @@ class EmptyStringImpl : public LazyStringImpl {
     return 0;
   }
   ColumnNumberDelta size() const override { return ColumnNumberDelta(0); }
+
+  ContiguousView Contiguous() const override { return std::wstring_view(); }
 };
 
 template <typename Container>
@@ -37,6 +70,10 @@ class StringFromContainer : public LazyStringImpl {
 
   ColumnNumberDelta size() const { return ColumnNumberDelta(data_.size()); }
 
+  ContiguousView Contiguous() const {
+    return std::wstring_view(data_.data(), data_.size());
+  }
+
  protected:
   const Container data_;
 };
@@ -54,6 +91,11 @@ class RepeatedChar : public LazyStringImpl {
 
   ColumnNumberDelta size() const { return times_; }
 
+  bool ForEachChunk(ColumnNumber, ColumnNumberDelta length,
+                    const ChunkCallback& callback) const override {
+    return ForEachCopiedChunk(length, [this](size_t) { return c_; }, callback);
+  }
+
  protected:
   const ColumnNumberDelta times_;
   const wchar_t c_;
@@ -71,6 +113,29 @@ class SubstringImpl : public LazyStringImpl {
 
   ColumnNumberDelta size() const override { return delta_; }
 
+  ContiguousView Contiguous() const override {
+    return std::visit(
+        [this]<typename View>(View view) -> ContiguousView {
+          if constexpr (std::is_same_v<View, std::monostate>)
+            return view;
+          else
+            return view.substr(column_.read(), delta_.read());
+        },
+        buffer_->Contiguous());
+  }
+
+  bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                    const ChunkCallback& callback) const override {
+    CHECK_LE((begin + length).ToDelta(), delta_);
+    return buffer_->ForEachChunk(column_ + begin.ToDelta(), length, callback);
+  }
+
+  const NonNull<std::shared_ptr<const LazyStringImpl>>& buffer() const {
+    return buffer_;
+  }
+
+  ColumnNumber column() const { return column_; }
+
  private:
   const NonNull<std::shared_ptr<const LazyStringImpl>> buffer_;
   // First column to read from.
@@ -79,12 +144,42 @@ class SubstringImpl : public LazyStringImpl {
 };
 }  // namespace
 
+bool LazyStringImpl::ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                                  const ChunkCallback& callback) const {
+  if (length.IsZero()) return true;
+  CHECK_LE((begin + length).ToDelta(), size());
+  return std::visit(
+      overload{[&](std::wstring_view view) {
+                 return callback(view.substr(begin.read(), length.read()));
+               },
+               [&](std::string_view view) {
+                 return ForEachCopiedChunk(
+                     length,
+                     [&](size_t i) -> wchar_t {
+                       return static_cast<unsigned char>(
+                           view[begin.read() + i]);
+                     },
+                     callback);
+               },
+               [&](std::monostate) {
+                 return ForEachCopiedChunk(
+                     length,
+                     [&](size_t i) {
+                       return get(begin + ColumnNumberDelta(i));
+                     },
+                     callback);
+               }},
+      Contiguous());
+}
+
 // Why isn't this in the anonymous namespace? We need to make it public so that
 // we can declare it as friend of LazyString (so that it can get access to the
 // `data_` field.
 class AppendImpl : public LazyStringImpl {
  public:
-  using Tree = ConstTree<VectorBlock<wchar_t, 64>, 64>;
+  static constexpr size_t kBlockSize = 64;
+  using Block = VectorBlock<wchar_t, kBlockSize>;
+  using Tree = ConstTree<Block, kBlockSize>;
 
   AppendImpl(Tree::Ptr tree) : tree_(std::move(tree)) {}
 
@@ -94,20 +189,64 @@ class AppendImpl : public LazyStringImpl {
     return ColumnNumberDelta(Tree::Size(tree_));
   }
 
+  bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                    const ChunkCallback& callback) const override {
+    return Tree::ForEachBlock(
+        tree_, begin.read(), length.read(),
+        [&callback](const Block& block, size_t start, size_t block_length) {
+          return callback(
+              std::wstring_view(block.values().data() + start, block_length));
+        });
+  }
+
   const Tree::Ptr& tree() const { return tree_; }
 
   static AppendImpl::Tree::Ptr TreeFrom(LazyString a) {
-    if (auto a_cast = dynamic_cast<const AppendImpl*>(a.data_.get().get());
-        a_cast != nullptr) {
+    const LazyStringImpl* data = a.data_.get().get();
+    if (auto a_cast = dynamic_cast<const AppendImpl*>(data); a_cast != nullptr)
       return a_cast->tree();
-    }
+    if (auto substring = dynamic_cast<const SubstringImpl*>(data);
+        substring != nullptr)
+      if (auto buffer =
+              dynamic_cast<const AppendImpl*>(substring->buffer().get().get());
+          buffer != nullptr)
+        return Tree::Suffix(
+            Tree::Prefix(buffer->tree(),
+                         (substring->column() + substring->size()).read()),
+            substring->column().read());
+
     AppendImpl::Tree::Ptr output;
-    ForEachColumn(a, [&output](ColumnNumber, wchar_t c) {
-      output = AppendImpl::Tree::PushBack(output, c).get_shared();
+    std::vector<wchar_t> values;
+    auto flush = [&output, &values] {
+      output = Tree::Append(
+          output,
+          Tree::FromBlock(Block::FromValues(std::move(values))).get_shared());
+      values = {};
+    };
+    a.ForEachChunk([&](std::wstring_view chunk) {
+      while (!chunk.empty()) {
+        size_t length = std::min(chunk.size(), kBlockSize - values.size());
+        values.insert(values.end(), chunk.begin(), chunk.begin() + length);
+        chunk.remove_prefix(length);
+        if (values.size() == kBlockSize) flush();
+      }
+      return true;
     });
+    if (!values.empty()) flush();
     return output;
   }
 
+  // Returns a string with the characters in `inputs`, stored contiguously.
+  static LazyString Flatten(std::initializer_list<const LazyString*> inputs) {
+    std::wstring output;
+    for (const LazyString* input : inputs)
+      input->ForEachChunk([&output](std::wstring_view chunk) {
+        output.append(chunk);
+        return true;
+      });
+    return LazyString(std::move(output));
+  }
+
  private:
   const Tree::Ptr tree_;
 };
@@ -129,11 +268,29 @@ ColumnNumberDelta LazyString::size() const { return data_->size(); }
 
 bool LazyString::empty() const { return data_->size().IsZero(); }
 
+LazyStringImpl::ContiguousView LazyString::Contiguous() const {
+  return data_->Contiguous();
+}
+
+bool LazyString::ForEachChunk(
+    const LazyStringImpl::ChunkCallback& callback) const {
+  return data_->ForEachChunk(ColumnNumber{}, size(), callback);
+}
+
+bool LazyString::ForEachChunk(
+    ColumnNumber begin, ColumnNumberDelta length,
+    const LazyStringImpl::ChunkCallback& callback) const {
+  return data_->ForEachChunk(begin, length, callback);
+}
+
 std::wstring LazyString::ToString() const {
   TRACK_OPERATION(LazyString_ToString);
-  std::wstring output(size().read(), 0);
-  ForEachColumn(*this,
-                [&output](ColumnNumber i, wchar_t c) { output[i.read()] = c; });
+  std::wstring output;
+  output.reserve(size().read());
+  ForEachChunk([&output](std::wstring_view chunk) {
+    output.append(chunk);
+    return true;
+  });
   return output;
 }
 
@@ -148,7 +305,16 @@ LazyString LazyString::Substring(ColumnNumber column,
   CHECK_GE(delta, ColumnNumberDelta(0));
   CHECK_LE(column, ColumnNumber(0) + size());
   CHECK_LE(column + delta, ColumnNumber(0) + size());
-  return LazyString(MakeNonNullShared<SubstringImpl>(data_, column, delta));
+  // Avoid nesting substrings: read directly from the underlying string.
+  if (auto substring = dynamic_cast<const SubstringImpl*>(data_.get().get());
+      substring != nullptr)
+    return LazyString(MakeNonNullShared<SubstringImpl>(
+        substring->buffer(), substring->column() + column.ToDelta(), delta));
+  LazyString output(MakeNonNullShared<SubstringImpl>(data_, column, delta));
+  if (delta <= kMaxFlatSize &&
+      dynamic_cast<const AppendImpl*>(data_.get().get()) != nullptr)
+    return AppendImpl::Flatten({&output});
+  return output;
 }
 
 LazyString LazyString::SubstringWithRangeChecks(ColumnNumber column,
@@ -160,6 +326,8 @@ LazyString LazyString::SubstringWithRangeChecks(ColumnNumber column,
 LazyString LazyString::Append(LazyString suffix) const {
   if (empty()) return suffix;
   if (suffix.empty()) return *this;
+  if (size() <= kMaxFlatSize - suffix.size())
+    return AppendImpl::Flatten({this, &suffix});
   return LazyString(MakeNonNullShared<AppendImpl>(AppendImpl::Tree::Append(
       AppendImpl::TreeFrom(*this), AppendImpl::TreeFrom(suffix))));
 }
@@ -1,8 +1,13 @@
 #ifndef __AFC_LANGUAGE_LAZY_STRING_LAZY_STRING_H__
 #define __AFC_LANGUAGE_LAZY_STRING_LAZY_STRING_H__
 
+#include <concepts>
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 
 #include "src/language/safe_types.h"
 
@@ -14,9 +19,59 @@ struct ColumnNumberDelta;
 // methods in a given instance always output the same values.
 class LazyStringImpl {
  public:
+  // A view of all the characters in the string, if they are stored
+  // contiguously. A `std::string_view` is only used for strings that only
+  // contain ASCII characters (so that each byte is a character).
+  using ContiguousView =
+      std::variant<std::monostate, std::wstring_view, std::string_view>;
+
+  // Receives consecutive (non-empty) fragments of a string. Returns false to
+  // stop the iteration.
+  //
+  // Only references the callable it's constructed from (which must outlive
+  // it); this avoids the costs of `std::function` (an allocation and a copy of
+  // the callable) in every call to `ForEachChunk`.
+  class ChunkCallback {
+   public:
+    template <typename Callable>
+      requires(!std::same_as<std::remove_cvref_t<Callable>, ChunkCallback> &&
+               std::is_invocable_r_v<bool, Callable&, std::wstring_view>)
+    ChunkCallback(Callable&& callable)
+        : callable_(const_cast<void*>(
+              static_cast<const void*>(std::addressof(callable)))),
+          call_([](void* callable, std::wstring_view chunk) -> bool {
+            return (*static_cast<std::remove_reference_t<Callable>*>(
+                callable))(chunk);
+          }) {}
+
+    bool operator()(std::wstring_view chunk) const {
+      return call_(callable_, chunk);
+    }
+
+   private:
+    void* callable_;
+    bool (*call_)(void*, std::wstring_view);
+  };
+
   virtual ~LazyStringImpl() {}
   virtual wchar_t get(ColumnNumber pos) const = 0;
   virtual ColumnNumberDelta size() const = 0;
+
+  // Allows algorithms to scan the characters directly (rather than calling
+  // `get` for each). The view must remain valid for as long as the instance is
+  // alive. Implementations that don't store the characters contiguously
+  // return `std::monostate`.
+  virtual ContiguousView Contiguous() const { return std::monostate{}; }
+
+  // Calls `callback` on consecutive views that, concatenated, contain the
+  // characters in the range [begin, begin + length). The views are only valid
+  // during the call to `callback`. Returns false if `callback` stopped the
+  // iteration (by returning false).
+  //
+  // The default implementation is based on `Contiguous` (if available) or
+  // copies the characters (with `get`) into a small buffer.
+  virtual bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                            const ChunkCallback& callback) const;
 };
 
 class AppendImpl;
@@ -44,6 +99,20 @@ class LazyString {
   ColumnNumberDelta size() const;
   bool empty() const;
 
+  // See `LazyStringImpl::Contiguous`. The view remains valid for as long as
+  // this instance (or a copy of it) is alive.
+  LazyStringImpl::ContiguousView Contiguous() const;
+
+  // See `LazyStringImpl::ForEachChunk`. This is significantly faster than
+  // reading each character (with `get`): most implementations can expose their
+  // characters in large fragments, avoiding a virtual call per character.
+  bool ForEachChunk(const LazyStringImpl::ChunkCallback& callback) const;
+
+  // Only visits the characters in the range [begin, begin + length). Cheaper
+  // than calling `ForEachChunk` on a `Substring`.
+  bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                    const LazyStringImpl::ChunkCallback& callback) const;
+
   std::wstring ToString() const;
 
   LazyStringIterator begin() const;
@@ -0,0 +1,92 @@
+// Benchmarks for LazyString, over strings shaped like the result of editing a
+// line: many small insertions (each replacing the string with the
+// concatenation of a prefix, the new characters and a suffix).
+
+#include "src/infrastructure/time.h"
+#include "src/language/lazy_string/functional.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/tests/benchmarks.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::tests::BenchmarkName;
+
+namespace afc::language::lazy_string {
+namespace {
+// Returns a string obtained by inserting `edits` fragments (of a few
+// characters each) at random positions.
+LazyString EditedString(int edits) {
+  LazyString output;
+  for (int i = 0; i < edits; i++) {
+    ColumnNumber position{static_cast<size_t>(random()) %
+                          (output.size().read() + 1)};
+    output = output.Substring(ColumnNumber{}, position.ToDelta()) +
+             LazyString{std::to_wstring(i) + L" "} +
+             output.Substring(position);
+  }
+  return output;
+}
+
+bool registration_edit = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"LazyString::Edit")},
+    [](int elements) {
+      LazyString input = EditedString(elements);
+      static const int kRuns = 1e4;
+      auto start = Now();
+      for (int i = 0; i < kRuns; i++) {
+        ColumnNumber position{static_cast<size_t>(random()) %
+                              (input.size().read() + 1)};
+        CHECK_EQ((input.Substring(ColumnNumber{}, position.ToDelta()) +
+                  LazyString{L"x"} + input.Substring(position))
+                     .size(),
+                 input.size() + ColumnNumberDelta{1});
+      }
+      return SecondsBetween(start, Now()) / kRuns;
+    });
+
+// Reads each character with `get`. Returns the time per character.
+bool registration_get = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"LazyString::Get")},
+    [](int elements) {
+      LazyString input = EditedString(elements);
+      size_t total = 0;
+      auto start = Now();
+      for (ColumnNumber i; i.ToDelta() < input.size(); ++i)
+        total += input.get(i);
+      double seconds = SecondsBetween(start, Now());
+      CHECK_NE(total, 1ul);  // Don't optimize away the loop.
+      return seconds / input.size().read();
+    });
+
+// Reads each character through `ForEachChunk`. Returns the time per
+// character.
+bool registration_for_each_chunk = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"LazyString::ForEachChunk")},
+    [](int elements) {
+      LazyString input = EditedString(elements);
+      size_t total = 0;
+      auto start = Now();
+      input.ForEachChunk([&total](std::wstring_view chunk) {
+        for (wchar_t c : chunk) total += c;
+        return true;
+      });
+      double seconds = SecondsBetween(start, Now());
+      CHECK_NE(total, 1ul);  // Don't optimize away the loop.
+      return seconds / input.size().read();
+    });
+
+// Reads each character through `ForEachColumn`. Returns the time per
+// character.
+bool registration_for_each_column = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"LazyString::ForEachColumn")},
+    [](int elements) {
+      LazyString input = EditedString(elements);
+      size_t total = 0;
+      auto start = Now();
+      ForEachColumn(input, [&total](ColumnNumber, wchar_t c) { total += c; });
+      double seconds = SecondsBetween(start, Now());
+      CHECK_NE(total, 1ul);  // Don't optimize away the loop.
+      return seconds / input.size().read();
+    });
+}  // namespace
+}  // namespace afc::language::lazy_string
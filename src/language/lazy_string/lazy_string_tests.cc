@@ -40,5 +40,119 @@ const bool iterator_tests_registration = tests::Register(
         CHECK(it == input.end());
       }}});
 
+// Returns the fragments produced by `ForEachChunk` (concatenated).
+std::wstring ReadChunks(const LazyString& input) {
+  std::wstring output;
+  CHECK(input.ForEachChunk([&output](std::wstring_view chunk) {
+    CHECK(!chunk.empty());
+    output.append(chunk);
+    return true;
+  }));
+  return output;
+}
+
+// Builds a long string through many small appends (so that it is stored in a
+// tree, rather than contiguously).
+LazyString LongAppendedString(std::wstring& expected) {
+  LazyString output;
+  for (int i = 0; i < 1000; i++) {
+    std::wstring fragment = std::to_wstring(i) + L" ";
+    output += LazyString{fragment};
+    expected += fragment;
+  }
+  return output;
+}
+
+const bool chunks_tests_registration = tests::Register(
+    L"LazyString::ForEachChunk",
+    {{.name = L"Empty",
+      .callback = [] { CHECK(ReadChunks(LazyString{}).empty()); }},
+     {.name = L"Contiguous",
+      .callback =
+          [] { CHECK(ReadChunks(LazyString{L"alejo"}) == L"alejo"); }},
+     {.name = L"RepeatedChar",
+      .callback =
+          [] {
+            CHECK(ReadChunks(LazyString{ColumnNumberDelta{1000}, L'x'}) ==
+                  std::wstring(1000, L'x'));
+          }},
+     {.name = L"Append",
+      .callback =
+          [] {
+            std::wstring expected;
+            LazyString input = LongAppendedString(expected);
+            CHECK(ReadChunks(input) == expected);
+            CHECK(input.ToString() == expected);
+          }},
+     {.name = L"SubstringOfAppend",
+      .callback =
+          [] {
+            std::wstring expected;
+            LazyString input = LongAppendedString(expected);
+            for (size_t start : {0, 1, 63, 64, 65, 1000, 2800})
+              for (size_t length : {0, 1, 100, 600, 1000})
+                CHECK(ReadChunks(input.Substring(ColumnNumber{start},
+                                                 ColumnNumberDelta(length))) ==
+                      expected.substr(start, length));
+          }},
+     {.name = L"RangeOfAppend",
+      .callback =
+          [] {
+            std::wstring expected;
+            LazyString input = LongAppendedString(expected);
+            for (size_t start : {0, 1, 63, 64, 65, 1000, 2800})
+              for (size_t length : {0, 1, 100, 600, 1000}) {
+                std::wstring output;
+                CHECK(input.ForEachChunk(
+                    ColumnNumber{start}, ColumnNumberDelta(length),
+                    [&output](std::wstring_view chunk) {
+                      output.append(chunk);
+                      return true;
+                    }));
+                CHECK(output == expected.substr(start, length));
+              }
+          }},
+     {.name = L"NestedSubstrings",
+      .callback =
+          [] {
+            LazyString input =
+                LazyString{L"alejandro forero cuervo"}
+                    .Substring(ColumnNumber{4})
+                    .Substring(ColumnNumber{6}, ColumnNumberDelta{6});
+            CHECK(ReadChunks(input) == L"forero");
+            CHECK(
+                std::holds_alternative<std::wstring_view>(input.Contiguous()));
+          }},
+     {.name = L"Stop",
+      .callback =
+          [] {
+            std::wstring expected;
+            size_t calls = 0;
+            CHECK(!LongAppendedString(expected).ForEachChunk(
+                [&calls](std::wstring_view) {
+                  calls++;
+                  return false;
+                }));
+            CHECK_EQ(calls, 1ul);
+          }},
+     {.name = L"ShortAppendIsFlattened",
+      .callback =
+          [] {
+            LazyString input = LazyString{L"ale"} + LazyString{L"jandro"} +
+                               LazyString{ColumnNumberDelta{3}, L'!'};
+            CHECK(
+                std::holds_alternative<std::wstring_view>(input.Contiguous()));
+            CHECK(input == LazyString{L"alejandro!!!"});
+          }},
+     {.name = L"ShortSubstringOfAppendIsFlattened", .callback = [] {
+        std::wstring expected;
+        LazyString input = LongAppendedString(expected);
+        CHECK(std::holds_alternative<std::monostate>(input.Contiguous()));
+        LazyString substring =
+            input.Substring(ColumnNumber{100}, ColumnNumberDelta{20});
+        CHECK(
+            std::holds_alternative<std::wstring_view>(substring.Contiguous()));
+        CHECK(substring.ToString() == expected.substr(100, 20));
+      }}});
 }  // namespace
 }  // namespace afc::language::lazy_string
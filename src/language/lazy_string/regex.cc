@@ -0,0 +1,610 @@
+#include "src/language/lazy_string/regex.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <optional>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/wstring.h"
+
+using afc::language::Error;
+using afc::language::ValueOrError;
+
+namespace afc::language::lazy_string {
+using internal::RegexCharacterClass;
+using internal::RegexInstruction;
+
+namespace {
+using OpCode = RegexInstruction::OpCode;
+
+// Upper bound on the number of instructions in a program. Protects us from
+// expressions such as `(((a{100}){100}){100})`.
+constexpr size_t kMaxProgramSize = 1 << 16;
+
+// Upper bound on the bounds of a repetition (e.g., `a{1000}`).
+constexpr size_t kMaxRepetition = 1000;
+
+// Upper bound on the nesting of groups and quantifiers (e.g., `((a))*`), which
+// protects the recursive parser and compiler from exhausting the stack.
+constexpr size_t kMaxNestingDepth = 100;
+
+struct Node {
+  enum class Type {
+    kEmpty,
+    kChar,
+    kAny,
+    kClass,
+    kLineBegin,
+    kLineEnd,
+    kConcatenation,
+    kAlternation,
+    kRepetition
+  };
+
+  Type type;
+  wchar_t character = 0;
+  size_t class_index = 0;
+  std::vector<Node> children = {};
+  // Only for kRepetition:
+  size_t min = 0;
+  std::optional<size_t> max = std::nullopt;
+};
+
+class Parser {
+ public:
+  Parser(std::wstring pattern, bool case_sensitive,
+         std::vector<RegexCharacterClass>& classes)
+      : pattern_(std::move(pattern)),
+        case_sensitive_(case_sensitive),
+        classes_(classes) {}
+
+  ValueOrError<Node> Parse() {
+    DECLARE_OR_RETURN(Node output, ParseAlternation());
+    if (position_ < pattern_.size())
+      return Error{LazyString{L"Unmatched closing parenthesis."}};
+    return output;
+  }
+
+ private:
+  bool AtEnd() const { return position_ >= pattern_.size(); }
+  wchar_t Peek() const { return pattern_[position_]; }
+
+  wchar_t Literal(wchar_t c) const {
+    return case_sensitive_ ? c : std::towlower(c);
+  }
+
+  ValueOrError<Node> ParseAlternation() {
+    Node output{.type = Node::Type::kAlternation};
+    while (true) {
+      DECLARE_OR_RETURN(Node branch, ParseConcatenation());
+      output.children.push_back(std::move(branch));
+      if (AtEnd() || Peek() != L'|') break;
+      ++position_;
+    }
+    if (output.children.size() == 1) return std::move(output.children[0]);
+    return output;
+  }
+
+  ValueOrError<Node> ParseConcatenation() {
+    Node output{.type = Node::Type::kConcatenation};
+    while (!AtEnd() && Peek() != L'|' && Peek() != L')') {
+      DECLARE_OR_RETURN(Node atom, ParseAtom());
+      for (size_t depth = depth_; !AtEnd(); ++depth) {
+        std::optional<std::pair<size_t, std::optional<size_t>>> bounds;
+        ASSIGN_OR_RETURN(bounds, ParseQuantifier());
+        if (!bounds.has_value()) break;
+        if (depth >= kMaxNestingDepth)
+          return Error{LazyString{L"Regular expression is too deeply nested."}};
+        atom = Node{.type = Node::Type::kRepetition,
+                    .children = {std::move(atom)},
+                    .min = bounds->first,
+                    .max = bounds->second};
+      }
+      output.children.push_back(std::move(atom));
+    }
+    if (output.children.empty()) return Node{.type = Node::Type::kEmpty};
+    if (output.children.size() == 1) return std::move(output.children[0]);
+    return output;
+  }
+
+  // Returns std::nullopt if the next token isn't a quantifier.
+  ValueOrError<std::optional<std::pair<size_t, std::optional<size_t>>>>
+  ParseQuantifier() {
+    using Output = std::optional<std::pair<size_t, std::optional<size_t>>>;
+    switch (Peek()) {
+      case L'*':
+        ++position_;
+        return Output{{0, std::nullopt}};
+      case L'+':
+        ++position_;
+        return Output{{1, std::nullopt}};
+      case L'?':
+        ++position_;
+        return Output{{0, 1}};
+      case L'{': {
+        // A brace that isn't followed by a digit is taken literally.
+        if (position_ + 1 >= pattern_.size() ||
+            !std::iswdigit(pattern_[position_ + 1]))
+          return Output{};
+        ++position_;
+        DECLARE_OR_RETURN(size_t min, ParseNumber());
+        std::optional<size_t> max = min;
+        if (!AtEnd() && Peek() == L',') {
+          ++position_;
+          max = std::nullopt;
+          if (!AtEnd() && std::iswdigit(Peek()))
+            ASSIGN_OR_RETURN(max, ParseNumber());
+        }
+        if (AtEnd() || Peek() != L'}')
+          return Error{LazyString{L"Invalid repetition bounds."}};
+        ++position_;
+        if (max.has_value() && *max < min)
+          return Error{LazyString{L"Invalid repetition bounds: max < min."}};
+        return Output{{min, max}};
+      }
+    }
+    return Output{};
+  }
+
+  // Fails if the number exceeds `kMaxRepetition` (which also ensures that it
+  // doesn't overflow).
+  ValueOrError<size_t> ParseNumber() {
+    size_t output = 0;
+    while (!AtEnd() && std::iswdigit(Peek())) {
+      output = output * 10 + (Peek() - L'0');
+      if (output > kMaxRepetition)
+        return Error{LazyString{L"Repetition bound is too large."}};
+      ++position_;
+    }
+    return output;
+  }
+
+  ValueOrError<Node> ParseAtom() {
+    wchar_t c = Peek();
+    ++position_;
+    switch (c) {
+      case L'(': {
+        if (depth_ >= kMaxNestingDepth)
+          return Error{LazyString{L"Regular expression is too deeply nested."}};
+        ++depth_;
+        ValueOrError<Node> alternation = ParseAlternation();
+        --depth_;
+        DECLARE_OR_RETURN(Node output, std::move(alternation));
+        if (AtEnd() || Peek() != L')')
+          return Error{LazyString{L"Unmatched opening parenthesis."}};
+        ++position_;
+        return output;
+      }
+      case L'[':
+        return ParseBracket();
+      case L'.':
+        return Node{.type = Node::Type::kAny};
+      case L'^':
+        return Node{.type = Node::Type::kLineBegin};
+      case L'$':
+        return Node{.type = Node::Type::kLineEnd};
+      case L'*':
+      case L'+':
+      case L'?':
+        return Error{LazyString{L"Nothing to repeat."}};
+      case L'\\':
+        return ParseEscape();
+    }
+    return Node{.type = Node::Type::kChar, .character = Literal(c)};
+  }
+
+  Node NewClass(RegexCharacterClass character_class) {
+    character_class.case_insensitive = !case_sensitive_;
+    classes_.push_back(std::move(character_class));
+    return Node{.type = Node::Type::kClass, .class_index = classes_.size() - 1};
+  }
+
+  ValueOrError<Node> ParseEscape() {
+    if (AtEnd()) return Error{LazyString{L"Trailing backslash."}};
+    wchar_t c = Peek();
+    ++position_;
+    if (std::optional<RegexCharacterClass> character_class =
+            EscapedClass(c);
+        character_class.has_value())
+      return NewClass(std::move(*character_class));
+    if (c == L't') c = L'\t';
+    return Node{.type = Node::Type::kChar, .character = Literal(c)};
+  }
+
+  static std::optional<RegexCharacterClass> EscapedClass(wchar_t c) {
+    switch (c) {
+      case L'd':
+      case L'D':
+        return RegexCharacterClass{.negated = c == L'D',
+                                   .types = {std::wctype("digit")}};
+      case L'w':
+      case L'W':
+        return RegexCharacterClass{.negated = c == L'W',
+                                   .ranges = {{L'_', L'_'}},
+                                   .types = {std::wctype("alnum")}};
+      case L's':
+      case L'S':
+        return RegexCharacterClass{.negated = c == L'S',
+                                   .types = {std::wctype("space")}};
+    }
+    return std::nullopt;
+  }
+
+  ValueOrError<Node> ParseBracket() {
+    RegexCharacterClass output;
+    if (!AtEnd() && Peek() == L'^') {
+      output.negated = true;
+      ++position_;
+    }
+    bool first = true;
+    while (true) {
+      if (AtEnd())
+        return Error{LazyString{L"Unterminated bracket expression."}};
+      wchar_t c = Peek();
+      ++position_;
+      if (c == L']' && !first) break;
+      first = false;
+      if (c == L'[' && !AtEnd() && Peek() == L':') {
+        size_t end = pattern_.find(L":]", position_ + 1);
+        if (end == std::wstring::npos)
+          return Error{LazyString{L"Unterminated character class name."}};
+        std::wstring name =
+            pattern_.substr(position_ + 1, end - position_ - 1);
+        std::wctype_t type = std::wctype(ToByteString(name).c_str());
+        if (type == 0)
+          return Error{LazyString{L"Invalid character class: "} +
+                       LazyString{name}};
+        output.types.push_back(type);
+        position_ = end + 2;
+        continue;
+      }
+      if (c == L'\\') {
+        if (AtEnd()) return Error{LazyString{L"Trailing backslash."}};
+        c = Peek();
+        ++position_;
+        if (std::optional<RegexCharacterClass> character_class =
+                EscapedClass(c);
+            character_class.has_value() && !character_class->negated) {
+          output.ranges.insert(output.ranges.end(),
+                               character_class->ranges.begin(),
+                               character_class->ranges.end());
+          output.types.insert(output.types.end(),
+                              character_class->types.begin(),
+                              character_class->types.end());
+          continue;
+        }
+      }
+      wchar_t last = c;
+      if (position_ + 1 < pattern_.size() && Peek() == L'-' &&
+          pattern_[position_ + 1] != L']') {
+        last = pattern_[position_ + 1];
+        position_ += 2;
+        if (last < c) return Error{LazyString{L"Invalid range."}};
+      }
+      output.ranges.push_back({c, last});
+    }
+    return NewClass(std::move(output));
+  }
+
+  const std::wstring pattern_;
+  const bool case_sensitive_;
+  std::vector<RegexCharacterClass>& classes_;
+  size_t position_ = 0;
+  // The number of groups and quantifiers enclosing the current position.
+  size_t depth_ = 0;
+};
+
+class Compiler {
+ public:
+  ValueOrError<std::vector<RegexInstruction>> Compile(const Node& node) {
+    RETURN_IF_ERROR(Emit(node));
+    program_.push_back(RegexInstruction{.op = OpCode::kMatch});
+    return std::move(program_);
+  }
+
+ private:
+  size_t Push(RegexInstruction instruction) {
+    program_.push_back(instruction);
+    return program_.size() - 1;
+  }
+
+  PossibleError Emit(const Node& node) {
+    if (program_.size() > kMaxProgramSize)
+      return Error{LazyString{L"Regular expression is too large."}};
+    switch (node.type) {
+      case Node::Type::kEmpty:
+        return Success();
+      case Node::Type::kChar:
+        Push({.op = OpCode::kChar, .character = node.character});
+        return Success();
+      case Node::Type::kAny:
+        Push({.op = OpCode::kAny});
+        return Success();
+      case Node::Type::kClass:
+        Push({.op = OpCode::kClass, .argument = node.class_index});
+        return Success();
+      case Node::Type::kLineBegin:
+        Push({.op = OpCode::kLineBegin});
+        return Success();
+      case Node::Type::kLineEnd:
+        Push({.op = OpCode::kLineEnd});
+        return Success();
+      case Node::Type::kConcatenation:
+        for (const Node& child : node.children) RETURN_IF_ERROR(Emit(child));
+        return Success();
+      case Node::Type::kAlternation:
+        return EmitAlternation(node);
+      case Node::Type::kRepetition:
+        return EmitRepetition(node);
+    }
+    LOG(FATAL) << "Invalid node type.";
+    return Success();
+  }
+
+  PossibleError EmitAlternation(const Node& node) {
+    std::vector<size_t> jumps_to_end;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+      if (i + 1 == node.children.size()) {
+        RETURN_IF_ERROR(Emit(node.children[i]));
+        break;
+      }
+      size_t split = Push({.op = OpCode::kSplit});
+      program_[split].argument = program_.size();
+      RETURN_IF_ERROR(Emit(node.children[i]));
+      jumps_to_end.push_back(Push({.op = OpCode::kJump}));
+      program_[split].alternative = program_.size();
+    }
+    for (size_t jump : jumps_to_end) program_[jump].argument = program_.size();
+    return Success();
+  }
+
+  PossibleError EmitRepetition(const Node& node) {
+    CHECK_EQ(node.children.size(), 1ul);
+    const Node& child = node.children[0];
+    // Repeating such a child would have no effect, but iterating the bounds
+    // (e.g., `((){1000}){1000}`) could take very long.
+    if (EmitsNothing(child)) return Success();
+    for (size_t i = 0; i < node.min; ++i) RETURN_IF_ERROR(Emit(child));
+    if (!node.max.has_value()) {
+      size_t split = Push({.op = OpCode::kSplit});
+      program_[split].argument = program_.size();
+      RETURN_IF_ERROR(Emit(child));
+      Push({.op = OpCode::kJump, .argument = split});
+      program_[split].alternative = program_.size();
+      return Success();
+    }
+    std::vector<size_t> splits;
+    for (size_t i = node.min; i < *node.max; ++i) {
+      splits.push_back(Push({.op = OpCode::kSplit}));
+      program_[splits.back()].argument = program_.size();
+      RETURN_IF_ERROR(Emit(child));
+    }
+    for (size_t split : splits) program_[split].alternative = program_.size();
+    return Success();
+  }
+
+  // Returns true if compiling `node` produces no instructions.
+  static bool EmitsNothing(const Node& node) {
+    switch (node.type) {
+      case Node::Type::kEmpty:
+        return true;
+      case Node::Type::kConcatenation:
+        return std::ranges::all_of(node.children, EmitsNothing);
+      case Node::Type::kRepetition:
+        return node.max == 0 || EmitsNothing(node.children[0]);
+      default:
+        return false;
+    }
+  }
+
+  std::vector<RegexInstruction> program_;
+};
+
+// Returns an expression that matches the reversal of the strings that `node`
+// matches. Anchors are positional assertions, so they remain unchanged.
+Node Reverse(Node node) {
+  if (node.type == Node::Type::kConcatenation)
+    std::ranges::reverse(node.children);
+  for (Node& child : node.children) child = Reverse(std::move(child));
+  return node;
+}
+}  // namespace
+
+bool RegexCharacterClass::Contains(wchar_t c) const {
+  bool found = ContainsExactly(c);
+  if (!found && case_insensitive)
+    found = ContainsExactly(std::towlower(c)) ||
+            ContainsExactly(std::towupper(c));
+  return found != negated;
+}
+
+bool RegexCharacterClass::ContainsExactly(wchar_t c) const {
+  for (const auto& [first, last] : ranges)
+    if (first <= c && c <= last) return true;
+  for (std::wctype_t type : types)
+    if (std::iswctype(c, type)) return true;
+  return false;
+}
+
+/* static */ ValueOrError<Regex> Regex::Compile(const LazyString& pattern,
+                                                Options options) {
+  TRACK_OPERATION(Regex_Compile);
+  std::vector<RegexCharacterClass> classes;
+  DECLARE_OR_RETURN(
+      Node root,
+      Parser(pattern.ToString(), options.case_sensitive, classes).Parse());
+  DECLARE_OR_RETURN(std::vector<RegexInstruction> program,
+                    Compiler().Compile(root));
+  DECLARE_OR_RETURN(std::vector<RegexInstruction> reverse_program,
+                    Compiler().Compile(Reverse(std::move(root))));
+  return Regex(options, std::move(program), std::move(reverse_program),
+               std::move(classes));
+}
+
+Regex::Regex(Options options, std::vector<RegexInstruction> program,
+             std::vector<RegexInstruction> reverse_program,
+             std::vector<RegexCharacterClass> classes)
+    : options_(options),
+      program_(std::move(program)),
+      reverse_program_(std::move(reverse_program)),
+      classes_(std::move(classes)) {
+  size_t pc = 0;
+  while (program_[pc].op == OpCode::kChar)
+    literal_prefix_.push_back(program_[pc++].character);
+  literal_only_ = program_[pc].op == OpCode::kMatch;
+}
+
+wchar_t Regex::Normalize(wchar_t c) const {
+  return options_.case_sensitive ? c : std::towlower(c);
+}
+
+bool Regex::Accepts(const RegexInstruction& instruction, wchar_t c,
+                    wchar_t normalized) const {
+  switch (instruction.op) {
+    case OpCode::kChar:
+      return instruction.character == normalized;
+    case OpCode::kAny:
+      return true;
+    case OpCode::kClass:
+      return classes_[instruction.argument].Contains(c);
+    default:
+      LOG(FATAL) << "Unexpected instruction in thread list.";
+  }
+  return false;
+}
+
+bool Regex::MatchesLiteralPrefix(const LazyString& input,
+                                 ColumnNumber start) const {
+  if (input.size() - start.ToDelta() <
+      ColumnNumberDelta(literal_prefix_.size()))
+    return false;
+  for (size_t i = 0; i < literal_prefix_.size(); ++i)
+    if (Normalize(input.get(start + ColumnNumberDelta(i))) !=
+        literal_prefix_[i])
+      return false;
+  return true;
+}
+
+bool Regex::MatchesAt(const LazyString& input, ColumnNumber start) const {
+  Scratch scratch;
+  return MatchesAt(input, start, scratch);
+}
+
+std::vector<ColumnNumber> Regex::FindAll(const LazyString& input) const {
+  TRACK_OPERATION(Regex_FindAll);
+  std::vector<ColumnNumber> output;
+  const ColumnNumberDelta input_size = input.size();
+  if (literal_only_) {
+    for (ColumnNumber start; start.ToDelta() < input_size; ++start)
+      if (MatchesLiteralPrefix(input, start)) output.push_back(start);
+    return output;
+  }
+
+  // We run `reverse_program_` from the end of the input towards its start,
+  // starting a new thread at every column. Threads that reach the same
+  // instruction at the same column are merged (regardless of the column where
+  // they started), so each character is visited once.
+  Scratch scratch;
+  scratch.visited_generation.assign(reverse_program_.size(), 0);
+  ColumnNumber column = ColumnNumber{} + input_size;
+  ++scratch.generation;
+  // A match starting at the end of the input isn't reported.
+  AddThread(reverse_program_, scratch.current, 0, column, input_size, scratch);
+  while (!column.IsZero()) {
+    --column;
+    const wchar_t c = input.get(column);
+    const wchar_t normalized = Normalize(c);
+    scratch.next.clear();
+    ++scratch.generation;
+    bool matched = false;
+    for (size_t pc : scratch.current)
+      if (Accepts(reverse_program_[pc], c, normalized) &&
+          AddThread(reverse_program_, scratch.next, pc + 1, column, input_size,
+                    scratch))
+        matched = true;
+    if (AddThread(reverse_program_, scratch.next, 0, column, input_size,
+                  scratch))
+      matched = true;
+    if (matched) output.push_back(column);
+    std::swap(scratch.current, scratch.next);
+  }
+  std::ranges::reverse(output);
+  return output;
+}
+
+bool Regex::MatchesAt(const LazyString& input, ColumnNumber start,
+                      Scratch& scratch) const {
+  if (!MatchesLiteralPrefix(input, start)) return false;
+  if (literal_only_) return true;
+
+  const ColumnNumberDelta input_size = input.size();
+  if (scratch.visited_generation.size() != program_.size())
+    scratch.visited_generation.assign(program_.size(), 0);
+  scratch.current.clear();
+
+  ColumnNumber column = start + ColumnNumberDelta(literal_prefix_.size());
+  ++scratch.generation;
+  if (AddThread(program_, scratch.current, literal_prefix_.size(), column,
+                input_size, scratch))
+    return true;
+  while (!scratch.current.empty() && column.ToDelta() < input_size) {
+    const wchar_t c = input.get(column);
+    const wchar_t normalized = Normalize(c);
+    scratch.next.clear();
+    ++scratch.generation;
+    for (size_t pc : scratch.current)
+      if (Accepts(program_[pc], c, normalized) &&
+          AddThread(program_, scratch.next, pc + 1, column.next(), input_size,
+                    scratch))
+        return true;
+    std::swap(scratch.current, scratch.next);
+    ++column;
+  }
+  return false;
+}
+
+/* static */ bool Regex::AddThread(const std::vector<RegexInstruction>& program,
+                                  std::vector<size_t>& threads,
+                                  size_t initial_pc, ColumnNumber column,
+                                  ColumnNumberDelta input_size,
+                                  Scratch& scratch) {
+  // We don't return as soon as we reach `kMatch`: `FindAll` needs all the
+  // threads.
+  bool matched = false;
+  std::vector<size_t>& stack = scratch.stack;
+  stack.clear();
+  stack.push_back(initial_pc);
+  while (!stack.empty()) {
+    size_t pc = stack.back();
+    stack.pop_back();
+    if (scratch.visited_generation[pc] == scratch.generation) continue;
+    scratch.visited_generation[pc] = scratch.generation;
+    const RegexInstruction& instruction = program[pc];
+    switch (instruction.op) {
+      case OpCode::kChar:
+      case OpCode::kAny:
+      case OpCode::kClass:
+        threads.push_back(pc);
+        break;
+      case OpCode::kSplit:
+        stack.push_back(instruction.alternative);
+        stack.push_back(instruction.argument);
+        break;
+      case OpCode::kJump:
+        stack.push_back(instruction.argument);
+        break;
+      case OpCode::kLineBegin:
+        if (column.IsZero()) stack.push_back(pc + 1);
+        break;
+      case OpCode::kLineEnd:
+        if (column.ToDelta() == input_size) stack.push_back(pc + 1);
+        break;
+      case OpCode::kMatch:
+        matched = true;
+        break;
+    }
+  }
+  return matched;
+}
+}  // namespace afc::language::lazy_string
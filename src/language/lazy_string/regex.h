@@ -0,0 +1,145 @@
+// Regular expressions that can be evaluated directly over a LazyString.
+//
+// Unlike `std::wregex`, which requires the input to be materialized into a
+// contiguous `std::wstring`, a `Regex` reads characters through
+// `LazyString::get`. The expression is compiled once into a Thompson NFA (a
+// flat vector of instructions) and evaluated by simulating all the NFA threads
+// in lock-step, so evaluation never backtracks: it is linear in the length of
+// the input times the size of the program.
+//
+// The syntax supported is (roughly) POSIX extended:
+//
+// * Literals, `.`, `^` and `$`.
+// * Bracket expressions: `[abc]`, `[^a-z]`, `[[:alpha:]_]`.
+// * Grouping `(...)` and alternation `a|b`.
+// * Quantifiers: `*`, `+`, `?`, `{m}`, `{m,}`, `{m,n}`.
+// * A backslash followed by a non-alphanumeric character matches that character
+//   literally. `\d`, `\w`, `\s` (and their upper-case negations) and `\t` are
+//   also recognized.
+#ifndef __AFC_LANGUAGE_LAZY_STRING_REGEX_H__
+#define __AFC_LANGUAGE_LAZY_STRING_REGEX_H__
+
+#include <cwctype>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/language/error/value_or_error.h"
+#include "src/language/lazy_string/column_number.h"
+#include "src/language/lazy_string/lazy_string.h"
+
+namespace afc::language::lazy_string {
+namespace internal {
+struct RegexCharacterClass {
+  bool negated = false;
+  std::vector<std::pair<wchar_t, wchar_t>> ranges = {};
+  std::vector<std::wctype_t> types = {};
+  // If true, a character is in the class if any of its case variants is in
+  // `ranges` or `types` (so `[[:upper:]]` also contains `a`).
+  bool case_insensitive = false;
+
+  bool Contains(wchar_t c) const;
+
+ private:
+  bool ContainsExactly(wchar_t c) const;
+};
+
+struct RegexInstruction {
+  enum class OpCode {
+    // Consumes `character`.
+    kChar,
+    // Consumes any character.
+    kAny,
+    // Consumes any character in `classes[argument]`.
+    kClass,
+    // Continues at both `argument` and `alternative`.
+    kSplit,
+    // Continues at `argument`.
+    kJump,
+    kLineBegin,
+    kLineEnd,
+    kMatch
+  };
+
+  OpCode op;
+  wchar_t character = 0;
+  size_t argument = 0;
+  size_t alternative = 0;
+};
+}  // namespace internal
+
+class Regex {
+ public:
+  struct Options {
+    bool case_sensitive = true;
+  };
+
+  static ValueOrError<Regex> Compile(const LazyString& pattern,
+                                     Options options);
+
+  // Returns true if a match of the expression starts at `start`.
+  bool MatchesAt(const LazyString& input, ColumnNumber start) const;
+
+  // Returns all the columns at which a match starts, in ascending order.
+  //
+  // Matches may overlap; for example, the expression `aa` matches the input
+  // `aaa` at columns 0 and 1.
+  //
+  // Runs in a single (backwards) pass over the input: a column is the start of
+  // a match if the reversed expression matches a prefix of the reversed input
+  // ending there.
+  std::vector<ColumnNumber> FindAll(const LazyString& input) const;
+
+  // A (possibly empty) literal string with which every match starts. Used to
+  // quickly discard positions where a match can't begin.
+  const std::wstring& literal_prefix() const { return literal_prefix_; }
+
+  // Returns true if the expression matches exactly `literal_prefix()` (and
+  // nothing else).
+  bool literal_only() const { return literal_only_; }
+
+ private:
+  // Buffers reused across calls to `MatchesAt` from a single caller, to avoid
+  // allocating them for every candidate position.
+  struct Scratch {
+    std::vector<size_t> current = {};
+    std::vector<size_t> next = {};
+    std::vector<size_t> stack = {};
+    std::vector<size_t> visited_generation = {};
+    size_t generation = 0;
+  };
+
+  Regex(Options options, std::vector<internal::RegexInstruction> program,
+        std::vector<internal::RegexInstruction> reverse_program,
+        std::vector<internal::RegexCharacterClass> classes);
+
+  wchar_t Normalize(wchar_t c) const;
+  // Returns true if `instruction` (which must consume a character) accepts
+  // `c`. `normalized` must be `Normalize(c)`.
+  bool Accepts(const internal::RegexInstruction& instruction, wchar_t c,
+               wchar_t normalized) const;
+  bool MatchesAt(const LazyString& input, ColumnNumber start,
+                 Scratch& scratch) const;
+  bool MatchesLiteralPrefix(const LazyString& input, ColumnNumber start) const;
+  // Follows all the epsilon transitions of `program` starting at `pc` and adds
+  // the instructions that consume characters to `threads`. Returns true if a
+  // `kMatch` instruction is reached.
+  static bool AddThread(const std::vector<internal::RegexInstruction>& program,
+                        std::vector<size_t>& threads, size_t pc,
+                        ColumnNumber column, ColumnNumberDelta input_size,
+                        Scratch& scratch);
+
+  Options options_;
+  std::vector<internal::RegexInstruction> program_;
+  // The program for the reversed expression (e.g., `c(b|a)` for `(a|b)c`).
+  // Used by `FindAll`.
+  std::vector<internal::RegexInstruction> reverse_program_;
+  std::vector<internal::RegexCharacterClass> classes_;
+  std::wstring literal_prefix_;
+  // True if the program consists exclusively of `literal_prefix_`; in this
+  // case, we can skip the NFA simulation.
+  bool literal_only_;
+};
+}  // namespace afc::language::lazy_string
+
+#endif  // __AFC_LANGUAGE_LAZY_STRING_REGEX_H__
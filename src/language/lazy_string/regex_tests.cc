@@ -0,0 +1,205 @@
+#include <glog/logging.h>
+
+#include "src/infrastructure/time.h"
+#include "src/language/lazy_string/regex.h"
+#include "src/tests/benchmarks.h"
+#include "src/tests/tests.h"
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::language::IsError;
+using afc::language::ValueOrDie;
+using afc::tests::BenchmarkName;
+
+namespace afc::language::lazy_string {
+namespace {
+std::vector<size_t> FindAll(std::wstring pattern, std::wstring input,
+                            bool case_sensitive = true) {
+  std::vector<size_t> output;
+  for (ColumnNumber column :
+       ValueOrDie(Regex::Compile(LazyString{pattern},
+                                 {.case_sensitive = case_sensitive}))
+           .FindAll(LazyString{input}))
+    output.push_back(column.read());
+  return output;
+}
+
+bool IsInvalid(std::wstring pattern) {
+  return IsError(Regex::Compile(LazyString{pattern}, {}));
+}
+
+const bool regex_tests_registration = tests::Register(
+    L"Regex",
+    {{.name = L"Literal",
+      .callback =
+          [] {
+            CHECK(FindAll(L"rero", L"Forero") == std::vector<size_t>({2}));
+          }},
+     {.name = L"LiteralOverlapping",
+      .callback =
+          [] {
+            CHECK(FindAll(L"aa", L"aaaa") == std::vector<size_t>({0, 1, 2}));
+          }},
+     {.name = L"LiteralNoMatch",
+      .callback = [] { CHECK(FindAll(L"xyz", L"Forero").empty()); }},
+     {.name = L"LiteralPrefix",
+      .callback =
+          [] {
+            CHECK(ValueOrDie(Regex::Compile(LazyString{L"abc(d|e)*"}, {}))
+                      .literal_prefix() == L"abc");
+            CHECK(ValueOrDie(Regex::Compile(LazyString{L"a*bc"}, {}))
+                      .literal_prefix()
+                      .empty());
+          }},
+     {.name = L"CaseInsensitive",
+      .callback =
+          [] {
+            CHECK(FindAll(L"FoR", L"forero FORERO", false) ==
+                  std::vector<size_t>({0, 7}));
+            CHECK(FindAll(L"[a-c]x", L"Ax bX", false) ==
+                  std::vector<size_t>({0, 3}));
+          }},
+     {.name = L"CaseInsensitiveClasses",
+      .callback =
+          [] {
+            CHECK(FindAll(L"[[:upper:]]", L"aB1", false) ==
+                  std::vector<size_t>({0, 1}));
+            CHECK(FindAll(L"[[:upper:]]", L"aB1") == std::vector<size_t>({1}));
+            CHECK(FindAll(L"[^a-z]", L"aB1", false) ==
+                  std::vector<size_t>({2}));
+            CHECK(FindAll(L"\\W", L"aB1", false).empty());
+          }},
+     {.name = L"Dot",
+      .callback =
+          [] {
+            CHECK(FindAll(L"a.c", L"abc a c ac") == std::vector<size_t>({0, 4}));
+          }},
+     {.name = L"Star",
+      .callback =
+          [] {
+            CHECK(FindAll(L"ab*c", L"ac abc abbbc abd") ==
+                  std::vector<size_t>({0, 3, 7}));
+          }},
+     {.name = L"EmptyMatchesEverywhere",
+      .callback =
+          [] {
+            CHECK(FindAll(L"x*", L"abc") == std::vector<size_t>({0, 1, 2}));
+          }},
+     {.name = L"Plus",
+      .callback =
+          [] {
+            CHECK(FindAll(L"ab+c", L"ac abc abbc") ==
+                  std::vector<size_t>({3, 7}));
+          }},
+     {.name = L"Optional",
+      .callback =
+          [] {
+            CHECK(FindAll(L"colou?r", L"color colour colouur") ==
+                  std::vector<size_t>({0, 6}));
+          }},
+     {.name = L"Bounds",
+      .callback =
+          [] {
+            CHECK(FindAll(L"^a{2,3}$", L"aa") == std::vector<size_t>({0}));
+            CHECK(FindAll(L"^a{2,3}$", L"aaaa").empty());
+            CHECK(FindAll(L"^a{2}$", L"aa") == std::vector<size_t>({0}));
+            CHECK(FindAll(L"^a{2,}$", L"aaaaa") == std::vector<size_t>({0}));
+            CHECK(FindAll(L"^a{2,}$", L"a").empty());
+          }},
+     {.name = L"BraceWithoutDigitIsLiteral",
+      .callback =
+          [] { CHECK(FindAll(L"f{x}", L"f{x}") == std::vector<size_t>({0})); }},
+     {.name = L"Alternation",
+      .callback =
+          [] {
+            CHECK(FindAll(L"cat|dog", L"a dog and a cat") ==
+                  std::vector<size_t>({2, 12}));
+          }},
+     {.name = L"Group",
+      .callback =
+          [] {
+            CHECK(FindAll(L"(ab)+c", L"abababc abc ac") ==
+                  std::vector<size_t>({0, 2, 4, 8}));
+          }},
+     {.name = L"Anchors",
+      .callback =
+          [] {
+            CHECK(FindAll(L"^a", L"aaa") == std::vector<size_t>({0}));
+            CHECK(FindAll(L"a$", L"aaa") == std::vector<size_t>({2}));
+            CHECK(FindAll(L"^$", L"").empty());
+          }},
+     {.name = L"Bracket",
+      .callback =
+          [] {
+            CHECK(FindAll(L"[0-9]+", L"a12b3") ==
+                  std::vector<size_t>({1, 2, 4}));
+            CHECK(FindAll(L"[^a-z]", L"ab1c") == std::vector<size_t>({2}));
+            CHECK(FindAll(L"[]x]", L"a]bx") == std::vector<size_t>({1, 3}));
+            CHECK(FindAll(L"[a-]", L"-ba") == std::vector<size_t>({0, 2}));
+          }},
+     {.name = L"BracketClassName",
+      .callback =
+          [] {
+            CHECK(FindAll(L"[[:digit:]_]", L"a_1") ==
+                  std::vector<size_t>({1, 2}));
+          }},
+     {.name = L"Escapes",
+      .callback =
+          [] {
+            CHECK(FindAll(L"\\(x\\)", L"f(x)") == std::vector<size_t>({1}));
+            CHECK(FindAll(L"\\d\\d", L"a123") == std::vector<size_t>({1, 2}));
+            CHECK(FindAll(L"\\w+\\s", L"ab c") == std::vector<size_t>({0, 1}));
+            CHECK(FindAll(L"\\ ", L"a b") == std::vector<size_t>({1}));
+          }},
+     {.name = L"OverlappingMatches",
+      .callback =
+          [] {
+            CHECK(FindAll(L"(a|ab)(c|bcd)", L"abcd xabcd") ==
+                  std::vector<size_t>({0, 6}));
+            CHECK(FindAll(L"a+b", L"aaab aab") ==
+                  std::vector<size_t>({0, 1, 2, 5, 6}));
+            CHECK(FindAll(L"a[^x]*$", L"abaxa") == std::vector<size_t>({4}));
+          }},
+     {.name = L"NestedStarDoesNotLoop",
+      .callback =
+          [] {
+            CHECK(FindAll(L"(a*)*b", L"aab") ==
+                  std::vector<size_t>({0, 1, 2}));
+          }},
+     {.name = L"Invalid", .callback = [] {
+        CHECK(IsInvalid(L"(abc"));
+        CHECK(IsInvalid(L"abc)"));
+        CHECK(IsInvalid(L"[abc"));
+        CHECK(IsInvalid(L"*a"));
+        CHECK(IsInvalid(L"a{3,2}"));
+        CHECK(IsInvalid(L"a\\"));
+        CHECK(IsInvalid(L"[[:nonsense:]]"));
+        CHECK(IsInvalid(L"((a{100}){100}){100}"));
+      }},
+     {.name = L"HostileInput", .callback = [] {
+        CHECK(IsInvalid(L"a{1001}"));
+        CHECK(IsInvalid(L"a{2,1001}"));
+        CHECK(IsInvalid(L"a{99999999999999999999999999}"));
+        CHECK(IsInvalid(L"(){99999999999}"));
+        CHECK(IsInvalid(std::wstring(100000, L'(') + L"a" +
+                        std::wstring(100000, L')')));
+        CHECK(IsInvalid(L"a" + std::wstring(100000, L'?')));
+        CHECK(FindAll(L"((){1000}){1000}b", L"ab") ==
+              std::vector<size_t>({1}));
+        CHECK(FindAll(L"a{2,1000}", L"aaa") == std::vector<size_t>({0}));
+      }}});
+
+// Runs `FindAll` over an input where a match could start at every column but
+// none does (so each start would have to be tried until the end of the input).
+// Returns the time per character, which shouldn't grow with the input.
+bool find_all_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"Regex::FindAll")},
+    [](int elements) {
+      Regex regex = ValueOrDie(Regex::Compile(LazyString{L"(a|b)*c"}, {}));
+      LazyString input{std::wstring(elements, L'a')};
+      auto start = Now();
+      CHECK(regex.FindAll(input).empty());
+      return SecondsBetween(start, Now()) / elements;
+    });
+}  // namespace
+}  // namespace afc::language::lazy_string
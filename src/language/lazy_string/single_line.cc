@@ -1,12 +1,13 @@
 #include "src/language/lazy_string/single_line.h"
 
 #include "src/language/error/value_or_error.h"
+#include "src/language/lazy_string/character_scanner.h"
 #include "src/language/lazy_string/functional.h"
 
 namespace afc::language::lazy_string {
 /* static */ language::PossibleError SingleLineValidator::Validate(
     const LazyString& input) {
-  if (FindFirstOf(input, {L'\n'}).has_value())
+  if (FindCharacter(input, L'\n', ColumnNumber{}).has_value())
     return Error{LazyString{L"SingleLine contained newline character."}};
   return EmptyValue{};
 }
@@ -168,8 +168,8 @@ namespace {
 // Does any of the elements in `name_tokens` start with `prefix`? If so, returns
 // a corresponding token. If `prefix` is all lower-case, the match ignores case;
 // otherwise, it is case-sensitive.
-std::optional<Token> FindPrefixInTokens(NonEmptySingleLine prefix,
-                                        std::vector<Token> name_tokens) {
+std::optional<Token> FindPrefixInTokens(
+    NonEmptySingleLine prefix, const std::vector<Token>& name_tokens) {
   const bool all_lower = prefix == LowerCase(prefix);
   for (const Token& name_token : name_tokens)
     if (StartsWith(all_lower ? LowerCase(name_token.value) : name_token.value,
@@ -245,7 +245,7 @@ std::vector<Token> ExtendTokensToEndOfString(SingleLine str,
 }
 
 std::optional<std::vector<Token>> FindFilterPositions(
-    const std::vector<Token>& filter, std::vector<Token> substrings) {
+    const std::vector<Token>& filter, const std::vector<Token>& substrings) {
   std::vector<Token> output;
   for (auto& filter_token : filter) {
     if (auto token = FindPrefixInTokens(filter_token.value, substrings);
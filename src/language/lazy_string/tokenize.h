@@ -47,7 +47,7 @@ std::vector<Token> ExtendTokensToEndOfString(
 // `filter`, containing one token for the first match of each filter. Otherwise,
 // returns std::nullopt.
 std::optional<std::vector<Token>> FindFilterPositions(
-    const std::vector<Token>& filter, std::vector<Token> substrings);
+    const std::vector<Token>& filter, const std::vector<Token>& substrings);
 
 }  // namespace afc::language::lazy_string
 
@@ -0,0 +1,280 @@
+#include "src/language/lazy_string/utf8_buffer.h"
+
+#include <glog/logging.h>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/lazy_string/character_scanner.h"
+#include "src/language/lazy_string/column_number.h"
+#include "src/tests/tests.h"
+
+namespace afc::language::lazy_string {
+namespace {
+// The index holds the byte offset of every `kIndexStride`-th character.
+constexpr size_t kIndexStride = 16;
+
+// Returns the length of the UTF-8 sequence starting with `byte`. Assumes that
+// `byte` is a valid initial byte.
+size_t SequenceLength(unsigned char byte) {
+  if (byte < 0x80) return 1;
+  if (byte < 0xE0) return 2;
+  if (byte < 0xF0) return 3;
+  return 4;
+}
+
+// Returns the length of the valid UTF-8 sequence at the start of `input`, or
+// nullopt if it isn't valid (or is incomplete). Rejects overlong encodings and
+// surrogates.
+std::optional<size_t> ValidSequenceLength(std::string_view input) {
+  auto byte = [&input](size_t i) {
+    return static_cast<unsigned char>(input[i]);
+  };
+  unsigned char first = byte(0);
+  if (first < 0x80) return 1;
+  if (first < 0xC2 || first > 0xF4) return std::nullopt;
+  size_t length = SequenceLength(first);
+  if (input.size() < length) return std::nullopt;
+  unsigned char second = byte(1);
+  unsigned char min = 0x80;
+  unsigned char max = 0xBF;
+  if (first == 0xE0)
+    min = 0xA0;
+  else if (first == 0xED)
+    max = 0x9F;
+  else if (first == 0xF0)
+    min = 0x90;
+  else if (first == 0xF4)
+    max = 0x8F;
+  if (second < min || second > max) return std::nullopt;
+  for (size_t i = 2; i < length; i++)
+    if ((byte(i) & 0xC0) != 0x80) return std::nullopt;
+  return length;
+}
+
+// Assumes that `input` points to a valid sequence.
+wchar_t Decode(const unsigned char* input) {
+  switch (SequenceLength(input[0])) {
+    case 1:
+      return input[0];
+    case 2:
+      return ((input[0] & 0x1F) << 6) | (input[1] & 0x3F);
+    case 3:
+      return ((input[0] & 0x0F) << 12) | ((input[1] & 0x3F) << 6) |
+             (input[2] & 0x3F);
+  }
+  return ((input[0] & 0x07) << 18) | ((input[1] & 0x3F) << 12) |
+         ((input[2] & 0x3F) << 6) | (input[3] & 0x3F);
+}
+
+class Utf8Buffer : public LazyStringImpl {
+ public:
+  Utf8Buffer(std::shared_ptr<const void> owner, std::string_view data,
+             ColumnNumberDelta size, std::vector<uint32_t> index)
+      : owner_(std::move(owner)),
+        data_(data),
+        size_(size),
+        index_(std::move(index)) {}
+
+  wchar_t get(ColumnNumber pos) const override {
+    CHECK_LT(pos.ToDelta(), size_);
+    return Decode(bytes() + ByteOffset(pos));
+  }
+
+  ColumnNumberDelta size() const override { return size_; }
+
+  ContiguousView Contiguous() const override {
+    if (index_.empty()) return data_;
+    return std::monostate{};
+  }
+
+  // Decodes the characters sequentially (rather than looking up the offset of
+  // each in the index).
+  bool ForEachChunk(ColumnNumber begin, ColumnNumberDelta length,
+                    const ChunkCallback& callback) const override {
+    if (length.IsZero()) return true;
+    CHECK_LE((begin + length).ToDelta(), size_);
+    if (index_.empty())
+      return LazyStringImpl::ForEachChunk(begin, length, callback);
+    static constexpr size_t kBufferSize = 256;
+    std::array<wchar_t, kBufferSize> buffer;
+    size_t offset = ByteOffset(begin);
+    size_t pending = length.read();
+    while (pending > 0) {
+      size_t chunk_length = std::min(kBufferSize, pending);
+      for (size_t i = 0; i < chunk_length; i++) {
+        buffer[i] = Decode(bytes() + offset);
+        offset += SequenceLength(bytes()[offset]);
+      }
+      if (!callback(std::wstring_view(buffer.data(), chunk_length)))
+        return false;
+      pending -= chunk_length;
+    }
+    return true;
+  }
+
+ private:
+  const unsigned char* bytes() const {
+    return reinterpret_cast<const unsigned char*>(data_.data());
+  }
+
+  // Returns the offset in `data_` of the first byte of the character at `pos`.
+  size_t ByteOffset(ColumnNumber pos) const {
+    if (index_.empty()) return pos.read();
+    size_t block = pos.read() / kIndexStride;
+    size_t skip = pos.read() % kIndexStride;
+    size_t offset = index_[block];
+    // Blocks with only ASCII characters contain exactly as many bytes as
+    // characters.
+    size_t block_characters = std::min(
+        kIndexStride, static_cast<size_t>(size_.read()) - block * kIndexStride);
+    size_t block_end =
+        block + 1 < index_.size() ? index_[block + 1] : data_.size();
+    if (block_end - offset == block_characters) return offset + skip;
+    while (skip-- > 0) offset += SequenceLength(bytes()[offset]);
+    return offset;
+  }
+
+  // Keeps `data_` alive.
+  const std::shared_ptr<const void> owner_;
+  const std::string_view data_;
+  const ColumnNumberDelta size_;
+
+  // Empty if `data_` only contains ASCII characters. Otherwise, the byte
+  // offset in `data_` of the characters at positions 0, kIndexStride,
+  // 2 * kIndexStride, etc.
+  const std::vector<uint32_t> index_;
+};
+}  // namespace
+
+ValueOrError<LazyString> NewUtf8LazyString(
+    NonNull<std::shared_ptr<const std::string>> input) {
+  std::string_view bytes = input.value();
+  return NewUtf8LazyString(input.get_shared(), bytes);
+}
+
+ValueOrError<LazyString> NewUtf8LazyString(std::shared_ptr<const void> owner,
+                                           std::string_view bytes) {
+  auto call = INLINE_TRACKER(NewUtf8LazyString);
+  CHECK(owner != nullptr);
+  CHECK_LT(bytes.size(), std::numeric_limits<uint32_t>::max());
+  size_t position = 0;
+  // Skip the ASCII prefix (typically, the entire input) quickly.
+  while (position < bytes.size() &&
+         static_cast<unsigned char>(bytes[position]) < 0x80)
+    position++;
+  if (position == bytes.size())
+    return LazyString(MakeNonNullShared<Utf8Buffer>(
+        std::move(owner), bytes, ColumnNumberDelta(bytes.size()),
+        std::vector<uint32_t>{}));
+
+  std::vector<uint32_t> index;
+  index.reserve(bytes.size() / kIndexStride + 1);
+  for (size_t i = 0; i < position; i += kIndexStride) index.push_back(i);
+  size_t characters = position;
+  while (position < bytes.size()) {
+    std::optional<size_t> length =
+        ValidSequenceLength(bytes.substr(position));
+    if (length == std::nullopt)
+      return Error{LazyString{L"Invalid UTF-8 sequence at byte "} +
+                   LazyString{std::to_wstring(position)}};
+    if (characters % kIndexStride == 0) index.push_back(position);
+    position += *length;
+    characters++;
+  }
+  return LazyString(
+      MakeNonNullShared<Utf8Buffer>(std::move(owner), bytes,
+                                    ColumnNumberDelta(characters),
+                                    std::move(index)));
+}
+
+size_t IncompleteUtf8SuffixLength(std::string_view input) {
+  for (size_t length = 1; length <= std::min<size_t>(3, input.size());
+       length++) {
+    unsigned char byte =
+        static_cast<unsigned char>(input[input.size() - length]);
+    if ((byte & 0xC0) == 0x80) continue;  // Continuation byte.
+    return byte >= 0xC2 && byte <= 0xF4 && SequenceLength(byte) > length
+               ? length
+               : 0;
+  }
+  return 0;
+}
+
+namespace {
+LazyString FromBytes(std::string input) {
+  return ValueOrDie(
+      NewUtf8LazyString(MakeNonNullShared<const std::string>(std::move(input))));
+}
+
+const bool utf8_buffer_tests_registration = tests::Register(
+    L"Utf8Buffer",
+    {{.name = L"Empty",
+      .callback = [] { CHECK_EQ(FromBytes(""), LazyString{}); }},
+     {.name = L"Ascii",
+      .callback =
+          [] { CHECK_EQ(FromBytes("alejandro"), LazyString{L"alejandro"}); }},
+     {.name = L"Multibyte",
+      .callback =
+          [] {
+            CHECK_EQ(FromBytes("a\xc3\xb1o \xe2\x98\x83\xf0\x9f\x8c\xb7."),
+                     LazyString{L"año ☃\U0001F337."});
+          }},
+     {.name = L"LongMixed",
+      .callback =
+          [] {
+            std::string bytes;
+            std::wstring expected;
+            for (int i = 0; i < 100; i++) {
+              bytes += std::string(i % 7, 'x') + "\xc3\xb1" +
+                       std::string(i % 23, 'y');
+              expected += std::wstring(i % 7, L'x') + L"ñ" +
+                          std::wstring(i % 23, L'y');
+            }
+            LazyString output = FromBytes(bytes);
+            CHECK_EQ(output, LazyString{expected});
+            // Exercise random access (rather than sequential reads).
+            for (size_t i = expected.size(); i > 0; i--)
+              CHECK(output.get(ColumnNumber(i - 1)) == expected[i - 1]);
+            // And sequential reads starting at arbitrary positions.
+            for (size_t start = 0; start < expected.size(); start += 37)
+              CHECK(output.Substring(ColumnNumber(start)).ToString() ==
+                    expected.substr(start));
+          }},
+     {.name = L"FindCharacter",
+      .callback =
+          [] {
+            // ASCII contents are scanned directly.
+            LazyString ascii = FromBytes("alejandro\nforero");
+            CHECK(std::holds_alternative<std::string_view>(ascii.Contiguous()));
+            CHECK(FindCharacter(ascii, L'\n', ColumnNumber{}) ==
+                  ColumnNumber{9});
+            CHECK(FindCharacter(ascii, L'ñ', ColumnNumber{}) == std::nullopt);
+            LazyString multibyte = FromBytes("a\xc3\xb1o\nx");
+            CHECK(FindCharacter(multibyte, L'\n', ColumnNumber{}) ==
+                  ColumnNumber{3});
+          }},
+     {.name = L"Invalid",
+      .callback =
+          [] {
+            for (std::string input :
+                 {"\xff", "a\x80", "\xc3", "\xc0\xaf", "\xed\xa0\x80",
+                  "\xf4\x90\x80\x80", "\xe2\x28\xa1"})
+              CHECK(IsError(NewUtf8LazyString(
+                  MakeNonNullShared<const std::string>(input))));
+          }},
+     {.name = L"IncompleteSuffix", .callback = [] {
+        CHECK_EQ(IncompleteUtf8SuffixLength(""), 0ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("abc"), 0ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("a\xc3"), 1ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("a\xc3\xb1"), 0ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("a\xe2\x98"), 2ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("\xf0\x9f\x8c"), 3ul);
+        CHECK_EQ(IncompleteUtf8SuffixLength("\xf0\x9f\x8c\xb7"), 0ul);
+      }}});
+}  // namespace
+}  // namespace afc::language::lazy_string
@@ -0,0 +1,38 @@
+#ifndef __AFC_LANGUAGE_LAZY_STRING_UTF8_BUFFER_H__
+#define __AFC_LANGUAGE_LAZY_STRING_UTF8_BUFFER_H__
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "src/language/error/value_or_error.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/safe_types.h"
+
+namespace afc::language::lazy_string {
+// Returns a LazyString that reads its characters directly from the UTF-8
+// encoded bytes in `input`, rather than expanding them (to a `wchar_t` per
+// character).
+//
+// If `input` only contains ASCII characters, `get` is O(1). Otherwise, a
+// sparse index from columns to byte offsets is built, so that `get` only
+// needs to skip a few (bounded) characters.
+//
+// Returns an error if `input` isn't valid UTF-8 (including if it ends in the
+// middle of a sequence; see `IncompleteUtf8SuffixLength`).
+ValueOrError<LazyString> NewUtf8LazyString(
+    NonNull<std::shared_ptr<const std::string>> input);
+
+// Similar to the above, but reads the bytes in `input` without copying them.
+// `input` must remain valid for as long as `owner` is alive (which the
+// returned LazyString retains).
+ValueOrError<LazyString> NewUtf8LazyString(std::shared_ptr<const void> owner,
+                                           std::string_view input);
+
+// Returns the number of bytes at the end of `input` that form the start of a
+// (yet) incomplete UTF-8 sequence. Those bytes should be held back until the
+// rest of the sequence is available.
+size_t IncompleteUtf8SuffixLength(std::string_view input);
+}  // namespace afc::language::lazy_string
+
+#endif  // __AFC_LANGUAGE_LAZY_STRING_UTF8_BUFFER_H__
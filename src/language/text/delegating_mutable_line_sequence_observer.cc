@@ -55,4 +55,10 @@ void DelegatingMutableLineSequenceObserver::InsertedCharacter(
     LineColumn position) {
   for (auto& delegate : delegates_) delegate->InsertedCharacter(position);
 }
+
+void DelegatingMutableLineSequenceObserver::InsertedCharacters(
+    const std::vector<LineColumn>& positions, ColumnNumberDelta amount) {
+  for (auto& delegate : delegates_)
+    delegate->InsertedCharacters(positions, amount);
+}
 }  // namespace afc::language::text
@@ -24,6 +24,9 @@ class DelegatingMutableLineSequenceObserver
       language::lazy_string::ColumnNumberDelta amount) override;
   void SetCharacter(language::text::LineColumn position) override;
   void InsertedCharacter(language::text::LineColumn position) override;
+  void InsertedCharacters(
+      const std::vector<language::text::LineColumn>& positions,
+      language::lazy_string::ColumnNumberDelta amount) override;
 
  private:
   const std::vector<Delegate> delegates_;
@@ -5,14 +5,19 @@
 #include <iostream>
 #include <unordered_set>
 
+#include "src/infrastructure/time.h"
 #include "src/language/lazy_string/append.h"
 #include "src/language/lazy_string/char_buffer.h"
+#include "src/language/lazy_string/character_scanner.h"
 #include "src/language/safe_types.h"
 #include "src/language/text/line.h"
 #include "src/language/text/line_builder.h"
 #include "src/language/wstring.h"
+#include "src/tests/benchmarks.h"
 #include "src/tests/tests.h"
 
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
 using afc::infrastructure::screen::LineModifierSet;
 using afc::language::MakeNonNullShared;
 using afc::language::MakeNonNullUnique;
@@ -20,6 +25,7 @@ using afc::language::NonNull;
 using afc::language::lazy_string::ColumnNumber;
 using afc::language::lazy_string::ColumnNumberDelta;
 using afc::language::lazy_string::Concatenate;
+using afc::language::lazy_string::FindCharacter;
 using afc::language::lazy_string::Intersperse;
 using afc::language::lazy_string::LazyString;
 using afc::language::lazy_string::SingleLine;
@@ -29,21 +35,19 @@ namespace afc::language::text {
 using ::operator<<;
 
 /* static */ LineSequence LineSequence::BreakLines(LazyString input) {
-  Lines::Ptr output = nullptr;
+  // Building the tree from all the lines at once is significantly faster than
+  // pushing them one by one.
+  std::vector<Line> lines;
   ColumnNumber start;
-  for (ColumnNumber i; i.ToDelta() < input.size(); ++i) {
-    wchar_t c = input.get(i);
-    CHECK_GE(i, start);
-    if (c == '\n') {
-      output =
-          Lines::PushBack(std::move(output),
-                          Line{SingleLine{input.Substring(start, i - start)}})
-              .get_shared();
-      start = i + ColumnNumberDelta(1);
-    }
+  while (std::optional<ColumnNumber> newline =
+             FindCharacter(input, L'\n', start)) {
+    lines.push_back(Line{SingleLine{input.Substring(start, *newline - start)}});
+    start = *newline + ColumnNumberDelta(1);
   }
-  return LineSequence(Lines::PushBack(
-      std::move(output), Line{SingleLine{LazyString{input.Substring(start)}}}));
+  lines.push_back(Line{SingleLine{input.Substring(start)}});
+  // This is safe because `lines` isn't empty.
+  return LineSequence(NonNull<Lines::Ptr>::Unsafe(
+      Lines::FromRange(lines.begin(), lines.end())));
 }
 
 /* static */ LineSequence LineSequence::ForTests(
@@ -543,6 +547,24 @@ const bool line_sequence_iterator_tests_registration = tests::Register(
                                  CHECK_EQ(lines.end() - lines.end(), 0);
                                }}});
 
+bool break_lines_benchmark = tests::RegisterBenchmark(
+    tests::BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"LineSequence::BreakLines")},
+    [](int elements) {
+      // Each element is a line with 100 characters, so 2^20 elements are about
+      // 100 million characters.
+      std::wstring line(99, L'x');
+      line.push_back(L'\n');
+      std::wstring input;
+      input.reserve(line.size() * elements);
+      for (int i = 0; i < elements; i++) input += line;
+      LazyString input_lazy{std::move(input)};
+      auto start = Now();
+      LineSequence output = LineSequence::BreakLines(input_lazy);
+      double seconds = SecondsBetween(start, Now());
+      CHECK_EQ(output.size(), LineNumberDelta(elements + 1));
+      return seconds;
+    });
 }  // namespace
 
 LineSequenceIterator& LineSequenceIterator::operator--() {
@@ -35,6 +35,8 @@ void NullMutableLineSequenceObserver::DeletedCharacters(LineColumn,
                                                         ColumnNumberDelta) {}
 void NullMutableLineSequenceObserver::SetCharacter(LineColumn) {}
 void NullMutableLineSequenceObserver::InsertedCharacter(LineColumn) {}
+void NullMutableLineSequenceObserver::InsertedCharacters(
+    const std::vector<LineColumn>&, ColumnNumberDelta) {}
 
 MutableLineSequence::MutableLineSequence()
     : MutableLineSequence(
@@ -198,6 +200,70 @@ void MutableLineSequence::InsertCharacter(LineColumn position) {
   observer_->InsertedCharacter(position);
 }
 
+void MutableLineSequence::InsertInPositions(
+    const std::vector<LineColumn>& positions, const Line& text) {
+  TRACK_OPERATION(MutableLineSequence_InsertInPositions);
+  if (positions.empty() || text.empty()) return;
+  CHECK(std::ranges::is_sorted(positions));
+  auto line_begin = positions.begin();
+  while (line_begin != positions.end()) {
+    const LineNumber line_number = line_begin->line;
+    auto line_end = std::find_if(
+        line_begin, positions.end(),
+        [line_number](LineColumn p) { return p.line != line_number; });
+    const Line& original = at(line_number);
+    CHECK_LE(std::prev(line_end)->column, original.EndColumn());
+
+    LineBuilder output(original);
+    output.DeleteSuffix(line_begin->column);
+    for (auto it = line_begin; it != line_end; ++it) {
+      output.Append(LineBuilder(text));
+      LineBuilder piece(original);
+      if (std::next(it) != line_end) piece.DeleteSuffix(std::next(it)->column);
+      piece.DeleteCharacters(ColumnNumber(0), it->column.ToDelta());
+      output.Append(std::move(piece));
+    }
+    set_line(line_number, std::move(output).Build());
+    line_begin = line_end;
+  }
+  observer_->InsertedCharacters(positions, text.EndColumn().ToDelta());
+}
+
+namespace {
+const bool insert_in_positions_tests_registration = tests::Register(
+    L"MutableLineSequence::InsertInPositions",
+    {
+        {.name = L"SeveralLines",
+         .callback =
+             [] {
+               MutableLineSequence contents;
+               contents.push_back(L"alejandro");
+               contents.push_back(L"forero");
+               contents.push_back(L"cuervo");
+               contents.InsertInPositions(
+                   {LineColumn(LineNumber(1), ColumnNumber(0)),
+                    LineColumn(LineNumber(1), ColumnNumber(4)),
+                    LineColumn(LineNumber(1), ColumnNumber(9)),
+                    LineColumn(LineNumber(3), ColumnNumber(3))},
+                   Line{SingleLine{LazyString{L"**"}}});
+               CHECK_EQ(contents.snapshot().ToLazyString(),
+                        LazyString{L"\n**alej**andro**\nforero\ncue**rvo"});
+             }},
+        {.name = L"RepeatedPosition",
+         .callback =
+             [] {
+               MutableLineSequence contents;
+               contents.push_back(L"foo");
+               contents.InsertInPositions(
+                   {LineColumn(LineNumber(1), ColumnNumber(1)),
+                    LineColumn(LineNumber(1), ColumnNumber(1))},
+                   Line{SingleLine{LazyString{L"-"}}});
+               CHECK_EQ(contents.snapshot().ToLazyString(),
+                        LazyString{L"\nf--oo"});
+             }},
+    });
+}  // namespace
+
 void MutableLineSequence::AppendToLine(LineNumber line, Line line_to_append,
                                        ObserverBehavior observer_behavior) {
   const LineColumn position = LineColumn(
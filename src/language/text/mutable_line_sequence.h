@@ -27,6 +27,9 @@ class NullMutableLineSequenceObserver : public MutableLineSequenceObserver {
       language::lazy_string::ColumnNumberDelta amount) override;
   void SetCharacter(language::text::LineColumn position) override;
   void InsertedCharacter(language::text::LineColumn position) override;
+  void InsertedCharacters(
+      const std::vector<language::text::LineColumn>& positions,
+      language::lazy_string::ColumnNumberDelta amount) override;
 };
 
 class MutableLineSequence : public tests::fuzz::FuzzTestable {
@@ -156,6 +159,13 @@ class MutableLineSequence : public tests::fuzz::FuzzTestable {
                     infrastructure::screen::LineModifierSet modifiers);
 
   void InsertCharacter(language::text::LineColumn position);
+
+  // Inserts a copy of `text` at each of `positions`, which must be sorted and
+  // valid, and refer to the contents before any insertion. Each affected line
+  // is rebuilt once and the observer is notified once.
+  void InsertInPositions(
+      const std::vector<language::text::LineColumn>& positions,
+      const language::text::Line& text);
   void AppendToLine(
       language::text::LineNumber line, language::text::Line line_to_append,
       ObserverBehavior observer_behavior = ObserverBehavior::kShow);
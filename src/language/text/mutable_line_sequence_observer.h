@@ -1,6 +1,8 @@
 #ifndef __AFC_LANGUAGE_TEXT_MUTABLE_LINE_SEQUENCE_OBSERVER_H__
 #define __AFC_LANGUAGE_TEXT_MUTABLE_LINE_SEQUENCE_OBSERVER_H__
 
+#include <vector>
+
 #include "src/language/text/line_column.h"
 
 namespace afc::language::text {
@@ -20,6 +22,11 @@ class MutableLineSequenceObserver {
       language::lazy_string::ColumnNumberDelta amount) = 0;
   virtual void SetCharacter(language::text::LineColumn position) = 0;
   virtual void InsertedCharacter(language::text::LineColumn position) = 0;
+  // `amount` characters were inserted at each of `positions`. The positions
+  // are sorted and refer to the contents before any of the insertions.
+  virtual void InsertedCharacters(
+      const std::vector<language::text::LineColumn>& positions,
+      language::lazy_string::ColumnNumberDelta amount) = 0;
 };
 
 }  // namespace afc::language::text
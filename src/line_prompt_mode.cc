@@ -3,6 +3,7 @@
 #include <glog/logging.h>
 
 #include <limits>
+#include <map>
 #include <memory>
 #include <ranges>
 #include <string>
@@ -47,6 +48,7 @@ namespace container = afc::language::container;
 namespace gc = afc::language::gc;
 
 using afc::concurrent::ChannelAll;
+using afc::concurrent::Protected;
 using afc::concurrent::VersionPropertyKey;
 using afc::concurrent::VersionPropertyReceiver;
 using afc::concurrent::WorkQueueScheduler;
@@ -171,9 +173,27 @@ SingleLine BuildHistoryLine(EditorState& editor, LazyString input) {
   return EscapedMap{std::move(data)}.Serialize();
 }
 
+// Returns the index of a history file. Indices outlive the prompts (and the
+// history buffers), so that each prompt only needs to parse the entries added
+// since the previous one.
+NonNull<std::shared_ptr<Protected<HistoryIndex>>> GetHistoryIndex(
+    const HistoryFile& history_file) {
+  using Indices =
+      std::map<HistoryFile, NonNull<std::shared_ptr<Protected<HistoryIndex>>>>;
+  static Protected<Indices>* const indices = new Protected<Indices>();
+  return indices->lock([&history_file](Indices& data) {
+    auto it = data.find(history_file);
+    if (it == data.end())
+      it = data.insert({history_file,
+                        MakeNonNullShared<Protected<HistoryIndex>>()})
+               .first;
+    return it->second;
+  });
+}
+
 futures::Value<gc::Root<OpenBuffer>> FilterHistory(
     EditorState& editor_state, gc::Root<OpenBuffer> history_buffer_root,
-    const HistoryFile&, DeleteNotification::Value abort_value,
+    const HistoryFile& history_file, DeleteNotification::Value abort_value,
     SingleLine filter) {
   gc::Root<OpenBuffer> filter_buffer_root = OpenBuffer::New(
       {.editor = editor_state,
@@ -189,8 +209,9 @@ futures::Value<gc::Root<OpenBuffer>> FilterHistory(
 
   LOG(INFO) << "Waiting for end of history.";
   return history_buffer_root->WaitForEndOfFile()
-      .Transform([&editor_state, filter_buffer_root, abort_value,
-                  filter](gc::Root<OpenBuffer> history_buffer) {
+      .Transform([&editor_state, filter_buffer_root, abort_value, filter,
+                  history_index = GetHistoryIndex(history_file)](
+                     gc::Root<OpenBuffer> history_buffer) {
         LOG(INFO) << "Starting history filter.";
         return editor_state.thread_pool().Run(std::bind_front(
             FilterSortBuffer,
@@ -198,7 +219,9 @@ futures::Value<gc::Root<OpenBuffer>> FilterHistory(
                 .abort_value = abort_value,
                 .filter = filter,
                 .history = history_buffer.ptr()->contents().snapshot(),
-                .current_features = GetCurrentFeatures(editor_state)}));
+                .current_features = GetCurrentFeatures(editor_state),
+                .history_index = history_index,
+                .thread_pool = editor_state.thread_pool().thread_pool()}));
       })
       .Transform([&editor_state, abort_value, filter_buffer_root,
                   &filter_buffer](FilterSortBufferOutput output) {
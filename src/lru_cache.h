@@ -48,6 +48,23 @@ class LRUCache {
     });
   }
 
+  // Returns whether the key is currently in the map. Doesn't affect the order
+  // in which entries will expire.
+  bool Contains(const Key& key) const {
+    return data_.lock(
+        [&key](const Data& data) { return data.map.contains(key); });
+  }
+
+  // Calls `callable` with the key and value of each entry, starting with the
+  // most recently used. `callable` shouldn't attempt to use the map.
+  template <typename Callable>
+  void ForEach(Callable callable) const {
+    data_.lock([&callable](const Data& data) {
+      for (const typename Data::Entry& entry : data.access_order)
+        callable(entry.key, entry.value);
+    });
+  }
+
   // If the key is currently in the map, just returns its value.
   //
   // Otherwise, runs the Creator callback, a function that receives zero
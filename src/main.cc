@@ -25,8 +25,11 @@ extern "C" {
 #include "src/infrastructure/command_line.h"
 #include "src/infrastructure/execution.h"
 #include "src/infrastructure/file_descriptor_reader.h"
+#include "src/infrastructure/screen/diffing_screen.h"
 #include "src/infrastructure/screen/screen.h"
 #include "src/infrastructure/time.h"
+#include "src/infrastructure/trace_recorder.h"
+#include "src/infrastructure/trace_writer.h"
 #include "src/language/gc_view.h"
 #include "src/language/lazy_string/char_buffer.h"
 #include "src/language/lazy_string/lazy_string.h"
@@ -56,9 +59,11 @@ using afc::infrastructure::Path;
 using afc::infrastructure::UnixSignal;
 using afc::infrastructure::execution::ExecutionEnvironment;
 using afc::infrastructure::execution::ExecutionEnvironmentOptions;
+using afc::infrastructure::screen::DiffingScreen;
 using afc::infrastructure::screen::Screen;
 using afc::language::Error;
 using afc::language::FromByteString;
+using afc::language::GetError;
 using afc::language::IgnoreErrors;
 using afc::language::IsError;
 using afc::language::MakeNonNullShared;
@@ -251,6 +256,9 @@ int main(int argc, const char** argv) {
   auto args = afc::command_line_arguments::Parse(afc::editor::CommandLineArgs(),
                                                  argc, argv);
 
+  afc::infrastructure::SetTraceThreadName(L"main");
+  if (args.trace_path.has_value()) afc::infrastructure::StartTraceRecording();
+
   LOG(INFO) << "Setting up audio_player.";
   const NonNull<std::unique_ptr<audio::Player>> audio_player =
       HasValue(afc::editor::GetEdgeParentAddress()) || args.mute
@@ -286,7 +294,9 @@ int main(int argc, const char** argv) {
   std::shared_ptr<Screen> screen_curses;
   if (!args.server) {
     LOG(INFO) << "Creating curses screen.";
-    screen_curses = std::move(NewScreenCurses().get_unique());
+    // Curses only receives the cells that change between refreshes.
+    screen_curses =
+        MakeNonNullShared<DiffingScreen>(NewScreenCurses()).get_shared();
   }
   RegisterScreenType(editor_state(),
                      editor_state().execution_context()->environment().value());
@@ -429,6 +439,14 @@ int main(int argc, const char** argv) {
   LOG(INFO) << "Deleting screen_curses.";
   screen_curses = nullptr;
 
+  VisitOptional(
+      [](Path path) {
+        if (auto result = afc::infrastructure::WriteTrace(path);
+            IsError(result))
+          std::cerr << GetError(result).read() << std::endl;
+      },
+      [] {}, args.trace_path);
+
   LOG(INFO) << "Returning";
   if (exit_notice.has_value()) std::cerr << *exit_notice;
   return output;
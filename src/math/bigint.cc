@@ -1,6 +1,7 @@
 #include "src/math/bigint.h"
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <limits>
 #include <ranges>
@@ -20,10 +21,265 @@ using afc::language::lazy_string::LazyString;
 namespace afc::math::numbers {
 using ::operator<<;
 
-BigInt::BigInt(std::vector<Digit> digits_input)
-    : digits(std::move(digits_input)) {
-  while (!digits.empty() && digits.back() == 0) digits.pop_back();
-  for (Digit digit : digits) CHECK_LE(digit, 9UL);
+namespace {
+using Limb = uint64_t;
+using DoubleLimb = unsigned __int128;
+
+// The largest power of 10 that fits in a limb, and its number of zeros.
+constexpr Limb kDecimalChunk = 10'000'000'000'000'000'000ull;
+constexpr size_t kDecimalChunkDigits = 19;
+
+// Operands with fewer limbs than this are multiplied with the schoolbook
+// algorithm; Karatsuba's overhead only pays off for larger operands.
+constexpr size_t kKaratsubaThreshold = 32;
+
+// All functions below receive and return limbs in little-endian order. Inputs
+// may have trailing (most significant) zero limbs.
+
+std::span<const Limb> Trim(std::span<const Limb> limbs) {
+  while (!limbs.empty() && limbs.back() == 0)
+    limbs = limbs.first(limbs.size() - 1);
+  return limbs;
+}
+
+std::strong_ordering CompareLimbs(std::span<const Limb> a,
+                                  std::span<const Limb> b) {
+  a = Trim(a);
+  b = Trim(b);
+  if (a.size() != b.size()) return a.size() <=> b.size();
+  for (size_t i = a.size(); i-- > 0;)
+    if (a[i] != b[i]) return a[i] <=> b[i];
+  return std::strong_ordering::equal;
+}
+
+std::vector<Limb> AddLimbs(std::span<const Limb> a, std::span<const Limb> b) {
+  if (a.size() < b.size()) std::swap(a, b);
+  std::vector<Limb> output(a.size() + 1);
+  Limb carry = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    DoubleLimb sum = DoubleLimb{a[i]} + (i < b.size() ? b[i] : 0) + carry;
+    output[i] = static_cast<Limb>(sum);
+    carry = static_cast<Limb>(sum >> 64);
+  }
+  output[a.size()] = carry;
+  return output;
+}
+
+// Adds `b`, shifted by `offset` limbs, to `a`. The result must fit in `a`.
+void AddInPlace(std::vector<Limb>& a, std::span<const Limb> b, size_t offset) {
+  b = Trim(b);
+  Limb carry = 0;
+  for (size_t i = 0; i < b.size() || carry != 0; ++i) {
+    CHECK_LT(offset + i, a.size());
+    DoubleLimb sum =
+        DoubleLimb{a[offset + i]} + (i < b.size() ? b[i] : 0) + carry;
+    a[offset + i] = static_cast<Limb>(sum);
+    carry = static_cast<Limb>(sum >> 64);
+  }
+}
+
+// Subtracts `b` from `a`. Requires `a >= b`.
+void SubtractInPlace(std::vector<Limb>& a, std::span<const Limb> b) {
+  b = Trim(b);
+  Limb borrow = 0;
+  for (size_t i = 0; i < b.size() || borrow != 0; ++i) {
+    CHECK_LT(i, a.size());
+    Limb subtrahend = i < b.size() ? b[i] : 0;
+    Limb partial = a[i] - subtrahend;
+    Limb next_borrow = (a[i] < subtrahend) + (partial < borrow);
+    a[i] = partial - borrow;
+    borrow = next_borrow;
+  }
+}
+
+// Computes `limbs * factor + addend`.
+void MultiplyAddInPlace(std::vector<Limb>& limbs, Limb factor, Limb addend) {
+  Limb carry = addend;
+  for (Limb& limb : limbs) {
+    DoubleLimb value = DoubleLimb{limb} * factor + carry;
+    limb = static_cast<Limb>(value);
+    carry = static_cast<Limb>(value >> 64);
+  }
+  if (carry != 0) limbs.push_back(carry);
+}
+
+std::vector<Limb> MultiplySchoolbook(std::span<const Limb> a,
+                                     std::span<const Limb> b) {
+  std::vector<Limb> output(a.size() + b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    Limb carry = 0;
+    for (size_t j = 0; j < b.size(); ++j) {
+      DoubleLimb product = DoubleLimb{a[i]} * b[j] + output[i + j] + carry;
+      output[i + j] = static_cast<Limb>(product);
+      carry = static_cast<Limb>(product >> 64);
+    }
+    output[i + b.size()] = carry;
+  }
+  return output;
+}
+
+std::vector<Limb> MultiplyLimbs(std::span<const Limb> a,
+                                std::span<const Limb> b) {
+  a = Trim(a);
+  b = Trim(b);
+  if (a.size() < b.size()) std::swap(a, b);
+  if (b.empty()) return {};
+  if (b.size() < kKaratsubaThreshold) return MultiplySchoolbook(a, b);
+
+  std::vector<Limb> output(a.size() + b.size());
+  if (a.size() >= 2 * b.size()) {
+    // Unbalanced operands: multiply `b` by slices of `a` of its size.
+    for (size_t start = 0; start < a.size(); start += b.size())
+      AddInPlace(output,
+                 MultiplyLimbs(a.subspan(start, std::min(b.size(),
+                                                         a.size() - start)),
+                               b),
+                 start);
+    return output;
+  }
+
+  // Karatsuba. With `a = a1 * B + a0` and `b = b1 * B + b0` (where `B` is
+  // 2^(64 * half)): `a * b = z2 * B^2 + (z1 - z2 - z0) * B + z0`, where
+  // `z0 = a0 * b0`, `z2 = a1 * b1` and `z1 = (a0 + a1) * (b0 + b1)`.
+  const size_t half = a.size() / 2;
+  std::span<const Limb> a0 = a.first(half);
+  std::span<const Limb> a1 = a.subspan(half);
+  std::span<const Limb> b0 = b.first(half);
+  std::span<const Limb> b1 = b.subspan(half);
+  std::vector<Limb> z0 = MultiplyLimbs(a0, b0);
+  std::vector<Limb> z2 = MultiplyLimbs(a1, b1);
+  std::vector<Limb> z1 = MultiplyLimbs(AddLimbs(a0, a1), AddLimbs(b0, b1));
+  SubtractInPlace(z1, z0);
+  SubtractInPlace(z1, z2);
+  AddInPlace(output, z0, 0);
+  AddInPlace(output, z1, half);
+  AddInPlace(output, z2, 2 * half);
+  return output;
+}
+
+struct LimbsDivideOutput {
+  std::vector<Limb> quotient;
+  std::vector<Limb> remainder;
+};
+
+LimbsDivideOutput DivideBySingleLimb(std::span<const Limb> numerator,
+                                     Limb denominator) {
+  LimbsDivideOutput output{.quotient = std::vector<Limb>(numerator.size()),
+                           .remainder = {}};
+  Limb remainder = 0;
+  for (size_t i = numerator.size(); i-- > 0;) {
+    DoubleLimb current = (DoubleLimb{remainder} << 64) | numerator[i];
+    output.quotient[i] = static_cast<Limb>(current / denominator);
+    remainder = static_cast<Limb>(current % denominator);
+  }
+  output.remainder.push_back(remainder);
+  return output;
+}
+
+// Knuth's Algorithm D (The Art of Computer Programming, volume 2, 4.3.1).
+// `denominator` must not be zero.
+LimbsDivideOutput DivideLimbs(std::span<const Limb> numerator,
+                              std::span<const Limb> denominator) {
+  numerator = Trim(numerator);
+  denominator = Trim(denominator);
+  CHECK(!denominator.empty());
+  if (CompareLimbs(numerator, denominator) == std::strong_ordering::less)
+    return LimbsDivideOutput{
+        .quotient = {},
+        .remainder = std::vector<Limb>(numerator.begin(), numerator.end())};
+  if (denominator.size() == 1)
+    return DivideBySingleLimb(numerator, denominator[0]);
+
+  // Normalize, so that the most significant limb of the denominator has its
+  // highest bit set. This ensures that the estimates of each quotient limb are
+  // off by at most two.
+  const size_t n = denominator.size();
+  const size_t m = numerator.size() - n;
+  const int shift = std::countl_zero(denominator.back());
+  auto shifted = [shift](std::span<const Limb> input, size_t i) -> Limb {
+    Limb high = i < input.size() ? input[i] : 0;
+    Limb low = i > 0 && i - 1 < input.size() ? input[i - 1] : 0;
+    return shift == 0 ? high : (high << shift) | (low >> (64 - shift));
+  };
+  std::vector<Limb> v(n);
+  for (size_t i = 0; i < n; ++i) v[i] = shifted(denominator, i);
+  std::vector<Limb> u(numerator.size() + 1);
+  for (size_t i = 0; i < u.size(); ++i) u[i] = shifted(numerator, i);
+
+  std::vector<Limb> quotient(m + 1);
+  for (size_t j = m + 1; j-- > 0;) {
+    DoubleLimb current = (DoubleLimb{u[j + n]} << 64) | u[j + n - 1];
+    DoubleLimb estimate = current / v[n - 1];
+    DoubleLimb estimate_remainder = current % v[n - 1];
+    while ((estimate >> 64) != 0 ||
+           estimate * v[n - 2] > ((estimate_remainder << 64) | u[j + n - 2])) {
+      --estimate;
+      estimate_remainder += v[n - 1];
+      if ((estimate_remainder >> 64) != 0) break;
+    }
+
+    // Subtract `estimate * v` from `u[j, j + n]`.
+    Limb carry = 0;
+    Limb borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+      DoubleLimb product = estimate * v[i] + carry;
+      carry = static_cast<Limb>(product >> 64);
+      Limb product_low = static_cast<Limb>(product);
+      Limb partial = u[i + j] - product_low;
+      Limb next_borrow = (u[i + j] < product_low) + (partial < borrow);
+      u[i + j] = partial - borrow;
+      borrow = next_borrow;
+    }
+    DoubleLimb subtrahend = DoubleLimb{carry} + borrow;
+    bool negative = DoubleLimb{u[j + n]} < subtrahend;
+    u[j + n] -= static_cast<Limb>(subtrahend);
+
+    if (negative) {
+      // The estimate was one too large; add `v` back.
+      --estimate;
+      Limb add_carry = 0;
+      for (size_t i = 0; i < n; ++i) {
+        DoubleLimb sum = DoubleLimb{u[i + j]} + v[i] + add_carry;
+        u[i + j] = static_cast<Limb>(sum);
+        add_carry = static_cast<Limb>(sum >> 64);
+      }
+      u[j + n] += add_carry;
+    }
+    quotient[j] = static_cast<Limb>(estimate);
+  }
+
+  // Undo the normalization of the remainder.
+  std::vector<Limb> remainder(n);
+  for (size_t i = 0; i < n; ++i)
+    remainder[i] =
+        shift == 0 ? u[i] : (u[i] >> shift) | (u[i + 1] << (64 - shift));
+  return LimbsDivideOutput{.quotient = std::move(quotient),
+                           .remainder = std::move(remainder)};
+}
+}  // namespace
+
+BigInt::BigInt(std::vector<Digit> digits_input) {
+  for (Digit digit : digits_input) CHECK_LE(digit, 9UL);
+  std::vector<Limb> output;
+  for (Digit digit : digits_input | std::views::reverse)
+    MultiplyAddInPlace(output, 10, digit);
+  *this = FromLimbs(std::move(output));
+}
+
+/* static */ BigInt BigInt::FromLimbs(std::vector<Limb> limbs_input) {
+  limbs_input.resize(Trim(limbs_input).size());
+  BigInt output;
+  if (limbs_input.size() <= 1)
+    output.small_value = limbs_input.empty() ? 0 : limbs_input[0];
+  else
+    output.limbs = std::move(limbs_input);
+  return output;
+}
+
+std::span<const BigInt::Limb> BigInt::LimbsView() const {
+  if (!limbs.empty()) return limbs;
+  if (small_value == 0) return {};
+  return std::span<const Limb>(&small_value, 1);
 }
 
 namespace {
@@ -65,15 +321,14 @@ const bool constructors_tests_registration =
 /* static */ ValueOrError<BigInt> BigInt::FromString(
     const std::wstring& input) {
   if (input.empty()) return Error{LazyString{L"Input string is empty."}};
-  size_t i = input[0] == L'+' ? 1 : 0;
-  std::vector<Digit> digits;
+  const size_t start = input[0] == L'+' ? 1 : 0;
+  size_t i = start;
   while (i < input.size() && input[i] != L'.') {
     wchar_t c = input[i];
     if (c < L'0' || c > L'9') {
       return Error{LazyString{L"Invalid character found: "} +
                    LazyString{ColumnNumberDelta{1}, c}};
     }
-    digits.insert(digits.begin(), c - L'0');
     ++i;
   }
 
@@ -83,9 +338,21 @@ const bool constructors_tests_registration =
         pos != std::wstring::npos)
       return Error{LazyString{L"Non-zero decimal part found."}};
   }
-  if (digits.empty()) return Error{LazyString{L"No digits found in input."}};
-
-  return BigInt(std::move(digits));
+  if (i == start) return Error{LazyString{L"No digits found in input."}};
+
+  // Consume the digits in chunks that fit in a limb.
+  std::vector<Limb> output;
+  for (size_t chunk_start = start; chunk_start < i;) {
+    size_t chunk_end = std::min(i, chunk_start + kDecimalChunkDigits);
+    Limb factor = 1;
+    Limb chunk = 0;
+    for (; chunk_start < chunk_end; ++chunk_start) {
+      factor *= 10;
+      chunk = chunk * 10 + (input[chunk_start] - L'0');
+    }
+    MultiplyAddInPlace(output, factor, chunk);
+  }
+  return FromLimbs(std::move(output));
 }
 
 namespace {
@@ -133,18 +400,47 @@ const bool from_string_tests_registration =
     }());
 }  // namespace
 
+namespace {
+// Appends the decimal representation of `value` to `output`. `powers[i]` must
+// be `kDecimalChunk^(2^i)` and `value` must be smaller than `powers[level]`.
+// If `pad` is true, adds leading zeros to produce exactly
+// `kDecimalChunkDigits * 2^level` digits.
+//
+// Splits `value` recursively (dividing by `powers[level - 1]`), which is much
+// faster than repeatedly dividing the entire value by `kDecimalChunk`.
+void AppendDecimal(const BigInt& value, size_t level, bool pad,
+                   const std::vector<BigInt>& powers, std::wstring& output) {
+  if (level == 0) {
+    std::wstring chunk = value.ToString();
+    if (pad) output.append(kDecimalChunkDigits - chunk.size(), L'0');
+    output += chunk;
+    return;
+  }
+  const BigInt& power = powers[level - 1];
+  if (!pad && value < power) {
+    AppendDecimal(value, level - 1, false, powers, output);
+    return;
+  }
+  BigIntDivideOutput split = ValueOrDie(Divide(value, power));
+  AppendDecimal(split.quotient, level - 1, pad, powers, output);
+  AppendDecimal(split.remainder, level - 1, true, powers, output);
+}
+}  // namespace
+
 std::wstring BigInt::ToString() const {
-  if (digits.empty()) return L"0";
+  if (limbs.empty()) return std::to_wstring(small_value);
 
-  std::wstring result;
-  for (auto it = digits.rbegin(); it != digits.rend(); ++it)
-    result += static_cast<wchar_t>(L'0' + *it);
-  return result;
+  std::vector<BigInt> powers = {BigInt::FromNumber(kDecimalChunk)};
+  while (powers.back() <= *this)
+    powers.push_back(powers.back() * powers.back());
+  std::wstring output;
+  AppendDecimal(*this, powers.size() - 1, false, powers, output);
+  return output;
 }
 
 LazyString BigInt::ToLazyString() const { return LazyString{ToString()}; }
 
-bool BigInt::IsZero() const { return digits.empty(); }
+bool BigInt::IsZero() const { return limbs.empty() && small_value == 0; }
 
 namespace {
 const bool is_zero_tests_registration = tests::Register(
@@ -176,12 +472,8 @@ const bool is_zero_tests_registration = tests::Register(
 }  // namespace
 
 std::strong_ordering BigInt::operator<=>(const BigInt& b) const {
-  if (digits.size() != b.digits.size())
-    return digits.size() <=> b.digits.size();
-  for (auto it = digits.rbegin(), it_b = b.digits.rbegin(); it != digits.rend();
-       ++it, ++it_b)
-    if (auto cmp = *it <=> *it_b; cmp != 0) return cmp;
-  return std::strong_ordering::equal;
+  if (limbs.empty() && b.limbs.empty()) return small_value <=> b.small_value;
+  return CompareLimbs(LimbsView(), b.LimbsView());
 }
 
 bool BigInt::operator==(const BigInt& other) const {
@@ -246,25 +538,12 @@ const bool tests_order_registration = tests::Register(
 }  // namespace
 
 BigInt BigInt::operator+(BigInt b) && {
-  std::vector<Digit> result;
-
-  const size_t max_size = std::max(digits.size(), b.digits.size());
-  result.resize(max_size, 0);
-
-  size_t carry = 0;
-  for (size_t i = 0; i < max_size; ++i) {
-    Digit a_digit = i < digits.size() ? digits[i] : 0;
-    Digit b_digit = i < b.digits.size() ? b.digits[i] : 0;
-    CHECK_LE(a_digit, 9UL);
-    CHECK_LE(b_digit, 9UL);
-    Digit sum = a_digit + b_digit + carry;
-    carry = sum / 10;
-    CHECK_LE(carry, 1ul);
-    result[i] = sum % 10;
+  if (Limb sum; limbs.empty() && b.limbs.empty() &&
+                !__builtin_add_overflow(small_value, b.small_value, &sum)) {
+    small_value = sum;
+    return std::move(*this);
   }
-
-  if (carry > 0) result.push_back(carry);
-  return BigInt(std::move(result));
+  return FromLimbs(AddLimbs(LimbsView(), b.LimbsView()));
 }
 
 namespace {
@@ -304,24 +583,14 @@ const bool addition_tests_registration =
 
 ValueOrError<BigInt> BigInt::operator-(BigInt b) && {
   if (*this < b) return Error{LazyString{L"Subtraction would underflow."}};
-
-  std::vector<Digit> output_digits;
-  int borrow = 0;
-  for (size_t i = 0; i < digits.size(); ++i) {
-    Digit a_digit = i < digits.size() ? digits[i] : 0;
-    Digit b_digit = i < b.digits.size() ? b.digits[i] : 0;
-    int diff = a_digit - b_digit - borrow;
-    if (diff < 0) {
-      diff += 10;
-      CHECK_GE(diff, 0);
-      borrow = 1;
-    } else {
-      borrow = 0;
-    }
-    output_digits.push_back(diff);
+  if (limbs.empty()) {
+    // Since `b` isn't larger than `*this`, it is also small.
+    small_value -= b.small_value;
+    return std::move(*this);
   }
-
-  return BigInt(std::move(output_digits));
+  std::vector<Limb> output = std::move(limbs);
+  SubtractInPlace(output, b.LimbsView());
+  return FromLimbs(std::move(output));
 }
 
 namespace {
@@ -365,22 +634,13 @@ const bool subtraction_tests_registration =
 }  // namespace
 
 BigInt BigInt::operator*(const BigInt& b) const {
-  std::vector<Digit> output_digits;
-  output_digits.resize(digits.size() + b.digits.size(), 0);
-
-  // Perform multiplication digit by digit:
-  for (size_t i = 0; i < digits.size(); ++i) {
-    for (size_t j = 0; j < b.digits.size(); ++j) {
-      int product = digits[i] * b.digits[j];
-      output_digits[i + j] += product;
-
-      for (size_t k = i + j; output_digits[k] >= 10; ++k) {  // Handle carry.
-        output_digits[k + 1] += output_digits[k] / 10;
-        output_digits[k] %= 10;
-      }
-    }
+  if (limbs.empty() && b.limbs.empty()) {
+    DoubleLimb product = DoubleLimb{small_value} * b.small_value;
+    if ((product >> 64) == 0) return FromNumber(static_cast<Limb>(product));
+    return FromLimbs(
+        {static_cast<Limb>(product), static_cast<Limb>(product >> 64)});
   }
-  return BigInt(std::move(output_digits));
+  return FromLimbs(MultiplyLimbs(LimbsView(), b.LimbsView()));
 }
 
 namespace {
@@ -415,13 +675,25 @@ const bool multiplication_tests_registration =
                ValueOrDie(BigInt::FromString(L"2")) +
                    ValueOrDie(BigInt::FromString(L"3")),
                L"25"),
-
+          test(L"Karatsuba",
+               ValueOrDie(BigInt::FromString(std::wstring(2000, L'9'))),
+               ValueOrDie(BigInt::FromString(std::wstring(2000, L'9'))),
+               std::wstring(1999, L'9') + L"8" + std::wstring(1999, L'0') +
+                   L"1"),
+          test(L"KaratsubaUnbalanced",
+               ValueOrDie(BigInt::FromString(std::wstring(5000, L'9'))),
+               ValueOrDie(BigInt::FromString(std::wstring(1000, L'9'))),
+               std::wstring(999, L'9') + L"8" + std::wstring(4000, L'9') +
+                   std::wstring(999, L'0') + L"1"),
       });
     }());
 }  // namespace
 
 BigInt& BigInt::operator++() {
-  *this = std::move(*this) + BigInt::FromNumber(1);
+  if (limbs.empty() && small_value < std::numeric_limits<Limb>::max())
+    ++small_value;
+  else
+    *this = std::move(*this) + BigInt::FromNumber(1);
   return *this;
 }
 
@@ -557,6 +829,17 @@ const bool big_int_divide_tests_registration =
                BigInt::FromNumber(3), BigInt::FromNumber(1)),
           test(L"DivisionByOne", BigInt::FromNumber(5), BigInt::FromNumber(1),
                BigInt::FromNumber(5), BigInt::FromNumber(0)),
+          test(L"LargeDivision",
+               ValueOrDie(BigInt::FromString(L"1" + std::wstring(2999, L'0') +
+                                             L"7")),
+               ValueOrDie(BigInt::FromString(L"1" + std::wstring(1500, L'0'))),
+               ValueOrDie(BigInt::FromString(L"1" + std::wstring(1500, L'0'))),
+               BigInt::FromNumber(7)),
+          test(L"LargeDivisionRemainder",
+               ValueOrDie(BigInt::FromString(std::wstring(600, L'9'))),
+               ValueOrDie(BigInt::FromString(std::wstring(300, L'9') + L"8")),
+               ValueOrDie(BigInt::FromString(L"1" + std::wstring(299, L'0'))),
+               ValueOrDie(BigInt::FromString(L"1" + std::wstring(299, L'9')))),
           tests::Test{
               .name = L"ZeroDenominator",
               .callback =
@@ -568,31 +851,18 @@ const bool big_int_divide_tests_registration =
 }  // namespace
 
 BigIntDivideOutput Divide(BigInt numerator, NonZeroBigInt denominator) {
-  BigInt quotient;
-  BigInt current_dividend;
-
-  for (size_t i = 0; i < numerator.digits.size(); ++i) {
-    BigInt::Digit next = numerator.digits[numerator.digits.size() - 1 - i];
-    CHECK_LE(next, 9ul);
-    if (!current_dividend.digits.empty() || next != 0)
-      current_dividend.digits.insert(current_dividend.digits.begin(), next);
-
-    // Largest number such that denominator * x <= current_dividend:
-    size_t x = 0;
-    while (denominator.read() * BigInt::FromNumber(x + 1) <= current_dividend) {
-      ++x;
-      CHECK_LE(x, 10UL);
-    }
-
-    if (x > 0)
-      current_dividend = ValueOrDie(std::move(current_dividend) -
-                                    denominator.read() * BigInt::FromNumber(x));
-    CHECK_LE(x, 9ul);
-    quotient.digits.insert(quotient.digits.begin(), x);
-  }
-
-  return BigIntDivideOutput{.quotient = BigInt(std::move(quotient.digits)),
-                            .remainder = std::move(current_dividend)};
+  const BigInt& denominator_value = denominator.read();
+  if (numerator.limbs.empty() && denominator_value.limbs.empty())
+    return BigIntDivideOutput{
+        .quotient = BigInt::FromNumber(numerator.small_value /
+                                       denominator_value.small_value),
+        .remainder = BigInt::FromNumber(numerator.small_value %
+                                        denominator_value.small_value)};
+  LimbsDivideOutput output =
+      DivideLimbs(numerator.LimbsView(), denominator_value.LimbsView());
+  return BigIntDivideOutput{
+      .quotient = BigInt::FromLimbs(std::move(output.quotient)),
+      .remainder = BigInt::FromLimbs(std::move(output.remainder))};
 }
 
 const bool big_int_divide_nonzero_tests_registration =
@@ -669,12 +939,14 @@ const bool big_int_modulo_tests_registration =
 BigInt BigInt::Pow(BigInt exponent) && {
   BigInt base = std::move(*this);
   BigInt output = BigInt::FromNumber(1);
-  while (exponent > BigInt()) {
-    BigIntDivideOutput divide_result =
-        Divide(std::move(exponent), NonZeroBigInt::Constant<2>());
-    if (!divide_result.remainder.IsZero()) output = std::move(output) * base;
-    base = base * base;
-    exponent = std::move(divide_result.quotient);
+  std::span<const Limb> exponent_limbs = exponent.LimbsView();
+  const size_t bits = exponent_limbs.empty()
+                          ? 0
+                          : 64 * exponent_limbs.size() -
+                                std::countl_zero(exponent_limbs.back());
+  for (size_t bit = 0; bit < bits; ++bit) {
+    if ((exponent_limbs[bit / 64] >> (bit % 64)) & 1) output = output * base;
+    if (bit + 1 < bits) base = base * base;
   }
   return output;
 }
@@ -820,10 +1092,8 @@ const bool big_int_to_size_t_tests_registration =
 
 language::ValueOrError<double> BigInt::ToDouble() const {
   double value = 0;
-  for (double digit : digits | std::views::reverse) {
-    value *= 10;
-    value += digit;
-  }
+  for (Limb limb : LimbsView() | std::views::reverse)
+    value = std::ldexp(value, 64) + static_cast<double>(limb);
   return value;
 }
 
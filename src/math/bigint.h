@@ -1,8 +1,12 @@
 #ifndef __AFC_MATH_BIGINT_H__
 #define __AFC_MATH_BIGINT_H__
 
+#include <cstdint>
+#include <limits>
 #include <ranges>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "src/language/error/value_or_error.h"
@@ -20,13 +24,26 @@ BigIntDivideOutput Divide(BigInt numerator, NonZeroBigInt denominator);
 
 class BigInt {
  private:
+  // A decimal digit.
   using Digit = size_t;
-  std::vector<Digit> digits;  // Element 0 is the least significant digit.
+  // Numbers are represented in base 2^64.
+  using Limb = uint64_t;
+
+  // Values that fit in a single limb are stored in `small_value` (and `limbs`
+  // is empty), which avoids heap allocations for the most common case.
+  // Otherwise, `limbs` holds all the limbs (at least two): element 0 is the
+  // least significant limb and the last one is never zero.
+  Limb small_value = 0;
+  std::vector<Limb> limbs;
 
  public:
   BigInt() = default;
+  // Receives decimal digits. Element 0 is the least significant digit.
   BigInt(std::vector<Digit> digits_input);
+  BigInt(const BigInt&) = default;
+  BigInt(BigInt&&) = default;
   BigInt& operator=(const BigInt&) = default;
+  BigInt& operator=(BigInt&&) = default;
 
   static language::ValueOrError<BigInt> FromString(const std::wstring& input);
 
@@ -35,13 +52,11 @@ class BigInt {
 
   template <typename NumberType>
   static BigInt FromNumber(NumberType value) {
+    static_assert(sizeof(NumberType) <= sizeof(Limb));
     CHECK_GE(value, NumberType{0ul});
-    std::vector<Digit> digits;
-    do {
-      digits.push_back(value % 10);
-      value /= 10;
-    } while (value != 0);
-    return BigInt(std::move(digits));
+    BigInt output;
+    output.small_value = static_cast<Limb>(value);
+    return output;
   }
 
   bool IsZero() const;
@@ -68,6 +83,9 @@ class BigInt {
   language::ValueOrError<double> ToDouble() const;
 
  private:
+  static BigInt FromLimbs(std::vector<Limb> limbs);
+  std::span<const Limb> LimbsView() const;
+
   template <typename OutputType>
   language::ValueOrError<OutputType> ToNumber() const {
     return ToNumber<OutputType>(true);
@@ -75,13 +93,28 @@ class BigInt {
 
   template <typename OutputType>
   language::ValueOrError<OutputType> ToNumber(bool positive) const {
-    OutputType value = 0;
-    for (OutputType digit : digits | std::views::reverse) {
-      ASSIGN_OR_RETURN(value, (CheckedMultiply(value, 10)));
-      if (!positive) ASSIGN_OR_RETURN(digit, CheckedMultiply(digit, -1));
-      ASSIGN_OR_RETURN(value, CheckedAdd(value, digit));
+    static_assert(sizeof(OutputType) <= sizeof(Limb));
+    if (positive) {
+      if (limbs.empty() &&
+          small_value <=
+              static_cast<Limb>(std::numeric_limits<OutputType>::max()))
+        return static_cast<OutputType>(small_value);
+      return language::Error{language::lazy_string::LazyString{
+          L"Overflow: the resulting number can't be represented."}};
+    }
+    if constexpr (std::is_signed_v<OutputType>) {
+      // The magnitude of `std::numeric_limits<OutputType>::min()`.
+      const Limb limit =
+          static_cast<Limb>(std::numeric_limits<OutputType>::max()) + 1;
+      if (limbs.empty() && small_value <= limit)
+        return small_value == limit
+                   ? std::numeric_limits<OutputType>::min()
+                   : -static_cast<OutputType>(small_value);
+    } else if (limbs.empty() && small_value == 0) {
+      return OutputType{0};
     }
-    return value;
+    return language::Error{language::lazy_string::LazyString{
+        L"Overflow: the resulting number can't be represented."}};
   }
 };
 
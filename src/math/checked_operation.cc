@@ -68,4 +68,32 @@ const bool multiplication_tests_registration =
                      std::numeric_limits<int32_t>::min(), -1, 0, true),
       });
     }());
+
+const bool subtraction_tests_registration =
+    tests::Register(L"math::numbers::CheckedSubtract", [] {
+      auto test = [](std::wstring name, int64_t input1, int64_t input2,
+                     int64_t expectation, bool expect_error = false) {
+        return tests::Test{
+            .name = name,
+            .callback = [input1, input2, expectation, expect_error] mutable {
+              auto result = CheckedSubtract<int64_t, int64_t>(input1, input2);
+              if (expect_error) {
+                CHECK(IsError(result));
+              } else {
+                CHECK_EQ(ValueOrDie(std::move(result)), expectation);
+              }
+            }};
+      };
+      return std::vector<tests::Test>({
+          test(L"Positive", 456, 123, 333),
+          test(L"NegativeResult", 123, 456, -333),
+          test(L"SubtractNegative", 123, -456, 579),
+          test(L"Min", std::numeric_limits<int64_t>::min() + 1, 1,
+               std::numeric_limits<int64_t>::min()),
+          test(L"Underflow", std::numeric_limits<int64_t>::min(), 1, 0, true),
+          test(L"Overflow", std::numeric_limits<int64_t>::max(), -1, 0, true),
+          test(L"ZeroMinusMin", 0, std::numeric_limits<int64_t>::min(), 0,
+               true),
+      });
+    }());
 }  // namespace afc::math::numbers
@@ -14,6 +14,15 @@ language::ValueOrError<A> CheckedAdd(A a, B b) {
   return a + b;
 }
 
+template <typename A, typename B>
+language::ValueOrError<A> CheckedSubtract(A a, B b) {
+  if (b >= B() ? std::numeric_limits<A>::min() + b > a
+               : std::numeric_limits<A>::max() + b < a)
+    return language::Error{language::lazy_string::LazyString{
+        L"Overflow: the resulting number can't be represented."}};
+  return a - b;
+}
+
 template <typename A, typename B>
 language::ValueOrError<A> CheckedMultiply(A a, B b) {
   static_assert(std::is_integral<A>::value,
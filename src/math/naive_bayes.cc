@@ -92,19 +92,23 @@ auto TransformValues(const Container& container, Callable callable) {
 }
 
 // Returns the probability of each event in history.
-EventProbabilityMap GetEventProbability(const History& history) {
+EventProbabilityMap GetEventProbability(const HistoryView& history) {
   size_t count = 0;
-  for (const std::vector<FeaturesSet>& instances : std::views::values(history))
-    count += instances.size();
+  for (const std::vector<FeaturesSet>* instances : std::views::values(history))
+    count += instances->size();
 
   return EventProbabilityMap(TransformValues(
       history,
-      [&count](const Event&, const std::vector<FeaturesSet>& instances) {
+      [&count](const Event&, const std::vector<FeaturesSet>* instances) {
         return ValueOrDie(
-            Probability::New(static_cast<double>(instances.size()) / count));
+            Probability::New(static_cast<double>(instances->size()) / count));
       }));
 }
 
+EventProbabilityMap GetEventProbability(const History& history) {
+  return GetEventProbability(NewHistoryView(history));
+}
+
 const bool get_probability_of_event_tests_registration =
     tests::Register(L"GetEventProbability", [] {
       Event e0{LazyString{L"e0"}}, e1{LazyString{L"e1"}}, e2{LazyString{L"e2"}};
@@ -242,8 +246,21 @@ const bool minimal_feature_probability_tests_registration = tests::Register(
       }}});
 }  // namespace
 
+HistoryView NewHistoryView(const History& history) {
+  HistoryView output;
+  for (const auto& [event, instances] : history)
+    output[event] = &instances;
+  return output;
+}
+
 std::vector<Event> Sort(const History& history,
                         const FeaturesSet& current_features) {
+  return Sort(NewHistoryView(history), current_features);
+}
+
+std::vector<Event> Sort(const HistoryView& history,
+                        const FeaturesSet& current_features,
+                        const std::function<bool()>& aborted) {
   // Let F = f₀, f₁, ..., fₙ be the set of current features. We'd like to
   // compute the probability of each event eᵢ in history given current_features:
   // p(eᵢ | F).
@@ -290,11 +307,18 @@ std::vector<Event> Sort(const History& history,
 
   // probability_of_feature_given_event[eᵢ][fⱼ] represents a value p(fⱼ | eᵢ):
   // the probability of fⱼ given eᵢ.
-  const std::unordered_map<Event, FeatureProbabilityMap>
-      probability_of_feature_given_event = TransformValues(
-          history, [](const Event&, const std::vector<FeaturesSet>& instances) {
-            return GetFeatureProbability(instances);
-          });
+  //
+  // This is the bulk of the work, so we check `aborted` as we compute it (but
+  // only every few events, since checking it may be expensive).
+  static constexpr size_t kEventsPerAbortCheck = 64;
+  std::unordered_map<Event, FeatureProbabilityMap>
+      probability_of_feature_given_event;
+  size_t events_processed = 0;
+  for (const auto& [event, instances] : history) {
+    if (events_processed++ % kEventsPerAbortCheck == 0 && aborted()) return {};
+    probability_of_feature_given_event.insert(
+        {event, GetFeatureProbability(*instances)});
+  }
 
   const Probability epsilon = ValueOrDie(
       MinimalFeatureProbability(probability_of_feature_given_event) / 2);
@@ -338,6 +362,16 @@ const bool bayes_sort_tests_probability_tests_registration =
                [=] {
                  CHECK_EQ(Sort(History(), FeaturesSet{{f1, f2}}).size(), 0ul);
                }},
+          {.name = L"Aborted",
+           .callback =
+               [=] {
+                 History history;
+                 history[e0] = {FeaturesSet{{f1}}};
+                 history[e1] = {FeaturesSet{{f2}}};
+                 CHECK(Sort(NewHistoryView(history), FeaturesSet{{f1}}, [] {
+                         return true;
+                       }).empty());
+               }},
           {.name = L"EmptyFeatures",
            .callback =
                [=] {
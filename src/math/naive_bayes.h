@@ -1,3 +1,7 @@
+#ifndef __AFC_MATH_NAIVE_BAYES_H__
+#define __AFC_MATH_NAIVE_BAYES_H__
+
+#include <functional>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -41,11 +45,31 @@ class History
   using GhostType::GhostType;
 };
 
+// Like `History`, but only references the sets of features of each event
+// (which must outlive it). Allows callers that already keep the features
+// elsewhere to avoid copying them.
+class HistoryView
+    : public language::GhostType<
+          HistoryView,
+          std::unordered_map<Event, const std::vector<FeaturesSet>*>> {
+  using GhostType::GhostType;
+};
+
+HistoryView NewHistoryView(const History& history);
+
 // Given the history of all past executions of all events and the current state,
 // apply Naive Bayes to sort all events by their predicted proportional
 // probability (in ascending order).
 //
-// The returned vector contains the keys of `history`.
+// The returned vector contains the keys of `history`. `aborted` is checked
+// periodically; once it returns true, the sort stops and returns an empty
+// vector.
+std::vector<Event> Sort(
+    const HistoryView& history, const FeaturesSet& current_features,
+    const std::function<bool()>& aborted = [] { return false; });
+
 std::vector<Event> Sort(const History& history,
                         const FeaturesSet& current_features);
 }  // namespace afc::math::naive_bayes
+
+#endif  // __AFC_MATH_NAIVE_BAYES_H__
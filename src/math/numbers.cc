@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <cmath>
 #include <limits>
 #include <ranges>
 
@@ -18,6 +19,7 @@
 namespace container = afc::language::container;
 
 using afc::language::Error;
+using afc::language::IsError;
 using afc::language::MakeNonNullShared;
 using afc::language::overload;
 using afc::language::ValueOrDie;
@@ -30,98 +32,200 @@ using afc::language::lazy_string::StartsWith;
 namespace afc::math::numbers {
 using ::operator<<;
 
-Number Number::operator+(Number other) && {
-  if (!positive_ && !other.positive_)
-    return (std::move(*this).Negate() + std::move(other).Negate()).Negate();
-  if (!positive_) return std::move(other) - std::move(*this).Negate();
-  if (!other.positive_) return std::move(*this) - std::move(other).Negate();
+Number::Number(bool positive, BigInt numerator, NonZeroBigInt denominator)
+    : Number(Rational{.positive = positive,
+                      .numerator = std::move(numerator),
+                      .denominator = std::move(denominator)}) {}
+
+Number::Number(Rational value) : value_(int64_t{0}) {
+  if (value.numerator.IsZero()) return;
+  if (value.denominator.read() == BigInt::FromNumber(1))
+    if (ValueOrError<int64_t> integer =
+            value.numerator.ToInt64(value.positive);
+        !IsError(integer)) {
+      value_ = ValueOrDie(std::move(integer));
+      return;
+    }
+  value_ = std::move(value);
+}
+
+Number::Rational Number::ToRational() const& {
+  return std::visit(
+      overload{[](int64_t value) {
+                 // We can't represent abs(std::numeric_limits<int64_t>::min())
+                 // as an int64_t, so we handle this case explicitly.
+                 return Rational{
+                     .positive = value >= 0,
+                     .numerator = BigInt::FromNumber<uint64_t>(
+                         value == std::numeric_limits<int64_t>::min()
+                             ? static_cast<uint64_t>(-(value + 1)) + 1
+                             : static_cast<uint64_t>(std::abs(value))),
+                     .denominator = NonZeroBigInt::Constant<1>()};
+               },
+               [](const Rational& value) { return value; }},
+      value_);
+}
+
+Number::Rational Number::ToRational() && {
+  if (Rational* value = std::get_if<Rational>(&value_); value != nullptr)
+    return std::move(*value);
+  return ToRational();
+}
 
-  BigInt new_numerator = std::move(numerator_) * other.denominator_.read() +
-                         denominator_.read() * std::move(other.numerator_);
+template <typename Operation>
+/* static */ std::optional<Number> Number::IntegerOperation(
+    const Number& a, const Number& b, Operation operation) {
+  const int64_t* a_value = std::get_if<int64_t>(&a.value_);
+  const int64_t* b_value = std::get_if<int64_t>(&b.value_);
+  if (a_value == nullptr || b_value == nullptr) return std::nullopt;
+  ValueOrError<int64_t> output = operation(*a_value, *b_value);
+  if (IsError(output)) return std::nullopt;
+  return Number(ValueOrDie(std::move(output)));
+}
+
+/* static */ Number::Rational Number::Add(Rational a, Rational b) {
+  if (!a.positive && !b.positive)
+    return Negate(Add(Negate(std::move(a)), Negate(std::move(b))));
+  if (!a.positive) return Subtract(std::move(b), Negate(std::move(a)));
+  if (!b.positive) return Subtract(std::move(a), Negate(std::move(b)));
+
+  BigInt new_numerator = std::move(a.numerator) * b.denominator.read() +
+                         a.denominator.read() * std::move(b.numerator);
   NonZeroBigInt new_denominator =
-      std::move(denominator_) * std::move(other.denominator_);
-  return Number(true, std::move(new_numerator), std::move(new_denominator));
+      std::move(a.denominator) * std::move(b.denominator);
+  return Rational{.positive = true,
+                  .numerator = std::move(new_numerator),
+                  .denominator = std::move(new_denominator)};
 }
 
-Number Number::operator-(Number other) && {
-  if (!positive_ && !other.positive_)
-    return (std::move(*this).Negate() - std::move(other).Negate()).Negate();
-  if (!positive_)
-    return (std::move(*this).Negate() + std::move(other)).Negate();
-  if (!other.positive_) return std::move(*this) + std::move(other);
-
-  BigInt a = std::move(numerator_) * other.denominator_.read();
-  BigInt b = std::move(other.numerator_) * denominator_.read();
-  BigInt new_numerator = ValueOrDie(a >= b ? std::move(a) - std::move(b)
-                                           : std::move(b) - std::move(a));
+/* static */ Number::Rational Number::Subtract(Rational a, Rational b) {
+  if (!a.positive && !b.positive)
+    return Negate(Subtract(Negate(std::move(a)), Negate(std::move(b))));
+  if (!a.positive) return Negate(Add(Negate(std::move(a)), std::move(b)));
+  if (!b.positive) return Add(std::move(a), Negate(std::move(b)));
+
+  BigInt a_scaled = std::move(a.numerator) * b.denominator.read();
+  BigInt b_scaled = std::move(b.numerator) * a.denominator.read();
+  const bool positive = a_scaled >= b_scaled;
+  BigInt new_numerator =
+      ValueOrDie(positive ? std::move(a_scaled) - std::move(b_scaled)
+                          : std::move(b_scaled) - std::move(a_scaled));
   NonZeroBigInt new_denominator =
-      std::move(denominator_) * std::move(other.denominator_);
-  return Number(a >= b, std::move(new_numerator), std::move(new_denominator));
+      std::move(a.denominator) * std::move(b.denominator);
+  return Rational{.positive = positive,
+                  .numerator = std::move(new_numerator),
+                  .denominator = std::move(new_denominator)};
 }
 
-Number Number::operator*(Number other) && {
-  BigInt new_numerator = std::move(numerator_) * std::move(other.numerator_);
+/* static */ Number::Rational Number::Multiply(Rational a, Rational b) {
+  BigInt new_numerator = std::move(a.numerator) * std::move(b.numerator);
   NonZeroBigInt new_denominator =
-      std::move(denominator_) * std::move(other.denominator_);
-  return Number(positive_ == other.positive_, std::move(new_numerator),
-                std::move(new_denominator));
+      std::move(a.denominator) * std::move(b.denominator);
+  return Rational{.positive = a.positive == b.positive,
+                  .numerator = std::move(new_numerator),
+                  .denominator = std::move(new_denominator)};
+}
+
+/* static */ Number::Rational Number::Negate(Rational a) {
+  a.positive = !a.positive;
+  return a;
+}
+
+Number Number::operator+(Number other) && {
+  if (std::optional<Number> output =
+          IntegerOperation(*this, other, CheckedAdd<int64_t, int64_t>);
+      output.has_value())
+    return *std::move(output);
+  return Number(
+      Add(std::move(*this).ToRational(), std::move(other).ToRational()));
+}
+
+Number Number::operator-(Number other) && {
+  if (std::optional<Number> output =
+          IntegerOperation(*this, other, CheckedSubtract<int64_t, int64_t>);
+      output.has_value())
+    return *std::move(output);
+  return Number(
+      Subtract(std::move(*this).ToRational(), std::move(other).ToRational()));
+}
+
+Number Number::operator*(Number other) && {
+  if (std::optional<Number> output =
+          IntegerOperation(*this, other, CheckedMultiply<int64_t, int64_t>);
+      output.has_value())
+    return *std::move(output);
+  return Number(
+      Multiply(std::move(*this).ToRational(), std::move(other).ToRational()));
 }
 
 ValueOrError<Number> Number::operator/(Number other) && {
+  if (std::optional<Number> output = IntegerOperation(
+          *this, other,
+          [](int64_t a, int64_t b) -> ValueOrError<int64_t> {
+            // Only handle exact divisions; everything else (including
+            // division by zero) falls back to the general case.
+            if (b == 0 ||
+                (b == -1 && a == std::numeric_limits<int64_t>::min()) ||
+                a % b != 0)
+              return Error{LazyString{L"Inexact division."}};
+            return a / b;
+          });
+      output.has_value())
+    return *std::move(output);
   DECLARE_OR_RETURN(Number reciprocal, std::move(other).Reciprocal());
   return std::move(*this) * std::move(reciprocal);
 }
 
 Number Number::Negate() && {
-  return Number(!positive_, std::move(numerator_), std::move(denominator_));
+  if (const int64_t* value = std::get_if<int64_t>(&value_);
+      value != nullptr && *value != std::numeric_limits<int64_t>::min())
+    return Number(-*value);
+  return Number(Negate(std::move(*this).ToRational()));
 }
 
 ValueOrError<Number> Number::Reciprocal() && {
+  Rational value = std::move(*this).ToRational();
   return std::visit(
       overload{[](Error) -> ValueOrError<Number> {
                  return Error{LazyString{L"Zero has no reciprocal."}};
                },
                [&](NonZeroBigInt new_denominator) -> ValueOrError<Number> {
-                 return Number{positive_, std::move(denominator_).read(),
+                 return Number{value.positive,
+                               std::move(value.denominator).read(),
                                std::move(new_denominator)};
                }},
-      NonZeroBigInt::New(std::move(numerator_)));
+      NonZeroBigInt::New(std::move(value.numerator)));
 }
 
 void Number::Optimize() {
-  std::visit(
-      overload{[&](Error) {
-                 CHECK(numerator_.IsZero());
-                 denominator_ = NonZeroBigInt::Constant<1>();
-               },
-               [&](NonZeroBigInt non_zero_numerator) {
-                 NonZeroBigInt gcd =
-                     non_zero_numerator.GreatestCommonDivisor(denominator_);
-                 {
-                   BigIntDivideOutput divided_numerator =
-                       Divide(std::move(non_zero_numerator).read(), gcd);
-                   CHECK(divided_numerator.remainder.IsZero());
-                   numerator_ = divided_numerator.quotient;
-                 }
-                 {
-                   BigIntDivideOutput divided_denominator =
-                       Divide(std::move(denominator_).read(), gcd);
-                   CHECK(divided_denominator.remainder.IsZero());
-                   // TODO(2024-04-09, P2): Find a way to use types to
-                   // avoid this ValueOrDie:
-                   denominator_ = ValueOrDie(
-                       NonZeroBigInt::New(divided_denominator.quotient));
-                 }
-               }},
-      NonZeroBigInt::New(std::move(numerator_)));
+  Rational* value = std::get_if<Rational>(&value_);
+  if (value == nullptr) return;
+  // Since `value` isn't demoted, its numerator isn't zero.
+  NonZeroBigInt numerator = ValueOrDie(NonZeroBigInt::New(value->numerator));
+  NonZeroBigInt gcd = numerator.GreatestCommonDivisor(value->denominator);
+  BigIntDivideOutput divided_numerator =
+      Divide(std::move(numerator).read(), gcd);
+  CHECK(divided_numerator.remainder.IsZero());
+  BigIntDivideOutput divided_denominator =
+      Divide(std::move(value->denominator).read(), gcd);
+  CHECK(divided_denominator.remainder.IsZero());
+  // TODO(2024-04-09, P2): Find a way to use types to avoid this ValueOrDie:
+  *this = Number(value->positive, std::move(divided_numerator.quotient),
+                 ValueOrDie(NonZeroBigInt::New(
+                     std::move(divided_denominator.quotient))));
 }
 
 std::wstring Number::ToString(size_t maximum_decimal_digits) const {
+  if (const int64_t* value = std::get_if<int64_t>(&value_); value != nullptr)
+    return std::to_wstring(*value);
+
+  const Rational& rational = std::get<Rational>(value_);
   BigInt scaled_numerator =
-      BigInt(numerator_) * BigInt::FromNumber(10).Pow(
-                               BigInt::FromNumber(maximum_decimal_digits + 1));
+      BigInt(rational.numerator) *
+      BigInt::FromNumber(10).Pow(
+          BigInt::FromNumber(maximum_decimal_digits + 1));
   BigIntDivideOutput divide_output =
-      Divide(std::move(scaled_numerator), denominator_);
+      Divide(std::move(scaled_numerator), rational.denominator);
   bool exact = divide_output.remainder.IsZero();
 
   // Rounding.
@@ -144,7 +248,7 @@ std::wstring Number::ToString(size_t maximum_decimal_digits) const {
   }
   if (output.empty() || output.front() == L'.')
     output.insert(output.begin(), L'0');
-  if (!positive_) output.insert(output.begin(), L'-');
+  if (!rational.positive) output.insert(output.begin(), L'-');
   return output;
 }
 
@@ -210,29 +314,99 @@ const bool operator_divide_tests_registration = tests::Register(
                       Number::FromInt64(1024))
                          .ToString(5) == L"341.33333");
              }},
+        {.name = L"ExactIntegers",
+         .callback =
+             [] {
+               CHECK_EQ(ValueOrDie(ValueOrDie(Number::FromInt64(-1024) /
+                                              Number::FromInt64(8))
+                                       .ToInt64()),
+                        -128);
+             }},
+        {.name = L"MinByMinusOne",
+         .callback =
+             [] {
+               CHECK(ValueOrDie(Number::FromInt64(
+                                    std::numeric_limits<int64_t>::min()) /
+                                Number::FromInt64(-1))
+                         .ToString(0) == L"9223372036854775808");
+             }},
+        {.name = L"ByZero",
+         .callback =
+             [] {
+               CHECK(IsError(Number::FromInt64(5) / Number::FromInt64(0)));
+             }},
     });
+
+const bool integer_overflow_tests_registration = tests::Register(
+    L"numbers::Number::IntegerOverflow",
+    {{.name = L"Addition",
+      .callback =
+          [] {
+            Number value =
+                Number::FromInt64(std::numeric_limits<int64_t>::max()) +
+                Number::FromInt64(1);
+            CHECK(value.ToString(0) == L"9223372036854775808");
+            // Goes back to the unboxed representation.
+            CHECK_EQ(ValueOrDie((std::move(value) - Number::FromInt64(2))
+                                    .ToInt64()),
+                     std::numeric_limits<int64_t>::max() - 1);
+          }},
+     {.name = L"Subtraction",
+      .callback =
+          [] {
+            CHECK((Number::FromInt64(std::numeric_limits<int64_t>::min()) -
+                   Number::FromInt64(1))
+                      .ToString(0) == L"-9223372036854775809");
+          }},
+     {.name = L"Multiplication",
+      .callback =
+          [] {
+            CHECK((Number::FromInt64(std::numeric_limits<int64_t>::max()) *
+                   Number::FromInt64(-2))
+                      .ToString(0) == L"-18446744073709551614");
+          }},
+     {.name = L"Negate",
+      .callback =
+          [] {
+            CHECK(Number::FromInt64(std::numeric_limits<int64_t>::min())
+                      .Negate()
+                      .ToString(0) == L"9223372036854775808");
+          }},
+     {.name = L"SubtractNegativeFraction",
+      .callback =
+          [] {
+            CHECK((Number::FromDouble(0.5) - Number::FromDouble(-0.25))
+                      .ToString(2) == L"0.75");
+          }},
+     {.name = L"FractionToInteger", .callback = [] {
+        CHECK_EQ(ValueOrDie((Number::FromDouble(0.5) + Number::FromDouble(1.5))
+                                .ToInt64()),
+                 2);
+      }}});
 }  // namespace
 
 /* static */ Number Number::FromBigInt(BigInt value) {
   return Number(true, std::move(value), NonZeroBigInt::Constant<1>());
 }
 
-/* static */ Number Number::FromInt64(int64_t value) {
-  // We can't represent abs(std::numeric_limits<int64_t>::min()) as an
-  // int64_t, so we handle this case explicitly.
-  BigInt numerator = BigInt::FromNumber<uint64_t>(
-      value == std::numeric_limits<int64_t>::min()
-          ? static_cast<uint64_t>(-(value + 1)) + 1
-          : static_cast<uint64_t>(std::abs(value)));
-  static NonZeroBigInt denominator = NonZeroBigInt::Constant<1>();
-  return Number(value >= 0, std::move(numerator), denominator);
-}
+/* static */ Number Number::FromInt64(int64_t value) { return Number(value); }
 
 afc::language::ValueOrError<int32_t> Number::ToInt32() const {
-  if (BigIntDivideOutput tmp = Divide(numerator_, denominator_);
+  if (const int64_t* value = std::get_if<int64_t>(&value_); value != nullptr) {
+    if (*value > std::numeric_limits<int32_t>::max() ||
+        *value < std::numeric_limits<int32_t>::min())
+      return Error{LazyString{
+          L"Overflow: the resulting number can't be represented."}};
+    return static_cast<int32_t>(*value);
+  }
+
+  // Since `value_` isn't demoted, the number is either fractional or too large.
+  const Rational& rational = std::get<Rational>(value_);
+  if (BigIntDivideOutput tmp = Divide(rational.numerator, rational.denominator);
       tmp.remainder.IsZero()) {
     DECLARE_OR_RETURN(int32_t abs_value, tmp.quotient.ToInt32());
-    return CheckedMultiply<int32_t, int32_t>(abs_value, positive_ ? 1 : -1);
+    return CheckedMultiply<int32_t, int32_t>(abs_value,
+                                             rational.positive ? 1 : -1);
   }
 
   return Error{
@@ -241,9 +415,13 @@ afc::language::ValueOrError<int32_t> Number::ToInt32() const {
 }
 
 afc::language::ValueOrError<int64_t> Number::ToInt64() const {
-  if (BigIntDivideOutput tmp = Divide(numerator_, denominator_);
+  if (const int64_t* value = std::get_if<int64_t>(&value_); value != nullptr)
+    return *value;
+
+  const Rational& rational = std::get<Rational>(value_);
+  if (BigIntDivideOutput tmp = Divide(rational.numerator, rational.denominator);
       tmp.remainder.IsZero())
-    return tmp.quotient.ToInt64(positive_);
+    return tmp.quotient.ToInt64(rational.positive);
 
   return Error{
       LazyString{L"Inexact: Number can't be represented as int64_t: fractional "
@@ -308,11 +486,19 @@ const bool int_tests_registration = tests::Register(
 }  // namespace
 
 afc::language::ValueOrError<size_t> Number::ToSizeT() const {
-  if (!positive_)
+  if (const int64_t* value = std::get_if<int64_t>(&value_); value != nullptr) {
+    if (*value < 0)
+      return Error{
+          LazyString{L"Negative: Number can't be represented as size_t."}};
+    return static_cast<size_t>(*value);
+  }
+
+  const Rational& rational = std::get<Rational>(value_);
+  if (!rational.positive)
     return Error{
         LazyString{L"Negative: Number can't be represented as size_t."}};
 
-  if (BigIntDivideOutput tmp = Divide(numerator_, denominator_);
+  if (BigIntDivideOutput tmp = Divide(rational.numerator, rational.denominator);
       tmp.remainder.IsZero())
     return tmp.quotient.ToSizeT();
 
@@ -357,9 +543,14 @@ const bool to_size_t_tests_registration = tests::Register(
       }}});
 
 ValueOrError<double> Number::ToDouble() const {
-  DECLARE_OR_RETURN(double numerator_double, numerator_.ToDouble());
-  DECLARE_OR_RETURN(double denominator_double, denominator_.read().ToDouble());
-  return numerator_double / denominator_double;
+  if (const int64_t* value = std::get_if<int64_t>(&value_); value != nullptr)
+    return static_cast<double>(*value);
+
+  const Rational& rational = std::get<Rational>(value_);
+  DECLARE_OR_RETURN(double numerator_double, rational.numerator.ToDouble());
+  DECLARE_OR_RETURN(double denominator_double,
+                    rational.denominator.read().ToDouble());
+  return (rational.positive ? 1 : -1) * numerator_double / denominator_double;
 }
 
 const bool to_double_tests_registration = tests::Register(
@@ -375,16 +566,7 @@ const bool to_double_tests_registration = tests::Register(
       }}});
 
 Number Number::FromSizeT(size_t value) {
-  const int base = 65536;  // 2^16
-  Number result = FromInt64(0);
-  Number multiplier = FromInt64(1);
-  while (value != 0) {
-    int chunk = value % base;
-    result = std::move(result) + FromInt64(chunk) * multiplier;
-    value /= base;
-    multiplier = std::move(multiplier) * FromInt64(base);
-  }
-  return result;
+  return FromBigInt(BigInt::FromNumber(value));
 }
 
 const bool from_size_t_tests_registration = tests::Register(
@@ -409,6 +591,11 @@ const bool from_size_t_tests_registration = tests::Register(
     });
 
 Number Number::FromDouble(double value) {
+  // The range check must be done on doubles: 2^63 is exactly representable
+  // (unlike `std::numeric_limits<int64_t>::max()`).
+  if (std::trunc(value) == value && value >= -0x1p63 && value < 0x1p63)
+    return Number(static_cast<int64_t>(value));
+
   union DoubleIntUnion {
     double dvalue;
     int64_t ivalue;
@@ -450,18 +637,27 @@ const bool from_double_tests_registration = tests::Register(
       }}});
 
 Number Number::Pow(BigInt exponent) && {
-  return Number(positive_ || (exponent % NonZeroBigInt::Constant<2>()).IsZero(),
-                std::move(numerator_).Pow(BigInt(exponent)),
-                std::move(denominator_).Pow(BigInt(exponent)));
+  Rational value = std::move(*this).ToRational();
+  return Number(
+      value.positive || (exponent % NonZeroBigInt::Constant<2>()).IsZero(),
+      std::move(value.numerator).Pow(BigInt(exponent)),
+      std::move(value.denominator).Pow(BigInt(exponent)));
 }
 
 std::strong_ordering Number::operator<=>(const Number& other) const {
-  if (!positive_ && !other.positive_)
-    return Number{other}.Negate() <=> Number{*this}.Negate();
-  if (!other.positive_) return std::strong_ordering::greater;
-  if (!positive_) return std::strong_ordering::less;
-  return numerator_ * other.denominator_.read() <=>
-         other.numerator_ * denominator_.read();
+  const int64_t* value = std::get_if<int64_t>(&value_);
+  const int64_t* other_value = std::get_if<int64_t>(&other.value_);
+  if (value != nullptr && other_value != nullptr)
+    return *value <=> *other_value;
+
+  Rational a = ToRational();
+  Rational b = other.ToRational();
+  if (!a.positive && !b.positive)
+    return Number{Negate(std::move(b))} <=> Number{Negate(std::move(a))};
+  if (!b.positive) return std::strong_ordering::greater;
+  if (!a.positive) return std::strong_ordering::less;
+  return a.numerator * b.denominator.read() <=>
+         b.numerator * a.denominator.read();
 }
 
 bool Number::operator==(const Number& other) const {
@@ -2,7 +2,9 @@
 #define __AFC_MATH_NUMBERS_H__
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <variant>
 
 #include "src/language/error/value_or_error.h"
 #include "src/language/safe_types.h"
@@ -10,15 +12,39 @@
 
 namespace afc::math::numbers {
 class Number {
-  bool positive_;
-  BigInt numerator_;
-  NonZeroBigInt denominator_;
+  struct Rational {
+    bool positive;
+    BigInt numerator;
+    NonZeroBigInt denominator;
+  };
+
+  // Integers that fit in an `int64_t` are kept unboxed, which avoids the heap
+  // allocations (and the expensive arithmetic) of `Rational`. An operation on
+  // integers that overflows promotes its result to `Rational`; a `Rational`
+  // that is an integer that fits in an `int64_t` is always demoted.
+  std::variant<int64_t, Rational> value_;
+
+  explicit Number(int64_t value) : value_(value) {}
+  explicit Number(Rational value);
+
+  Rational ToRational() const&;
+  Rational ToRational() &&;
+
+  // If both `a` and `b` are unboxed and `operation` (which receives two
+  // `int64_t` values and returns a `ValueOrError<int64_t>`) succeeds, returns
+  // its result.
+  template <typename Operation>
+  static std::optional<Number> IntegerOperation(const Number& a,
+                                                const Number& b,
+                                                Operation operation);
+
+  static Rational Add(Rational a, Rational b);
+  static Rational Subtract(Rational a, Rational b);
+  static Rational Multiply(Rational a, Rational b);
+  static Rational Negate(Rational a);
 
  public:
-  Number(bool positive, BigInt numerator, NonZeroBigInt denominator)
-      : positive_(positive),
-        numerator_(std::move(numerator)),
-        denominator_(std::move(denominator)) {}
+  Number(bool positive, BigInt numerator, NonZeroBigInt denominator);
 
   Number operator+(Number other) &&;
   Number operator-(Number other) &&;
@@ -0,0 +1,337 @@
+#include "src/parsers/parse_cache.h"
+
+#include <glog/logging.h>
+#include <sys/stat.h>
+
+#include <limits>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/lazy_string/single_line.h"
+#include "src/language/overload.h"
+#include "src/language/wstring.h"
+#include "src/tests/tests.h"
+
+using afc::infrastructure::screen::kLineModifierCount;
+using afc::infrastructure::screen::LineModifier;
+using afc::infrastructure::screen::LineModifierSet;
+using afc::language::Error;
+using afc::language::FromByteString;
+using afc::language::IsError;
+using afc::language::overload;
+using afc::language::ValueOrDie;
+using afc::language::ValueOrError;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::LazyString;
+using afc::language::lazy_string::NonEmptySingleLine;
+using afc::language::lazy_string::SingleLine;
+
+namespace afc::editor::parsers {
+namespace {
+// Increase whenever the encoding changes.
+constexpr uint64_t kFormatVersion = 2;
+constexpr std::string_view kMagic = "edge-parse-cache";
+
+// Identifies the build of the running binary, so that caches produced by other
+// builds (in which the parsers may behave differently) are rejected. Based on
+// the size and modification time of the executable (or, if those can't be
+// read, on the time at which this file was compiled).
+const std::string& BuildRevision() {
+  static const std::string* const output = new std::string([] {
+    struct stat stat_buffer;
+    if (stat("/proc/self/exe", &stat_buffer) == -1) {
+      LOG(INFO) << "Unable to stat the executable; using compilation time.";
+      return std::string(__DATE__ " " __TIME__);
+    }
+    return std::to_string(stat_buffer.st_size) + ":" +
+           std::to_string(stat_buffer.st_mtim.tv_sec) + "." +
+           std::to_string(stat_buffer.st_mtim.tv_nsec);
+  }());
+  return *output;
+}
+
+enum class ActionTag : uint8_t {
+  kPush = 1,
+  kPop = 2,
+  kSetFirstChildModifiers = 3,
+};
+
+void AppendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+void AppendString(const std::string& value, std::string& output) {
+  AppendVarint(value.size(), output);
+  output += value;
+}
+
+void AppendModifiers(const LineModifierSet& modifiers, std::string& output) {
+  AppendVarint(modifiers.size(), output);
+  for (LineModifier modifier : modifiers)
+    output.push_back(static_cast<char>(modifier));
+}
+
+void AppendAction(const Action& action, std::string& output) {
+  std::visit(
+      overload{[&output](const ActionPush& push) {
+                 output.push_back(static_cast<char>(ActionTag::kPush));
+                 AppendVarint(push.column.read(), output);
+                 AppendModifiers(push.modifiers, output);
+                 AppendVarint(push.properties.size(), output);
+                 for (const ParseTreeProperty& property : push.properties)
+                   AppendString(property.read().read().read().ToBytes(),
+                                output);
+               },
+               [&output](const ActionPop& pop) {
+                 output.push_back(static_cast<char>(ActionTag::kPop));
+                 AppendVarint(pop.column.read(), output);
+               },
+               [&output](const ActionSetFirstChildModifiers& set) {
+                 output.push_back(
+                     static_cast<char>(ActionTag::kSetFirstChildModifiers));
+                 AppendModifiers(set.modifiers, output);
+               }},
+      action);
+}
+
+class Reader {
+ public:
+  explicit Reader(std::string_view input) : input_(input) {}
+
+  bool AtEnd() const { return position_ == input_.size(); }
+
+  ValueOrError<uint8_t> ReadByte() {
+    if (position_ >= input_.size()) return Error{LazyString{L"Truncated."}};
+    return static_cast<uint8_t>(input_[position_++]);
+  }
+
+  ValueOrError<uint64_t> ReadVarint() {
+    uint64_t output = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+      DECLARE_OR_RETURN(uint8_t byte, ReadByte());
+      output |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) return output;
+    }
+    return Error{LazyString{L"Varint is too long."}};
+  }
+
+  // Reads a count of elements, each of which takes at least one byte.
+  ValueOrError<size_t> ReadCount() {
+    DECLARE_OR_RETURN(uint64_t output, ReadVarint());
+    if (output > input_.size() - position_)
+      return Error{LazyString{L"Invalid count."}};
+    return output;
+  }
+
+  ValueOrError<std::string_view> ReadBytes(size_t length) {
+    if (length > input_.size() - position_)
+      return Error{LazyString{L"Truncated string."}};
+    std::string_view output = input_.substr(position_, length);
+    position_ += length;
+    return output;
+  }
+
+  ValueOrError<std::string> ReadString() {
+    DECLARE_OR_RETURN(size_t length, ReadCount());
+    DECLARE_OR_RETURN(std::string_view output, ReadBytes(length));
+    return std::string(output);
+  }
+
+  ValueOrError<LineModifierSet> ReadModifiers() {
+    DECLARE_OR_RETURN(size_t size, ReadCount());
+    LineModifierSet output;
+    for (size_t i = 0; i < size; i++) {
+      DECLARE_OR_RETURN(uint8_t value, ReadByte());
+      if (value >= kLineModifierCount)
+        return Error{LazyString{L"Invalid modifier."}};
+      output.insert(static_cast<LineModifier>(value));
+    }
+    return output;
+  }
+
+  ValueOrError<Action> ReadAction() {
+    DECLARE_OR_RETURN(uint8_t tag, ReadByte());
+    switch (static_cast<ActionTag>(tag)) {
+      case ActionTag::kPush: {
+        DECLARE_OR_RETURN(uint64_t column, ReadVarint());
+        DECLARE_OR_RETURN(LineModifierSet modifiers, ReadModifiers());
+        DECLARE_OR_RETURN(size_t properties_size, ReadCount());
+        std::unordered_set<ParseTreeProperty> properties;
+        for (size_t i = 0; i < properties_size; i++) {
+          DECLARE_OR_RETURN(std::string property, ReadString());
+          DECLARE_OR_RETURN(
+              ParseTreeProperty value,
+              ParseTreeProperty::New(NonEmptySingleLine::New(SingleLine::New(
+                  LazyString{FromByteString(property)}))));
+          properties.insert(std::move(value));
+        }
+        return ActionPush{.column = ColumnNumber(column),
+                          .modifiers = std::move(modifiers),
+                          .properties = std::move(properties)};
+      }
+      case ActionTag::kPop: {
+        DECLARE_OR_RETURN(uint64_t column, ReadVarint());
+        return ActionPop{.column = ColumnNumber(column)};
+      }
+      case ActionTag::kSetFirstChildModifiers: {
+        DECLARE_OR_RETURN(LineModifierSet modifiers, ReadModifiers());
+        return ActionSetFirstChildModifiers{.modifiers = std::move(modifiers)};
+      }
+    }
+    return Error{LazyString{L"Invalid action."}};
+  }
+
+ private:
+  const std::string_view input_;
+  size_t position_ = 0;
+};
+
+std::string SerializeParseCacheForBuild(const ParserId& parser_id,
+                                        const std::string& build_revision,
+                                        const ParseCacheEntries& entries) {
+  std::string output(kMagic);
+  AppendVarint(kFormatVersion, output);
+  AppendString(build_revision, output);
+  AppendString(parser_id.read().read().read().ToBytes(), output);
+  AppendVarint(entries.size(), output);
+  for (const auto& [hash, results] : entries) {
+    AppendVarint(hash, output);
+    AppendVarint(results.states_stack.size(), output);
+    for (size_t state : results.states_stack) AppendVarint(state, output);
+    AppendVarint(results.actions.size(), output);
+    for (const Action& action : results.actions) AppendAction(action, output);
+  }
+  return output;
+}
+
+ValueOrError<ParseCacheEntries> DeserializeParseCacheForBuild(
+    const ParserId& parser_id, const std::string& build_revision,
+    std::string_view input) {
+  Reader reader(input);
+  DECLARE_OR_RETURN(std::string_view magic, reader.ReadBytes(kMagic.size()));
+  if (magic != kMagic) return Error{LazyString{L"Invalid header."}};
+  DECLARE_OR_RETURN(uint64_t version, reader.ReadVarint());
+  if (version != kFormatVersion)
+    return Error{LazyString{L"Unsupported version."}};
+  DECLARE_OR_RETURN(std::string revision, reader.ReadString());
+  if (revision != build_revision)
+    return Error{LazyString{L"Produced by a different build."}};
+  DECLARE_OR_RETURN(std::string parser, reader.ReadString());
+  if (parser != parser_id.read().read().read().ToBytes())
+    return Error{LazyString{L"Produced by a different parser."}};
+
+  DECLARE_OR_RETURN(size_t size, reader.ReadCount());
+  ParseCacheEntries output;
+  output.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    DECLARE_OR_RETURN(uint64_t hash, reader.ReadVarint());
+    ParseResults results;
+    DECLARE_OR_RETURN(size_t states_size, reader.ReadCount());
+    for (size_t j = 0; j < states_size; j++) {
+      DECLARE_OR_RETURN(uint64_t state, reader.ReadVarint());
+      results.states_stack.push_back(state);
+    }
+    DECLARE_OR_RETURN(size_t actions_size, reader.ReadCount());
+    for (size_t j = 0; j < actions_size; j++) {
+      DECLARE_OR_RETURN(Action action, reader.ReadAction());
+      results.actions.push_back(std::move(action));
+    }
+    output.push_back({hash, std::move(results)});
+  }
+  if (!reader.AtEnd()) return Error{LazyString{L"Unexpected trailing data."}};
+  return output;
+}
+}  // namespace
+
+std::string SerializeParseCache(const ParserId& parser_id,
+                                const ParseCacheEntries& entries) {
+  TRACK_OPERATION(SerializeParseCache);
+  return SerializeParseCacheForBuild(parser_id, BuildRevision(), entries);
+}
+
+ValueOrError<ParseCacheEntries> DeserializeParseCache(
+    const ParserId& parser_id, std::string_view input) {
+  TRACK_OPERATION(DeserializeParseCache);
+  return DeserializeParseCacheForBuild(parser_id, BuildRevision(), input);
+}
+
+namespace {
+ParseCacheEntries TestEntries() {
+  return {{42,
+           ParseResults{
+               .states_stack = {0, 3},
+               .actions = {
+                   ActionPush{.column = ColumnNumber(1),
+                              .modifiers = {LineModifier::kBold},
+                              .properties = {ParseTreeProperty::Link()}},
+                   ActionSetFirstChildModifiers{
+                       .modifiers = {LineModifier::kRed}},
+                   ActionPop{.column = ColumnNumber(300)}}}},
+          {std::numeric_limits<size_t>::max(),
+           ParseResults{.states_stack = {0}}}};
+}
+
+const bool tests_registration = tests::Register(
+    L"ParseCache",
+    {{.name = L"RoundTrip",
+      .callback =
+          [] {
+            ParseCacheEntries output = ValueOrDie(DeserializeParseCache(
+                ParserId::Cpp(),
+                SerializeParseCache(ParserId::Cpp(), TestEntries())));
+            CHECK_EQ(output.size(), 2ul);
+            CHECK_EQ(output[0].first, 42ul);
+            CHECK(output[0].second.states_stack ==
+                  std::vector<size_t>({0, 3}));
+            CHECK_EQ(output[0].second.actions.size(), 3ul);
+            const ActionPush& push =
+                std::get<ActionPush>(output[0].second.actions[0]);
+            CHECK_EQ(push.column, ColumnNumber(1));
+            CHECK(push.modifiers == LineModifierSet{LineModifier::kBold});
+            CHECK(push.properties == std::unordered_set<ParseTreeProperty>{
+                                         ParseTreeProperty::Link()});
+            CHECK(std::get<ActionSetFirstChildModifiers>(
+                      output[0].second.actions[1])
+                      .modifiers == LineModifierSet{LineModifier::kRed});
+            CHECK_EQ(std::get<ActionPop>(output[0].second.actions[2]).column,
+                     ColumnNumber(300));
+            CHECK_EQ(output[1].first, std::numeric_limits<size_t>::max());
+            CHECK(output[1].second.states_stack == std::vector<size_t>({0}));
+            CHECK(output[1].second.actions.empty());
+          }},
+     {.name = L"DifferentParser",
+      .callback =
+          [] {
+            CHECK(IsError(DeserializeParseCache(
+                ParserId::Py(),
+                SerializeParseCache(ParserId::Cpp(), TestEntries()))));
+          }},
+     {.name = L"DifferentBuild",
+      .callback =
+          [] {
+            CHECK(IsError(DeserializeParseCacheForBuild(
+                ParserId::Cpp(), BuildRevision() + "-other",
+                SerializeParseCache(ParserId::Cpp(), TestEntries()))));
+          }},
+     {.name = L"Truncated",
+      .callback =
+          [] {
+            std::string input =
+                SerializeParseCache(ParserId::Cpp(), TestEntries());
+            for (size_t i = 0; i < input.size(); i++)
+              CHECK(IsError(DeserializeParseCache(
+                  ParserId::Cpp(), std::string_view(input).substr(0, i))));
+          }},
+     {.name = L"InvalidAction",
+      .callback = [] {
+        std::string input = SerializeParseCache(
+            ParserId::Cpp(), {{1, ParseResults{.actions = {ActionPop{}}}}});
+        input[input.size() - 2] = 17;  // The action's tag.
+        CHECK(IsError(DeserializeParseCache(ParserId::Cpp(), input)));
+      }}});
+}  // namespace
+}  // namespace afc::editor::parsers
@@ -0,0 +1,35 @@
+// Compact binary encoding of the results of parsing individual lines (with a
+// `LineOrientedTreeParser`), used to persist them across sessions.
+//
+// The output starts with a header identifying the format version, the build of
+// the binary and the parser (the parser's states, which the results contain,
+// are only meaningful for the build of the parser that produced them). The
+// entries follow. Integers are encoded
+// as (unsigned, LEB128) varints and strings as their length followed by their
+// UTF-8 bytes.
+#ifndef __AFC_EDITOR_PARSERS_PARSE_CACHE_H__
+#define __AFC_EDITOR_PARSERS_PARSE_CACHE_H__
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "src/language/error/value_or_error.h"
+#include "src/parse_tools.h"
+#include "src/parse_tree.h"
+
+namespace afc::editor::parsers {
+// The key is the hash that `LineOrientedTreeParser` uses to look up the
+// results of parsing a line.
+using ParseCacheEntries = std::vector<std::pair<size_t, ParseResults>>;
+
+std::string SerializeParseCache(const ParserId& parser_id,
+                                const ParseCacheEntries& entries);
+
+// Fails if `input` is invalid or was produced for a different parser (or by a
+// different build, or with a different version of the format).
+language::ValueOrError<ParseCacheEntries> DeserializeParseCache(
+    const ParserId& parser_id, std::string_view input);
+}  // namespace afc::editor::parsers
+#endif  // __AFC_EDITOR_PARSERS_PARSE_CACHE_H__
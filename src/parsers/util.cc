@@ -3,10 +3,13 @@
 #include "src/infrastructure/tracker.h"
 #include "src/language/hash.h"
 #include "src/language/lazy_string/functional.h"
+#include "src/parsers/parse_cache.h"
 
 using afc::infrastructure::screen::LineModifier;
 using afc::infrastructure::screen::LineModifierSet;
 using afc::language::NonNull;
+using afc::language::PossibleError;
+using afc::language::Success;
 using afc::language::container::MaterializeUnorderedSet;
 using afc::language::lazy_string::ColumnNumber;
 using afc::language::lazy_string::ColumnNumberDelta;
@@ -188,6 +191,10 @@ ParseTree LineOrientedTreeParser::FindChildren(const LineSequence& contents,
 
   range.ForEachLine([&](LineNumber i) {
     size_t hash = GetLineHash(contents.at(i).contents().read(), states_stack);
+    // The cache hits are the executions of this operation minus those of
+    // `LineOrientedTreeParser_FindChildren_Parse` (the misses).
+    auto cache_get_call =
+        INLINE_TRACKER(LineOrientedTreeParser_FindChildren_CacheGet);
     NonNull<const ParseResults*> parse_results = cache_.Get(hash, [&] {
       TRACK_OPERATION(LineOrientedTreeParser_FindChildren_Parse);
       ParseData data(contents, std::move(states_stack),
@@ -196,6 +203,7 @@ ParseTree LineOrientedTreeParser::FindChildren(const LineSequence& contents,
       ParseLine(&data);
       return data.parse_results();
     });
+    cache_get_call = nullptr;
 
     TRACK_OPERATION(LineOrientedTreeParser_FindChildren_ExecuteActions);
     CHECK(!trees.empty());
@@ -223,4 +231,26 @@ ParseTree LineOrientedTreeParser::FindChildren(const LineSequence& contents,
   return trees[0];
 }
 
+std::string LineOrientedTreeParser::SerializeCache(
+    const ParserId& parser_id) const {
+  TRACK_OPERATION(LineOrientedTreeParser_SerializeCache);
+  ParseCacheEntries entries;
+  cache_.ForEach([&entries](size_t hash, const ParseResults& results) {
+    entries.push_back({hash, results});
+  });
+  return SerializeParseCache(parser_id, entries);
+}
+
+PossibleError LineOrientedTreeParser::LoadCache(const ParserId& parser_id,
+                                                std::string_view input) {
+  TRACK_OPERATION(LineOrientedTreeParser_LoadCache);
+  DECLARE_OR_RETURN(ParseCacheEntries entries,
+                    DeserializeParseCache(parser_id, input));
+  // `FindChildren` will adjust it (based on the size of the file).
+  cache_.SetMaxSize(entries.size());
+  // Inserted in reverse, to preserve the order in which they were used.
+  for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    cache_.Get(it->first, [&it] { return std::move(it->second); });
+  return Success();
+}
 }  // namespace afc::editor::parsers
@@ -3,9 +3,11 @@
 
 #include <ostream>  // For operator<< overload
 
+#include "src/language/error/value_or_error.h"
 #include "src/language/lazy_string/single_line.h"
 #include "src/lru_cache.h"
 #include "src/parse_tools.h"
+#include "src/parse_tree.h"
 
 namespace afc::editor::parsers {
 
@@ -85,6 +87,15 @@ class LineOrientedTreeParser : public TreeParser {
   ParseTree FindChildren(const language::text::LineSequence& buffer,
                          language::text::Range range);
 
+  // Returns the contents of the cache of parsed lines, encoded with
+  // `SerializeParseCache`.
+  std::string SerializeCache(const ParserId& parser_id) const;
+
+  // Adds to the cache of parsed lines the entries in `input` (produced by
+  // `SerializeCache`).
+  language::PossibleError LoadCache(const ParserId& parser_id,
+                                    std::string_view input);
+
  protected:
   static constexpr size_t kDefaultState = 0;
   virtual void ParseLine(ParseData* result) = 0;
@@ -1,13 +1,18 @@
 #include "src/screen_vm.h"
 
+#include <fcntl.h>
 #include <glog/logging.h>
 
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "src/editor.h"
 #include "src/infrastructure/dirname_vm.h"
 #include "src/infrastructure/file_system_driver.h"
 #include "src/infrastructure/screen/screen.h"
+#include "src/infrastructure/screen/screen_protocol.h"
 #include "src/language/lazy_string/char_buffer.h"
 #include "src/language/safe_types.h"
 #include "src/language/text/line_column_vm.h"
@@ -24,7 +29,11 @@ using afc::infrastructure::Path;
 using afc::infrastructure::screen::LineModifier;
 using afc::infrastructure::screen::ModifierFromString;
 using afc::infrastructure::screen::Screen;
+using afc::infrastructure::screen::ScreenEncoder;
+using afc::language::EmptyValue;
 using afc::language::Error;
+using afc::language::FromByteString;
+using afc::language::IsError;
 using afc::language::MakeNonNullShared;
 using afc::language::MakeNonNullUnique;
 using afc::language::NonNull;
@@ -32,6 +41,7 @@ using afc::language::PossibleError;
 using afc::language::Success;
 using afc::language::ToByteString;
 using afc::language::ValueOrError;
+using afc::language::ValueOrDie;
 using afc::language::VisitPointer;
 using afc::language::lazy_string::ColumnNumberDelta;
 using afc::language::lazy_string::LazyString;
@@ -128,6 +138,121 @@ class ScreenVm : public Screen {
   LineColumnDelta size_ =
       LineColumnDelta(LineNumberDelta(25), ColumnNumberDelta(80));
 };
+
+enum class RemoteScreenProtocol { kVm, kBinary };
+
+// Returns the protocols in `protocols` (a comma-separated list of names) that
+// we support, preserving their order.
+ValueOrError<std::vector<RemoteScreenProtocol>> ParseProtocols(
+    const std::wstring& protocols) {
+  std::vector<RemoteScreenProtocol> output;
+  size_t start = 0;
+  while (start <= protocols.size()) {
+    size_t end = std::min(protocols.find(L',', start), protocols.size());
+    std::wstring name = protocols.substr(start, end - start);
+    if (name == L"binary") output.push_back(RemoteScreenProtocol::kBinary);
+    if (name == L"vm") output.push_back(RemoteScreenProtocol::kVm);
+    start = end + 1;
+  }
+  if (output.empty())
+    return Error{LazyString{L"No supported remote screen protocol: "} +
+                 LazyString{protocols}};
+  return output;
+}
+
+ValueOrError<FileDescriptor> SyncConnect(const Path& path,
+                                         RemoteScreenProtocol protocol) {
+  switch (protocol) {
+    case RemoteScreenProtocol::kVm:
+      return SyncConnectToServer(path);
+    case RemoteScreenProtocol::kBinary:
+      return SyncConnectScreenToServer(path);
+  }
+  LOG(FATAL) << "Invalid protocol.";
+  return SyncConnectToServer(path);
+}
+
+// Writes all of `frame` to `fd`. A frame that is only partially written would
+// corrupt the stream. Blocks while `fd` is full (i.e., while the remote end
+// isn't reading), just like the writes of `ScreenVm`.
+PossibleError WriteFrame(FileDescriptor fd, const std::string& frame) {
+  size_t position = 0;
+  while (position < frame.size()) {
+    ssize_t result =
+        write(fd.read(), frame.data() + position, frame.size() - position);
+    if (result != -1) {
+      position += result;
+      continue;
+    }
+    if (errno == EINTR) continue;
+    return Error{LazyString{L"Remote screen update failed: "} +
+                 LazyString{FromByteString(strerror(errno))}};
+  }
+  return Success();
+}
+
+// Connects through the first protocol in `protocols` that the server in `path`
+// accepts.
+futures::ValueOrError<NonNull<std::shared_ptr<Screen>>> NewRemoteScreen(
+    EditorState& editor, Path path,
+    std::vector<RemoteScreenProtocol> protocols) {
+  return editor.thread_pool()
+      .Run([path, protocols]()
+           -> ValueOrError<std::pair<RemoteScreenProtocol, FileDescriptor>> {
+        std::optional<Error> error;
+        for (RemoteScreenProtocol protocol : protocols) {
+          ValueOrError<FileDescriptor> fd = SyncConnect(path, protocol);
+          if (!IsError(fd)) return std::make_pair(protocol, ValueOrDie(fd));
+          LOG(INFO) << "Unable to connect remote screen: "
+                    << std::get<Error>(fd);
+          error = std::get<Error>(fd);
+        }
+        return error.value();
+      })
+      .Transform(
+          [](std::pair<RemoteScreenProtocol, FileDescriptor> connection)
+              -> futures::ValueOrError<NonNull<std::shared_ptr<Screen>>> {
+            auto [protocol, fd] = connection;
+            switch (protocol) {
+              case RemoteScreenProtocol::kVm:
+                return futures::Past(MakeNonNullShared<ScreenVm>(fd));
+              case RemoteScreenProtocol::kBinary:
+                return futures::Past(MakeNonNullShared<ScreenEncoder>(
+                    [fd, connected = std::make_shared<bool>(true)](
+                        std::string frame) {
+                      if (!*connected) return;
+                      if (PossibleError result = WriteFrame(fd, frame);
+                          IsError(result)) {
+                        // The remote end may have received part of the frame,
+                        // so we can't send further updates.
+                        LOG(INFO) << std::get<Error>(result)
+                                  << " Closing connection: " << fd;
+                        close(fd.read());
+                        *connected = false;
+                      }
+                    }));
+            }
+            LOG(FATAL) << "Invalid protocol.";
+            return futures::Past(MakeNonNullShared<ScreenVm>(fd));
+          });
+}
+
+// Returns the value of the `screen` variable.
+ValueOrError<NonNull<std::shared_ptr<Screen>>> GetScreen(EditorState& editor) {
+  static const vm::Namespace kEmptyNamespace;
+  std::optional<Environment::LookupResult> value =
+      editor.execution_context()->environment()->Lookup(
+          kEmptyNamespace,
+          Identifier{NON_EMPTY_SINGLE_LINE_CONSTANT(L"screen")},
+          GetScreenVmType());
+  if (!value.has_value() ||
+      !std::holds_alternative<gc::Root<Value>>(value->value) ||
+      std::get<gc::Root<Value>>(value->value)->type() !=
+          vm::Type{GetScreenVmType()})
+    return Error{LazyString{L"No screen is available."}};
+  return vm::VMTypeMapper<NonNull<std::shared_ptr<Screen>>>::get(
+      std::get<gc::Root<Value>>(value->value).value());
+}
 }  // namespace
 
 void RegisterScreenType(EditorState& editor, Environment& environment) {
@@ -140,20 +265,47 @@ void RegisterScreenType(EditorState& editor, Environment& environment) {
   gc::Root<ObjectType> screen_type = ObjectType::New(
       pool, VMTypeMapper<NonNull<std::shared_ptr<Screen>>>::object_type_name);
 
-  // Constructor.
+  // Constructors.
+  environment.Define(
+      Identifier{NonEmptySingleLine{SingleLine{LazyString{L"RemoteScreen"}}}},
+      vm::NewCallback(pool, kPurityTypeUnknown, [&editor](Path path) {
+        return NewRemoteScreen(editor, path, {RemoteScreenProtocol::kVm});
+      }));
+
+  // `protocols` is a comma-separated list of the names of the protocols that
+  // the remote screen supports, by preference.
   environment.Define(
       Identifier{NonEmptySingleLine{SingleLine{LazyString{L"RemoteScreen"}}}},
       vm::NewCallback(
           pool, kPurityTypeUnknown,
-          [&editor](Path path)
+          [&editor](Path path, std::wstring protocols)
               -> futures::ValueOrError<NonNull<std::shared_ptr<Screen>>> {
-            return editor.thread_pool()
-                .Run([path] { return SyncConnectToServer(path); })
-                .Transform([](FileDescriptor fd)
-                               -> futures::ValueOrError<
-                                   NonNull<std::shared_ptr<Screen>>> {
-                  return futures::Past(MakeNonNullShared<ScreenVm>(fd));
-                });
+            ValueOrError<std::vector<RemoteScreenProtocol>> supported =
+                ParseProtocols(protocols);
+            if (IsError(supported))
+              return futures::Past(std::get<Error>(supported));
+            return NewRemoteScreen(editor, path, ValueOrDie(supported));
+          }));
+
+  // Receives the updates of a remote screen connected through the binary
+  // protocol.
+  environment.Define(
+      Identifier{NonEmptySingleLine{
+          SingleLine{LazyString{L"ReceiveRemoteScreen"}}}},
+      vm::NewCallback(
+          pool, kPurityTypeUnknown,
+          [&editor](Path path) -> futures::ValueOrError<EmptyValue> {
+            ValueOrError<NonNull<std::shared_ptr<Screen>>> screen =
+                GetScreen(editor);
+            if (IsError(screen)) return futures::Past(std::get<Error>(screen));
+            ValueOrError<FileDescriptor> fd = AugmentError(
+                path.read() + LazyString{L": open failed: "} +
+                    LazyString{FromByteString(strerror(errno))},
+                FileDescriptor::New(
+                    open(path.ToBytes().c_str(), O_RDONLY | O_NONBLOCK)));
+            if (IsError(fd)) return futures::Past(std::get<Error>(fd));
+            editor.ReceiveRemoteScreen(ValueOrDie(fd), ValueOrDie(screen));
+            return futures::Past(EmptyValue{});
           }));
 
   // Methods for Screen.
@@ -239,9 +391,20 @@ void RegisterScreenType(EditorState& editor, Environment& environment) {
                   vm_screen->set_size(line_column_delta);
                   return language::EmptyValue();
                 },
-                []() -> PossibleError {
-                  return Error{LazyString{
-                      L"Screen type does not support set_size method."}};
+                [&screen, line_column_delta]() -> PossibleError {
+                  return VisitPointer(
+                      NonNull<std::shared_ptr<ScreenEncoder>>::DynamicCast(
+                          screen),
+                      [line_column_delta](
+                          NonNull<std::shared_ptr<ScreenEncoder>> encoder)
+                          -> PossibleError {
+                        encoder->set_size(line_column_delta);
+                        return EmptyValue();
+                      },
+                      []() -> PossibleError {
+                        return Error{LazyString{
+                            L"Screen type does not support set_size method."}};
+                      });
                 }));
           })
           .ptr());
@@ -401,7 +401,10 @@ class SearchCommand : public Command {
       SingleLine input, OpenBuffer& buffer,
       DeleteNotification::Value abort_value) {
     auto& editor = buffer.editor();
-    SearchOptions search_options{.search_query = std::move(input)};
+    SearchOptions search_options{
+        .search_query = std::move(input),
+        .thread_pool = editor.thread_pool().thread_pool().get_shared(),
+        .search_index = SearchIndex::NewSnapshot(buffer.search_index())};
 
     if (GetStructureSearchRange(editor.structure()) ==
         StructureSearchRange::kBuffer) {
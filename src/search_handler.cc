@@ -1,18 +1,22 @@
 #include "src/search_handler.h"
 
+#include <atomic>
 #include <iostream>
 #include <regex>
 #include <set>
 
 #include "src/buffer_variables.h"
 #include "src/infrastructure/audio.h"
+#include "src/infrastructure/time.h"
 #include "src/language/container.h"
 #include "src/language/gc_view.h"
 #include "src/language/lazy_string/append.h"
 #include "src/language/lazy_string/char_buffer.h"
 #include "src/language/lazy_string/functional.h"
+#include "src/language/lazy_string/regex.h"
 #include "src/language/lazy_string/single_line.h"
 #include "src/language/wstring.h"
+#include "src/tests/benchmarks.h"
 #include "src/tests/tests.h"
 
 namespace gc = afc::language::gc;
@@ -22,6 +26,8 @@ namespace container = afc::language::container;
 using afc::concurrent::ChannelAll;
 using afc::concurrent::VersionPropertyKey;
 using afc::concurrent::WorkQueue;
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
 using afc::language::EmptyValue;
 using afc::language::EraseIf;
 using afc::language::Error;
@@ -34,25 +40,33 @@ using afc::language::ValueOrError;
 using afc::language::lazy_string::ColumnNumber;
 using afc::language::lazy_string::ColumnNumberDelta;
 using afc::language::lazy_string::LazyString;
+using afc::language::lazy_string::Regex;
 using afc::language::lazy_string::SingleLine;
 using afc::language::text::Line;
 using afc::language::text::LineBuilder;
 using afc::language::text::LineColumn;
 using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
 using afc::language::text::LineSequence;
 using afc::language::text::MutableLineSequence;
 using afc::language::text::Range;
 using afc::language::text::SortedLineSequence;
 using afc::language::text::SortedLineSequenceUniqueLines;
+using afc::tests::BenchmarkName;
 
 namespace afc::editor {
 namespace {
 
-typedef std::wregex RegexPattern;
-
 // Returns all columns where the current line matches the pattern.
 std::vector<ColumnNumber> GetMatches(const SingleLine& line,
-                                     const RegexPattern& pattern) {
+                                     const Regex& pattern) {
+  return pattern.FindAll(line.read());
+}
+
+// The implementation we used before `Regex`. Only used by benchmarks, to
+// compare against.
+std::vector<ColumnNumber> GetMatchesWithStdRegex(const SingleLine& line,
+                                                 const std::wregex& pattern) {
   ColumnNumber start;
   std::vector<ColumnNumber> output;
   while (start.ToDelta() < line.size()) {
@@ -77,48 +91,303 @@ auto GetRegexTraits(bool case_sensitive) {
   return traits;
 }
 
-ValueOrError<std::vector<LineColumn>> PerformSearch(
-    const SearchOptions& options, const LineSequence& contents,
-    size_t previously_found_matches,
-    std::function<bool(const LineColumn&)> predicate) {
-  std::wregex pattern;
-  try {
-    pattern = std::wregex(options.search_query.read().ToString(),
-                          GetRegexTraits(options.case_sensitive));
-  } catch (std::regex_error& e) {
-    Error error{LazyString{L"Regex failure: "} +
-                LazyString{FromByteString(e.what())}};
-    options.progress_channel->Push(
-        {.values = {{VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"!")},
-                     LineSequence::BreakLines(error.read()).FoldLines()}}});
-    return error;
-  }
-
-  std::vector<LineColumn> positions;
-  contents.EveryLine([&](LineNumber position, const Line& line) {
-    size_t initial_size = positions.size();
+// Lines per shard in a parallel search are always a multiple of this. This
+// matches the size of the leaves of the tree in `LineSequence`, so shards
+// that start at a leaf boundary cover entire leaves.
+constexpr size_t kLinesPerLeaf = 256;
+
+// Inputs with fewer lines than this are always searched sequentially; the
+// overhead of scheduling shards is larger than the cost of the search.
+constexpr size_t kMinimumLinesForParallelSearch = 16 * 1024;
+
+// Minimal number of lines per shard in a parallel search.
+constexpr size_t kMinimumLinesPerShard = 16 * kLinesPerLeaf;
+
+struct SearchLinesOutput {
+  std::vector<LineColumn> positions = {};
+  // False if the search stopped (because `keep_going` returned false) before
+  // reaching the end of the input.
+  bool complete = true;
+};
+
+// Runs `pattern` over all lines in `contents`, adding `line_offset` to the
+// line of every position found.
+//
+// After each line that contains matches, calls `on_matches` with the number of
+// matches found in that line. After each line, calls `keep_going` with the
+// number of matches found so far and stops if it returns false.
+template <typename OnMatches, typename KeepGoing>
+SearchLinesOutput SearchLines(
+    const Regex& pattern, const LineSequence& contents,
+    LineNumberDelta line_offset,
+    const std::function<bool(const LineColumn&)>& predicate,
+    const OnMatches& on_matches, const KeepGoing& keep_going) {
+  SearchLinesOutput output;
+  output.complete = contents.EveryLine([&](LineNumber line_number,
+                                           const Line& line) {
+    const LineNumber position = line_number + line_offset;
+    size_t initial_size = output.positions.size();
     std::ranges::copy(
         GetMatches(line.contents(), pattern) |
             std::views::transform([position](ColumnNumber column) {
               return LineColumn(position, column);
             }) |
             std::views::filter(predicate),
-        std::back_inserter(positions));
-    if (positions.size() > initial_size)
-      options.progress_channel->Push(ProgressInformation{
-          .counters = {
-              {VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"matches")},
-               previously_found_matches + positions.size()}}});
-    if (!options.abort_value.has_value() &&
-        (!options.required_positions.has_value() ||
-         options.required_positions.value() > positions.size()))
-      return true;
-    options.progress_channel->Push(ProgressInformation{
-        .values = {
-            {VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"partial")},
-             SingleLine{}}}});
-    return false;
+        std::back_inserter(output.positions));
+    if (output.positions.size() > initial_size)
+      on_matches(output.positions.size() - initial_size);
+    return keep_going(output.positions.size());
   });
+  return output;
+}
+
+void PushMatchesCount(const SearchOptions& options, size_t matches) {
+  options.progress_channel->Push(ProgressInformation{
+      .counters = {
+          {VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"matches")},
+           matches}}});
+}
+
+void PushPartial(const SearchOptions& options) {
+  options.progress_channel->Push(ProgressInformation{
+      .values = {
+          {VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"partial")},
+           SingleLine{}}}});
+}
+
+bool RequiredPositionsFound(const SearchOptions& options, size_t positions) {
+  return options.required_positions.has_value() &&
+         options.required_positions.value() <= positions;
+}
+
+// Like the sequential search, keeps all positions up to the end of the line in
+// which `required_positions` is reached.
+void DropPositionsAfterRequired(const SearchOptions& options,
+                                std::vector<LineColumn>& positions) {
+  if (!RequiredPositionsFound(options, positions.size())) return;
+  size_t end = options.required_positions.value();
+  while (end > 0 && end < positions.size() &&
+         positions[end].line == positions[end - 1].line)
+    ++end;
+  positions.resize(end);
+}
+
+std::vector<LineColumn> PerformSequentialSearch(
+    const Regex& pattern, const SearchOptions& options,
+    const LineSequence& contents, size_t previously_found_matches,
+    const std::function<bool(const LineColumn&)>& predicate) {
+  size_t matches = previously_found_matches;
+  SearchLinesOutput output = SearchLines(
+      pattern, contents, LineNumberDelta(), predicate,
+      [&](size_t new_matches) {
+        matches += new_matches;
+        PushMatchesCount(options, matches);
+      },
+      [&options](size_t positions) {
+        return !options.abort_value.has_value() &&
+               !RequiredPositionsFound(options, positions);
+      });
+  if (!output.complete) PushPartial(options);
+  return std::move(output.positions);
+}
+
+// State shared between the threads that participate in a parallel search. The
+// input is split in consecutive shards; threads claim shards (in order) until
+// they are all claimed (or the search is stopped).
+//
+// Because the thread that starts the search also claims shards (and only
+// waits for shards that have been claimed), it never blocks on work that is
+// still queued in the thread pool. This matters because searches themselves
+// typically run in the thread pool.
+struct ParallelSearchState {
+  ParallelSearchState(Regex input_pattern, SearchOptions input_options,
+                      LineSequence input_contents,
+                      std::function<bool(const LineColumn&)> input_predicate,
+                      size_t input_previously_found_matches,
+                      size_t input_shard_size)
+      : pattern(std::move(input_pattern)),
+        options(std::move(input_options)),
+        contents(std::move(input_contents)),
+        predicate(std::move(input_predicate)),
+        previously_found_matches(input_previously_found_matches),
+        shard_size(input_shard_size),
+        shards_count((static_cast<size_t>(contents.size().read()) +
+                      shard_size - 1) /
+                     shard_size),
+        data(Data{.results = std::vector<std::optional<SearchLinesOutput>>(
+                      shards_count)}) {}
+
+  const Regex pattern;
+  const SearchOptions options;
+  const LineSequence contents;
+  const std::function<bool(const LineColumn&)> predicate;
+  const size_t previously_found_matches;
+  const size_t shard_size;
+  const size_t shards_count;
+
+  std::atomic<size_t> matches = 0;
+  // Set once the shards at the beginning of the input (that have completed)
+  // already contain `required_positions`; no more shards are needed.
+  std::atomic<bool> stop = false;
+
+  struct Data {
+    std::vector<std::optional<SearchLinesOutput>> results;
+    size_t next_shard = 0;
+    // Shards that have been claimed but haven't completed.
+    size_t running = 0;
+  };
+  concurrent::ProtectedWithCondition<Data> data;
+
+  bool ShouldStop() const { return stop || options.abort_value.has_value(); }
+
+  // Claims and searches shards until none are left.
+  void Run() {
+    while (std::optional<size_t> shard = ClaimShard())
+      CompleteShard(*shard, SearchShard(*shard));
+  }
+
+  std::optional<size_t> ClaimShard() {
+    return data.lock([this](Data& d,
+                            std::condition_variable&) -> std::optional<size_t> {
+      if (d.next_shard == shards_count || ShouldStop()) return std::nullopt;
+      ++d.running;
+      return d.next_shard++;
+    });
+  }
+
+  SearchLinesOutput SearchShard(size_t shard) {
+    const LineNumber first_line(shard * shard_size);
+    const LineNumber last_line(
+        std::min<size_t>(contents.size().read(), (shard + 1) * shard_size) - 1);
+    return SearchLines(
+        pattern,
+        contents.ViewRange(
+            Range(LineColumn(first_line),
+                  LineColumn(last_line,
+                             std::numeric_limits<ColumnNumber>::max()))),
+        first_line.ToDelta(), predicate,
+        [this](size_t new_matches) {
+          PushMatchesCount(options,
+                           previously_found_matches + (matches += new_matches));
+        },
+        [this](size_t positions) {
+          return !ShouldStop() && !RequiredPositionsFound(options, positions);
+        });
+  }
+
+  void CompleteShard(size_t shard, SearchLinesOutput output) {
+    data.lock([&](Data& d, std::condition_variable& condition) {
+      d.results[shard] = std::move(output);
+      --d.running;
+      size_t positions = 0;
+      for (const std::optional<SearchLinesOutput>& result : d.results) {
+        if (!result.has_value()) break;
+        positions += result->positions.size();
+        if (!result->complete) break;
+      }
+      if (RequiredPositionsFound(options, positions)) stop = true;
+      condition.notify_all();
+    });
+  }
+
+  void WaitForRunningShards() {
+    data.wait([](const Data& d) { return d.running == 0; });
+  }
+
+  // Concatenates the results of consecutive shards, stopping at the first
+  // shard that didn't complete.
+  std::vector<LineColumn> Merge() {
+    return data.lock([this](Data& d, std::condition_variable&) {
+      std::vector<LineColumn> output;
+      bool complete = true;
+      for (std::optional<SearchLinesOutput>& result : d.results) {
+        if (!result.has_value()) {
+          complete = false;
+          break;
+        }
+        output.insert(output.end(), result->positions.begin(),
+                      result->positions.end());
+        if (!result->complete) {
+          complete = false;
+          break;
+        }
+      }
+      // Like the sequential search, stop at the end of the line in which the
+      // required positions were reached.
+      if (RequiredPositionsFound(options, output.size())) {
+        LineNumber last_line =
+            output[options.required_positions.value() - 1].line;
+        EraseIf(output, [last_line](const LineColumn& position) {
+          return position.line > last_line;
+        });
+        complete = false;
+      }
+      if (!complete) PushPartial(options);
+      return output;
+    });
+  }
+};
+
+std::vector<LineColumn> PerformParallelSearch(
+    const Regex& pattern, const SearchOptions& options,
+    const LineSequence& contents, size_t previously_found_matches,
+    const std::function<bool(const LineColumn&)>& predicate,
+    concurrent::ThreadPool& thread_pool) {
+  TRACK_OPERATION(SearchHandler_PerformParallelSearch);
+  const size_t lines = static_cast<size_t>(contents.size().read());
+  // Aim for a few shards per thread, so that threads that finish early can
+  // take over some of the work.
+  const size_t shard_size = std::max(
+      kMinimumLinesPerShard,
+      (lines / (4 * thread_pool.size()) + kLinesPerLeaf - 1) / kLinesPerLeaf *
+          kLinesPerLeaf);
+  NonNull<std::shared_ptr<ParallelSearchState>> state =
+      MakeNonNullShared<ParallelSearchState>(pattern, options, contents,
+                                             predicate,
+                                             previously_found_matches,
+                                             shard_size);
+  VLOG(5) << "Parallel search: lines: " << lines
+          << ", shard size: " << shard_size
+          << ", shards: " << state->shards_count;
+  for (size_t i = 1;
+       i < std::min(state->shards_count, thread_pool.size() + 1); ++i)
+    thread_pool.RunIgnoringResult(
+        [state = state.get_shared()] { state->Run(); });
+  state->Run();
+  state->WaitForRunningShards();
+  return state->Merge();
+}
+
+ValueOrError<Regex> CompilePattern(const SearchOptions& options) {
+  ValueOrError<Regex> pattern_or_error =
+      Regex::Compile(options.search_query.read(),
+                     {.case_sensitive = options.case_sensitive});
+  if (IsError(pattern_or_error)) {
+    Error error = AugmentError(LazyString{L"Regex failure"},
+                               GetError(pattern_or_error));
+    options.progress_channel->Push(
+        {.values = {{VersionPropertyKey{NON_EMPTY_SINGLE_LINE_CONSTANT(L"!")},
+                     LineSequence::BreakLines(error.read()).FoldLines()}}});
+    return error;
+  }
+  return pattern_or_error;
+}
+
+ValueOrError<std::vector<LineColumn>> PerformSearch(
+    const SearchOptions& options, const LineSequence& contents,
+    size_t previously_found_matches,
+    std::function<bool(const LineColumn&)> predicate) {
+  DECLARE_OR_RETURN(Regex pattern, CompilePattern(options));
+
+  std::vector<LineColumn> positions =
+      options.thread_pool != nullptr &&
+              static_cast<size_t>(contents.size().read()) >=
+                  kMinimumLinesForParallelSearch
+          ? PerformParallelSearch(pattern, options, contents,
+                                  previously_found_matches, predicate,
+                                  *options.thread_pool)
+          : PerformSequentialSearch(pattern, options, contents,
+                                    previously_found_matches, predicate);
   VLOG(5) << "Perform search found matches: " << positions.size();
   return positions;
 }
@@ -162,7 +431,9 @@ PossibleError SearchInBuffer(PredictorInput& input, OpenBuffer& buffer,
                    buffer.status().LogErrors(SearchHandler(
                        input.editor.modifiers().direction,
                        SearchOptions{.starting_position = buffer.position(),
-                                     .search_query = input.input},
+                                     .search_query = input.input,
+                                     .search_index = SearchIndex::NewSnapshot(
+                                         buffer.search_index())},
                        buffer.contents().snapshot())));
 
   // Get the first `required_positions` matches:
@@ -248,19 +519,70 @@ ValueOrError<std::vector<LineColumn>> SearchHandler(
     return results;
   };
 
-  DECLARE_OR_RETURN(
-      std::vector<LineColumn> output,
-      Search(range_after, 0, [](const LineColumn&) { return true; }));
-
-  DECLARE_OR_RETURN(std::vector<LineColumn> results_before,
-                    Search(range_before, output.size(),
-                           // Account for the fact that we extended
-                           // `range_before` past the starting position
-                           [starting_position](const LineColumn& candidate) {
-                             return candidate <= starting_position;
-                           }));
+  std::optional<std::vector<LineColumn>> index_positions;
+  if (options.search_index.has_value() && !options.limit_position.has_value()) {
+    DECLARE_OR_RETURN(Regex pattern, CompilePattern(options));
+    SearchIndex::Query query{.search_query = options.search_query,
+                             .case_sensitive = options.case_sensitive};
+    index_positions =
+        SearchIndex::SearchIfWarm(options.search_index.value(), query, pattern,
+                                  contents, options.abort_value);
+    if (!index_positions.has_value() && options.thread_pool != nullptr)
+      options.thread_pool->RunIgnoringResult(
+          [snapshot = options.search_index.value(), query, pattern, contents,
+           abort_value = options.abort_value] {
+            SearchIndex::Search(snapshot, query, pattern, contents,
+                                abort_value);
+          });
+  }
 
-  output.insert(output.end(), results_before.begin(), results_before.end());
+  std::vector<LineColumn> output;
+  if (index_positions.has_value()) {
+    // The index matches entire lines. To match the behavior of the search
+    // without the index, we search the line with the starting position
+    // directly, like `range_after` and `range_before` would.
+    const LineNumber starting_line = starting_position.line;
+    if (!range_after.empty()) {
+      Range starting_line_after = range_after;
+      starting_line_after.set_end(std::min(range_after.end(),
+                                           range_before.end()));
+      DECLARE_OR_RETURN(output, Search(starting_line_after, 0,
+                                       [](const LineColumn&) { return true; }));
+    }
+    auto split = std::ranges::partition_point(
+        *index_positions, [starting_line](const LineColumn& position) {
+          return position.line <= starting_line;
+        });
+    output.insert(output.end(), split, index_positions->end());
+    for (const LineColumn& position : *index_positions)
+      if (position.line < starting_line) output.push_back(position);
+    PushMatchesCount(options, index_positions->size());
+    if (!RequiredPositionsFound(options, output.size())) {
+      DECLARE_OR_RETURN(
+          std::vector<LineColumn> results_before,
+          Search(Range(LineColumn(starting_line), range_before.end()),
+                 output.size(),
+                 [starting_position](const LineColumn& candidate) {
+                   return candidate <= starting_position;
+                 }));
+      output.insert(output.end(), results_before.begin(),
+                    results_before.end());
+    }
+    DropPositionsAfterRequired(options, output);
+  } else {
+    DECLARE_OR_RETURN(
+        output, Search(range_after, 0, [](const LineColumn&) { return true; }));
+
+    DECLARE_OR_RETURN(std::vector<LineColumn> results_before,
+                      Search(range_before, output.size(),
+                             // Account for the fact that we extended
+                             // `range_before` past the starting position
+                             [starting_position](const LineColumn& candidate) {
+                               return candidate <= starting_position;
+                             }));
+
+    output.insert(output.end(), results_before.begin(), results_before.end());
+  }
   switch (direction) {
     case Direction::kForwards:
       break;
@@ -272,6 +594,18 @@ ValueOrError<std::vector<LineColumn>> SearchHandler(
 }
 
 namespace {
+// Returns a sequence with 30000 lines, large enough to trigger a parallel
+// search. Every line contains two matches for `ro[0-9]+ `.
+LineSequence LargeInputForTests() {
+  MutableLineSequence output;
+  for (int i = 0; i < 30000; ++i)
+    output.push_back(Line{SingleLine{LazyString{
+        L"Foro" + std::to_wstring(i) + L" ro" + std::to_wstring(i) +
+        L" Cuervo"}}});
+  output.MaybeEraseEmptyFirstLine();
+  return output.snapshot();
+}
+
 bool tests_search_handler_register = tests::Register(L"SearchHandler", [] {
   auto contents = [] {
     return LineSequence::ForTests({L"Alejandro", L"Forero", L"Cuervo"});
@@ -380,8 +714,93 @@ bool tests_search_handler_register = tests::Register(L"SearchHandler", [] {
                     LineColumn(LineNumber(0), ColumnNumber(7)),
                     LineColumn(LineNumber(0), ColumnNumber(8)),
                 }));
+        }},
+       {.name = L"ParallelMatchesSequential",
+        .callback =
+            [] {
+              LineSequence input = LargeInputForTests();
+              SearchOptions options{.search_query =
+                                        SingleLine{LazyString{L"ro[0-9]*7 "}}};
+              std::vector<LineColumn> sequential = ValueOrDie(
+                  SearchHandler(Direction::kForwards, options, input));
+              options.thread_pool = MakeNonNullShared<concurrent::ThreadPool>(
+                                        LazyString{L"Test"}, 4)
+                                        .get_shared();
+              std::vector<LineColumn> parallel = ValueOrDie(
+                  SearchHandler(Direction::kForwards, options, input));
+              CHECK_EQ(sequential.size(), 6000ul);
+              CHECK(parallel == sequential);
+            }},
+       {.name = L"ParallelRequiredPositions",
+        .callback =
+            [] {
+              LineSequence input = LargeInputForTests();
+              SearchOptions options{
+                  .search_query = SingleLine{LazyString{L"ro[0-9]+ "}},
+                  .required_positions = 5,
+                  .thread_pool = MakeNonNullShared<concurrent::ThreadPool>(
+                                     LazyString{L"Test"}, 4)
+                                     .get_shared()};
+              std::vector<LineColumn> output = ValueOrDie(
+                  SearchHandler(Direction::kForwards, options, input));
+              // We stop at the end of the line containing the fifth match.
+              CHECK_EQ(output.size(), 6ul);
+              CHECK_EQ(output.back(),
+                       LineColumn(LineNumber(2), ColumnNumber(6)));
+            }},
+       {.name = L"IndexMatchesSearch", .callback = [=] {
+          for (std::wstring query : {L"r", L"^.", L"o$", L"."}) {
+            SearchOptions options{
+                .starting_position = LineColumn(LineNumber(1), ColumnNumber(3)),
+                .search_query = SingleLine{LazyString{query}}};
+            std::vector<LineColumn> expected = ValueOrDie(
+                SearchHandler(Direction::kForwards, options, contents()));
+            options.search_index =
+                SearchIndex::NewSnapshot(MakeNonNullShared<SearchIndex>());
+            CHECK(ValueOrDie(SearchHandler(Direction::kForwards, options,
+                                           contents())) == expected);
+            // We stop at the end of the line containing the first match.
+            options.required_positions = 1;
+            std::vector<LineColumn> output = ValueOrDie(
+                SearchHandler(Direction::kForwards, options, contents()));
+            CHECK(!output.empty());
+            CHECK(std::ranges::equal(output, expected | std::views::take(
+                                                            output.size())));
+            CHECK(output.size() == expected.size() ||
+                  output.back().line != expected[output.size()].line);
+          }
         }}});
 }());
+
+SingleLine BenchmarkLine(size_t size) {
+  static const std::wstring kText = L"Alejandro Forero Cuervo, Medellin. ";
+  std::wstring output;
+  while (output.size() < size) output += kText;
+  output.resize(size);
+  return SingleLine{LazyString{std::move(output)}};
+}
+
+bool search_handler_get_matches_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"SearchHandler::GetMatches")},
+    [](int elements) {
+      SingleLine line = BenchmarkLine(elements);
+      auto start = Now();
+      Regex pattern = ValueOrDie(
+          Regex::Compile(LazyString{L"for[a-z]+"}, {.case_sensitive = false}));
+      GetMatches(line, pattern);
+      return SecondsBetween(start, Now());
+    });
+
+bool search_handler_get_matches_std_regex_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{
+        NON_EMPTY_SINGLE_LINE_CONSTANT(L"SearchHandler::GetMatchesStdRegex")},
+    [](int elements) {
+      SingleLine line = BenchmarkLine(elements);
+      auto start = Now();
+      std::wregex pattern(L"for[a-z]+", GetRegexTraits(false));
+      GetMatchesWithStdRegex(line, pattern);
+      return SecondsBetween(start, Now());
+    });
 }  // namespace
 
 ValueOrError<LineColumn> GetNextMatch(Direction direction,
@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "src/concurrent/thread_pool.h"
 #include "src/futures/delete_notification.h"
 #include "src/language/lazy_string/lazy_string.h"
 #include "src/language/safe_types.h"
@@ -10,6 +11,7 @@
 #include "src/language/text/line_sequence.h"
 #include "src/line_prompt_mode.h"
 #include "src/predictor.h"
+#include "src/search_index.h"
 
 namespace afc {
 namespace editor {
@@ -39,6 +41,18 @@ struct SearchOptions {
 
   bool case_sensitive = false;
 
+  // If set, large inputs are split into shards that are searched concurrently
+  // in this pool.
+  std::shared_ptr<concurrent::ThreadPool> thread_pool = nullptr;
+
+  // If set, searches over the entire contents (i.e., without `limit_position`)
+  // are served from this index when it is warm (i.e., when it only needs to
+  // examine a few lines that changed since the previous search). Otherwise,
+  // the search runs without the index and, if `thread_pool` is set, the index
+  // is filled in the background. The contents given to `SearchHandler` must
+  // correspond to this snapshot.
+  std::optional<SearchIndex::Snapshot> search_index = std::nullopt;
+
   language::NonNull<std::shared_ptr<concurrent::Channel<ProgressInformation>>>
       progress_channel = language::MakeNonNullShared<
           concurrent::ChannelAll<ProgressInformation>>(
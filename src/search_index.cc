@@ -0,0 +1,543 @@
+#include "src/search_index.h"
+
+#include <glog/logging.h>
+
+#include "src/infrastructure/tracker.h"
+#include "src/language/overload.h"
+#include "src/language/text/mutable_line_sequence.h"
+#include "src/tests/tests.h"
+
+using afc::futures::DeleteNotification;
+using afc::language::MakeNonNullUnique;
+using afc::language::NonNull;
+using afc::language::overload;
+using afc::language::ValueOrDie;
+using afc::language::lazy_string::ColumnNumber;
+using afc::language::lazy_string::ColumnNumberDelta;
+using afc::language::lazy_string::LazyString;
+using afc::language::lazy_string::Regex;
+using afc::language::lazy_string::SingleLine;
+using afc::language::text::Line;
+using afc::language::text::LineColumn;
+using afc::language::text::LineNumber;
+using afc::language::text::LineNumberDelta;
+using afc::language::text::LineSequence;
+using afc::language::text::MutableLineSequence;
+using afc::language::text::MutableLineSequenceObserver;
+
+namespace afc::editor {
+namespace {
+// If more changes than this are received before a search applies them, we
+// drop them all and just examine all lines in the next search. This bounds the
+// memory used by buffers that are modified but never searched.
+constexpr size_t kMaxPendingChanges = 1024;
+
+// `SearchIfWarm` only uses the index if it needs to examine at most this many
+// lines.
+constexpr size_t kMaxStaleLinesForWarmSearch = 1024;
+
+LineNumber& NodeKey(std::map<LineNumber, std::vector<ColumnNumber>>::node_type&
+                        node) {
+  return node.key();
+}
+
+LineNumber& NodeKey(std::set<LineNumber>::node_type& node) {
+  return node.value();
+}
+
+// Adds `delta` to all keys in `container` that are greater than or equal to
+// `start`. The caller must ensure that this doesn't cause collisions.
+template <typename Container>
+void ShiftKeys(Container& container, LineNumber start, LineNumberDelta delta) {
+  std::vector<typename Container::node_type> nodes;
+  for (auto it = container.lower_bound(start); it != container.end();)
+    nodes.push_back(container.extract(it++));
+  for (typename Container::node_type& node : nodes) {
+    NodeKey(node) += delta;
+    container.insert(container.end(), std::move(node));
+  }
+}
+
+template <typename Container>
+void EraseKeys(Container& container, LineNumber start, LineNumberDelta size) {
+  container.erase(container.lower_bound(start),
+                  container.lower_bound(start + size));
+}
+
+// Returns true if every match of `next` is also a match of `previous`.
+bool IsRefinement(const Regex& previous, const Regex& next) {
+  return previous.literal_only() &&
+         next.literal_prefix().starts_with(previous.literal_prefix());
+}
+
+std::vector<LineColumn> SearchWithoutIndex(
+    const Regex& pattern, const LineSequence& contents,
+    const DeleteNotification::Value& abort_value) {
+  std::vector<LineColumn> output;
+  contents.EveryLine([&](LineNumber line, const Line& contents_line) {
+    for (ColumnNumber column : pattern.FindAll(contents_line.contents().read()))
+      output.push_back(LineColumn(line, column));
+    return !abort_value.has_value();
+  });
+  return output;
+}
+}  // namespace
+
+class SearchIndexMutableLineSequenceObserver
+    : public MutableLineSequenceObserver {
+ public:
+  SearchIndexMutableLineSequenceObserver(SearchIndex& index) : index_(index) {}
+
+  void LinesInserted(LineNumber position, LineNumberDelta size) override {
+    index_.AddChange(SearchIndex::LinesInserted{position, size});
+  }
+
+  void LinesErased(LineNumber position, LineNumberDelta size) override {
+    index_.AddChange(SearchIndex::LinesErased{position, size});
+  }
+
+  void SplitLine(LineColumn position) override {
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+    LinesInserted(position.line + LineNumberDelta(1), LineNumberDelta(1));
+  }
+
+  void FoldedLine(LineColumn position) override {
+    LinesErased(position.line + LineNumberDelta(1), LineNumberDelta(1));
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+  }
+
+  void Sorted() override { index_.Invalidate(); }
+
+  void AppendedToLine(LineColumn position) override {
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+  }
+
+  void DeletedCharacters(LineColumn position, ColumnNumberDelta) override {
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+  }
+
+  void SetCharacter(LineColumn position) override {
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+  }
+
+  void InsertedCharacter(LineColumn position) override {
+    index_.AddChange(SearchIndex::LineChanged{position.line});
+  }
+
+  void InsertedCharacters(const std::vector<LineColumn>& positions,
+                          ColumnNumberDelta) override {
+    std::optional<LineNumber> last_line;
+    for (const LineColumn& position : positions)
+      if (position.line != last_line) {
+        index_.AddChange(SearchIndex::LineChanged{position.line});
+        last_line = position.line;
+      }
+  }
+
+ private:
+  SearchIndex& index_;
+};
+
+SearchIndex::SearchIndex()
+    : pending_changes_(PendingChanges{}), data_(Data{}) {}
+
+/* static */ SearchIndex::Snapshot SearchIndex::NewSnapshot(
+    NonNull<std::shared_ptr<SearchIndex>> index) {
+  size_t changes = index->pending_changes_.lock(
+      [](const PendingChanges& pending) { return pending.changes; });
+  return Snapshot{.index = std::move(index), .changes = changes};
+}
+
+NonNull<std::unique_ptr<MutableLineSequenceObserver>>
+SearchIndex::NewMutableLineSequenceObserver() {
+  return MakeNonNullUnique<SearchIndexMutableLineSequenceObserver>(*this);
+}
+
+void SearchIndex::Invalidate() {
+  pending_changes_.lock([](PendingChanges& pending) {
+    pending.entries.push_back(
+        {pending.changes, AllLinesChanged{pending.changes, pending.changes}});
+    ++pending.changes;
+  });
+}
+
+void SearchIndex::AddChange(Change change) {
+  pending_changes_.lock([&change](PendingChanges& pending) {
+    const size_t change_id = pending.changes++;
+    if (pending.entries.size() < kMaxPendingChanges) {
+      pending.entries.push_back({change_id, std::move(change)});
+      return;
+    }
+    const size_t first_change = pending.entries.front().first;
+    pending.entries.clear();
+    pending.entries.push_back(
+        {first_change, AllLinesChanged{first_change, change_id}});
+  });
+}
+
+std::vector<SearchIndex::Change> SearchIndex::TakePendingChanges(
+    size_t changes) {
+  return pending_changes_.lock([changes](PendingChanges& pending) {
+    std::vector<Change> output;
+    auto it = pending.entries.begin();
+    while (it != pending.entries.end() && it->first < changes) {
+      output.push_back(it->second);
+      if (AllLinesChanged* all_lines =
+              std::get_if<AllLinesChanged>(&it->second);
+          all_lines != nullptr && all_lines->last_change >= changes) {
+        // Some of the dropped changes happened after `changes`; they must also
+        // be reflected in subsequent searches.
+        it->first = all_lines->first_change = changes;
+        break;
+      }
+      ++it;
+    }
+    pending.entries.erase(pending.entries.begin(), it);
+    return output;
+  });
+}
+
+/* static */ void SearchIndex::Apply(Data& data, const Change& change) {
+  std::visit(
+      overload{
+          [&data](const LinesInserted& inserted) {
+            data.lines += inserted.size;
+            ShiftKeys(data.matches, inserted.position, inserted.size);
+            ShiftKeys(data.stale_lines, inserted.position, inserted.size);
+            if (inserted.position < data.stale_suffix) {
+              data.stale_suffix += inserted.size;
+              for (LineNumber line = inserted.position;
+                   line < inserted.position + inserted.size; ++line)
+                data.stale_lines.insert(line);
+            }
+          },
+          [&data](const LinesErased& erased) {
+            data.lines = std::max(LineNumberDelta(), data.lines - erased.size);
+            EraseKeys(data.matches, erased.position, erased.size);
+            EraseKeys(data.stale_lines, erased.position, erased.size);
+            ShiftKeys(data.matches, erased.position + erased.size,
+                      -erased.size);
+            ShiftKeys(data.stale_lines, erased.position + erased.size,
+                      -erased.size);
+            if (erased.position < data.stale_suffix)
+              data.stale_suffix =
+                  std::max(erased.position, data.stale_suffix - erased.size);
+          },
+          [&data](const LineChanged& changed) {
+            if (changed.position < data.stale_suffix)
+              data.stale_lines.insert(changed.position);
+          },
+          [&data](const AllLinesChanged&) {
+            data.matches.clear();
+            data.stale_lines.clear();
+            data.stale_suffix = LineNumber();
+          }},
+      change);
+}
+
+/* static */ void SearchIndex::ResetQuery(Data& data, Query query,
+                                          Regex pattern) {
+  if (data.pattern.has_value() &&
+      data.query->case_sensitive == query.case_sensitive &&
+      IsRefinement(*data.pattern, pattern)) {
+    VLOG(5) << "Refining query; lines with matches: " << data.matches.size();
+    for (const auto& [line, columns] : data.matches)
+      if (line < data.stale_suffix) data.stale_lines.insert(line);
+  } else {
+    data.matches.clear();
+    data.stale_lines.clear();
+    data.stale_suffix = LineNumber();
+  }
+  data.query = std::move(query);
+  data.pattern = std::move(pattern);
+}
+
+/* static */ void SearchIndex::UpdateLinesCount(Data& data,
+                                                LineNumberDelta lines) {
+  if (lines < data.lines) {
+    Apply(data, AllLinesChanged{});
+  } else if (lines > data.lines && !data.lines.IsZero()) {
+    // Lines were appended without notifying the observer.
+    data.stale_suffix = std::min(data.stale_suffix,
+                                 LineNumber() + data.lines - LineNumberDelta(1));
+  }
+  data.lines = lines;
+  // Buffers modify their last line without notifying the observer, as they
+  // receive the output of a process.
+  if (LineNumber last_line = LineNumber() + lines - LineNumberDelta(1);
+      !lines.IsZero() && last_line < data.stale_suffix)
+    data.stale_lines.insert(last_line);
+}
+
+/* static */ bool SearchIndex::IsStale(const Data& data, LineNumber line) {
+  return line >= data.stale_suffix || data.stale_lines.contains(line);
+}
+
+/* static */ size_t SearchIndex::StaleLinesCount(const Data& data) {
+  LineNumberDelta suffix_lines =
+      std::max(LineNumberDelta(), data.lines - data.stale_suffix.ToDelta());
+  return data.stale_lines.size() + static_cast<size_t>(suffix_lines.read());
+}
+
+/* static */ std::vector<LineColumn> SearchIndex::Matches(const Data& data) {
+  std::vector<LineColumn> output;
+  for (const auto& [line, columns] : data.matches)
+    if (!IsStale(data, line))
+      for (ColumnNumber column : columns)
+        output.push_back(LineColumn(line, column));
+  return output;
+}
+
+/* static */ std::vector<LineColumn> SearchIndex::Search(
+    const Snapshot& snapshot, const Query& query, const Regex& pattern,
+    const LineSequence& contents,
+    const DeleteNotification::Value& abort_value) {
+  TRACK_OPERATION(SearchIndex_Search);
+  ++snapshot.index->running_searches_;
+  std::vector<LineColumn> output =
+      snapshot.index->data_.lock([&](Data& data) {
+        if (!Update(data, snapshot, query, pattern, contents)) {
+          VLOG(5) << "Outdated snapshot, searching without index.";
+          return SearchWithoutIndex(pattern, contents, abort_value);
+        }
+        ExamineStaleLines(data, contents, abort_value);
+        return Matches(data);
+      });
+  --snapshot.index->running_searches_;
+  return output;
+}
+
+/* static */ std::optional<std::vector<LineColumn>> SearchIndex::SearchIfWarm(
+    const Snapshot& snapshot, const Query& query, const Regex& pattern,
+    const LineSequence& contents,
+    const DeleteNotification::Value& abort_value) {
+  TRACK_OPERATION(SearchIndex_SearchIfWarm);
+  if (snapshot.index->running_searches_ > 0) {
+    VLOG(5) << "Index is being updated.";
+    return std::nullopt;
+  }
+  return snapshot.index->data_.lock(
+      [&](Data& data) -> std::optional<std::vector<LineColumn>> {
+        if (!Update(data, snapshot, query, pattern, contents))
+          return std::nullopt;
+        if (size_t stale_lines = StaleLinesCount(data);
+            stale_lines > kMaxStaleLinesForWarmSearch) {
+          VLOG(5) << "Index is cold; stale lines: " << stale_lines;
+          return std::nullopt;
+        }
+        ExamineStaleLines(data, contents, abort_value);
+        return Matches(data);
+      });
+}
+
+/* static */ bool SearchIndex::Update(Data& data, const Snapshot& snapshot,
+                                      const Query& query, const Regex& pattern,
+                                      const LineSequence& contents) {
+  // If the index already reflects changes that `contents` doesn't, it can't be
+  // used.
+  if (snapshot.changes < data.applied_changes) return false;
+  for (const Change& change :
+       snapshot.index->TakePendingChanges(snapshot.changes))
+    Apply(data, change);
+  data.applied_changes = snapshot.changes;
+  UpdateLinesCount(data, contents.size());
+  if (data.query != query) ResetQuery(data, query, pattern);
+  return true;
+}
+
+/* static */ void SearchIndex::ExamineStaleLines(
+    Data& data, const LineSequence& contents,
+    const DeleteNotification::Value& abort_value) {
+  auto examine = [&](LineNumber line) {
+    std::vector<ColumnNumber> columns =
+        data.pattern->FindAll(contents.at(line).contents().read());
+    if (columns.empty())
+      data.matches.erase(line);
+    else
+      data.matches[line] = std::move(columns);
+  };
+  VLOG(5) << "Stale lines: " << data.stale_lines.size()
+          << ", stale suffix: " << data.stale_suffix;
+  while (!data.stale_lines.empty() && !abort_value.has_value()) {
+    examine(*data.stale_lines.begin());
+    data.stale_lines.erase(data.stale_lines.begin());
+  }
+  while (data.stale_suffix.ToDelta() < data.lines && !abort_value.has_value()) {
+    examine(data.stale_suffix);
+    ++data.stale_suffix;
+  }
+}
+
+namespace {
+struct SearchIndexTestsEnvironment {
+  NonNull<std::shared_ptr<SearchIndex>> index;
+  MutableLineSequence contents;
+
+  SearchIndexTestsEnvironment(std::vector<std::wstring> lines)
+      : contents(NonNull<std::shared_ptr<MutableLineSequenceObserver>>(
+            index->NewMutableLineSequenceObserver())) {
+    for (const std::wstring& line : lines)
+      contents.push_back(Line{SingleLine{LazyString{line}}},
+                         MutableLineSequence::ObserverBehavior::kShow);
+    contents.MaybeEraseEmptyFirstLine();
+  }
+
+  std::vector<LineColumn> Search(std::wstring query) {
+    Regex pattern = ValueOrDie(
+        Regex::Compile(LazyString{query}, {.case_sensitive = false}));
+    return SearchIndex::Search(
+        SearchIndex::NewSnapshot(index),
+        SearchIndex::Query{.search_query = SingleLine{LazyString{query}}},
+        pattern, contents.snapshot(), DeleteNotification::Never());
+  }
+
+  std::optional<std::vector<LineColumn>> SearchIfWarm(std::wstring query) {
+    Regex pattern = ValueOrDie(
+        Regex::Compile(LazyString{query}, {.case_sensitive = false}));
+    return SearchIndex::SearchIfWarm(
+        SearchIndex::NewSnapshot(index),
+        SearchIndex::Query{.search_query = SingleLine{LazyString{query}}},
+        pattern, contents.snapshot(), DeleteNotification::Never());
+  }
+};
+
+const bool search_index_tests_registration = tests::Register(
+    L"SearchIndex",
+    {{.name = L"Simple",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            CHECK(environment.Search(L"r") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(0), ColumnNumber(7)),
+                       LineColumn(LineNumber(1), ColumnNumber(2)),
+                       LineColumn(LineNumber(1), ColumnNumber(4)),
+                       LineColumn(LineNumber(2), ColumnNumber(3))}));
+          }},
+     {.name = L"LinesInserted",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            CHECK_EQ(environment.Search(L"ro").size(), 2ul);
+            environment.contents.insert_line(
+                LineNumber(1), Line{SingleLine{LazyString{L"Rosa"}}});
+            CHECK(environment.Search(L"ro") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(0), ColumnNumber(7)),
+                       LineColumn(LineNumber(1), ColumnNumber(0)),
+                       LineColumn(LineNumber(2), ColumnNumber(4))}));
+          }},
+     {.name = L"LinesErased",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo", L"Rosa"});
+            CHECK_EQ(environment.Search(L"ro").size(), 3ul);
+            environment.contents.EraseLines(LineNumber(0), LineNumber(2));
+            CHECK(environment.Search(L"ro") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(1), ColumnNumber(0))}));
+          }},
+     {.name = L"LineModified",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            CHECK_EQ(environment.Search(L"ro").size(), 2ul);
+            environment.contents.DeleteCharactersFromLine(
+                LineColumn(LineNumber(1), ColumnNumber(4)),
+                ColumnNumberDelta(2));
+            CHECK(environment.Search(L"ro") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(0), ColumnNumber(7))}));
+          }},
+     {.name = L"SplitAndFold",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            CHECK_EQ(environment.Search(L"rof").size(), 0ul);
+            environment.contents.SplitLine(
+                LineColumn(LineNumber(1), ColumnNumber(3)));
+            environment.contents.FoldNextLine(LineNumber(0));
+            // Contents: "AlejandroFor", "ero", "Cuervo".
+            CHECK(environment.Search(L"rof") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(0), ColumnNumber(7))}));
+          }},
+     {.name = L"Refinement",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            CHECK_EQ(environment.Search(L"r").size(), 4ul);
+            CHECK(environment.Search(L"rer") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(1), ColumnNumber(2))}));
+            CHECK_EQ(environment.Search(L"v").size(), 1ul);
+          }},
+     {.name = L"HiddenAppend",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment({L"Alejandro", L"Fore"});
+            CHECK_EQ(environment.Search(L"ro").size(), 1ul);
+            environment.contents.AppendToLine(
+                LineNumber(1), Line{SingleLine{LazyString{L"ro"}}},
+                MutableLineSequence::ObserverBehavior::kHide);
+            environment.contents.push_back(
+                Line{SingleLine{LazyString{L"Cuervo Rosa"}}},
+                MutableLineSequence::ObserverBehavior::kHide);
+            CHECK(environment.Search(L"ro") ==
+                  std::vector<LineColumn>(
+                      {LineColumn(LineNumber(0), ColumnNumber(7)),
+                       LineColumn(LineNumber(1), ColumnNumber(4)),
+                       LineColumn(LineNumber(2), ColumnNumber(7))}));
+          }},
+     {.name = L"OutdatedSnapshot",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(
+                {L"Alejandro", L"Forero", L"Cuervo"});
+            SearchIndex::Snapshot snapshot =
+                SearchIndex::NewSnapshot(environment.index);
+            LineSequence contents = environment.contents.snapshot();
+            environment.contents.EraseLines(LineNumber(0), LineNumber(1));
+            CHECK_EQ(environment.Search(L"ro").size(), 1ul);
+            Regex pattern = ValueOrDie(
+                Regex::Compile(LazyString{L"ro"}, {.case_sensitive = false}));
+            CHECK_EQ(SearchIndex::Search(
+                         snapshot,
+                         SearchIndex::Query{.search_query =
+                                                SingleLine{LazyString{L"ro"}}},
+                         pattern, contents, DeleteNotification::Never())
+                         .size(),
+                     2ul);
+          }},
+     {.name = L"SearchIfWarm",
+      .callback =
+          [] {
+            SearchIndexTestsEnvironment environment(std::vector<std::wstring>(
+                2 * kMaxStaleLinesForWarmSearch, L"Forero"));
+            CHECK(!environment.SearchIfWarm(L"ro").has_value());
+            CHECK_EQ(environment.Search(L"ro").size(),
+                     2 * kMaxStaleLinesForWarmSearch);
+            environment.contents.DeleteCharactersFromLine(
+                LineColumn(LineNumber(0), ColumnNumber(4)),
+                ColumnNumberDelta(2));
+            CHECK_EQ(environment.SearchIfWarm(L"ro").value().size(),
+                     2 * kMaxStaleLinesForWarmSearch - 1);
+            CHECK(!environment.SearchIfWarm(L"fo").has_value());
+          }},
+     {.name = L"ManyChangesBeforeSearch", .callback = [] {
+        SearchIndexTestsEnvironment environment({L"Alejandro"});
+        CHECK_EQ(environment.Search(L"ro").size(), 1ul);
+        for (size_t i = 0; i < 2 * kMaxPendingChanges; ++i)
+          environment.contents.insert_line(
+              LineNumber(0), Line{SingleLine{LazyString{L"Forero"}}});
+        CHECK_EQ(environment.Search(L"ro").size(),
+                 2 * kMaxPendingChanges + 1);
+      }}});
+}  // namespace
+}  // namespace afc::editor
@@ -0,0 +1,190 @@
+#ifndef __AFC_EDITOR_SEARCH_INDEX_H__
+#define __AFC_EDITOR_SEARCH_INDEX_H__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <variant>
+#include <vector>
+
+#include "src/concurrent/protected.h"
+#include "src/futures/delete_notification.h"
+#include "src/language/lazy_string/column_number.h"
+#include "src/language/lazy_string/regex.h"
+#include "src/language/lazy_string/single_line.h"
+#include "src/language/safe_types.h"
+#include "src/language/text/line_column.h"
+#include "src/language/text/line_sequence.h"
+#include "src/language/text/mutable_line_sequence_observer.h"
+
+namespace afc::editor {
+class SearchIndexMutableLineSequenceObserver;
+
+// Keeps the positions in the contents of a buffer that match the last search
+// query, so that subsequent searches only need to examine the lines that have
+// changed.
+//
+// Changes to the contents are received (in the thread that applies them)
+// through the observer returned by `NewMutableLineSequenceObserver`; they only
+// mark lines as stale. Stale lines are examined by the next call to `Search`.
+// When the query changes, only the lines that matched the previous query are
+// examined if the new query refines it (e.g., the user typed an additional
+// character of a literal query); otherwise all lines are examined.
+//
+// Changes that aren't reported to the observer (through
+// `MutableLineSequence::ObserverBehavior::kHide`) are only supported when they
+// append contents at the end of the buffer (as happens when a buffer receives
+// the output of a process) or when they are followed by a call to
+// `Invalidate`.
+//
+// This class is thread-safe: `Search` can run in a background thread.
+class SearchIndex {
+ public:
+  struct Query {
+    language::lazy_string::SingleLine search_query;
+    bool case_sensitive = false;
+
+    bool operator==(const Query&) const = default;
+  };
+
+  // Identifies the state of the contents after a given number of changes.
+  // Must be obtained in the thread that applies the changes, at the same time
+  // that the snapshot of the contents (that will be given to `Search`) is
+  // obtained.
+  struct Snapshot {
+    language::NonNull<std::shared_ptr<SearchIndex>> index;
+    size_t changes;
+  };
+
+  SearchIndex();
+  SearchIndex(const SearchIndex&) = delete;
+
+  static Snapshot NewSnapshot(language::NonNull<std::shared_ptr<SearchIndex>>);
+
+  language::NonNull<
+      std::unique_ptr<language::text::MutableLineSequenceObserver>>
+  NewMutableLineSequenceObserver();
+
+  // Signals that all lines should be considered stale.
+  void Invalidate();
+
+  // Returns all the positions in `contents` that match `query`, in ascending
+  // order. `pattern` must be the compiled form of `query` and `contents` must
+  // correspond to `snapshot.changes`.
+  //
+  // If `abort_value` is notified, returns early; only the positions in the
+  // lines that have already been examined are returned.
+  static std::vector<language::text::LineColumn> Search(
+      const Snapshot& snapshot, const Query& query,
+      const language::lazy_string::Regex& pattern,
+      const language::text::LineSequence& contents,
+      const futures::DeleteNotification::Value& abort_value);
+
+  // Like `Search`, but returns std::nullopt (without examining any lines) if
+  // the index is cold: if it would need to examine many lines (e.g., because
+  // the query changed or because it hasn't been filled yet), if another search
+  // is updating it, or if `snapshot` is outdated.
+  //
+  // Callers should fall back to a search that doesn't use the index (and,
+  // perhaps, fill it by calling `Search` in a background thread).
+  static std::optional<std::vector<language::text::LineColumn>> SearchIfWarm(
+      const Snapshot& snapshot, const Query& query,
+      const language::lazy_string::Regex& pattern,
+      const language::text::LineSequence& contents,
+      const futures::DeleteNotification::Value& abort_value);
+
+ private:
+  friend SearchIndexMutableLineSequenceObserver;
+
+  struct LinesInserted {
+    language::text::LineNumber position;
+    language::text::LineNumberDelta size;
+  };
+
+  struct LinesErased {
+    language::text::LineNumber position;
+    language::text::LineNumberDelta size;
+  };
+
+  struct LineChanged {
+    language::text::LineNumber position;
+  };
+
+  // All lines should be considered stale. Represents all the changes in the
+  // range [`first_change`, `last_change`] (which have been dropped).
+  struct AllLinesChanged {
+    size_t first_change;
+    size_t last_change;
+  };
+
+  using Change =
+      std::variant<LinesInserted, LinesErased, LineChanged, AllLinesChanged>;
+
+  // Changes received through the observer. This is kept separately from
+  // `Data`, so that the observer doesn't block while a search is running.
+  struct PendingChanges {
+    // Total number of changes received.
+    size_t changes = 0;
+
+    // The changes that haven't yet been applied, along with the value of
+    // `changes` at the time they were received.
+    std::vector<std::pair<size_t, Change>> entries = {};
+  };
+
+  struct Data {
+    // Number of changes reflected in the fields below.
+    size_t applied_changes = 0;
+
+    std::optional<Query> query = std::nullopt;
+    std::optional<language::lazy_string::Regex> pattern = std::nullopt;
+
+    // The number of lines in the contents after `applied_changes`.
+    language::text::LineNumberDelta lines = language::text::LineNumberDelta();
+
+    // The columns that match `pattern` in all lines with matches. Entries for
+    // stale lines may be outdated.
+    std::map<language::text::LineNumber,
+             std::vector<language::lazy_string::ColumnNumber>>
+        matches = {};
+
+    // Lines that need to be examined.
+    std::set<language::text::LineNumber> stale_lines = {};
+
+    // All lines at or after this position need to be examined.
+    language::text::LineNumber stale_suffix = language::text::LineNumber();
+  };
+
+  // Brings `data` up to date with `snapshot` and `query`, without examining
+  // any lines. Returns false if `snapshot` is outdated.
+  static bool Update(Data& data, const Snapshot& snapshot, const Query& query,
+                     const language::lazy_string::Regex& pattern,
+                     const language::text::LineSequence& contents);
+  // Examines the stale lines (until `abort_value` is notified).
+  static void ExamineStaleLines(
+      Data& data, const language::text::LineSequence& contents,
+      const futures::DeleteNotification::Value& abort_value);
+
+  void AddChange(Change change);
+  // Removes and returns the pending changes received before `changes`.
+  std::vector<Change> TakePendingChanges(size_t changes);
+
+  static void Apply(Data& data, const Change& change);
+  static void ResetQuery(Data& data, Query query,
+                         language::lazy_string::Regex pattern);
+  static void UpdateLinesCount(Data& data,
+                               language::text::LineNumberDelta lines);
+  static bool IsStale(const Data& data, language::text::LineNumber line);
+  static size_t StaleLinesCount(const Data& data);
+  static std::vector<language::text::LineColumn> Matches(const Data& data);
+
+  concurrent::Protected<PendingChanges> pending_changes_;
+  concurrent::Protected<Data> data_;
+
+  // Number of calls to `Search` that are running (or waiting for `data_`).
+  std::atomic<size_t> running_searches_ = 0;
+};
+}  // namespace afc::editor
+
+#endif  // __AFC_EDITOR_SEARCH_INDEX_H__
@@ -4,10 +4,12 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <utility>
 
 extern "C" {
@@ -90,12 +92,13 @@ ValueOrError<Path> CreateFifo(std::optional<Path> input_path) {
   }
 }
 
-// Sends an `editor.ConnectTo(input_path)` command to the server in `server_fd`.
-PossibleError SendPathToServer(FileDescriptor server_fd,
+// Sends a command to the server in `server_fd` that calls `function` with
+// `input_path`.
+PossibleError SendPathToServer(FileDescriptor server_fd, LazyString function,
                                const Path& input_path) {
   LOG(INFO) << "Sending path to server: " << input_path;
   LazyString command =
-      LazyString{L"editor.ConnectTo("} +
+      function + LazyString{L"("} +
       ToLazyString(
           EscapedString::FromString(input_path.read()).CppRepresentation()) +
       LazyString{L");\n"};
@@ -156,7 +159,10 @@ ValueOrError<FileDescriptor> SyncConnectToParentServer() {
   return SyncConnectToServer(path);
 }
 
-ValueOrError<FileDescriptor> SyncConnectToServer(const Path& path) {
+namespace {
+// Creates a private fifo and asks the server in `path` to call `function` with
+// its path. Returns the path of the fifo.
+ValueOrError<Path> SyncSendFifoToServer(const Path& path, LazyString function) {
   LOG(INFO) << "Connecting to server: " << path.read();
   DECLARE_OR_RETURN(
       FileDescriptor server_fd,
@@ -176,9 +182,14 @@ ValueOrError<FileDescriptor> SyncConnectToServer(const Path& path) {
       AugmentError(
           LazyString{L"Unable to create fifo for communication with server"},
           CreateFifo({})));
-  RETURN_IF_ERROR(SendPathToServer(server_fd, private_fifo));
-  fd_deleter = nullptr;
+  RETURN_IF_ERROR(SendPathToServer(server_fd, function, private_fifo));
+  return private_fifo;
+}
+}  // namespace
 
+ValueOrError<FileDescriptor> SyncConnectToServer(const Path& path) {
+  DECLARE_OR_RETURN(Path private_fifo,
+                    SyncSendFifoToServer(path, LazyString{L"editor.ConnectTo"}));
   LOG(INFO) << "Opening private fifo: " << private_fifo.read();
   return AugmentError(
       private_fifo.read() + LazyString{L": open failed: "} +
@@ -186,6 +197,36 @@ ValueOrError<FileDescriptor> SyncConnectToServer(const Path& path) {
       FileDescriptor::New(open(private_fifo.ToBytes().c_str(), O_RDWR)));
 }
 
+ValueOrError<FileDescriptor> SyncConnectScreenToServer(const Path& path) {
+  static constexpr auto kAcceptTimeout = std::chrono::seconds(2);
+  DECLARE_OR_RETURN(
+      Path private_fifo,
+      SyncSendFifoToServer(path, LazyString{L"ReceiveRemoteScreen"}));
+  // The server accepts the protocol by opening the fifo for reading (which it
+  // only does if it successfully evaluates `ReceiveRemoteScreen`). Until then,
+  // opening it for writing (without blocking) fails with ENXIO.
+  LOG(INFO) << "Waiting for server to open private fifo: "
+            << private_fifo.read();
+  const auto deadline = std::chrono::steady_clock::now() + kAcceptTimeout;
+  while (true) {
+    int fd = open(private_fifo.ToBytes().c_str(), O_WRONLY | O_NONBLOCK);
+    if (fd != -1) {
+      // Writes block (rather than fail) when the fifo is full.
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+      return FileDescriptor(fd);
+    }
+    if (errno != ENXIO && errno != EINTR)
+      return Error{private_fifo.read() + LazyString{L": open failed: "} +
+                   LazyString{FromByteString(strerror(errno))}};
+    if (std::chrono::steady_clock::now() >= deadline) {
+      unlink(private_fifo.ToBytes().c_str());
+      return Error{path.read() +
+                   LazyString{L": Server didn't accept the screen protocol."}};
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
 void Daemonize(const std::unordered_set<FileDescriptor>& surviving_fds) {
   pid_t pid;
 
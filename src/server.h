@@ -22,6 +22,15 @@ language::PossibleError SyncSendCommandsToServer(
     language::lazy_string::LazyString commands_to_run);
 language::ValueOrError<infrastructure::FileDescriptor> SyncConnectToServer(
     const infrastructure::Path& address);
+// Like `SyncConnectToServer`, but rather than evaluating the data written to
+// the returned file descriptor, the server decodes it as screen updates (see
+// `infrastructure/screen/screen_protocol.h`) and applies them to its screen.
+//
+// Fails if the server doesn't acknowledge the request (e.g., because it doesn't
+// support the protocol) within a short timeout. Writes to the returned file
+// descriptor block while the server isn't reading.
+language::ValueOrError<infrastructure::FileDescriptor>
+SyncConnectScreenToServer(const infrastructure::Path& address);
 language::ValueOrError<infrastructure::FileDescriptor>
 SyncConnectToParentServer();
 
@@ -8,6 +8,8 @@
 
 #include "src/buffer_output_producer.h"
 #include "src/buffer_variables.h"
+#include "src/concurrent/operation.h"
+#include "src/editor_variables.h"
 #include "src/frame_output_producer.h"
 #include "src/infrastructure/dirname.h"
 #include "src/infrastructure/tracker.h"
@@ -97,12 +99,21 @@ void Terminal::Display(const EditorState& editor_state, Screen& screen,
 
   LineColumnDelta screen_size = screen.size();
   std::optional<gc::Root<OpenBuffer>> buffer = editor_state.current_buffer();
-  LineWithCursor::Generator::Vector lines =
-      GetLines(editor_state.buffer_tree(), editor_state.status(),
-               editor_state.modifiers(), editor_state.current_buffer(), screen);
+  LineWithCursor::Generator::Vector lines = [&] {
+    TRACK_OPERATION(Terminal_Display_GetLines);
+    return GetLines(editor_state.buffer_tree(), editor_state.status(),
+                    editor_state.modifiers(), editor_state.current_buffer(),
+                    screen);
+  }();
   CHECK_EQ(lines.size(), screen_size.line);
-  for (LineNumber line; line.ToDelta() < screen_size.line; ++line)
-    WriteLine(screen, line, lines.lines[line.read()]);
+  if (editor_state.Read(editor_variables::parallel_line_generation))
+    GenerateConcurrently(editor_state.thread_pool().thread_pool().value(),
+                         lines.lines, screen_size.column);
+  {
+    TRACK_OPERATION(Terminal_Display_WriteLines);
+    for (LineNumber line; line.ToDelta() < screen_size.line; ++line)
+      WriteLine(screen, line, lines.lines[line.read()]);
+  }
 
   if (editor_state.status().GetType() == Status::Type::kPrompt ||
       (buffer.has_value() &&
@@ -126,6 +137,41 @@ void FlushModifiers(Screen& screen, const LineModifierSet& modifiers) {
   }
 }
 
+void Terminal::GenerateConcurrently(
+    concurrent::ThreadPool& thread_pool,
+    std::vector<LineWithCursor::Generator>& lines, ColumnNumberDelta width) {
+  TRACK_OPERATION(Terminal_Display_GenerateConcurrently);
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < lines.size(); i++)
+    if (const std::optional<size_t>& hash = lines[i].inputs_hash;
+        hash.has_value() &&
+        (i >= hashes_current_lines_.size() ||
+         hashes_current_lines_[i] != hash) &&
+        !lines_cache_.Contains(hash.value()))
+      indices.push_back(i);
+  if (indices.size() < 2) return;
+
+  std::vector<std::optional<LineDrawer>> drawers(indices.size());
+  {
+    concurrent::Operation operation(thread_pool);
+    for (size_t i = 0; i < indices.size(); i++)
+      operation.Add(
+          [&generator = lines[indices[i]], &drawer = drawers[i], width] {
+            LineWithCursor line_with_cursor = generator.generate();
+            drawer = GetLineDrawer(line_with_cursor, width);
+            // In case the drawer gets evicted from `lines_cache_` before
+            // `WriteLine` gets to it.
+            generator.generate = [line_with_cursor] {
+              return line_with_cursor;
+            };
+          });
+  }  // Blocks until all lines have been generated.
+
+  for (size_t i = 0; i < indices.size(); i++)
+    lines_cache_.Get(lines[indices[i]].inputs_hash.value(),
+                     [&drawer = drawers[i]] { return std::move(*drawer); });
+}
+
 void Terminal::WriteLine(Screen& screen, LineNumber line,
                          LineWithCursor::Generator generator) {
   TRACK_OPERATION(Terminal_WriteLine);
@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 
+#include "src/concurrent/thread_pool.h"
 #include "src/editor.h"
 #include "src/infrastructure/screen/screen.h"
 #include "src/line_with_cursor.h"
@@ -32,6 +33,14 @@ class Terminal {
     std::optional<language::lazy_string::ColumnNumber> cursor;
   };
 
+  // Runs (in `thread_pool`) the generators in `lines` that will need to be
+  // drawn and that only depend on immutable inputs (i.e., that have an
+  // `inputs_hash`), adding their drawers to `lines_cache_`. Blocks until they
+  // are all done.
+  void GenerateConcurrently(concurrent::ThreadPool& thread_pool,
+                            std::vector<LineWithCursor::Generator>& lines,
+                            language::lazy_string::ColumnNumberDelta width);
+
   void WriteLine(infrastructure::screen::Screen& screen,
                  language::text::LineNumber line,
                  LineWithCursor::Generator line_with_cursor);
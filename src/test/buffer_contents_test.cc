@@ -197,11 +197,15 @@ class TestObserver : public afc::language::text::MutableLineSequenceObserver {
   struct MessageInsertedCharacter {
     LineColumn position;
   };
+  struct MessageInsertedCharacters {
+    std::vector<LineColumn> positions;
+    ColumnNumberDelta amount;
+  };
   using Message =
       std::variant<MessageLinesInserted, MessageLinesErased, MessageSplitLine,
                    MessageFoldedLine, MessageSorted, MessageAppendedToLine,
                    MessageDeletedCharacters, MessageSetCharacter,
-                   MessageInsertedCharacter>;
+                   MessageInsertedCharacter, MessageInsertedCharacters>;
 
   TestObserver(std::vector<Message>& messages) : messages_(messages) {}
 
@@ -233,6 +237,11 @@ class TestObserver : public afc::language::text::MutableLineSequenceObserver {
   void InsertedCharacter(LineColumn position) override {
     messages_.push_back(MessageInsertedCharacter{.position = position});
   }
+  void InsertedCharacters(const std::vector<LineColumn>& positions,
+                          ColumnNumberDelta amount) override {
+    messages_.push_back(
+        MessageInsertedCharacters{.positions = positions, .amount = amount});
+  }
 
  private:
   std::vector<Message>& messages_;
@@ -255,6 +264,17 @@ void TestCursorsMove() {
   CHECK_EQ(messages.size(), 1ul);
   CHECK_EQ(std::get<TestObserver::MessageSetCharacter>(messages[0]).position,
            LineColumn(LineNumber(0), ColumnNumber(2)));
+  messages.clear();
+
+  std::vector<LineColumn> positions = {
+      LineColumn(LineNumber(0), ColumnNumber(1)),
+      LineColumn(LineNumber(0), ColumnNumber(5))};
+  contents.InsertInPositions(positions, Line{SingleLine{LazyString{L"xy"}}});
+  CHECK_EQ(messages.size(), 1ul);
+  const auto& inserted =
+      std::get<TestObserver::MessageInsertedCharacters>(messages[0]);
+  CHECK(inserted.positions == positions);
+  CHECK_EQ(inserted.amount, ColumnNumberDelta(2));
 }
 }  // namespace
 
@@ -9,6 +9,7 @@
 #include "src/language/safe_types.h"
 #include "src/language/text/line_sequence.h"
 #include "src/modifiers.h"
+#include "src/transformation_delete.h"
 #include "src/transformation_input.h"
 #include "src/transformation_result.h"
 #include "src/vm/environment.h"
@@ -43,6 +44,10 @@ struct Insert {
   std::optional<language::text::LineColumn> position = std::nullopt;
 };
 
+// Returns the options to delete `repetitions` characters inserted by an
+// `Insert` transformation (used to undo it).
+Delete GetCharactersDeleteOptions(size_t repetitions);
+
 void RegisterInsert(language::gc::Pool& pool, vm::Environment& environment);
 futures::Value<Result> ApplyBase(const Insert& parameters, Input input);
 std::wstring ToStringBase(const Insert& v);
@@ -0,0 +1,77 @@
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include "src/infrastructure/time.h"
+#include "src/language/error/value_or_error.h"
+#include "src/language/gc.h"
+#include "src/language/lazy_string/lazy_string.h"
+#include "src/language/once_only_function.h"
+#include "src/tests/benchmarks.h"
+#include "src/vm/default_environment.h"
+#include "src/vm/environment.h"
+#include "src/vm/expression.h"
+#include "src/vm/value.h"
+#include "src/vm/vm.h"
+
+namespace gc = afc::language::gc;
+
+using afc::infrastructure::Now;
+using afc::infrastructure::SecondsBetween;
+using afc::language::OnceOnlyFunction;
+using afc::language::ValueOrDie;
+using afc::language::lazy_string::LazyString;
+using afc::tests::BenchmarkName;
+
+namespace afc::vm {
+namespace {
+// Compiles and evaluates `code`. Returns the time spent evaluating it (which
+// excludes compilation).
+double BenchmarkEvaluation(std::wstring code, int64_t expected_output) {
+  gc::Pool pool({});
+  gc::Root<Environment> environment = NewDefaultEnvironment(pool);
+  gc::Root<Expression> expression =
+      ValueOrDie(CompileString(LazyString{std::move(code)}, environment.ptr()));
+
+  // Without a yield callback, the evaluation of a loop would recurse once per
+  // iteration; we use one to keep the depth of the stack bounded.
+  std::vector<OnceOnlyFunction<void()>> pending;
+  auto start = Now();
+  futures::ValueOrError<gc::Root<Value>> output =
+      Evaluate(expression.ptr(), environment.ptr(),
+               [&pending](OnceOnlyFunction<void()> callback) {
+                 pending.push_back(std::move(callback));
+               });
+  while (!pending.empty()) {
+    OnceOnlyFunction<void()> callback = std::move(pending.back());
+    pending.pop_back();
+    std::move(callback)();
+  }
+  double seconds = SecondsBetween(start, Now());
+  CHECK_EQ(ValueOrDie(ValueOrDie(output.Get().value()).ptr()->get_number()
+                          .ToInt64()),
+           expected_output);
+  return seconds;
+}
+
+bool counting_loop_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"VM::CountingLoop")},
+    [](int elements) {
+      return BenchmarkEvaluation(
+          L"number i = 0; while (i < " + std::to_wstring(elements) +
+              L") { i = i + 1; } i;",
+          elements);
+    });
+
+bool accumulating_loop_benchmark = tests::RegisterBenchmark(
+    BenchmarkName{NON_EMPTY_SINGLE_LINE_CONSTANT(L"VM::AccumulatingLoop")},
+    [](int elements) {
+      return BenchmarkEvaluation(
+          L"number total = 0; for (number i = 0; i < " +
+              std::to_wstring(elements) + L"; i++) { total = total + i * 2; } "
+              L"total;",
+          static_cast<int64_t>(elements) * (elements - 1));
+    });
+}  // namespace
+}  // namespace afc::vm